@@ -0,0 +1,327 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "harness.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+#  include <windows.h>
+#elif defined(HUMMSTRUMM_ENGINE_PLATFORM_GNULINUX)
+#  include <sched.h>
+#endif
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace benchmark {
+
+namespace detail {
+
+const void *volatile sink;
+
+}
+
+namespace {
+
+int
+usage ()
+{
+  cerr << "Usage: " << "bench_NAME [--filter TEXT] [--clock CLOCK] "
+       << "[--warm-up MS]\n"
+       << "                  [--sample-time MS] [--samples N] "
+       << "[--processor N]\n"
+       << "                  [--output FILE] [--baseline FILE] "
+       << "[--threshold PERCENT]\n"
+       << "CLOCK is steady, highresolution, or tsc.  --processor -1 doesn't "
+       << "pin the thread.\n";
+  return EXIT_FAILURE;
+}
+
+// Returns the value of a "key":value pair in a line of JSON, or an empty
+// string.  This only reads the JSON that WriteResults() writes.
+string
+findValue (const string &line, const string &key)
+{
+  string::size_type begin = line.find ("\"" + key + "\":");
+  if (begin == string::npos)
+    return "";
+  begin += key.size () + 3;
+  if (begin < line.size () && line[begin] == '"')
+    return line.substr (begin + 1, line.find ('"', begin + 1) - begin - 1);
+  return line.substr (begin, line.find_first_of (",}", begin) - begin);
+}
+
+}
+
+Registration::Registration (const char *name, Function function)
+{
+  Benchmark benchmark = { name, function };
+  GetBenchmarks ().push_back (benchmark);
+}
+
+NullBackend::NullBackend (debug::logging::Level levels)
+  : Backend (levels),
+    count (0)
+{
+}
+
+void
+NullBackend::operator() (const debug::logging::Record &record)
+{
+  if ((record.level & acceptLevels) != debug::logging::Level::none)
+    ++count;
+}
+
+Options::Options ()
+  : filter (),
+    clock ("steady"),
+    warmUp (chrono::milliseconds (100)),
+    sampleTime (chrono::milliseconds (10)),
+    samples (30),
+    processor (-1),
+    output (),
+    baseline (),
+    threshold (0.05)
+{
+}
+
+vector<Benchmark> &
+GetBenchmarks ()
+{
+  // Benchmarks register before main() runs, in whatever order their files are
+  // initialized in, so the list has to be made on first use.
+  static vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+bool
+ParseOptions (int argc, char **argv, Options &options)
+{
+  bool pin = true;
+  for (int i = 1; i < argc; ++i)
+    {
+      string option = argv[i];
+      if (i + 1 == argc)
+        return false;
+      string value = argv[++i];
+      if (option == "--filter")
+        options.filter = value;
+      else if (option == "--clock")
+        options.clock = value;
+      else if (option == "--warm-up")
+        options.warmUp = chrono::milliseconds (atol (value.c_str ()));
+      else if (option == "--sample-time")
+        options.sampleTime = chrono::milliseconds (atol (value.c_str ()));
+      else if (option == "--samples")
+        options.samples = strtoul (value.c_str (), nullptr, 10);
+      else if (option == "--processor")
+        {
+          options.processor = atoi (value.c_str ());
+          pin = options.processor >= 0;
+        }
+      else if (option == "--output")
+        options.output = value;
+      else if (option == "--baseline")
+        options.baseline = value;
+      else if (option == "--threshold")
+        options.threshold = atof (value.c_str ()) / 100;
+      else
+        return false;
+    }
+  // By default, stay on the processor we started on.  If we can't be pinned,
+  // don't say we were.
+  if (pin)
+    options.processor = PinToProcessor (options.processor);
+  return options.samples >= 2 &&
+    options.sampleTime > chrono::nanoseconds::zero ();
+}
+
+int
+PinToProcessor (int processor)
+{
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  if (processor < 0)
+    processor = static_cast<int> (GetCurrentProcessorNumber ());
+  if (processor >= 64 ||
+      SetThreadAffinityMask (GetCurrentThread (),
+                             DWORD_PTR (1) << processor) == 0)
+    return -1;
+  return processor;
+#elif defined(HUMMSTRUMM_ENGINE_PLATFORM_GNULINUX)
+  if (processor < 0)
+    processor = sched_getcpu ();
+  if (processor < 0 || processor >= CPU_SETSIZE)
+    return -1;
+  cpu_set_t processors;
+  CPU_ZERO (&processors);
+  CPU_SET (processor, &processors);
+  if (sched_setaffinity (0, sizeof processors, &processors) != 0)
+    return -1;
+  return processor;
+#else
+  // We don't know how to pin threads here.
+  (void) processor;
+  return -1;
+#endif
+}
+
+double
+GetConfidenceFactor (uint64_t samples)
+{
+  // Two-sided 95% quantiles of Student's t distribution, by degrees of
+  // freedom.  Past 30, the normal distribution is close enough.
+  static const double factors[] = {
+    0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+    2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+    2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+    2.042
+  };
+  if (samples < 2)
+    return 0;
+  uint64_t freedom = samples - 1;
+  if (freedom <= 30)
+    return factors[freedom];
+  return 1.960;
+}
+
+bool
+WriteResults (const string &file, const vector<Result> &results)
+{
+  ofstream out (file.c_str ());
+  out.precision (17);
+  out << "[\n";
+  for (size_t i = 0; i < results.size (); ++i)
+    {
+      const Result &result = results[i];
+      out << "{\"engine\":\"" << HUMMSTRUMM_ENGINE_VERSION
+          << "\",\"name\":\"" << result.name
+          << "\",\"iterations\":" << result.iterations
+          << ",\"samples\":" << result.samples
+          << ",\"mean\":" << result.mean
+          << ",\"interval\":" << result.interval
+          << ",\"deviation\":" << result.deviation
+          << ",\"median\":" << result.median
+          << ",\"min\":" << result.min
+          << ",\"max\":" << result.max << "}"
+          << (i + 1 < results.size () ? ",\n" : "\n");
+    }
+  out << "]\n";
+  return static_cast<bool> (out);
+}
+
+bool
+ReadResults (const string &file, vector<Result> &results)
+{
+  ifstream in (file.c_str ());
+  if (!in)
+    return false;
+  string line;
+  while (getline (in, line))
+    {
+      Result result;
+      result.name = findValue (line, "name");
+      if (result.name.empty ())
+        continue;
+      result.iterations = strtoull (findValue (line, "iterations").c_str (),
+                                    nullptr, 10);
+      result.samples = strtoull (findValue (line, "samples").c_str (),
+                                 nullptr, 10);
+      result.mean = atof (findValue (line, "mean").c_str ());
+      result.interval = atof (findValue (line, "interval").c_str ());
+      result.deviation = atof (findValue (line, "deviation").c_str ());
+      result.median = atof (findValue (line, "median").c_str ());
+      result.min = atof (findValue (line, "min").c_str ());
+      result.max = atof (findValue (line, "max").c_str ());
+      results.push_back (result);
+    }
+  return true;
+}
+
+unsigned
+CompareResults (ostream &out, const vector<Result> &results,
+                const vector<Result> &baseline, double threshold)
+{
+  unsigned regressions = 0;
+  for (auto &result : results)
+    for (auto &old : baseline)
+      {
+        if (old.name != result.name || old.mean <= 0)
+          continue;
+        double change = (result.mean - old.mean) / old.mean;
+        // Only call it a change if the intervals don't overlap, so noise
+        // isn't flagged.
+        bool slower = change > threshold &&
+          result.mean - result.interval > old.mean + old.interval;
+        bool faster = change < -threshold &&
+          result.mean + result.interval < old.mean - old.interval;
+        if (slower)
+          ++regressions;
+        if (slower || faster)
+          out << "# " << result.name << ": " << (change > 0 ? "+" : "")
+              << change * 100 << "% against the baseline"
+              << (slower ? " (regression)" : "") << "\n";
+      }
+  out << "# " << regressions << " regression(s)" << endl;
+  return regressions;
+}
+
+int
+Main (int argc, char **argv)
+{
+  Options options;
+  if (!ParseOptions (argc, argv, options))
+    return usage ();
+
+  cout << "# engine " << HUMMSTRUMM_ENGINE_VERSION << ", clock "
+       << options.clock;
+  if (options.clock == "tsc")
+    {
+      system::Processors processors;
+      debug::profiling::TscClock::Calibrate (processors);
+      if (debug::profiling::TscClock::GetSource () ==
+          debug::profiling::TscSource::steadyClock)
+        cout << " (falling back to steady_clock)";
+      else
+        cout << " (" << debug::profiling::TscClock::GetTicksPerSecond () / 1e6
+             << " MHz)";
+    }
+  if (options.processor >= 0)
+    cout << ", pinned to processor " << options.processor;
+  cout << ", " << options.samples << " samples of at least "
+       << chrono::duration_cast<chrono::milliseconds> (options.sampleTime)
+          .count ()
+       << " ms\n";
+
+  if (options.clock == "steady")
+    return Run<chrono::steady_clock> (options);
+  if (options.clock == "highresolution")
+    return Run<chrono::high_resolution_clock> (options);
+  if (options.clock == "tsc")
+    return Run<debug::profiling::TscClock> (options);
+  return usage ();
+}
+
+
+}
+}
@@ -0,0 +1,356 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines the microbenchmark harness that the benchmarks in this directory
+ * can share.  A benchmark is a function that runs the code to measure a given
+ * number of times:
+ *
+ * @code
+ * HUMMSTRUMM_ENGINE_BENCHMARK (MatrixProduct)
+ * {
+ *   Eigen::Matrix4f a = Eigen::Matrix4f::Random ();
+ *   for (std::size_t i = 0; i < iterations; ++i)
+ *     benchmark::Keep (a = a * a);
+ * }
+ *
+ * int
+ * main (int argc, char **argv)
+ * {
+ *   return benchmark::Main (argc, argv);
+ * }
+ * @endcode
+ *
+ * For each benchmark, the harness runs the function until it is warm and
+ * finds how many iterations make a sample last long enough to time well.  It
+ * then times a number of samples with a debug::Profiler, on a thread pinned to
+ * one processor, and prints the mean time of an iteration with its 95%
+ * confidence interval.  The results can be saved as JSON and compared with a
+ * saved baseline, which flags the benchmarks that got slower.
+ *
+ * @file   harness.hpp
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_BENCHMARKS_HARNESS
+#define HUMMSTRUMM_ENGINE_BENCHMARKS_HARNESS
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "hummstrummengine.hpp"
+
+namespace hummstrummengine {
+namespace benchmark {
+
+/// Runs the code being measured the given number of times.
+typedef void (*Function) (std::size_t iterations);
+
+/**
+ * A registered benchmark.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct Benchmark
+{
+    const char *name;           ///< The name of the benchmark.
+    Function function;          ///< The code to measure.
+};
+
+/**
+ * Registers a benchmark when it is constructed.  Use
+ * HUMMSTRUMM_ENGINE_BENCHMARK() instead of constructing one.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct Registration
+{
+    /**
+     * Registers a benchmark.
+     *
+     * @since  0.7
+     *
+     * @param [in] name The name of the benchmark.
+     * @param [in] function The code to measure.
+     */
+    Registration (const char *name, Function function);
+};
+
+/**
+ * @def HUMMSTRUMM_ENGINE_BENCHMARK
+ *
+ * Defines and registers a benchmark.  The body that follows is a function
+ * with a @c std::size_t parameter named @c iterations , and must run the code
+ * being measured that many times.
+ *
+ * @since  0.7
+ *
+ * @param [in] name The name of the benchmark, which must be an identifier.
+ */
+#define HUMMSTRUMM_ENGINE_BENCHMARK(name)                             \
+  static void name (std::size_t iterations);                          \
+  static hummstrummengine::benchmark::Registration                    \
+  name##Registration (#name, name);                                   \
+  static void name (std::size_t iterations)
+
+/**
+ * Keeps the compiler from throwing away the computation of a value that is
+ * never used.
+ *
+ * @since  0.7
+ *
+ * @param [in] value The value.
+ */
+template <typename T>
+inline void Keep (const T &value);
+
+/**
+ * A log backend that only counts the messages it accepts, so that logging
+ * benchmarks measure the cost of getting a message to a backend.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct NullBackend : public debug::logging::Backend
+{
+    /**
+     * Constructs a backend that accepts the given levels.
+     *
+     * @since  0.7
+     *
+     * @param [in] levels The levels of messages to count.
+     */
+    explicit NullBackend (
+      debug::logging::Level levels = debug::logging::Level::all);
+
+    /**
+     * Counts a message, if its level is accepted.
+     *
+     * @since  0.7
+     *
+     * @param [in] record The message.
+     */
+    virtual void operator() (const debug::logging::Record &record) override;
+
+    /// How many messages were accepted.
+    unsigned long count;
+};
+
+/**
+ * How to run the benchmarks.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct Options
+{
+    /**
+     * Constructs the default options.
+     *
+     * @since  0.7
+     */
+    Options ();
+
+    /// Only run benchmarks whose names contain this.
+    std::string filter;
+    /// Which clock to time with: steady, highresolution, or tsc.
+    std::string clock;
+    /// How long to run each benchmark before timing it.
+    std::chrono::nanoseconds warmUp;
+    /// How long each sample should take, at least.
+    std::chrono::nanoseconds sampleTime;
+    /// How many samples to time.
+    unsigned samples;
+    /// The processor to pin to, or -1 to not pin.  After ParseOptions(), the
+    /// processor the thread was pinned to, or -1 if it wasn't.
+    int processor;
+    /// The file to save the results in, if any.
+    std::string output;
+    /// The file with the results to compare with, if any.
+    std::string baseline;
+    /// How much slower than the baseline is a regression, as a fraction.
+    double threshold;
+};
+
+/**
+ * What a benchmark measured.  Times are of one iteration, in nanoseconds.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct Result
+{
+    std::string name;           ///< The name of the benchmark.
+    std::uint64_t iterations;   ///< The iterations in each sample.
+    std::uint64_t samples;      ///< The number of samples.
+    double mean;                ///< The mean time.
+    double interval;            ///< Half the 95% confidence interval.
+    double deviation;           ///< The standard deviation.
+    double median;              ///< The median time.
+    double min;                 ///< The shortest time.
+    double max;                 ///< The longest time.
+};
+
+/**
+ * Returns every registered benchmark.
+ *
+ * @since  0.7
+ *
+ * @return The benchmarks, in the order they were registered.
+ */
+std::vector<Benchmark> &GetBenchmarks ();
+
+/**
+ * Parses the command line.
+ *
+ * @since  0.7
+ *
+ * @param [in] argc The number of arguments.
+ * @param [in] argv The arguments.
+ * @param [out] options The options the arguments give.
+ *
+ * @return Whether the arguments made sense.
+ */
+bool ParseOptions (int argc, char **argv, Options &options);
+
+/**
+ * Pins the calling thread to a processor.
+ *
+ * @since  0.7
+ *
+ * @param [in] processor The processor, or -1 for the one the thread is on.
+ *
+ * @return The processor, or -1 if the thread couldn't be pinned.
+ */
+int PinToProcessor (int processor);
+
+/**
+ * Returns the factor of Student's t distribution for a two-sided 95%
+ * confidence interval.
+ *
+ * @since  0.7
+ *
+ * @param [in] samples The number of samples.
+ *
+ * @return The factor to multiply the standard error by.
+ */
+double GetConfidenceFactor (std::uint64_t samples);
+
+/**
+ * Saves results as JSON: an array with one object per line.
+ *
+ * @since  0.7
+ *
+ * @param [in] file The file.
+ * @param [in] results The results.
+ *
+ * @return Whether the file could be written.
+ */
+bool WriteResults (const std::string &file,
+                   const std::vector<Result> &results);
+
+/**
+ * Loads results saved by WriteResults().
+ *
+ * @since  0.7
+ *
+ * @param [in] file The file.
+ * @param [out] results The results.
+ *
+ * @return Whether the file could be read.
+ */
+bool ReadResults (const std::string &file, std::vector<Result> &results);
+
+/**
+ * Compares results with a baseline, and prints the benchmarks that got
+ * slower or faster.  A benchmark got slower if its mean grew by more than the
+ * threshold and its confidence interval doesn't overlap the baseline's.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] out The stream to print to.
+ * @param [in] results The new results.
+ * @param [in] baseline The results to compare with.
+ * @param [in] threshold How much slower is a regression, as a fraction.
+ *
+ * @return The number of regressions.
+ */
+unsigned CompareResults (std::ostream &out,
+                         const std::vector<Result> &results,
+                         const std::vector<Result> &baseline,
+                         double threshold);
+
+/**
+ * Measures one benchmark: warms it up, finds how many iterations a sample
+ * needs, and times the samples with a debug::Profiler.
+ *
+ * @since  0.7
+ *
+ * @tparam ClockT The clock to time with, as for debug::Profiler.
+ *
+ * @param [in] benchmark The benchmark.
+ * @param [in] options How to run it.
+ *
+ * @return What was measured.
+ */
+template <typename ClockT>
+Result Measure (const Benchmark &benchmark, const Options &options);
+
+/**
+ * Runs every benchmark that passes the filter, prints the results, and saves
+ * and compares them as the options say.
+ *
+ * @since  0.7
+ *
+ * @tparam ClockT The clock to time with, as for debug::Profiler.
+ * @tparam DurationT The unit to print times in, as for debug::Profiler.
+ *
+ * @param [in] options How to run the benchmarks.
+ *
+ * @return @c EXIT_SUCCESS , or @c EXIT_FAILURE if a benchmark regressed or a
+ * file couldn't be used.
+ */
+template <typename ClockT,
+          typename DurationT = std::chrono::nanoseconds>
+int Run (const Options &options);
+
+/**
+ * Parses the command line and runs the benchmarks with the clock it names.
+ * Call this from @c main() .
+ *
+ * @since  0.7
+ *
+ * @param [in] argc The number of arguments.
+ * @param [in] argv The arguments.
+ *
+ * @return What @c main() should return.
+ */
+int Main (int argc, char **argv);
+
+
+}
+}
+
+#include "harness.inl"
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_BENCHMARKS_HARNESS
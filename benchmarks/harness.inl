@@ -0,0 +1,184 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_BENCHMARKS_HARNESS_INL
+#define HUMMSTRUMM_ENGINE_BENCHMARKS_HARNESS_INL
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef HUMMSTRUMM_ENGINE_COMPILER_MSVC
+#  include <intrin.h>
+#endif
+
+namespace hummstrummengine {
+namespace benchmark {
+
+namespace detail {
+
+/// Where Keep() puts values on compilers without inline assembly.
+extern const void *volatile sink;
+
+}
+
+template <typename T>
+void
+Keep (const T &value)
+{
+#ifdef HUMMSTRUMM_ENGINE_COMPILER_MSVC
+  detail::sink = &value;
+  _ReadWriteBarrier ();
+#else
+  // Pretend to read the value and write all of memory.
+  asm volatile ("" : : "r" (&value) : "memory");
+#endif
+}
+
+template <typename ClockT>
+Result
+Measure (const Benchmark &benchmark, const Options &options)
+{
+  typedef std::chrono::duration<double, std::nano> Nanoseconds;
+  typedef debug::HistogramStatistics<typename ClockT::duration> Statistics;
+
+  // Run the benchmark until it is warm, growing the iterations until a sample
+  // lasts long enough that the clock's resolution and the cost of reading it
+  // don't matter.
+  std::size_t iterations = 1;
+  auto warm = ClockT::now () + options.warmUp;
+  for (;;)
+    {
+      auto start = ClockT::now ();
+      benchmark.function (iterations);
+      auto end = ClockT::now ();
+      Nanoseconds elapsed = end - start;
+      if (elapsed >= options.sampleTime)
+        {
+          if (end >= warm)
+            break;
+          continue;
+        }
+      // Aim a little past the sample time, but don't grow more than tenfold
+      // at once, in case the first iterations were slow.
+      double growth = elapsed.count () > 0 ?
+        1.2 * Nanoseconds (options.sampleTime).count () / elapsed.count () :
+        10;
+      growth = std::min (std::max (growth, 2.0), 10.0);
+      iterations = static_cast<std::size_t> (iterations * growth);
+    }
+
+  // Each run of the Profiler is a sample.  It reports nothing; the harness
+  // reads its statistics instead.
+  std::ostream nowhere (nullptr);
+  Statistics statistics;
+  {
+    debug::Profiler<ClockT, std::chrono::nanoseconds, Statistics> profiler (
+      nowhere, debug::ProfilerReport::Quiet ());
+    for (unsigned sample = 0; sample < options.samples; ++sample)
+      {
+        benchmark.function (iterations);
+        profiler.next ();
+      }
+    statistics = profiler.GetStatistics ();
+  }
+
+  Result result;
+  double perIteration = 1.0 / iterations;
+  result.name = benchmark.name;
+  result.iterations = iterations;
+  result.samples = statistics.GetCount ();
+  result.mean = Nanoseconds (statistics.GetMean ()).count () * perIteration;
+  result.deviation =
+    Nanoseconds (statistics.GetStandardDeviation ()).count () * perIteration;
+  result.interval = GetConfidenceFactor (result.samples) * result.deviation /
+    std::sqrt (static_cast<double> (result.samples));
+  result.median =
+    Nanoseconds (statistics.GetPercentile (0.5)).count () * perIteration;
+  result.min = Nanoseconds (statistics.GetMin ()).count () * perIteration;
+  result.max = Nanoseconds (statistics.GetMax ()).count () * perIteration;
+  return result;
+}
+
+template <typename ClockT, typename DurationT>
+int
+Run (const Options &options)
+{
+  // Print times in the unit asked for.
+  typedef std::chrono::duration<double, std::nano> Nanoseconds;
+  typedef std::chrono::duration<double, typename DurationT::period> Unit;
+  const std::string suffix = debug::detail::getDurationSuffix<DurationT> ();
+  auto print = [] (double nanoseconds) {
+    return Unit (Nanoseconds (nanoseconds)).count ();
+  };
+
+  std::cout << std::left << std::setw (32) << "# benchmark" << std::right
+            << std::setw (12) << "iterations" << std::setw (16)
+            << ("mean/" + suffix) << std::setw (14) << "95% CI"
+            << std::setw (14) << "median" << std::setw (14) << "min"
+            << '\n';
+
+  std::vector<Result> results;
+  for (auto &benchmark : GetBenchmarks ())
+    {
+      if (std::string (benchmark.name).find (options.filter) ==
+          std::string::npos)
+        continue;
+      Result result = Measure<ClockT> (benchmark, options);
+      results.push_back (result);
+
+      std::ostringstream interval;
+      interval << std::fixed << std::setprecision (3) << "+-"
+               << print (result.interval);
+      std::cout << std::left << std::setw (32) << result.name << std::right
+                << std::setw (12) << result.iterations << std::fixed
+                << std::setprecision (3) << std::setw (16)
+                << print (result.mean) << std::setw (14) << interval.str ()
+                << std::setw (14) << print (result.median) << std::setw (14)
+                << print (result.min) << std::endl;
+    }
+
+  int status = EXIT_SUCCESS;
+  if (!options.output.empty () && !WriteResults (options.output, results))
+    {
+      std::cerr << "Couldn't write " << options.output << "\n";
+      status = EXIT_FAILURE;
+    }
+  if (!options.baseline.empty ())
+    {
+      std::vector<Result> baseline;
+      if (!ReadResults (options.baseline, baseline))
+        {
+          std::cerr << "Couldn't read " << options.baseline << "\n";
+          status = EXIT_FAILURE;
+        }
+      else if (CompareResults (std::cout, results, baseline,
+                               options.threshold) != 0)
+        status = EXIT_FAILURE;
+    }
+  return status;
+}
+
+
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_BENCHMARKS_HARNESS_INL
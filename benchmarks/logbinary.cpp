@@ -0,0 +1,110 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compares FileBackend, which writes XML, with BinaryFileBackend.  Both get
+// the same records straight from this thread, so only the cost of the backend
+// is measured.  Prints records per second and bytes per record for each.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine;
+
+namespace {
+
+const unsigned RECORDS = 200000;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Result
+{
+    double recordsPerSecond;
+    double bytesPerRecord;
+};
+
+std::streamoff
+fileSize (const char *path)
+{
+  std::ifstream in (path, std::ios_base::in | std::ios_base::binary);
+  in.seekg (0, std::ios_base::end);
+  return in.tellg ();
+}
+
+template <typename BackendT>
+Result
+run (const char *path)
+{
+  std::unique_ptr<BackendT> backend (
+    new BackendT (debug::logging::Level::all, path));
+  std::string message;
+
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < RECORDS; ++i)
+    {
+      message.assign ("Loaded texture ");
+      message += std::to_string (i);
+      message += " in 0.25 ms.";
+      debug::logging::Record record = {
+        std::time (0), __FILE__, __LINE__, debug::logging::Level::info,
+        message.data (), message.size ()
+      };
+      (*backend) (record);
+    }
+  // Count the time it takes to write out what's left, too.
+  backend.reset ();
+  std::chrono::duration<double> elapsed = Clock::now () - start;
+
+  Result result = {
+    RECORDS / elapsed.count (),
+    static_cast<double> (fileSize (path)) / RECORDS
+  };
+  return result;
+}
+
+}
+
+int
+main ()
+{
+  const char *xmlPath = "bench_logbinary.xml";
+  const char *binaryPath = "bench_logbinary.hslog";
+
+  Result xml = run<debug::logging::FileBackend> (xmlPath);
+  Result binary = run<debug::logging::BinaryFileBackend> (binaryPath);
+  std::remove (xmlPath);
+  std::remove (binaryPath);
+
+  std::cout << "# " << RECORDS << " records\n"
+            << std::fixed << std::setprecision (1)
+            << std::setw (8) << "backend" << std::setw (16) << "records/s"
+            << std::setw (16) << "bytes/record" << '\n'
+            << std::setw (8) << "xml" << std::setw (16) << xml.recordsPerSecond
+            << std::setw (16) << xml.bytesPerRecord << '\n'
+            << std::setw (8) << "binary"
+            << std::setw (16) << binary.recordsPerSecond
+            << std::setw (16) << binary.bytesPerRecord << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures how log throughput scales when 1 to 64 threads log at once.  Three
+// ways of logging are compared:
+//
+//   shared     One stream for all threads, locked from the first manipulator
+//              to the flush.  This is how the log used to work.
+//   perthread  The streams from Engine::GetLog(), with synchronous backends.
+//   async      The streams from Engine::GetLog(), with an AsyncQueue.
+//
+// The backend throws every message away, so only the cost of building and
+// handing off messages is measured.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "harness.hpp"
+using namespace hummstrummengine;
+
+namespace {
+
+const unsigned MESSAGES_PER_THREAD = 20000;
+
+void
+logMessages (std::ostream &log, unsigned thread, std::mutex *lock)
+{
+  for (unsigned i = 0; i < MESSAGES_PER_THREAD; ++i)
+    {
+      std::unique_lock<std::mutex> guard;
+      if (lock)
+        guard = std::unique_lock<std::mutex> (*lock);
+      log << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
+          << "Thread " << thread << " sends message " << i
+          << " with value " << 0.5 * i << std::flush;
+    }
+}
+
+// Returns messages per second.
+double
+runShared (unsigned threads)
+{
+  auto backend = std::make_shared<benchmark::NullBackend> ();
+  debug::logging::StreamBuffer buffer ({ backend });
+  std::ostream log (&buffer);
+  std::mutex lock;
+
+  auto start = std::chrono::steady_clock::now ();
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t)
+    workers.emplace_back (logMessages, std::ref (log), t, &lock);
+  for (auto &worker : workers)
+    worker.join ();
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now () - start;
+
+  return threads * MESSAGES_PER_THREAD / elapsed.count ();
+}
+
+// Returns messages per second.
+double
+runPerThread (unsigned threads, bool async)
+{
+  core::Engine::Configuration params;
+  params.logBackends.push_back (std::make_shared<benchmark::NullBackend> ());
+  params.asyncLogging = async;
+  params.asyncLogCapacity = 4096;
+  core::Engine engine (params);
+
+  auto start = std::chrono::steady_clock::now ();
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t)
+    {
+      workers.emplace_back ([&engine, t]() {
+          logMessages (engine.GetLog (), t, nullptr);
+        });
+    }
+  for (auto &worker : workers)
+    worker.join ();
+  // Only count the messages as logged once they've reached the backend.
+  engine.FlushLog ();
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now () - start;
+
+  return threads * MESSAGES_PER_THREAD / elapsed.count ();
+}
+
+}
+
+int
+main ()
+{
+  std::cout << "# " << MESSAGES_PER_THREAD << " messages per thread, "
+            << std::thread::hardware_concurrency () << " hardware threads\n"
+            << "# throughput in messages per second\n"
+            << std::setw (8) << "threads" << std::setw (14) << "shared"
+            << std::setw (14) << "perthread" << std::setw (14) << "async"
+            << std::endl;
+
+  std::cout << std::fixed << std::setprecision (0);
+  for (unsigned threads = 1; threads <= 64; threads *= 2)
+    {
+      std::cout << std::setw (8) << threads
+                << std::setw (14) << runShared (threads)
+                << std::setw (14) << runPerThread (threads, false)
+                << std::setw (14) << runPerThread (threads, true)
+                << std::endl;
+    }
+
+  return EXIT_SUCCESS;
+}
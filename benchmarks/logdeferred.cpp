@@ -0,0 +1,85 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures how long the logging thread spends on one message with the stream
+// operators and with HUMMSTRUMM_ENGINE_LOGF().  Messages go through an
+// AsyncQueue to a backend that throws them away, so with LOGF the formatting
+// happens on the writer thread and isn't counted.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <ostream>
+
+#include "harness.hpp"
+using namespace hummstrummengine;
+
+namespace {
+
+const unsigned MESSAGES = 200000;
+
+typedef std::chrono::steady_clock Clock;
+
+// Returns nanoseconds per message on the logging thread.
+template <typename LogT>
+double
+run (LogT logMessage)
+{
+  auto backend = std::make_shared<benchmark::NullBackend> ();
+  std::unique_ptr<debug::logging::AsyncQueue> queue (
+    new debug::logging::AsyncQueue ({ backend }, 1 << 16,
+                                    debug::logging::OverflowPolicy::block));
+  debug::logging::StreamBuffer buffer ({ backend }, std::move (queue));
+  std::ostream log (&buffer);
+
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < MESSAGES; ++i)
+    logMessage (log, i);
+  std::chrono::duration<double, std::nano> elapsed = Clock::now () - start;
+
+  return elapsed.count () / MESSAGES;
+}
+
+}
+
+int
+main ()
+{
+  double streamed = run ([](std::ostream &log, unsigned i) {
+      log << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
+          << "Entity " << i << " moved to (" << 0.25 * i << ", "
+          << 1.5 * i << ") at speed " << 3.75 << std::flush;
+    });
+  double deferred = run ([](std::ostream &log, unsigned i) {
+      HUMMSTRUMM_ENGINE_LOGF (log, Level::info,
+                              "Entity {} moved to ({}, {}) at speed {}", i,
+                              0.25 * i, 1.5 * i, 3.75);
+    });
+
+  std::cout << "# " << MESSAGES << " messages through an AsyncQueue\n"
+            << "# nanoseconds per message on the logging thread\n"
+            << std::setw (10) << "streamed" << std::setw (10) << "deferred"
+            << std::endl
+            << std::fixed << std::setprecision (1)
+            << std::setw (10) << streamed << std::setw (10) << deferred
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
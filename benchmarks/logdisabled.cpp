@@ -0,0 +1,134 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures what a log statement costs when its level is turned off.  Four
+// loops are compared:
+//
+//   manipulators  SetFile, SetLine, and SetLevel, then the message, as every
+//                 log statement used to be written.  The backend throws the
+//                 message away.
+//   runtime       HUMMSTRUMM_ENGINE_LOG, with the level turned off by
+//                 SetEnabledLevels().
+//   compiletime   HUMMSTRUMM_ENGINE_LOG, with the level below
+//                 HUMMSTRUMM_ENGINE_LOG_MIN_LEVEL.
+//   empty         The loop without any logging.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+#include "harness.hpp"
+using namespace hummstrummengine;
+
+namespace {
+
+const unsigned ITERATIONS = 10000000;
+
+// Keeps the compiler from throwing the loops away.
+volatile unsigned sink;
+
+typedef std::chrono::steady_clock Clock;
+
+double
+nanosecondsPerIteration (Clock::time_point start)
+{
+  std::chrono::duration<double, std::nano> elapsed = Clock::now () - start;
+  return elapsed.count () / ITERATIONS;
+}
+
+double
+runManipulators (std::ostream &log)
+{
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < ITERATIONS; ++i)
+    {
+      log << debug::logging::SetFile (__FILE__)
+          << debug::logging::SetLine (__LINE__)
+          << debug::logging::SetLevel (debug::logging::Level::info)
+          << "Iteration " << i << " with value " << 0.5 * i << std::flush;
+      sink = i;
+    }
+  return nanosecondsPerIteration (start);
+}
+
+double
+runRuntime (std::ostream &log)
+{
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < ITERATIONS; ++i)
+    {
+      HUMMSTRUMM_ENGINE_LOG (log, Level::info)
+        << "Iteration " << i << " with value " << 0.5 * i << std::flush;
+      sink = i;
+    }
+  return nanosecondsPerIteration (start);
+}
+
+// Pretend the engine was configured with MINIMUM_LOG_LEVEL=warning.
+#undef HUMMSTRUMM_ENGINE_LOG_MIN_LEVEL
+#define HUMMSTRUMM_ENGINE_LOG_MIN_LEVEL 4
+
+double
+runCompileTime (std::ostream &log)
+{
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < ITERATIONS; ++i)
+    {
+      HUMMSTRUMM_ENGINE_LOG (log, Level::info)
+        << "Iteration " << i << " with value " << 0.5 * i << std::flush;
+      sink = i;
+    }
+  return nanosecondsPerIteration (start);
+}
+
+double
+runEmpty ()
+{
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < ITERATIONS; ++i)
+    sink = i;
+  return nanosecondsPerIteration (start);
+}
+
+}
+
+int
+main ()
+{
+  std::shared_ptr<debug::logging::Backend> backend =
+    std::make_shared<benchmark::NullBackend> (debug::logging::Level::error);
+  debug::logging::StreamBuffer buffer ({ backend });
+  std::ostream log (&buffer);
+  debug::logging::SetEnabledLevels (backend->GetLevels ());
+
+  std::cout << "# " << ITERATIONS << " disabled Level::info messages\n"
+            << "# nanoseconds per message\n"
+            << std::fixed << std::setprecision (2)
+            << std::setw (14) << "manipulators"
+            << std::setw (14) << runManipulators (log) << '\n'
+            << std::setw (14) << "runtime"
+            << std::setw (14) << runRuntime (log) << '\n'
+            << std::setw (14) << "compiletime"
+            << std::setw (14) << runCompileTime (log) << '\n'
+            << std::setw (14) << "empty"
+            << std::setw (14) << runEmpty () << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,324 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures the throughput and caller-side latency of logging through
+// core::Engine::GetLog() for every backend, with and without an AsyncQueue,
+// from 1 to N threads, and with messages from 16 bytes to 4 KiB.  Each
+// backend is also run once per thread count with the level of the messages
+// turned off, to measure disabled log statements.
+//
+// Every run prints one line of JSON on stdout, so results from different
+// engine versions can be compared by a script:
+//
+//   engine       The engine version.
+//   backend      console, file, binary, rotating, ringbuffer, sharedmemory,
+//                jsonlines, or null (which throws every message away).
+//   mode         sync, async, or disabled.
+//   threads      How many threads logged at once.
+//   size         The length of each message, in bytes.
+//   messages     How many messages were logged in all.
+//   seconds      How long the run took, until the backend had every message.
+//   perSecond    Messages per second, over the whole run.
+//   p50, p99,    The latency of a log statement, as seen by the thread that
+//   p999, max    logs it, in nanoseconds.
+//
+// The console backend writes to stderr, which is sent to the null device.
+// The files are written to the current directory and removed afterwards.
+//
+// Usage: bench_logging [--messages N] [--threads N] [--sizes N,...]
+//                      [--backends NAME,...] [--modes MODE,...]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "harness.hpp"
+using namespace hummstrummengine;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+typedef std::shared_ptr<debug::logging::Backend> BackendPointer;
+
+const char *const FILE_NAME = "bench_logging";
+
+// Returns a new backend of the given kind, or nullptr if there is no such
+// kind.
+BackendPointer
+makeBackend (const std::string &kind, debug::logging::Level levels)
+{
+  using namespace debug::logging;
+  std::string name = FILE_NAME;
+  if (kind == "null")
+    return std::make_shared<benchmark::NullBackend> (levels);
+  if (kind == "console")
+    return std::make_shared<ConsoleBackend> (levels);
+  if (kind == "file")
+    return std::make_shared<FileBackend> (levels, name + ".log");
+  if (kind == "binary")
+    return std::make_shared<BinaryFileBackend> (levels, name + ".hslog");
+  if (kind == "rotating")
+    return std::make_shared<RotatingFileBackend> (levels, name);
+  if (kind == "ringbuffer")
+    return std::make_shared<RingBufferBackend> (levels);
+  if (kind == "sharedmemory")
+    return std::make_shared<SharedMemoryBackend> (levels, "/" + name);
+  if (kind == "jsonlines")
+    return std::make_shared<JsonLinesBackend> (levels, name + ".jsonl");
+  return nullptr;
+}
+
+// Removes the files a backend of the given kind wrote.
+void
+removeFiles (const std::string &kind)
+{
+  std::string name = FILE_NAME;
+  if (kind == "file")
+    std::remove ((name + ".log").c_str ());
+  else if (kind == "binary")
+    std::remove ((name + ".hslog").c_str ());
+  else if (kind == "jsonlines")
+    std::remove ((name + ".jsonl").c_str ());
+  else if (kind == "rotating")
+    for (unsigned i = 0;
+         std::remove ((name + "." + std::to_string (i) + ".log").c_str ()) ==
+           0;
+         ++i)
+      ;
+}
+
+struct Result
+{
+    std::uint64_t messages;
+    double seconds;
+    std::vector<std::uint64_t> latencies;
+};
+
+// Logs messages from one thread, timing each log statement.  Each thread waits
+// for the signal to go, so they start together.
+void
+logMessages (core::Engine &engine, const std::string &message,
+             unsigned messages, std::atomic<unsigned> &ready,
+             std::atomic<bool> &go, std::uint64_t *latencies)
+{
+  std::ostream &log = engine.GetLog ();
+  ready.fetch_add (1);
+  while (!go.load ())
+    std::this_thread::yield ();
+
+  for (unsigned i = 0; i < messages; ++i)
+    {
+      auto start = Clock::now ();
+      HUMMSTRUMM_ENGINE_LOG (log, Level::info) << message << std::flush;
+      auto end = Clock::now ();
+      latencies[i] = static_cast<std::uint64_t> (
+        std::chrono::duration_cast<std::chrono::nanoseconds> (end - start)
+        .count ());
+    }
+}
+
+Result
+run (const std::string &kind, const std::string &mode, unsigned threads,
+     std::size_t size, unsigned messages)
+{
+  // When disabled, the backend only takes errors, and so the engine turns
+  // Level::info off.
+  bool disabled = mode == "disabled";
+  core::Engine::Configuration params;
+  params.logBackends.push_back (
+    makeBackend (kind, disabled ? debug::logging::Level::error :
+                 debug::logging::Level::all));
+  params.asyncLogging = mode == "async";
+  params.asyncLogCapacity = 4096;
+  params.crashLogFile = "";
+
+  Result result;
+  result.messages = static_cast<std::uint64_t> (threads) * messages;
+  result.latencies.resize (result.messages);
+  std::string message (size, 'x');
+
+  {
+    core::Engine engine (params);
+    std::atomic<unsigned> ready (0);
+    std::atomic<bool> go (false);
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t)
+      workers.emplace_back (logMessages, std::ref (engine),
+                            std::cref (message), messages, std::ref (ready),
+                            std::ref (go), &result.latencies[t * messages]);
+    while (ready.load () < threads)
+      std::this_thread::yield ();
+    auto start = Clock::now ();
+    go.store (true);
+    for (auto &worker : workers)
+      worker.join ();
+    // Only count the messages as logged once they've reached the backend.
+    engine.FlushLog ();
+    std::chrono::duration<double> elapsed = Clock::now () - start;
+    result.seconds = elapsed.count ();
+  }
+
+  removeFiles (kind);
+  return result;
+}
+
+// Returns the latency that the given fraction of log statements were faster
+// than.  The latencies must be sorted.
+std::uint64_t
+percentile (const std::vector<std::uint64_t> &latencies, double fraction)
+{
+  std::size_t index = static_cast<std::size_t> (fraction * latencies.size ());
+  if (index >= latencies.size ())
+    index = latencies.size () - 1;
+  return latencies[index];
+}
+
+void
+print (const std::string &kind, const std::string &mode, unsigned threads,
+       std::size_t size, Result &result)
+{
+  std::sort (result.latencies.begin (), result.latencies.end ());
+  std::cout << "{\"engine\":\"" << HUMMSTRUMM_ENGINE_VERSION
+            << "\",\"backend\":\"" << kind
+            << "\",\"mode\":\"" << mode
+            << "\",\"threads\":" << threads
+            << ",\"size\":" << size
+            << ",\"messages\":" << result.messages
+            << ",\"seconds\":" << result.seconds
+            << ",\"perSecond\":"
+            << static_cast<std::uint64_t> (result.messages / result.seconds)
+            << ",\"p50\":" << percentile (result.latencies, 0.5)
+            << ",\"p99\":" << percentile (result.latencies, 0.99)
+            << ",\"p999\":" << percentile (result.latencies, 0.999)
+            << ",\"max\":" << result.latencies.back ()
+            << "}" << std::endl;
+}
+
+// Splits a comma-separated list.
+std::vector<std::string>
+split (const std::string &list)
+{
+  std::vector<std::string> items;
+  std::istringstream in (list);
+  std::string item;
+  while (std::getline (in, item, ','))
+    if (!item.empty ())
+      items.push_back (item);
+  return items;
+}
+
+int
+usage ()
+{
+  std::cerr << "Usage: bench_logging [--messages N] [--threads N] "
+            << "[--sizes N,...]\n"
+            << "                     [--backends NAME,...] "
+            << "[--modes MODE,...]\n";
+  return EXIT_FAILURE;
+}
+
+}
+
+int
+main (int argc, char **argv)
+{
+  unsigned messages = 10000;
+  unsigned maxThreads = std::thread::hardware_concurrency ();
+  if (maxThreads == 0)
+    maxThreads = 1;
+  std::vector<std::size_t> sizes = { 16, 64, 256, 1024, 4096 };
+  std::vector<std::string> kinds = {
+    "null", "console", "file", "binary", "rotating", "ringbuffer",
+    "sharedmemory", "jsonlines"
+  };
+  std::vector<std::string> modes = { "sync", "async", "disabled" };
+
+  for (int i = 1; i < argc; ++i)
+    {
+      std::string option = argv[i];
+      if (i + 1 == argc)
+        return usage ();
+      std::string value = argv[++i];
+      if (option == "--messages")
+        messages = std::strtoul (value.c_str (), nullptr, 10);
+      else if (option == "--threads")
+        maxThreads = std::strtoul (value.c_str (), nullptr, 10);
+      else if (option == "--backends")
+        kinds = split (value);
+      else if (option == "--modes")
+        modes = split (value);
+      else if (option == "--sizes")
+        {
+          sizes.clear ();
+          for (auto &size : split (value))
+            sizes.push_back (std::strtoul (size.c_str (), nullptr, 10));
+        }
+      else
+        return usage ();
+    }
+  if (messages == 0 || maxThreads == 0 || sizes.empty ())
+    return usage ();
+  for (auto &kind : kinds)
+    if (!makeBackend (kind, debug::logging::Level::none))
+      {
+        std::cerr << "bench_logging: no backend named " << kind << "\n";
+        return EXIT_FAILURE;
+      }
+  for (auto &kind : kinds)
+    removeFiles (kind);
+
+  std::vector<unsigned> threadCounts;
+  for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+    threadCounts.push_back (threads);
+  threadCounts.push_back (maxThreads);
+
+  // Send the console backend's messages nowhere.
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  std::ofstream nowhere ("NUL");
+#else
+  std::ofstream nowhere ("/dev/null");
+#endif
+  std::streambuf *stderrBuffer = std::cerr.rdbuf (nowhere.rdbuf ());
+
+  for (auto &kind : kinds)
+    for (auto &mode : modes)
+      for (unsigned threads : threadCounts)
+        {
+          // The size of a message doesn't matter if it is never built.
+          std::size_t runs = mode == "disabled" ? 1 : sizes.size ();
+          for (std::size_t i = 0; i < runs; ++i)
+            {
+              Result result = run (kind, mode, threads, sizes[i], messages);
+              print (kind, mode, threads, sizes[i], result);
+            }
+        }
+
+  std::cerr.rdbuf (stderrBuffer);
+  return EXIT_SUCCESS;
+}
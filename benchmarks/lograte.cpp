@@ -0,0 +1,132 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Measures what a flood of warnings from one line costs the thread that logs
+// them.  Four loops are compared:
+//
+//   unlimited  HUMMSTRUMM_ENGINE_LOG, so every message reaches the backend.
+//   limited    HUMMSTRUMM_ENGINE_LOG_RATE_LIMITED at 10 messages a second.
+//   sampled    HUMMSTRUMM_ENGINE_LOG_SAMPLED, letting 1 in 1000 through.
+//   empty      The loop without any logging.
+//
+// The backend counts the messages and throws them away, so this is the cost of
+// the call site, not of writing the log.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+#include "harness.hpp"
+using namespace hummstrummengine;
+
+namespace {
+
+const unsigned ITERATIONS = 10000000;
+
+// Keeps the compiler from throwing the loops away.
+volatile unsigned sink;
+
+typedef std::chrono::steady_clock Clock;
+
+double
+nanosecondsPerIteration (Clock::time_point start)
+{
+  std::chrono::duration<double, std::nano> elapsed = Clock::now () - start;
+  return elapsed.count () / ITERATIONS;
+}
+
+double
+runUnlimited (std::ostream &log)
+{
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < ITERATIONS; ++i)
+    {
+      HUMMSTRUMM_ENGINE_LOG (log, Level::warning)
+        << "Entity " << i << " fell out of the world." << std::flush;
+      sink = i;
+    }
+  return nanosecondsPerIteration (start);
+}
+
+double
+runLimited (std::ostream &log)
+{
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < ITERATIONS; ++i)
+    {
+      HUMMSTRUMM_ENGINE_LOG_RATE_LIMITED (log, Level::warning, 10, 10)
+        << "Entity " << i << " fell out of the world." << std::flush;
+      sink = i;
+    }
+  return nanosecondsPerIteration (start);
+}
+
+double
+runSampled (std::ostream &log)
+{
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < ITERATIONS; ++i)
+    {
+      HUMMSTRUMM_ENGINE_LOG_SAMPLED (log, Level::warning, 1000)
+        << "Entity " << i << " fell out of the world." << std::flush;
+      sink = i;
+    }
+  return nanosecondsPerIteration (start);
+}
+
+double
+runEmpty ()
+{
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < ITERATIONS; ++i)
+    sink = i;
+  return nanosecondsPerIteration (start);
+}
+
+}
+
+int
+main ()
+{
+  auto backend = std::make_shared<benchmark::NullBackend> ();
+  debug::logging::StreamBuffer buffer ({ backend });
+  std::ostream log (&buffer);
+
+  std::cout << "# " << ITERATIONS << " Level::warning messages from one line\n"
+            << "# nanoseconds per message, messages logged\n"
+            << std::fixed << std::setprecision (2);
+
+  double time = runUnlimited (log);
+  std::cout << std::setw (10) << "unlimited" << std::setw (10) << time
+            << std::setw (10) << backend->count << '\n';
+  backend->count = 0;
+  time = runLimited (log);
+  std::cout << std::setw (10) << "limited" << std::setw (10) << time
+            << std::setw (10) << backend->count << '\n';
+  backend->count = 0;
+  time = runSampled (log);
+  std::cout << std::setw (10) << "sampled" << std::setw (10) << time
+            << std::setw (10) << backend->count << '\n';
+  std::cout << std::setw (10) << "empty" << std::setw (10) << runEmpty ()
+            << std::setw (10) << 0 << std::endl;
+
+  return EXIT_SUCCESS;
+}
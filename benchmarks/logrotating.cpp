@@ -0,0 +1,89 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compares FileBackend, which writes each message to an ofstream and flushes
+// it, with RotatingFileBackend, which copies messages into memory-mapped
+// segments.  Both write the same XML.  Prints records per second for each.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine;
+
+namespace {
+
+const unsigned RECORDS = 200000;
+
+typedef std::chrono::steady_clock Clock;
+
+// Returns records per second.
+double
+run (std::unique_ptr<debug::logging::Backend> backend)
+{
+  std::string message;
+
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < RECORDS; ++i)
+    {
+      message.assign ("Loaded texture ");
+      message += std::to_string (i);
+      message += " in 0.25 ms.";
+      debug::logging::Record record (
+        debug::logging::GetTimestamp (), 1, __FILE__, __LINE__,
+        debug::logging::Level::info, message.data (), message.size ());
+      (*backend) (record);
+    }
+  // Count the time it takes to close the files, too.
+  backend.reset ();
+  std::chrono::duration<double> elapsed = Clock::now () - start;
+
+  return RECORDS / elapsed.count ();
+}
+
+}
+
+int
+main ()
+{
+  double file = run (std::unique_ptr<debug::logging::Backend> (
+                       new debug::logging::FileBackend (
+                         debug::logging::Level::all, "bench_logrotating.xml")));
+  std::remove ("bench_logrotating.xml");
+
+  double rotating = run (std::unique_ptr<debug::logging::Backend> (
+                           new debug::logging::RotatingFileBackend (
+                             debug::logging::Level::all, "bench_logrotating")));
+  for (unsigned i = 0; i < 16; ++i)
+    std::remove (("bench_logrotating." + std::to_string (i) + ".log").c_str ());
+
+  std::cout << "# " << RECORDS << " records\n"
+            << std::fixed << std::setprecision (1)
+            << std::setw (10) << "backend" << std::setw (16) << "records/s"
+            << '\n'
+            << std::setw (10) << "file" << std::setw (16) << file << '\n'
+            << std::setw (10) << "rotating" << std::setw (16) << rotating
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
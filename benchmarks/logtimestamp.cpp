@@ -0,0 +1,85 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compares formatting every timestamp with std::gmtime and std::strftime, the
+// way the backends used to, with TimestampFormatter, which only renders the
+// fraction of the second again.  Timestamps are a microsecond apart, like
+// messages logged in a burst.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine;
+
+namespace {
+
+const unsigned TIMESTAMPS = 1000000;
+
+typedef std::chrono::steady_clock Clock;
+
+// Returns nanoseconds per timestamp.
+template <typename FormatT>
+double
+run (FormatT format)
+{
+  std::uint64_t start = debug::logging::GetTimestamp ();
+  unsigned long checksum = 0;
+
+  auto begin = Clock::now ();
+  for (unsigned i = 0; i < TIMESTAMPS; ++i)
+    checksum += format (start + i * 1000ull)[18];
+  std::chrono::duration<double, std::nano> elapsed = Clock::now () - begin;
+
+  // Keep the compiler from throwing the formatting away.
+  if (checksum == 0)
+    std::cerr << "";
+  return elapsed.count () / TIMESTAMPS;
+}
+
+}
+
+int
+main ()
+{
+  char tbuffer[22];
+  double strftime = run ([&tbuffer](std::uint64_t timestamp) {
+      std::time_t t = static_cast<std::time_t> (timestamp / 1000000000u);
+      std::strftime (tbuffer, sizeof tbuffer, "%Y-%m-%dT%H:%M:%SZ",
+                     std::gmtime (&t));
+      return tbuffer;
+    });
+  debug::logging::TimestampFormatter formatter;
+  double cached = run ([&formatter](std::uint64_t timestamp) {
+      return formatter.Format (timestamp);
+    });
+
+  std::cout << "# " << TIMESTAMPS << " timestamps, 1 us apart\n"
+            << "# nanoseconds per timestamp\n"
+            << std::setw (10) << "strftime" << std::setw (10) << "cached"
+            << std::endl
+            << std::fixed << std::setprecision (1)
+            << std::setw (10) << strftime << std::setw (10) << cached
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures the Eigen operations that the engine's math leans on, next to the
+// same operations written as plain loops, so that the claim in NEWS that Eigen
+// was faster than our own math code can be checked on any machine.  Our old
+// math classes are gone, so the plain loops stand in for them: they are the
+// straightforward code a math library without vectorization would run.
+//
+// Usage: bench_math [--filter TEXT] [--clock CLOCK] [--output FILE]
+//                   [--baseline FILE] ...
+// See benchmarks/harness.hpp for every option.
+
+#include <cmath>
+#include <cstddef>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "harness.hpp"
+using namespace hummstrummengine;
+
+namespace {
+
+// Multiplies two column-major 4x4 matrices.
+void
+multiply (const float *a, const float *b, float *product)
+{
+  for (int column = 0; column < 4; ++column)
+    for (int row = 0; row < 4; ++row)
+      {
+        float sum = 0;
+        for (int k = 0; k < 4; ++k)
+          sum += a[k * 4 + row] * b[column * 4 + k];
+        product[column * 4 + row] = sum;
+      }
+}
+
+// Transforms a vector by a column-major 4x4 matrix.
+void
+transform (const float *matrix, const float *vector, float *result)
+{
+  for (int row = 0; row < 4; ++row)
+    {
+      float sum = 0;
+      for (int k = 0; k < 4; ++k)
+        sum += matrix[k * 4 + row] * vector[k];
+      result[row] = sum;
+    }
+}
+
+// Scales a 4-vector to unit length.
+void
+normalize (float *vector)
+{
+  float length = std::sqrt (vector[0] * vector[0] + vector[1] * vector[1] +
+                            vector[2] * vector[2] + vector[3] * vector[3]);
+  for (int i = 0; i < 4; ++i)
+    vector[i] /= length;
+}
+
+}
+
+HUMMSTRUMM_ENGINE_BENCHMARK (EigenMatrixProduct)
+{
+  Eigen::Matrix4f a = Eigen::Matrix4f::Random ();
+  Eigen::Matrix4f b = Eigen::Matrix4f::Random ();
+  for (std::size_t i = 0; i < iterations; ++i)
+    {
+      Eigen::Matrix4f product = a * b;
+      benchmark::Keep (product);
+    }
+}
+
+HUMMSTRUMM_ENGINE_BENCHMARK (LoopMatrixProduct)
+{
+  Eigen::Matrix4f a = Eigen::Matrix4f::Random ();
+  Eigen::Matrix4f b = Eigen::Matrix4f::Random ();
+  for (std::size_t i = 0; i < iterations; ++i)
+    {
+      float product[16];
+      multiply (a.data (), b.data (), product);
+      benchmark::Keep (product);
+    }
+}
+
+HUMMSTRUMM_ENGINE_BENCHMARK (EigenTransform)
+{
+  Eigen::Matrix4f matrix = Eigen::Matrix4f::Random ();
+  Eigen::Vector4f vector = Eigen::Vector4f::Random ();
+  for (std::size_t i = 0; i < iterations; ++i)
+    {
+      Eigen::Vector4f result = matrix * vector;
+      benchmark::Keep (result);
+    }
+}
+
+HUMMSTRUMM_ENGINE_BENCHMARK (LoopTransform)
+{
+  Eigen::Matrix4f matrix = Eigen::Matrix4f::Random ();
+  Eigen::Vector4f vector = Eigen::Vector4f::Random ();
+  for (std::size_t i = 0; i < iterations; ++i)
+    {
+      float result[4];
+      transform (matrix.data (), vector.data (), result);
+      benchmark::Keep (result);
+    }
+}
+
+HUMMSTRUMM_ENGINE_BENCHMARK (EigenNormalize)
+{
+  Eigen::Vector4f vector = Eigen::Vector4f::Random ();
+  for (std::size_t i = 0; i < iterations; ++i)
+    {
+      Eigen::Vector4f result = vector.normalized ();
+      benchmark::Keep (result);
+    }
+}
+
+HUMMSTRUMM_ENGINE_BENCHMARK (LoopNormalize)
+{
+  Eigen::Vector4f vector = Eigen::Vector4f::Random ();
+  for (std::size_t i = 0; i < iterations; ++i)
+    {
+      float result[4] = { vector[0], vector[1], vector[2], vector[3] };
+      normalize (result);
+      benchmark::Keep (result);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  return benchmark::Main (argc, argv);
+}
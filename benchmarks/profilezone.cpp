@@ -0,0 +1,104 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures what a zone costs the thread that records it.  Three loops are
+// compared:
+//
+//   recorded  HUMMSTRUMM_ENGINE_ZONE with a ZoneProfiler, ending a frame every
+//             1000 zones so that the buffer never fills up.
+//   inactive  HUMMSTRUMM_ENGINE_ZONE without a ZoneProfiler.
+//   empty     The loop without any zones.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine;
+
+namespace {
+
+const unsigned ITERATIONS = 10000000;
+const unsigned ZONES_PER_FRAME = 1000;
+
+// Keeps the compiler from throwing the loops away.
+volatile unsigned sink;
+
+typedef std::chrono::steady_clock Clock;
+
+double
+runZones (debug::profiling::ZoneProfiler *profiler)
+{
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < ITERATIONS; ++i)
+    {
+      {
+        HUMMSTRUMM_ENGINE_ZONE ("iteration");
+        sink = i;
+      }
+      if (profiler && i % ZONES_PER_FRAME == ZONES_PER_FRAME - 1)
+        profiler->EndFrame ();
+    }
+  std::chrono::duration<double, std::nano> elapsed = Clock::now () - start;
+  return elapsed.count () / ITERATIONS;
+}
+
+double
+runEmpty ()
+{
+  auto start = Clock::now ();
+  for (unsigned i = 0; i < ITERATIONS; ++i)
+    sink = i;
+  std::chrono::duration<double, std::nano> elapsed = Clock::now () - start;
+  return elapsed.count () / ITERATIONS;
+}
+
+}
+
+int
+main ()
+{
+  // Zones are timed with the time stamp counter when the Engine is running.
+  system::Processors processors;
+  debug::profiling::TscClock::Calibrate (processors);
+
+  std::cout << "# " << ITERATIONS << " zones, " << ZONES_PER_FRAME
+            << " per frame, "
+            << (debug::profiling::TscClock::GetSource () ==
+                debug::profiling::TscSource::steadyClock ?
+                "timed with steady_clock" : "timed with the TSC") << '\n'
+            << "# nanoseconds per zone\n"
+            << std::fixed << std::setprecision (2);
+
+  std::uint64_t dropped;
+  {
+    debug::profiling::ZoneProfiler profiler (nullptr);
+    profiler.RegisterThread ("main");
+    std::cout << std::setw (10) << "recorded" << std::setw (10)
+              << runZones (&profiler) << '\n';
+    dropped = profiler.GetDropped ();
+  }
+  std::cout << std::setw (10) << "inactive" << std::setw (10)
+            << runZones (nullptr) << '\n'
+            << std::setw (10) << "empty" << std::setw (10) << runEmpty ()
+            << '\n'
+            << "# " << dropped << " zones dropped" << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures what sampling call stacks costs the thread being sampled: the same
+// work is timed with and without a debug::profiling::Sampler taking 1000
+// samples a second of it.  The difference between the two is the overhead,
+// which should stay under 2%.
+//
+// Usage: bench_sampler [--frequency N] [harness options]
+// See benchmarks/harness.hpp for the harness options.
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "harness.hpp"
+using namespace hummstrummengine;
+
+namespace {
+
+debug::profiling::Sampler *sampler = nullptr;
+
+// Does some work a few calls deep, so there is a stack to walk.
+unsigned
+work (unsigned depth, unsigned value)
+{
+  if (depth == 0)
+    {
+      for (unsigned i = 0; i < 64; ++i)
+        value = value * 1664525u + 1013904223u;
+      return value;
+    }
+  return work (depth - 1, value) ^ depth;
+}
+
+}
+
+HUMMSTRUMM_ENGINE_BENCHMARK (Unsampled)
+{
+  unsigned value = 1;
+  for (std::size_t i = 0; i < iterations; ++i)
+    value = work (16, value);
+  benchmark::Keep (value);
+}
+
+HUMMSTRUMM_ENGINE_BENCHMARK (Sampled)
+{
+  sampler->RegisterThread ();
+  unsigned value = 1;
+  for (std::size_t i = 0; i < iterations; ++i)
+    value = work (16, value);
+  benchmark::Keep (value);
+  sampler->UnregisterThread ();
+}
+
+int
+main (int argc, char **argv)
+{
+  unsigned frequency = 1000;
+  std::vector<char *> arguments (argv, argv + argc);
+  if (argc > 2 && std::string (argv[1]) == "--frequency")
+    {
+      frequency = std::strtoul (argv[2], nullptr, 10);
+      arguments.erase (arguments.begin () + 1, arguments.begin () + 3);
+    }
+
+  debug::profiling::Sampler theSampler (frequency);
+  if (!theSampler.IsSampling ())
+    std::cerr << "bench_sampler: call stacks can't be sampled here\n";
+  sampler = &theSampler;
+  int status = benchmark::Main (static_cast<int> (arguments.size ()),
+                                arguments.data ());
+  std::cout << "# " << theSampler.GetSamples () << " samples, "
+            << theSampler.GetDropped () << " dropped\n";
+  return status;
+}
@@ -46,6 +46,17 @@ endif ()
 # Look for Intel TBB
 find_package(TBB REQUIRED)
 
+# The logging system runs a writer thread.
+find_package(Threads REQUIRED)
+
+# zlib compresses old log files.  We can do without it.
+if (WITH_ZLIB)
+  find_package (ZLIB)
+  if (ZLIB_FOUND)
+    set (HUMMSTRUMM_ENGINE_HAVE_ZLIB ON)
+  endif ()
+endif ()
+
 # Find Git
 find_package (Git)
 
@@ -17,6 +17,7 @@
 # CompilerChecks.cmake -- Makes sure that the compiler supports various headers,
 #                         functions, and features.
 
+include (CheckCXXCompilerFlag)
 include (CheckIncludeFileCXX)
 include (CheckCpp11)
 
@@ -27,4 +28,12 @@ if (HUMMSTRUMM_ENGINE_COMPILER_CLANG OR HUMMSTRUMM_ENGINE_COMPILER_GCC)
   add_definitions("-msse")
   #      add_definitions("-msse4.1")
   #      add_definitions("-msse4.2")
+  if (WITH_FRAME_POINTERS)
+    add_definitions("-fno-omit-frame-pointer")
+    check_cxx_compiler_flag ("-mno-omit-leaf-frame-pointer"
+      HAVE_NO_OMIT_LEAF_FRAME_POINTER)
+    if (HAVE_NO_OMIT_LEAF_FRAME_POINTER)
+      add_definitions("-mno-omit-leaf-frame-pointer")
+    endif ()
+  endif ()
 endif ()
\ No newline at end of file
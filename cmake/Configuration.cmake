@@ -19,4 +19,33 @@
 
 set (WITH_UNIT_TESTS ON CACHE BOOL "Build unit tests?")
 
-set (WITH_CPPCHECK OFF CACHE BOOL "Run source checks with CppCheck?")
\ No newline at end of file
+set (WITH_BENCHMARKS OFF CACHE BOOL "Build benchmarks?")
+
+set (WITH_TOOLS ON CACHE BOOL "Build tools, such as hummstrumm-logdump?")
+
+set (WITH_CPPCHECK OFF CACHE BOOL "Run source checks with CppCheck?")
+
+set (WITH_ZLIB ON CACHE BOOL "Compress rotated log files with zlib, if found?")
+
+set (WITH_FRAME_POINTERS ON CACHE BOOL
+  "Keep frame pointers, so the sampling profiler sees whole call stacks?")
+
+set (MINIMUM_LOG_LEVEL "info" CACHE STRING
+  "Least severe log level to compile in (info, success, warning, error, none)")
+set_property (CACHE MINIMUM_LOG_LEVEL
+  PROPERTY STRINGS info success warning error none)
+
+# These match the values of hummstrummengine::debug::logging::Level.
+if (MINIMUM_LOG_LEVEL STREQUAL "info")
+  set (HUMMSTRUMM_ENGINE_LOG_MIN_LEVEL 1)
+elseif (MINIMUM_LOG_LEVEL STREQUAL "success")
+  set (HUMMSTRUMM_ENGINE_LOG_MIN_LEVEL 2)
+elseif (MINIMUM_LOG_LEVEL STREQUAL "warning")
+  set (HUMMSTRUMM_ENGINE_LOG_MIN_LEVEL 4)
+elseif (MINIMUM_LOG_LEVEL STREQUAL "error")
+  set (HUMMSTRUMM_ENGINE_LOG_MIN_LEVEL 8)
+elseif (MINIMUM_LOG_LEVEL STREQUAL "none")
+  set (HUMMSTRUMM_ENGINE_LOG_MIN_LEVEL 16)
+else ()
+  message (FATAL_ERROR "Unknown MINIMUM_LOG_LEVEL ${MINIMUM_LOG_LEVEL}.")
+endif ()
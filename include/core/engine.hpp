@@ -28,6 +28,12 @@
 #ifndef HUMMSTRUMM_ENGINE_CORE_ENGINE
 #define HUMMSTRUMM_ENGINE_CORE_ENGINE
 
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
 namespace hummstrummengine {
 namespace core {
 
@@ -55,9 +61,48 @@ public:
    */
   struct Configuration
   {
+    /**
+     * Sets the default parameters: no log backends and synchronous logging.
+     *
+     * @since  0.7
+     */
+    Configuration ()
+        : logBackends (),
+          asyncLogging (false),
+          asyncLogCapacity (1024),
+          asyncLogOverflow (
+            hummstrummengine::debug::logging::OverflowPolicy::block),
+          crashLogFile ("hummstrummengine-crash.hslog"),
+          samplingFrequency (0),
+          samplingFile ("hummstrummengine.folded")
+    {
+    }
+
     /// The backends to send log messages to.
     std::vector<std::shared_ptr<hummstrummengine::debug::logging::Backend> >
     logBackends;
+    /// Whether log messages are sent to the backends by a writer thread
+    /// instead of the thread that logs them.
+    bool asyncLogging;
+    /// How many messages can wait for the log writer thread.
+    std::size_t asyncLogCapacity;
+    /// What to do when too many messages are waiting for the log writer
+    /// thread.
+    hummstrummengine::debug::logging::OverflowPolicy asyncLogOverflow;
+    /// Where to write the messages in the first
+    /// debug::logging::RingBufferBackend of logBackends if the program
+    /// crashes (on @c SIGSEGV , @c SIGABRT , @c SIGBUS , @c SIGFPE ,
+    /// @c SIGILL , or std::terminate()).  Leave this empty, or don't use a
+    /// RingBufferBackend, to leave those alone.
+    std::string crashLogFile;
+    /// How many times a second to sample the call stack of each thread
+    /// registered with the debug::profiling::Sampler, or 0 to not sample.
+    /// The thread that constructs the Engine is registered.
+    unsigned samplingFrequency;
+    /// Where to write the sampled call stacks as folded stacks, for
+    /// @c flamegraph.pl , when the Engine is destructed.  Leave this empty to
+    /// not write them.
+    std::string samplingFile;
   };
 
   /**
@@ -70,7 +115,9 @@ public:
    */
   Engine (Configuration params = Configuration ());
   /**
-   * Shuts down the Humm and Strumm Engine.
+   * Shuts down the Humm and Strumm Engine.  Every message logged before the
+   * Engine is destructed reaches the log backends, even when logging is
+   * asynchronous.
    *
    * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
    * @date   2012-02-13
@@ -92,16 +139,28 @@ public:
       /* noexcept */;
 
   /**
-   * Returns the log stream.
+   * Returns the log stream of the calling thread.  Every thread gets its own
+   * stream, so threads can build messages at the same time without waiting on
+   * each other.  All the streams send their messages to the same backends.
    *
    * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
    * @date   2010-11-27
    * @since  0.3
    *
-   * @return The log std::ostream .
+   * @return The log std::ostream of the calling thread.
+   *
+   * @warning Do not hand the stream to another thread.
    */
   std::ostream &GetLog ()
       /* noexcept */;
+  /**
+   * Waits until every message that has been flushed to any thread's log stream
+   * has reached the log backends.  This only has to wait when logging is
+   * asynchronous.
+   *
+   * @since  0.7
+   */
+  void FlushLog ();
   /**
    * Returns the Platform.
    *
@@ -146,13 +205,42 @@ public:
    */
   hummstrummengine::system::Endianness *GetEndianness ()
       /* noexcept */;
+  /**
+   * Returns the Sampler, which samples the call stacks of the threads that
+   * register with it.  Other threads can register with
+   * debug::profiling::Sampler::RegisterThread().
+   *
+   * @since  0.7
+   *
+   * @return The Sampler, or @c nullptr if Configuration::samplingFrequency
+   * was 0.
+   */
+  hummstrummengine::debug::profiling::Sampler *GetSampler ()
+      /* noexcept */;
 
 private:
-  /// The engine-wide log's streambuf, so we can control when it is
-  /// initialized and deconstructed.
-  hummstrummengine::debug::logging::StreamBuffer logStreamBuffer;
-  /// The engine-wide log.
-  std::ostream log;
+  /// A log stream belonging to one thread.
+  struct ThreadLog;
+
+  /**
+   * Makes a log stream for the calling thread, or finds the one it already
+   * has.
+   *
+   * @return The log std::ostream of the calling thread.
+   */
+  std::ostream &FindThreadLog ();
+
+  /// Where all the threads' log streams send their messages.
+  std::shared_ptr<hummstrummengine::debug::logging::Dispatcher> logDispatcher;
+  /// The log streams of every thread that has logged.
+  std::vector<std::unique_ptr<ThreadLog> > threadLogs;
+  /// Protects threadLogs.
+  std::mutex threadLogsMutex;
+  /// Tells this Engine apart from ones that existed before it.
+  unsigned long id;
+  /// The backend that is written out if the program crashes, if any.
+  std::shared_ptr<hummstrummengine::debug::logging::RingBufferBackend>
+  crashRing;
   /// Platform information.
   hummstrummengine::system::Platform *platform;
   /// Processor information.
@@ -161,6 +249,10 @@ private:
   hummstrummengine::system::Memory *memory;
   /// Endianness information.
   hummstrummengine::system::Endianness *endianness;
+  /// Samples call stacks, if asked to.
+  std::unique_ptr<hummstrummengine::debug::profiling::Sampler> sampler;
+  /// Where to write the sampled call stacks.
+  std::string samplingFile;
 
   /// The global engine pointer.
   static Engine *theEngine;
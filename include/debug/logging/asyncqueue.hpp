@@ -0,0 +1,236 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::logging::AsyncQueue, which hands log messages to a background
+ * thread that writes them to the logging backends.
+ *
+ * @file   debug/logging/asyncqueue.hpp
+ * @see    AsyncQueue
+ * @see    OverflowPolicy
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_ASYNCQUEUE
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_ASYNCQUEUE
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+// Forward declare for safety.
+class Backend;
+struct Record;
+
+/**
+ * What an AsyncQueue does with a new message when it is already full.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+enum class OverflowPolicy
+{
+    block,       ///< Wait until the writer thread makes room.
+    dropNewest,  ///< Throw away the new message.
+    /// Throw away the oldest message still in the queue, or the new message
+    /// if the oldest is being sent.
+    dropOldest
+};
+
+/**
+ * A bounded, multiple-producer, single-consumer queue of log messages with a
+ * dedicated thread that sends them to the logging backends.  A
+ * logging::StreamBuffer that owns one of these only copies the finished message
+ * into a free slot on a flush, so the thread that logs never waits on
+ * formatting the timestamp or on the console or disk.
+ *
+ * The queue is a ring of preallocated slots, each with a sequence number that
+ * says whose turn it is to use the slot.  Producers claim slots with a
+ * compare-and-swap on the enqueue position, and no lock is taken unless the
+ * writer thread is asleep.  Every slot keeps its strings between messages, so
+ * once the strings have grown to the size of the usual message, queueing does
+ * not allocate.
+ *
+ * Whenever messages are dropped because of the OverflowPolicy, the writer
+ * thread sends a warning to the backends saying how many were lost.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @note The backends are only ever called from the writer thread, so they do
+ * not need to be thread-safe.
+ */
+class AsyncQueue
+{
+  public:
+    /**
+     * Constructs a new AsyncQueue and starts its writer thread.
+     *
+     * @since  0.7
+     *
+     * @param [in] backends The backends to which the writer thread sends
+     * messages.
+     * @param [in] capacity The number of messages the queue can hold.  This is
+     * rounded up to a power of two.
+     * @param [in] policy What to do when the queue is full.
+     */
+    AsyncQueue (std::vector<std::shared_ptr<Backend>> backends,
+                std::size_t capacity = 1024,
+                OverflowPolicy policy = OverflowPolicy::block);
+    /**
+     * Destructs an existing AsyncQueue.  Every message that was queued before
+     * the destructor was called is sent to the backends before the writer
+     * thread is stopped.
+     *
+     * @since  0.7
+     */
+    ~AsyncQueue ();
+
+    /**
+     * Queues a message for the writer thread.  Depending on the
+     * OverflowPolicy, this can wait for room in the queue.
+     *
+     * @since  0.7
+     *
+     * @param [in] record The message.  Its strings are copied into the queue.
+     *
+     * @return Whether the message was queued.
+     * @retval false If the message was dropped because the queue was full.
+     */
+    bool Push (const Record &record);
+
+    /**
+     * Waits until every message that was queued before this call has been sent
+     * to the backends (or dropped).
+     *
+     * @since  0.7
+     */
+    void Flush ();
+
+    /**
+     * Returns the number of messages that have been dropped because the queue
+     * was full.
+     *
+     * @since  0.7
+     *
+     * @return The total number of dropped messages.
+     */
+    inline unsigned long long GetDroppedCount () const;
+
+  private:
+    /// One message in the ring.
+    struct Slot
+    {
+        /// Whose turn it is to use this slot.
+        std::atomic<std::size_t> sequence;
+        std::uint64_t timestamp;  ///< When the message was flushed.
+        unsigned thread;      ///< The thread that flushed the message.
+        std::string file;     ///< The source file of the message.
+        unsigned line;        ///< The source line of the message.
+        Level level;          ///< The level of the message.
+        std::string message;  ///< The text of the message.
+        /// The format string of an unformatted message, or @c nullptr .
+        const char *format;
+        /// The arguments of an unformatted message.
+        std::vector<char> arguments;
+        /// The structured fields of the message.
+        std::vector<char> fields;
+    };
+
+    /**
+     * Claims the oldest filled slot.  The slot must be given back with
+     * Release() once its contents are no longer needed.
+     *
+     * @return The slot, or @c nullptr if the queue is empty.
+     */
+    Slot *Claim (std::size_t &position);
+    /**
+     * Gives a slot claimed with Claim() back to the producers.
+     */
+    void Release (Slot *slot, std::size_t position);
+    /**
+     * Sends a message to each backend, ignoring any exceptions they throw.
+     */
+    void Dispatch (const Record &record);
+    /**
+     * Wakes the writer thread if it is waiting for messages.
+     */
+    void Wake ();
+    /**
+     * The body of the writer thread.
+     */
+    void Run ();
+
+    /// The backends to send messages to.
+    std::vector<std::shared_ptr<Backend>> backends;
+    /// The ring of messages.
+    std::unique_ptr<Slot[]> slots;
+    /// The capacity of the ring, less one.  The capacity is a power of two.
+    std::size_t mask;
+    /// What to do when the queue is full.
+    OverflowPolicy policy;
+
+    // The positions are written by different threads, so keep them on
+    // different cache lines.
+    char padding0[64];
+    /// The position of the next slot a producer will fill.
+    std::atomic<std::size_t> enqueuePosition;
+    char padding1[64 - sizeof (std::atomic<std::size_t>)];
+    /// The position of the next slot the writer thread will send.
+    std::atomic<std::size_t> dequeuePosition;
+    char padding2[64 - sizeof (std::atomic<std::size_t>)];
+    /// The number of messages that have been sent or dropped.
+    std::atomic<std::size_t> completed;
+    char padding3[64 - sizeof (std::atomic<std::size_t>)];
+
+    /// Messages dropped since the writer thread last reported them.
+    std::atomic<unsigned long long> pendingDrops;
+    /// Messages dropped over the lifetime of the queue.
+    std::atomic<unsigned long long> totalDrops;
+
+    /// Whether the writer thread should keep running.
+    std::atomic<bool> running;
+    /// Whether the writer thread is waiting for messages.
+    std::atomic<bool> sleeping;
+    /// Protects the sleeping writer thread against missed wake-ups.
+    std::mutex sleepMutex;
+    /// Where the writer thread waits for messages.
+    std::condition_variable wakeUp;
+    /// Whether some backend needs unformatted messages formatted for it.
+    bool formatMessages;
+    /// Where the writer thread formats unformatted messages.
+    std::string formatted;
+    /// The writer thread.
+    std::thread writer;
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_ASYNCQUEUE
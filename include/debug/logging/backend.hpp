@@ -44,9 +44,7 @@ namespace logging {
  * backend.  The exact format of a message is determined by the backend that is
  * used to log them.
  * 
- * @version 0.6
- * @author  Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
- * @date    2012-06-14
+ * @version 0.7
  * @since   0.6
  */
 class Backend
@@ -72,11 +70,94 @@ class Backend
      */
     virtual ~Backend ();
 
+    /**
+     * Writes a message to the backend.  This method is intended to be called
+     * during a flush from the logging::StreamBuffer associated with some log,
+     * but any user can call it.
+     *
+     * The Record only refers to the sender's strings, so no matter how many
+     * backends there are, nothing has to be copied.  Backends written for the
+     * older interface can derive from LegacyBackend instead.
+     *
+     * @since  0.7
+     *
+     * @param [in] record The message and where it came from.
+     *
+     * @note The time is provided by the logging::StreamBuffer so that
+     * timestamps between backends will be the same for corresponding messages.
+     */
+    virtual void operator() (const Record &record) = 0;
+
+    /**
+     * Returns whether this backend can take a Record whose message hasn't been
+     * formatted yet (see HUMMSTRUMM_ENGINE_LOGF()).  If every backend of a log
+     * can, messages are never formatted before they reach the backends.  The
+     * default implementation returns @c false .
+     *
+     * @since  0.7
+     *
+     * @return Whether the backend takes unformatted messages.
+     */
+    virtual bool AcceptsUnformatted () const;
+
+    /**
+     * Returns the levels that this backend prints.
+     *
+     * @since  0.7
+     *
+     * @return The levels this backend prints, OR'd together.
+     */
+    inline Level GetLevels () const;
+
+  protected:
+    Level acceptLevels;
+};
+
+
+/**
+ * A base class for backends written against the interface of version 0.6,
+ * which take each message as a time, two strings, and the rest.  It copies
+ * the strings out of each Record, and formats any unformatted message, before
+ * calling the older operator().  New backends should derive from Backend
+ * directly.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @deprecated This copies both strings for every backend.  Derive from Backend
+ * and override the operator() that takes a Record instead.
+ */
+class LegacyBackend : public Backend
+{
+  public:
+    /**
+     * Constructs and initializes a backend.
+     *
+     * @since  0.7
+     *
+     * @param [in] allowedLevels The levels that this backend should print, OR'd
+     * together.
+     */
+    inline LegacyBackend (Level allowedLevels = Level::all);
+    /**
+     * Destructs a backend.
+     *
+     * @since  0.7
+     */
+    virtual ~LegacyBackend ();
+
+    /**
+     * Copies the strings of a message and passes them to the older
+     * operator().
+     *
+     * @since  0.7
+     *
+     * @param [in] record The message and where it came from.
+     */
+    virtual void operator() (const Record &record);
     /**
      * Writes a message to the backend.  Each message has an associated file,
-     * line, and time.  This method is intended to be called during a flush from
-     * the logging::StreamBuffer associated with some log, but any user can call
-     * it.
+     * line, and time.
      *
      * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
      * @date   2012-06-14
@@ -87,15 +168,9 @@ class Backend
      * @param [in] line The line from which the message came.
      * @param [in] level The level of the message.
      * @param [in] message The user-provided message string.
-     *
-     * @note The time is provided by the logging::StreamBuffer so that
-     * timestamps between backends will be the same for corresponding messages.
      */
     virtual void operator() (std::time_t time, std::string file, unsigned line,
                              Level level, std::string message) = 0;
-
-  protected:
-    Level acceptLevels;
 };
 
 
@@ -143,26 +218,36 @@ class ConsoleBackend : public Backend
     /**
      * Writes a message to the POSIX stream this backend is configured to use.
      *
-     * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
-     * @date   2012-06-14
      * @since  0.6
      *
-     * @param [in] time The time when the message was sent to the backend.
-     * @param [in] file The name of the source file from which the message came.
-     * @param [in] line The line from which the message came.
-     * @param [in] level The level of the message.
-     * @param [in] message The user-provided message string.
+     * @param [in] record The message and where it came from.
      *
      * @todo Colors?
      *
      * @see debug::logging::Backend
      */
-    virtual void operator() (std::time_t time, std::string file, unsigned line,
-                             Level level, std::string message);
+    virtual void operator() (const Record &record);
+
+    /**
+     * Writes a message to a stream the way a ConsoleBackend does, without
+     * flushing it.  Tools that show log messages, like
+     * @c hummstrumm-logtail , use this to look the same.
+     *
+     * @since  0.7
+     *
+     * @param [in,out] out The stream.
+     * @param [in] record The message and where it came from.  The message
+     * must be formatted.
+     * @param [in,out] timestamps Formats the time of the message.
+     * @param [in] color Whether to print in color.
+     */
+    static void Print (std::ostream &out, const Record &record,
+                       TimestampFormatter &timestamps, bool color);
 
   private:
     bool useStderr;  ///< Should we use @c stderr ?
     bool printColor; ///< Should we print in color?
+    TimestampFormatter timestamps; ///< Formats the times of messages.
 };
 
 
@@ -209,23 +294,17 @@ class FileBackend : public Backend
     /**
      * Writes a message to the file stream this backend is configured to use.
      *
-     * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
-     * @date   2012-06-14
      * @since  0.6
      *
-     * @param [in] time The time when the message was sent to the backend.
-     * @param [in] file The name of the source file from which the message came.
-     * @param [in] line The line from which the message came.
-     * @param [in] level The level of the message.
-     * @param [in] message The user-provided message string.
+     * @param [in] record The message and where it came from.
      *
      * @see debug::logging::Backend
      */
-    virtual void operator() (std::time_t time, std::string file, unsigned line,
-                             Level level, std::string message);
+    virtual void operator() (const Record &record);
 
   private:
     std::ofstream fileStream; ///< The file we should print to.
+    TimestampFormatter timestamps; ///< Formats the times of messages.
 };
 
 }
@@ -32,6 +32,22 @@ Backend::Backend (Level levels)
 {
 }
 
+Level
+Backend::GetLevels ()
+  const
+{
+  return acceptLevels;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// hummstrummengine::debug::logging::LegacyBackend implementation
+
+LegacyBackend::LegacyBackend (Level levels)
+  : Backend (levels)
+{
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // hummstrummengine::debug::logging::ConsoleBackend implementation
@@ -40,7 +56,8 @@ ConsoleBackend::ConsoleBackend (Level levels, bool useStderr,
                                 bool printColor)
   : Backend (levels),
     useStderr (useStderr),
-    printColor (printColor)
+    printColor (printColor),
+    timestamps ()
 {
 }
 
@@ -0,0 +1,314 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines the binary log format, debug::logging::BinaryFileBackend, which
+ * writes it, and debug::logging::BinaryLogReader, which reads it back.
+ *
+ * A binary log starts with a header:
+ *
+ * @verbatim
+   "HSBL"                  4 bytes of magic
+   version                 1 byte, currently 1
+   ticks per second        varint
+   epoch                   varint, in seconds since 1970-01-01T00:00:00Z
+   @endverbatim
+ *
+ * After that come records, each of which looks like this:
+ *
+ * @verbatim
+   type                    1 byte
+   length                  varint, the number of bytes that follow
+   payload                 length bytes
+   @endverbatim
+ *
+ * A reader skips over records whose type it doesn't know.  The types are:
+ *
+ * @verbatim
+   1  file name            varint id, then the name
+   2  message              zigzag varint time in ticks since the epoch,
+                           varint thread number, varint file id,
+                           varint line, 1 byte level, then the message
+   3  format string        varint id, then the format string
+   4  unformatted message  zigzag varint time in ticks since the epoch,
+                           varint thread number, varint file id,
+                           varint line, 1 byte level,
+                           varint format string id, then the arguments
+                           as written by EncodeArguments()
+   @endverbatim
+ *
+ * This engine writes timestamps in nanoseconds.  A file name or format string
+ * record comes before the first message that uses its id.  The arguments of an
+ * unformatted message are in the byte order of the machine that wrote the log.
+ * Varints are unsigned LEB128: seven bits at a time, least significant first,
+ * with the high bit set on every byte but the last.
+ *
+ * @file   debug/logging/binarylog.hpp
+ * @see    BinaryFileBackend
+ * @see    BinaryLogReader
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_BINARYLOG
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_BINARYLOG
+
+#include <ctime>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <istream>
+#include <unordered_map>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+/**
+ * Constants of the binary log format.
+ *
+ * @since 0.7
+ */
+namespace binarylog {
+
+/// The first bytes of every binary log.
+const char magic[4] = { 'H', 'S', 'B', 'L' };
+/// The version of the format that this engine writes.
+const unsigned char version = 1;
+
+/// The type byte at the start of each record.
+enum class RecordType : unsigned char
+{
+    fileName = 1,           ///< Gives a file name an id.
+    message = 2,            ///< A log message.
+    formatString = 3,       ///< Gives a format string an id.
+    unformattedMessage = 4  ///< A log message that hasn't been formatted.
+};
+
+/// The most bytes a 64-bit varint can take.
+const std::size_t maxVarint = 10;
+/// The ticks per second of the timestamps this engine writes.
+const std::uint64_t nanosecondTicks = 1000000000u;
+
+/**
+ * Writes a varint.
+ *
+ * @since  0.7
+ *
+ * @param [out] out Where to write it.  There must be room for maxVarint bytes.
+ * @param [in] value The number to write.
+ *
+ * @return The number of bytes written.
+ */
+inline std::size_t PutVarint (char *out, std::uint64_t value);
+/**
+ * Maps signed numbers to unsigned ones so that small negative numbers stay
+ * small: 0, -1, 1, -2, ... become 0, 1, 2, 3, ...
+ *
+ * @since  0.7
+ *
+ * @param [in] value The signed number.
+ *
+ * @return The number to write as a varint.
+ */
+inline std::uint64_t Zigzag (std::int64_t value);
+/**
+ * Undoes Zigzag().
+ *
+ * @since  0.7
+ *
+ * @param [in] value The number read as a varint.
+ *
+ * @return The signed number.
+ */
+inline std::int64_t Unzigzag (std::uint64_t value);
+
+}
+
+/**
+ * A log backend that writes messages to a compact binary file.  The file is
+ * many times smaller than the XML written by a FileBackend and much quicker to
+ * write, because nothing is formatted and the file is written in large blocks
+ * instead of being flushed after every message.  Use the @c hummstrumm-logdump
+ * tool to turn it back into XML or text.
+ *
+ * Each file name is only written once; after that, messages refer to it by a
+ * number.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @warning Messages that are still in the write buffer when the program
+ * crashes are lost.
+ */
+class BinaryFileBackend : public Backend
+{
+  public:
+    /**
+     * Constructs a new BinaryFileBackend and writes the header of the log.
+     *
+     * @since  0.7
+     *
+     * @param [in] allowedLevels The levels that this backend should print, OR'd
+     * together.
+     * @param [in] file The name of the log file.
+     * @param [in] bufferSize How many bytes to collect before writing them to
+     * the file.
+     */
+    BinaryFileBackend (Level allowedLevels = Level::all,
+                       std::string file = "hummstrummengine.hslog",
+                       std::size_t bufferSize = 1 << 20);
+    /**
+     * Destructs an existing BinaryFileBackend, writing out anything that is
+     * still buffered.
+     *
+     * @since  0.7
+     */
+    virtual ~BinaryFileBackend ();
+
+    /**
+     * Returns @c true : messages logged with HUMMSTRUMM_ENGINE_LOGF() are
+     * written without being formatted.
+     *
+     * @since  0.7
+     *
+     * @return @c true .
+     */
+    virtual bool AcceptsUnformatted () const;
+
+    /**
+     * Adds a message to the write buffer.  The buffer is written to the file
+     * when it is full.
+     *
+     * @since  0.7
+     *
+     * @param [in] record The message and where it came from.
+     *
+     * @see debug::logging::Backend
+     */
+    virtual void operator() (const Record &record);
+
+    /**
+     * Writes everything in the buffer to the file.
+     *
+     * @since  0.7
+     */
+    void Flush ();
+
+  private:
+    /**
+     * The ids given to file names or format strings.
+     */
+    struct StringTable
+    {
+        /// Ids by the address of the string.  Most strings are literals, so
+        /// this finds them without looking at the string.
+        std::unordered_map<const char *, std::uint64_t> idsByAddress;
+        /// Ids by contents, for strings that moved.
+        std::unordered_map<std::string, std::uint64_t> idsByName;
+        /// The strings, by id.
+        std::vector<std::string> names;
+    };
+
+    /**
+     * Returns the id of a string in a table, writing a record of the given
+     * type the first time the string is seen.
+     */
+    std::uint64_t Intern (StringTable &table, binarylog::RecordType type,
+                          const char *name);
+    /**
+     * Adds a record to the buffer.
+     */
+    void PutRecord (binarylog::RecordType type, const char *head,
+                    std::size_t headLength, const char *body,
+                    std::size_t bodyLength);
+
+    std::ofstream fileStream;  ///< The file we should write to.
+    std::vector<char> buffer;  ///< Bytes not yet written to the file.
+    std::size_t used;          ///< How much of the buffer is full.
+    std::time_t epoch;         ///< When the log was started.
+    std::uint64_t epochTimestamp;  ///< The epoch, in nanoseconds.
+
+    StringTable files;         ///< The ids of file names.
+    StringTable formats;       ///< The ids of format strings.
+};
+
+/**
+ * Reads the messages in a binary log written by a BinaryFileBackend.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+class BinaryLogReader
+{
+  public:
+    /**
+     * Constructs a new BinaryLogReader and reads the header of the log.
+     *
+     * @since  0.7
+     *
+     * @param [in,out] in The stream to read the log from.  It should be opened
+     * in binary mode.
+     *
+     * @throws std::runtime_error If the stream does not hold a binary log of a
+     * version this reader understands.
+     */
+    explicit BinaryLogReader (std::istream &in);
+
+    /**
+     * Reads the next message in the log.
+     *
+     * @since  0.7
+     *
+     * @param [out] record The message.  Its strings belong to the reader and
+     * are only valid until the next call.  Unformatted messages are formatted,
+     * but their format string and arguments are also given.
+     *
+     * @return Whether there was another message.
+     * @retval false At the end of the log, or if the rest of the log was cut
+     * off (for instance, because the program crashed while writing it).
+     *
+     * @throws std::runtime_error If the log is corrupt.
+     */
+    bool Next (Record &record);
+
+    /**
+     * Returns when the log was started.
+     *
+     * @since  0.7
+     *
+     * @return The epoch in the header of the log.
+     */
+    inline std::time_t GetEpoch () const;
+
+  private:
+    std::istream &in;                ///< Where the log comes from.
+    std::uint64_t ticksPerSecond;    ///< The unit of the timestamps.
+    std::time_t epoch;               ///< When the log was started.
+    std::vector<char> payload;       ///< The record being read.
+    std::vector<std::string> names;  ///< File names, by id.
+    std::vector<std::string> formats;  ///< Format strings, by id.
+    std::string formatted;           ///< The last unformatted message.
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_BINARYLOG
@@ -0,0 +1,69 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_BINARYLOG_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_BINARYLOG_INL
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+namespace binarylog {
+
+std::size_t
+PutVarint (char *out, std::uint64_t value)
+{
+  std::size_t n = 0;
+  while (value >= 0x80)
+    {
+      out[n++] = static_cast<char> ((value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+  out[n++] = static_cast<char> (value);
+  return n;
+}
+
+std::uint64_t
+Zigzag (std::int64_t value)
+{
+  return (static_cast<std::uint64_t> (value) << 1) ^
+         static_cast<std::uint64_t> (value >> 63);
+}
+
+std::int64_t
+Unzigzag (std::uint64_t value)
+{
+  return static_cast<std::int64_t> (value >> 1) ^
+         -static_cast<std::int64_t> (value & 1);
+}
+
+}
+
+std::time_t
+BinaryLogReader::GetEpoch ()
+  const
+{
+  return epoch;
+}
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_BINARYLOG_INL
@@ -0,0 +1,264 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines HUMMSTRUMM_ENGINE_LOGF(), which logs a format string and its
+ * arguments without formatting them on the thread that logs.
+ *
+ * The arguments are encoded one after another, each as a type byte followed by
+ * the value in the machine's byte order:
+ *
+ * @verbatim
+   signed integer     8 bytes (std::int64_t)
+   unsigned integer   8 bytes (std::uint64_t)
+   floating point     8 bytes (double)
+   character          1 byte
+   boolean            1 byte
+   string             4 bytes of length (std::uint32_t), then the characters
+   pointer            8 bytes (std::uint64_t)
+   id                 8 bytes (std::uint64_t)
+   @endverbatim
+ *
+ * @file   debug/logging/deferred.hpp
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_DEFERRED
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_DEFERRED
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+/**
+ * The type byte in front of each encoded argument.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+enum class ArgumentType : unsigned char
+{
+    signedInteger = 1,
+    unsignedInteger = 2,
+    floatingPoint = 3,
+    character = 4,
+    boolean = 5,
+    string = 6,
+    pointer = 7,
+    id = 8
+};
+
+/**
+ * An argument read back by DecodeArgument().
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct Argument
+{
+    /// What kind of argument it is.
+    ArgumentType type;
+    /// The value of a signed integer.
+    std::int64_t signedValue;
+    /// The value of an unsigned integer, a boolean, a pointer, or an id.
+    std::uint64_t unsignedValue;
+    /// The value of a floating point number.
+    double floatValue;
+    /// The characters of a string or a character.  This points into the
+    /// encoded arguments and is not nul-terminated.
+    const char *text;
+    /// The number of characters in text.
+    std::size_t textLength;
+};
+
+/**
+ * Appends a @c bool to a buffer of encoded arguments.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] out The buffer.
+ * @param [in] value The argument.
+ */
+inline void EncodeArgument (std::vector<char> &out, bool value);
+/**
+ * @copydoc EncodeArgument(std::vector<char> &, bool)
+ */
+inline void EncodeArgument (std::vector<char> &out, char value);
+/**
+ * Appends a string to a buffer of encoded arguments.  The characters are
+ * copied, so the string does not have to outlive the call.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] out The buffer.
+ * @param [in] value The argument.  A @c nullptr is encoded as "(null)".
+ */
+inline void EncodeArgument (std::vector<char> &out, const char *value);
+/**
+ * @copydoc EncodeArgument(std::vector<char> &, const char *)
+ */
+inline void EncodeArgument (std::vector<char> &out, const std::string &value);
+/**
+ * Appends a pointer to a buffer of encoded arguments.  Only the address is
+ * kept.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] out The buffer.
+ * @param [in] value The argument.
+ */
+inline void EncodeArgument (std::vector<char> &out, const void *value);
+/**
+ * Appends an integer or floating point number to a buffer of encoded
+ * arguments.  Enumerations are encoded as their underlying type.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] out The buffer.
+ * @param [in] value The argument.
+ */
+template <typename T>
+inline typename std::enable_if<std::is_arithmetic<T>::value ||
+                               std::is_enum<T>::value>::type
+EncodeArgument (std::vector<char> &out, T value);
+
+/**
+ * Appends any number of arguments to a buffer of encoded arguments.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] out The buffer.
+ * @param [in] args The arguments.  Each must be a type that EncodeArgument()
+ * takes.
+ */
+template <typename... Args>
+inline void EncodeArguments (std::vector<char> &out, const Args &... args);
+
+/**
+ * Reads the next argument from a buffer of encoded arguments.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] position Where the argument starts.  On success, it is moved
+ * past the argument.
+ * @param [in] end The end of the buffer.
+ * @param [out] argument The argument.
+ *
+ * @return Whether there was a whole argument to read.
+ */
+bool DecodeArgument (const char *&position, const char *end,
+                     Argument &argument);
+
+/**
+ * Formats a message that was logged with HUMMSTRUMM_ENGINE_LOGF().  Each
+ * @c {} in the format string is replaced by the next argument, formatted the
+ * way an @c ostream would format it by default; ids are written as 16
+ * hexadecimal digits.  Write @c {{ and @c }} for literal braces.  Placeholders
+ * without an argument are left alone, and arguments without a placeholder are
+ * ignored.
+ *
+ * @since  0.7
+ *
+ * @param [out] out The formatted message.  Its storage is reused.
+ * @param [in] format The format string.
+ * @param [in] arguments The arguments, as written by EncodeArguments().
+ * @param [in] length The length of the arguments, in bytes.
+ */
+void FormatDeferred (std::string &out, const char *format,
+                     const char *arguments, std::size_t length);
+
+/**
+ * Formats the message of a Record that was logged with
+ * HUMMSTRUMM_ENGINE_LOGF(), if it hasn't been formatted yet.  Other Records are
+ * left alone.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] record The Record.  Its message will point into the buffer.
+ * @param [out] buffer Holds the formatted message.  Its storage is reused.
+ */
+void FormatRecord (Record &record, std::string &buffer);
+
+/**
+ * Sends a message to be formatted later to the StreamBuffer of a stream.  Use
+ * HUMMSTRUMM_ENGINE_LOGF() instead of calling this directly.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] log The stream to log to.
+ * @param [in] file The source file of the message.
+ * @param [in] line The source line of the message.
+ * @param [in] level The level of the message.
+ * @param [in] format The format string.  It must live as long as the
+ * program.
+ * @param [in] args The arguments.
+ */
+template <typename... Args>
+inline void LogDeferred (std::ostream &log, const char *file, unsigned line,
+                         Level level, const char *format,
+                         const Args &... args);
+
+
+}
+}
+}
+
+/**
+ * @def HUMMSTRUMM_ENGINE_LOGF
+ *
+ * Logs a message without formatting it on this thread.  The format string is
+ * kept as a pointer and the arguments are copied into a buffer that belongs to
+ * the stream, and they're sent to the backends of the stream as they are.  If
+ * the stream sends its messages through an AsyncQueue, the writer thread
+ * formats the message; a BinaryFileBackend doesn't format it at all, and
+ * leaves that to @c hummstrumm-logdump .  See FormatDeferred() for the syntax
+ * of the format string.
+ *
+ * Like HUMMSTRUMM_ENGINE_LOG(), nothing is evaluated if the level is disabled.
+ *
+ * @code
+ * HUMMSTRUMM_ENGINE_LOGF (engine.GetLog (), Level::info,
+ *                         "Loaded {} textures in {} ms.", count, time);
+ * @endcode
+ *
+ * @since  0.7
+ *
+ * @param [in] log The stream to log to.  It must have a
+ * debug::logging::StreamBuffer as a streambuf; otherwise, nothing is logged.
+ * @param [in] level The logging level to apply.  Only use the class name
+ * Level, double colon, and the level constant name.
+ * @param [in] ... The format string, which must be a string literal (or live
+ * as long as the program does), and then the arguments.
+ *
+ * @remarks This expands to a @c for statement (see
+ * HUMMSTRUMM_ENGINE_LOG_GUARD()), so it can only be used as a statement.  It
+ * can be the body of an @c if without braces.
+ */
+#define HUMMSTRUMM_ENGINE_LOGF(log, level, ...)                       \
+  HUMMSTRUMM_ENGINE_LOG_GUARD (level)                                 \
+    hummstrummengine::debug::logging::LogDeferred (                   \
+      (log), __FILE__, __LINE__,                                      \
+      hummstrummengine::debug::logging::level, __VA_ARGS__)
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_DEFERRED
@@ -0,0 +1,167 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_DEFERRED_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_DEFERRED_INL
+
+#include <cstdint>
+#include <cstring>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+namespace detail {
+
+// Appends a type byte and the bytes of a value.
+template <typename T>
+inline void
+AppendArgument (std::vector<char> &out, ArgumentType type, const T &value)
+{
+  std::size_t size = out.size ();
+  out.resize (size + 1 + sizeof value);
+  out[size] = static_cast<char> (type);
+  std::memcpy (&out[size + 1], &value, sizeof value);
+}
+
+// Integers, by signedness.
+template <typename T>
+inline void
+EncodeNumber (std::vector<char> &out, T value, std::true_type, std::false_type)
+{
+  if (std::is_signed<T>::value)
+    AppendArgument (out, ArgumentType::signedInteger,
+                    static_cast<std::int64_t> (value));
+  else
+    AppendArgument (out, ArgumentType::unsignedInteger,
+                    static_cast<std::uint64_t> (value));
+}
+
+// Floating point numbers.
+template <typename T>
+inline void
+EncodeNumber (std::vector<char> &out, T value, std::false_type, std::true_type)
+{
+  AppendArgument (out, ArgumentType::floatingPoint,
+                  static_cast<double> (value));
+}
+
+// Enumerations.
+template <typename T>
+inline void
+EncodeNumber (std::vector<char> &out, T value, std::false_type,
+              std::false_type)
+{
+  typedef typename std::underlying_type<T>::type Underlying;
+  EncodeArgument (out, static_cast<Underlying> (value));
+}
+
+inline void
+EncodeString (std::vector<char> &out, const char *value, std::size_t length)
+{
+  std::uint32_t encodedLength = static_cast<std::uint32_t> (length);
+  std::size_t size = out.size ();
+  out.resize (size + 1 + sizeof encodedLength + encodedLength);
+  out[size] = static_cast<char> (ArgumentType::string);
+  std::memcpy (&out[size + 1], &encodedLength, sizeof encodedLength);
+  if (encodedLength != 0)
+    std::memcpy (&out[size + 1 + sizeof encodedLength], value, encodedLength);
+}
+
+inline void
+EncodeArguments (std::vector<char> &)
+{
+}
+
+template <typename T, typename... Rest>
+inline void
+EncodeArguments (std::vector<char> &out, const T &first, const Rest &... rest)
+{
+  EncodeArgument (out, first);
+  EncodeArguments (out, rest...);
+}
+
+}
+
+void
+EncodeArgument (std::vector<char> &out, bool value)
+{
+  detail::AppendArgument (out, ArgumentType::boolean,
+                          static_cast<unsigned char> (value));
+}
+
+void
+EncodeArgument (std::vector<char> &out, char value)
+{
+  detail::AppendArgument (out, ArgumentType::character, value);
+}
+
+void
+EncodeArgument (std::vector<char> &out, const char *value)
+{
+  if (!value)
+    value = "(null)";
+  detail::EncodeString (out, value, std::strlen (value));
+}
+
+void
+EncodeArgument (std::vector<char> &out, const std::string &value)
+{
+  detail::EncodeString (out, value.data (), value.size ());
+}
+
+void
+EncodeArgument (std::vector<char> &out, const void *value)
+{
+  detail::AppendArgument (out, ArgumentType::pointer,
+                          static_cast<std::uint64_t> (
+                            reinterpret_cast<std::uintptr_t> (value)));
+}
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value ||
+                        std::is_enum<T>::value>::type
+EncodeArgument (std::vector<char> &out, T value)
+{
+  detail::EncodeNumber (out, value, typename std::is_integral<T>::type (),
+                        typename std::is_floating_point<T>::type ());
+}
+
+template <typename... Args>
+void
+EncodeArguments (std::vector<char> &out, const Args &... args)
+{
+  detail::EncodeArguments (out, args...);
+}
+
+template <typename... Args>
+void
+LogDeferred (std::ostream &log, const char *file, unsigned line, Level level,
+             const char *format, const Args &... args)
+{
+  StreamBuffer *buffer = dynamic_cast<StreamBuffer *> (log.rdbuf ());
+  if (buffer)
+    buffer->SendDeferred (file, line, level, format, args...);
+}
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_DEFERRED_INL
@@ -0,0 +1,119 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::logging::Dispatcher, which passes finished log messages from
+ * any number of logging::StreamBuffer objects to a shared set of backends.
+ *
+ * @file   debug/logging/dispatcher.hpp
+ * @see    Dispatcher
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_DISPATCHER
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_DISPATCHER
+
+#include <ctime>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+// Forward declare for safety.
+class Backend;
+class AsyncQueue;
+struct Record;
+
+/**
+ * The meeting point of all the streams of a log.  Each thread writes to its own
+ * logging::StreamBuffer, so threads never have to wait on each other while they
+ * build a message.  When a message is flushed, the StreamBuffer hands it to the
+ * Dispatcher, which is shared by all the StreamBuffers of the log.
+ *
+ * If the Dispatcher has an AsyncQueue, the message is queued for the queue's
+ * writer thread.  Otherwise, the backends are called right away under a mutex,
+ * so that a backend is never called from two threads at once.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+class Dispatcher
+{
+  public:
+    /**
+     * Constructs a new Dispatcher for the given backends.
+     *
+     * @since  0.7
+     *
+     * @param [in] backends The backends to which to send messages.
+     * @param [in] queue A queue whose writer thread sends messages to the
+     * backends, or @c nullptr to send them on the thread that flushes.
+     */
+    Dispatcher (std::vector<std::shared_ptr<Backend>> backends,
+                std::unique_ptr<AsyncQueue> queue = nullptr);
+    /**
+     * Destructs an existing Dispatcher.  Any messages still waiting in the
+     * AsyncQueue are written first, after the counts of messages rate limited
+     * call sites suppressed (see ReportSuppressed()).
+     *
+     * @since  0.7
+     */
+    ~Dispatcher ();
+
+    /**
+     * Sends a message to each backend, either directly or through the
+     * AsyncQueue.  This may be called from any thread.
+     *
+     * @since  0.7
+     *
+     * @param [in] record The message.  Its strings only have to stay valid
+     * until this returns.
+     */
+    void Send (const Record &record);
+
+    /**
+     * Waits until every message that has been sent has reached the backends.
+     * The counts of messages that rate limited call sites suppressed since
+     * their last summary are sent first (see ReportSuppressed()).
+     *
+     * @since  0.7
+     */
+    void Flush ();
+
+  private:
+    /// Send messages to these backends.
+    std::vector<std::shared_ptr<Backend>> backends;
+    /// The queue that sends messages asynchronously, if any.
+    std::unique_ptr<AsyncQueue> queue;
+    /// Keeps two threads from calling the backends at once.
+    debug::Mutex backendMutex;
+    /// Whether some backend needs unformatted messages formatted for it.
+    bool formatMessages;
+    /// Where unformatted messages are formatted, under the backend mutex.
+    std::string formatted;
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_DISPATCHER
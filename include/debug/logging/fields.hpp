@@ -0,0 +1,136 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines Field(), which attaches a structured field to a log message, and Id,
+ * the type of field values that name things.
+ *
+ * Fields travel to the backends in the binary encoding of EncodeArguments(),
+ * next to the message, so attaching one costs a copy of its value and nothing
+ * is turned into text on the thread that logs.  A backend that understands
+ * them, such as JsonLinesBackend, writes them out; the others ignore them.
+ *
+ * @code
+ * HUMMSTRUMM_ENGINE_LOG (engine.GetLog (), Level::info)
+ *   << Field ("frame", frame) << Field ("ms", milliseconds)
+ *   << Field ("entity", Id (entity)) << "Frame finished." << std::flush;
+ * @endcode
+ *
+ * @file   debug/logging/fields.hpp
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_FIELDS
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_FIELDS
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+/**
+ * An identifier, such as the number of an entity or an asset.  Unlike an
+ * integer, an id is written as 16 hexadecimal digits, and JsonLinesBackend
+ * writes it as a string, so that no tool rounds it to a floating point number.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct Id
+{
+    /**
+     * Constructs and initializes the id.
+     *
+     * @since  0.7
+     *
+     * @param [in] value The number of the thing.
+     */
+    inline explicit Id (std::uint64_t value);
+
+    std::uint64_t value;
+};
+
+/**
+ * Appends an id to a buffer of encoded arguments.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] out The buffer.
+ * @param [in] value The argument.
+ */
+inline void EncodeArgument (std::vector<char> &out, Id value);
+
+/**
+ * An @c iostream manipulator that attaches a structured field to the message
+ * being built.  Use Field() to make one.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+template <typename T>
+struct AddField
+{
+    /**
+     * Constructs and initializes the manipulator.
+     *
+     * @since  0.7
+     *
+     * @param [in] key The name of the field.
+     * @param [in] value The value of the field.
+     */
+    inline AddField (const char *key, const T &value);
+
+    const char *key;
+    const T &value;
+};
+
+/**
+ * Makes a manipulator that attaches a structured field to the message being
+ * built.  The value may be anything EncodeArgument() takes: an integer, a
+ * floating point number, a string, an Id, and so on.  It is copied when the
+ * manipulator is applied.
+ *
+ * @since  0.7
+ *
+ * @param [in] key The name of the field.
+ * @param [in] value The value of the field.
+ *
+ * @return The manipulator.
+ */
+template <typename T>
+inline AddField<T> Field (const char *key, const T &value);
+
+/**
+ * Applies the manipulator to an @c ostream .  This only succeeds if the @c
+ * ostream object has a streambuf of type debug::logging::StreamBuffer.
+ *
+ * @since  0.7
+ *
+ * @return The @c ostream object passed in.
+ */
+template <typename T>
+inline std::ostream &operator<< (std::ostream &, const AddField<T> &);
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_FIELDS
@@ -0,0 +1,65 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_FIELDS_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_FIELDS_INL
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+
+Id::Id (std::uint64_t value)
+  : value (value)
+{}
+
+void
+EncodeArgument (std::vector<char> &out, Id value)
+{
+  detail::AppendArgument (out, ArgumentType::id, value.value);
+}
+
+template <typename T>
+AddField<T>::AddField (const char *key, const T &value)
+  : key (key),
+    value (value)
+{}
+
+template <typename T>
+AddField<T>
+Field (const char *key, const T &value)
+{
+  return AddField<T> (key, value);
+}
+
+template <typename T>
+std::ostream &
+operator<< (std::ostream &out, const AddField<T> &manip)
+{
+  StreamBuffer *buf = dynamic_cast<StreamBuffer *> (out.rdbuf ());
+  if (buf)
+    buf->AddField (manip.key, manip.value);
+  return out;
+}
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_FIELDS_INL
@@ -0,0 +1,134 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::logging::JsonLinesBackend, which writes log messages and
+ * their structured fields as one JSON object per line.
+ *
+ * @file   debug/logging/jsonlines.hpp
+ * @see    JsonLinesBackend
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_JSONLINES
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_JSONLINES
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+/**
+ * A log backend that writes each message as a line of JSON, so that tools can
+ * read the structured fields attached with Field() instead of parsing the
+ * text of the message:
+ *
+ * @verbatim
+   {"time":"2012-06-14T02:09:18.123456789Z","thread":1,"file":"game.cpp",
+    "line":52,"level":"info","message":"Frame finished.",
+    "fields":{"frame":1200,"ms":16.4,"entity":"00000000000004d2"}}
+   @endverbatim
+ *
+ * (without the line breaks).  Integers and floating point numbers are written
+ * as JSON numbers, booleans as @c true or @c false , and strings, characters,
+ * pointers, and ids as JSON strings.  Floating point numbers that JSON can't
+ * hold, such as infinity, are written as @c null .  The @c fields member is
+ * left out of messages without fields.
+ *
+ * The lines are built in a buffer that is allocated up front and written to the
+ * file when it is full, so writing a message doesn't allocate.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @warning Messages that are still in the write buffer when the program
+ * crashes are lost.
+ */
+class JsonLinesBackend : public Backend
+{
+  public:
+    /**
+     * Constructs a new JsonLinesBackend.
+     *
+     * @since  0.7
+     *
+     * @param [in] allowedLevels The levels that this backend should print, OR'd
+     * together.
+     * @param [in] file The name of the log file.
+     * @param [in] bufferSize How many bytes to collect before writing them to
+     * the file.
+     */
+    JsonLinesBackend (Level allowedLevels = Level::all,
+                      std::string file = "hummstrummengine.jsonl",
+                      std::size_t bufferSize = 1 << 20);
+    /**
+     * Destructs an existing JsonLinesBackend, writing out anything that is
+     * still buffered.
+     *
+     * @since  0.7
+     */
+    virtual ~JsonLinesBackend ();
+
+    /**
+     * Adds a message to the write buffer as a line of JSON.  The buffer is
+     * written to the file when it is full.
+     *
+     * @since  0.7
+     *
+     * @param [in] record The message and where it came from.
+     *
+     * @see debug::logging::Backend
+     */
+    virtual void operator() (const Record &record);
+
+    /**
+     * Writes everything in the buffer to the file.
+     *
+     * @since  0.7
+     */
+    void Flush ();
+
+  private:
+    /**
+     * Adds bytes to the buffer.
+     */
+    void Put (const char *text, std::size_t length);
+    /**
+     * Adds a string to the buffer as a quoted JSON string.
+     */
+    void PutString (const char *text, std::size_t length);
+    /**
+     * Adds the value of a field to the buffer.
+     */
+    void PutValue (const Argument &value);
+
+    std::ofstream fileStream;  ///< The file we should write to.
+    std::vector<char> buffer;  ///< Bytes not yet written to the file.
+    std::size_t used;          ///< How much of the buffer is full.
+    TimestampFormatter timestamps; ///< Formats the times of messages.
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_JSONLINES
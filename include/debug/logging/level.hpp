@@ -28,6 +28,8 @@
 #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_LEVEL
 #define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_LEVEL
 
+#include <atomic>
+
 namespace hummstrummengine {
 namespace debug {
 namespace logging {
@@ -71,6 +73,56 @@ inline Level operator&(const Level &, const Level &);
  */
 inline Level operator|(const Level &, const Level &);
 
+/**
+ * Returns the name of a level, as it is written in logs.
+ *
+ * @since  0.7
+ *
+ * @param [in] level The level.  It must be one level, not several OR'd
+ * together.
+ *
+ * @return @c "info" , @c "success" , @c "warning" , or @c "error" , or
+ * @c "none" for anything else.
+ */
+const char *GetLevelName (Level level);
+
+/**
+ * Returns whether messages of a level can reach any backend.  The logging
+ * macros check this before they format anything, so a disabled message costs
+ * one load and one branch.
+ *
+ * @since  0.7
+ *
+ * @param [in] level The level to check.
+ *
+ * @return Whether messages of the level should be logged.
+ */
+inline bool IsLevelEnabled (Level level);
+/**
+ * Returns the levels that are currently enabled, OR'd together.
+ *
+ * @since  0.7
+ *
+ * @return The enabled levels.
+ */
+inline Level GetEnabledLevels ();
+/**
+ * Changes which levels are enabled.  core::Engine sets this to the levels that
+ * its backends accept, but you can turn off more levels at any time.
+ *
+ * @since  0.7
+ *
+ * @param [in] levels The levels to enable, OR'd together.
+ */
+inline void SetEnabledLevels (Level levels);
+
+namespace detail {
+
+/// The levels that are enabled, as a mask of Level values.
+extern std::atomic<unsigned> enabledLevels;
+
+}
+
 
 }
 }
@@ -40,6 +40,25 @@ inline Level operator|(const Level &a, const Level &b)
     static_cast<const std::underlying_type<Level>::type> (b));
 }
 
+inline bool IsLevelEnabled (Level level)
+{
+  return (detail::enabledLevels.load (std::memory_order_relaxed) &
+          static_cast<std::underlying_type<Level>::type> (level)) != 0;
+}
+
+inline Level GetEnabledLevels ()
+{
+  return static_cast<Level> (
+    detail::enabledLevels.load (std::memory_order_relaxed));
+}
+
+inline void SetEnabledLevels (Level levels)
+{
+  detail::enabledLevels.store (
+    static_cast<std::underlying_type<Level>::type> (levels),
+    std::memory_order_relaxed);
+}
+
 
 }
 }
@@ -47,10 +47,10 @@ namespace logging {
  * log << SetFile (__FILE__) << "Testing file..." << std::flush;
  * @endcode
  *
- * Note that you can use the HummstrummSetLogging() macro to automatically use
- * this manipulator, the Lock manipulator, the SetLine manipulator, and the
- * SetLevel manipulator, using the default values of @c __FILE__ and @c __LINE__
- * and the provided log level.
+ * Note that you can use the HUMMSTRUMM_ENGINE_SET_LOGGING() macro to
+ * automatically use this manipulator, the SetLine manipulator, and the SetLevel
+ * manipulator, using the default values of @c __FILE__ and @c __LINE__ and the
+ * provided log level.
  * 
  * @version 0.6
  * @author  Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
@@ -90,10 +90,10 @@ struct SetFile
  * log << SetLine (__LINE__) << "Testing file..." << std::flush;
  * @endcode
  *
- * Note that you can use the HummstrummSetLogging() macro to automatically use
- * this manipulator, the Lock manipulator, the SetFile manipulator, and the
- * SetLevel manipulator, using the default values of @c __FILE__ and @c __LINE__
- * and the provided log level.
+ * Note that you can use the HUMMSTRUMM_ENGINE_SET_LOGGING() macro to
+ * automatically use this manipulator, the SetFile manipulator, and the SetLevel
+ * manipulator, using the default values of @c __FILE__ and @c __LINE__ and the
+ * provided log level.
  * 
  * @version 0.6
  * @author  Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
@@ -133,10 +133,10 @@ struct SetLine
  * log << SetLevel (Level::INFO) << "Testing file..." << std::flush;
  * @endcode
  *
- * Note that you can use the HummstrummSetLogging() macro to automatically use
- * this manipulator, the Lock manipulator, the SetFile manipulator, and the
- * SetLine manipulator, using the default values of @c __FILE__ and @c __LINE__
- * and the provided log level.
+ * Note that you can use the HUMMSTRUMM_ENGINE_SET_LOGGING() macro to
+ * automatically use this manipulator, the SetFile manipulator, and the SetLine
+ * manipulator, using the default values of @c __FILE__ and @c __LINE__ and the
+ * provided log level.
  * 
  * @version 0.6
  * @author  Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
@@ -166,31 +166,54 @@ struct SetLevel
 };
 
 /**
- * An @c iostream manipulator for locking the log stream so that two messages
- * cannot be sent at once.  This manipulator works by setting a flag in the
- * StreamBuffer on the first time it is called after a flush, and waiting until
- * it is able to lock again on a subsequent call before a flush.  This
+ * An @c iostream manipulator for setting the file, line, and level of a message
+ * for a log all at once.  This is what HUMMSTRUMM_ENGINE_SET_LOGGING() uses,
+ * because it only has to look up the StreamBuffer of the stream once.  This
  * manipulator only works for @c ostream objects that have a
  * debug::logging::StreamBuffer as a streambuf.
  *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @note Unlike SetLevel, this does not check that the level is one of the
+ * predefined constants.
+ */
+struct SetLogging
+{
+    /**
+     * Constructs and initializes the manipulator.
+     *
+     * @since  0.7
+     *
+     * @param [in] file The source file of the message.
+     * @param [in] line The source line of the message.
+     * @param [in] level The level of the message.
+     */
+    inline SetLogging (const char *file, unsigned line, Level level);
+
+    const char *file;
+    unsigned line;
+    Level level;
+};
+
+/**
+ * An @c iostream manipulator that used to lock the log stream so that two
+ * messages could not be sent at once.  Since core::Engine::GetLog() gives each
+ * thread its own stream, there is nothing left to lock, and this manipulator
+ * does nothing.  It is kept so that existing code still compiles.
+ *
  * The basic usage is as follows:
  *
  * @code
- * log << Lock << "Testing file..." << std::flush; // flush unlocks
+ * log << Lock << "Testing file..." << std::flush;
  * @endcode
- *
- * Note that you can use the HummstrummSetLogging() macro to automatically use
- * this manipulator, the SetFile and SetLine manipulators, and the SetLevel
- * manipulator, using the default values of @c __FILE__ and @c __LINE__ and the
- * provided log level.
  * 
- * @version 0.6
- * @author  Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
- * @date    2012-06-15
+ * @version 0.7
  * @since   0.6
  *
- * @note This structure is intentionally empty.  Work is done in the overloaded
- * operator<<() function.
+ * @deprecated Use a separate stream for each thread instead.
+ *
+ * @note This structure is intentionally empty.
  */
 struct LockType
 { };
@@ -221,12 +244,20 @@ std::ostream &operator<< (std::ostream &, const SetLevel);
  * @copydoc hummstrummengine::debug::logging::operator<<(std::ostream &, const SetFile)
  */
 std::ostream &operator<< (std::ostream &, const LockType);
+/**
+ * @copydoc hummstrummengine::debug::logging::operator<<(std::ostream &, const SetFile)
+ */
+std::ostream &operator<< (std::ostream &, const SetLogging &);
 
 /**
  * @def HUMMSTRUMM_ENGINE_SET_LOGGING
  *
- * Applies the Lock, SetFile, SetLine, and SetLevel manipulators to an @c
- * ostream . This macro functions just like another manipulator.
+ * Sets the file, line, and level of the message on an @c ostream , like the
+ * SetFile, SetLine, and SetLevel manipulators would.  This macro functions just
+ * like another manipulator.
+ *
+ * The rest of the statement is still evaluated if no backend accepts the level.
+ * Use HUMMSTRUMM_ENGINE_LOG() so disabled messages cost nothing.
  *
  * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
  * @date   2012-06-15
@@ -235,19 +266,88 @@ std::ostream &operator<< (std::ostream &, const LockType);
  * @param [in] level The logging level to apply.  Only use the class name Level,
  * double colon, and the level constant name.
  *
- * @warning You must use this to be thread-safe!
+ * @warning The stream must not be shared between threads.  Use the stream
+ * returned by core::Engine::GetLog(), which is different for each thread.
  *
  * @todo Implement logging levels.
  *
  * @remarks We unfortunately have to have this as a macro, because it uses the
  * default macros @c __FILE__ and @c __LEVEL__ .
  */
-#define HUMMSTRUMM_ENGINE_SET_LOGGING(level)				\
-  hummstrummengine::debug::logging::Lock <<                           \
-  hummstrummengine::debug::logging::SetFile (__FILE__) <<             \
-  hummstrummengine::debug::logging::SetLine (__LINE__) <<             \
-  hummstrummengine::debug::logging::SetLevel (                        \
-    hummstrummengine::debug::logging::level)
+#define HUMMSTRUMM_ENGINE_SET_LOGGING(level)                          \
+  hummstrummengine::debug::logging::SetLogging (                      \
+    __FILE__, __LINE__, hummstrummengine::debug::logging::level)
+
+#ifndef HUMMSTRUMM_ENGINE_LOG_MIN_LEVEL
+#  define HUMMSTRUMM_ENGINE_LOG_MIN_LEVEL 1
+#endif
+
+/**
+ * @def HUMMSTRUMM_ENGINE_LOG_ENABLED
+ *
+ * Evaluates to whether a message of the given level would be logged.  A level
+ * less severe than the @c MINIMUM_LOG_LEVEL chosen when the engine was
+ * configured is a constant @c false ; otherwise, the levels enabled with
+ * SetEnabledLevels() are checked.
+ *
+ * @since  0.7
+ *
+ * @param [in] level The logging level to check.  Only use the class name
+ * Level, double colon, and the level constant name.
+ */
+#define HUMMSTRUMM_ENGINE_LOG_ENABLED(level)                          \
+  (static_cast<unsigned> (hummstrummengine::debug::logging::level) >= \
+     HUMMSTRUMM_ENGINE_LOG_MIN_LEVEL &&                               \
+   hummstrummengine::debug::logging::IsLevelEnabled (                 \
+     hummstrummengine::debug::logging::level))
+
+/**
+ * @def HUMMSTRUMM_ENGINE_LOG_GUARD
+ *
+ * Starts a statement that only runs if the level is enabled.  The logging
+ * macros begin with this.  It is a @c for loop that runs at most once rather
+ * than an @c if , so an @c else after the statement belongs to the @c if
+ * around it, and compilers don't suggest braces when a logging macro is the
+ * body of an @c if .
+ *
+ * @since  0.7
+ *
+ * @param [in] level The logging level to check.  Only use the class name
+ * Level, double colon, and the level constant name.
+ */
+#define HUMMSTRUMM_ENGINE_LOG_GUARD(level)                            \
+  for (bool hummstrummEnabled = HUMMSTRUMM_ENGINE_LOG_ENABLED (level); \
+       hummstrummEnabled; hummstrummEnabled = false)
+
+/**
+ * @def HUMMSTRUMM_ENGINE_LOG
+ *
+ * Starts a log message on a stream, like HUMMSTRUMM_ENGINE_SET_LOGGING() does,
+ * but only if the level is enabled.  If it isn't, nothing else in the statement
+ * is evaluated, not even the expression for the stream.  Levels that were
+ * compiled out with @c MINIMUM_LOG_LEVEL cost nothing at all, and levels
+ * turned off at run time cost one predictable branch.
+ *
+ * The basic usage is as follows:
+ *
+ * @code
+ * HUMMSTRUMM_ENGINE_LOG (engine.GetLog (), Level::info)
+ *   << "Loaded " << count << " textures." << std::flush;
+ * @endcode
+ *
+ * @since  0.7
+ *
+ * @param [in] log The stream to log to.
+ * @param [in] level The logging level to apply.  Only use the class name
+ * Level, double colon, and the level constant name.
+ *
+ * @remarks This expands to a @c for statement (see
+ * HUMMSTRUMM_ENGINE_LOG_GUARD()), so it can only be used at the start of a
+ * statement.  It can be the body of an @c if without braces.
+ */
+#define HUMMSTRUMM_ENGINE_LOG(log, level)                             \
+  HUMMSTRUMM_ENGINE_LOG_GUARD (level)                                 \
+    (log) << HUMMSTRUMM_ENGINE_SET_LOGGING (level)
 
 
 }
@@ -52,6 +52,14 @@ SetLevel::~SetLevel ()
 }
 
 
+SetLogging::SetLogging (const char *f, unsigned l, Level lev)
+  : file (f),
+    line (l),
+    level (lev)
+{
+}
+
+
 }
 }
 }
@@ -0,0 +1,344 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines logging macros that limit how often a single line of code can log:
+ * HUMMSTRUMM_ENGINE_LOG_RATE_LIMITED() and HUMMSTRUMM_ENGINE_LOG_SAMPLED(), and
+ * their HUMMSTRUMM_ENGINE_LOGF() counterparts.
+ *
+ * Each use of one of these macros keeps its own CallSite in a static variable,
+ * so one noisy loop doesn't silence the rest of the program, and deciding
+ * whether a message passes only takes a few atomic operations.  The number of
+ * messages that didn't pass is logged from the same file and line, at most once
+ * a second, just before the next message that passes:
+ *
+ * @verbatim
+   Suppressed 1832 messages from this call site.
+   @endverbatim
+ *
+ * If no message passes after a burst, the count is logged when the log is
+ * flushed or destroyed instead (see ReportSuppressed()).
+ *
+ * @file   debug/logging/ratelimit.hpp
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RATELIMIT
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RATELIMIT
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+// Forward declare for safety.
+class Dispatcher;
+
+/**
+ * What a rate limited or sampled call site remembers between messages.  The
+ * macros in this file declare one as a static variable for each place they are
+ * used.
+ *
+ * This is an aggregate with no constructor, so a static CallSite is
+ * zero-initialized before the program starts and never needs a lock to be
+ * constructed.  The first message that passes adds the CallSite to a list of
+ * every call site, which ReportSuppressed() walks.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct CallSite
+{
+    /// For rate limiting, when the bucket will next be full, in nanoseconds
+    /// since 1970; for sampling, how many messages have been seen.
+    std::atomic<std::uint64_t> state;
+    /// How many messages didn't pass since the last summary.
+    std::atomic<std::uint64_t> suppressed;
+    /// When the last summary was logged, in nanoseconds since 1970.
+    std::atomic<std::uint64_t> lastSummary;
+    /// The Dispatcher of the log to which the last message that passed went,
+    /// or @c nullptr if that Dispatcher is gone.
+    std::atomic<Dispatcher *> dispatcher;
+    /// Whether this call site is in the list of call sites.
+    std::atomic<bool> listed;
+    /// The next call site in the list of call sites.
+    CallSite *next;
+    /// The source file of the call site, once it is listed.
+    const char *file;
+    /// The source line of the call site, once it is listed.
+    unsigned line;
+    /// The level of the call site, once it is listed.
+    Level level;
+};
+
+/**
+ * Whether a message passed a rate limit or sampler, and how many messages to
+ * report as suppressed before it.  Sending this to a log stream logs the
+ * summary, if there is one.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct Suppressed
+{
+    /**
+     * Constructs and initializes the result.
+     *
+     * @since  0.7
+     *
+     * @param [in] site The state of the call site.
+     * @param [in] pass Whether the message should be logged.
+     * @param [in] count How many messages to report as suppressed.
+     * @param [in] file The source file of the call site.
+     * @param [in] line The source line of the call site.
+     * @param [in] level The level of the call site.
+     */
+    inline Suppressed (CallSite &site, bool pass, std::uint64_t count,
+                       const char *file, unsigned line, Level level);
+
+    CallSite *site;
+    bool pass;
+    std::uint64_t count;
+    const char *file;
+    unsigned line;
+    Level level;
+};
+
+/**
+ * Decides whether a message passes a token bucket rate limit.  The bucket holds
+ * @p burst messages and refills at @p perSecond messages a second.  Use
+ * HUMMSTRUMM_ENGINE_LOG_RATE_LIMITED() instead of calling this directly.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] site The state of the call site.
+ * @param [in] perSecond How many messages a second pass over a long time.
+ * @param [in] burst How many messages can pass at once after a quiet period.
+ * @param [in] file The source file of the call site.
+ * @param [in] line The source line of the call site.
+ * @param [in] level The level of the call site.
+ *
+ * @return Whether the message passes, and the summary to log before it.
+ */
+inline Suppressed RateLimit (CallSite &site, double perSecond, unsigned burst,
+                             const char *file, unsigned line, Level level);
+
+/**
+ * Decides whether a message passes a sampler that lets the first of every
+ * @p every messages through.  Use HUMMSTRUMM_ENGINE_LOG_SAMPLED() instead of
+ * calling this directly.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] site The state of the call site.
+ * @param [in] every One in how many messages pass.
+ * @param [in] file The source file of the call site.
+ * @param [in] line The source line of the call site.
+ * @param [in] level The level of the call site.
+ *
+ * @return Whether the message passes, and the summary to log before it.
+ */
+inline Suppressed Sample (CallSite &site, unsigned every, const char *file,
+                          unsigned line, Level level);
+
+/**
+ * Logs the number of suppressed messages as a message of its own, if there
+ * were any, and remembers the log's Dispatcher in the CallSite.  This only
+ * succeeds if the @c ostream object has a streambuf of type
+ * debug::logging::StreamBuffer.
+ *
+ * @since  0.7
+ *
+ * @return The @c ostream object passed in.
+ */
+std::ostream &operator<< (std::ostream &, const Suppressed &);
+
+/**
+ * Logs the number of suppressed messages of every call site whose last message
+ * went to @p dispatcher, if there were any, without waiting for the next
+ * message to pass.  Dispatcher::Flush() and the Dispatcher's destructor call
+ * this, so a burst of messages followed by silence is still summarized.
+ *
+ * @since  0.7
+ *
+ * @param [in] dispatcher The Dispatcher to which to send the summaries.
+ */
+void ReportSuppressed (Dispatcher &dispatcher);
+
+/**
+ * Makes every call site whose last message went to @p dispatcher forget it.
+ * The Dispatcher's destructor calls this.
+ *
+ * @since  0.7
+ *
+ * @param [in] dispatcher The Dispatcher that is being destroyed.
+ */
+void ForgetDispatcher (Dispatcher &dispatcher);
+
+
+}
+}
+}
+
+/**
+ * @def HUMMSTRUMM_ENGINE_LOG_CALL_SITE
+ *
+ * Evaluates to a reference to a static CallSite that belongs to this use of the
+ * macro.  Each lambda has its own type, so each has its own static variable.
+ *
+ * @since  0.7
+ */
+#define HUMMSTRUMM_ENGINE_LOG_CALL_SITE()                             \
+  ([]() -> hummstrummengine::debug::logging::CallSite & {             \
+    static hummstrummengine::debug::logging::CallSite site;           \
+    return site;                                                      \
+  } ())
+
+/**
+ * @def HUMMSTRUMM_ENGINE_LOG_RATE_LIMITED
+ *
+ * Starts a log message like HUMMSTRUMM_ENGINE_LOG() does, but only lets
+ * @p perSecond messages a second through from this line of code, with bursts of
+ * up to @p burst messages.  Messages that don't pass cost a clock reading and
+ * an atomic add; nothing else in the statement is evaluated.
+ *
+ * @code
+ * HUMMSTRUMM_ENGINE_LOG_RATE_LIMITED (engine.GetLog (), Level::warning, 1, 5)
+ *   << "Entity " << id << " fell out of the world." << std::flush;
+ * @endcode
+ *
+ * @since  0.7
+ *
+ * @param [in] log The stream to log to.
+ * @param [in] level The logging level to apply.  Only use the class name
+ * Level, double colon, and the level constant name.
+ * @param [in] perSecond How many messages a second pass over a long time.
+ * @param [in] burst How many messages can pass at once.
+ *
+ * @remarks This expands to a @c for statement (see
+ * HUMMSTRUMM_ENGINE_LOG_GUARD()), so it can only be used at the start of a
+ * statement.  It can be the body of an @c if without braces.
+ */
+#define HUMMSTRUMM_ENGINE_LOG_RATE_LIMITED(log, level, perSecond, burst) \
+  HUMMSTRUMM_ENGINE_LOG_GUARD (level)                                 \
+    for (hummstrummengine::debug::logging::Suppressed hummstrummPass = \
+           hummstrummengine::debug::logging::RateLimit (              \
+             HUMMSTRUMM_ENGINE_LOG_CALL_SITE (), (perSecond), (burst), \
+             __FILE__, __LINE__,                                      \
+             hummstrummengine::debug::logging::level);                \
+         hummstrummPass.pass; hummstrummPass.pass = false)            \
+      (log) << hummstrummPass << HUMMSTRUMM_ENGINE_SET_LOGGING (level)
+
+/**
+ * @def HUMMSTRUMM_ENGINE_LOG_SAMPLED
+ *
+ * Starts a log message like HUMMSTRUMM_ENGINE_LOG() does, but only lets the
+ * first of every @p every messages through from this line of code.  Messages
+ * that don't pass cost an atomic add; nothing else in the statement is
+ * evaluated.
+ *
+ * @code
+ * HUMMSTRUMM_ENGINE_LOG_SAMPLED (engine.GetLog (), Level::info, 100)
+ *   << "Frame took " << time << " ms." << std::flush;
+ * @endcode
+ *
+ * @since  0.7
+ *
+ * @param [in] log The stream to log to.
+ * @param [in] level The logging level to apply.  Only use the class name
+ * Level, double colon, and the level constant name.
+ * @param [in] every One in how many messages pass.
+ *
+ * @remarks This expands to a @c for statement (see
+ * HUMMSTRUMM_ENGINE_LOG_GUARD()), so it can only be used at the start of a
+ * statement.  It can be the body of an @c if without braces.
+ */
+#define HUMMSTRUMM_ENGINE_LOG_SAMPLED(log, level, every)              \
+  HUMMSTRUMM_ENGINE_LOG_GUARD (level)                                 \
+    for (hummstrummengine::debug::logging::Suppressed hummstrummPass = \
+           hummstrummengine::debug::logging::Sample (                 \
+             HUMMSTRUMM_ENGINE_LOG_CALL_SITE (), (every),             \
+             __FILE__, __LINE__,                                      \
+             hummstrummengine::debug::logging::level);                \
+         hummstrummPass.pass; hummstrummPass.pass = false)            \
+      (log) << hummstrummPass << HUMMSTRUMM_ENGINE_SET_LOGGING (level)
+
+/**
+ * @def HUMMSTRUMM_ENGINE_LOGF_RATE_LIMITED
+ *
+ * Logs a message like HUMMSTRUMM_ENGINE_LOGF() does, with the rate limit of
+ * HUMMSTRUMM_ENGINE_LOG_RATE_LIMITED().
+ *
+ * @since  0.7
+ *
+ * @param [in] log The stream to log to.
+ * @param [in] level The logging level to apply.  Only use the class name
+ * Level, double colon, and the level constant name.
+ * @param [in] perSecond How many messages a second pass over a long time.
+ * @param [in] burst How many messages can pass at once.
+ * @param [in] ... The format string and then the arguments.
+ *
+ * @remarks This expands to a @c for statement (see
+ * HUMMSTRUMM_ENGINE_LOG_GUARD()), so it can only be used as a statement.  It
+ * can be the body of an @c if without braces.
+ */
+#define HUMMSTRUMM_ENGINE_LOGF_RATE_LIMITED(log, level, perSecond, burst, ...) \
+  HUMMSTRUMM_ENGINE_LOG_GUARD (level)                                 \
+    for (hummstrummengine::debug::logging::Suppressed hummstrummPass = \
+           hummstrummengine::debug::logging::RateLimit (              \
+             HUMMSTRUMM_ENGINE_LOG_CALL_SITE (), (perSecond), (burst), \
+             __FILE__, __LINE__,                                      \
+             hummstrummengine::debug::logging::level);                \
+         hummstrummPass.pass; hummstrummPass.pass = false)            \
+      hummstrummengine::debug::logging::LogDeferred (                 \
+        (log) << hummstrummPass, __FILE__, __LINE__,                  \
+        hummstrummengine::debug::logging::level, __VA_ARGS__)
+
+/**
+ * @def HUMMSTRUMM_ENGINE_LOGF_SAMPLED
+ *
+ * Logs a message like HUMMSTRUMM_ENGINE_LOGF() does, with the sampling of
+ * HUMMSTRUMM_ENGINE_LOG_SAMPLED().
+ *
+ * @since  0.7
+ *
+ * @param [in] log The stream to log to.
+ * @param [in] level The logging level to apply.  Only use the class name
+ * Level, double colon, and the level constant name.
+ * @param [in] every One in how many messages pass.
+ * @param [in] ... The format string and then the arguments.
+ *
+ * @remarks This expands to a @c for statement (see
+ * HUMMSTRUMM_ENGINE_LOG_GUARD()), so it can only be used as a statement.  It
+ * can be the body of an @c if without braces.
+ */
+#define HUMMSTRUMM_ENGINE_LOGF_SAMPLED(log, level, every, ...)        \
+  HUMMSTRUMM_ENGINE_LOG_GUARD (level)                                 \
+    for (hummstrummengine::debug::logging::Suppressed hummstrummPass = \
+           hummstrummengine::debug::logging::Sample (                 \
+             HUMMSTRUMM_ENGINE_LOG_CALL_SITE (), (every),             \
+             __FILE__, __LINE__,                                      \
+             hummstrummengine::debug::logging::level);                \
+         hummstrummPass.pass; hummstrummPass.pass = false)            \
+      hummstrummengine::debug::logging::LogDeferred (                 \
+        (log) << hummstrummPass, __FILE__, __LINE__,                  \
+        hummstrummengine::debug::logging::level, __VA_ARGS__)
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RATELIMIT
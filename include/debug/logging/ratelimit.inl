@@ -0,0 +1,110 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RATELIMIT_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RATELIMIT_INL
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+namespace detail {
+
+// How long a call site waits between summaries, in nanoseconds.
+const std::uint64_t summaryInterval = 1000000000u;
+
+// Returns how many suppressed messages to report before a message that passed
+// at the given time.  Only one thread gets to report them.
+inline std::uint64_t
+TakeSuppressed (CallSite &site, std::uint64_t now)
+{
+  if (site.suppressed.load (std::memory_order_relaxed) == 0)
+    return 0;
+  std::uint64_t last = site.lastSummary.load (std::memory_order_relaxed);
+  if (now - last < summaryInterval ||
+      !site.lastSummary.compare_exchange_strong (last, now,
+                                                 std::memory_order_relaxed))
+    return 0;
+  return site.suppressed.exchange (0, std::memory_order_relaxed);
+}
+
+}
+
+Suppressed::Suppressed (CallSite &site, bool pass, std::uint64_t count,
+                        const char *file, unsigned line, Level level)
+  : site (&site),
+    pass (pass),
+    count (count),
+    file (file),
+    line (line),
+    level (level)
+{}
+
+Suppressed
+RateLimit (CallSite &site, double perSecond, unsigned burst, const char *file,
+           unsigned line, Level level)
+{
+  // This is the generic cell rate algorithm: instead of counting tokens, we
+  // keep the time at which the bucket would be full again, so one atomic is
+  // enough.  A message passes unless the bucket won't be full for longer than
+  // it takes to refill burst - 1 tokens.
+  std::uint64_t now = GetTimestamp ();
+  std::uint64_t interval = perSecond > 0 ?
+    static_cast<std::uint64_t> (1e9 / perSecond) : detail::summaryInterval;
+  std::uint64_t tolerance = (burst > 1 ? burst - 1 : 0) * interval;
+
+  std::uint64_t full = site.state.load (std::memory_order_relaxed);
+  std::uint64_t next;
+  do
+    {
+      if (full > now + tolerance)
+        {
+          site.suppressed.fetch_add (1, std::memory_order_relaxed);
+          return Suppressed (site, false, 0, file, line, level);
+        }
+      next = (full > now ? full : now) + interval;
+    }
+  while (!site.state.compare_exchange_weak (full, next,
+                                            std::memory_order_relaxed));
+
+  return Suppressed (site, true, detail::TakeSuppressed (site, now), file,
+                     line, level);
+}
+
+Suppressed
+Sample (CallSite &site, unsigned every, const char *file, unsigned line,
+        Level level)
+{
+  std::uint64_t seen = site.state.fetch_add (1, std::memory_order_relaxed);
+  if (every > 1 && seen % every != 0)
+    {
+      site.suppressed.fetch_add (1, std::memory_order_relaxed);
+      return Suppressed (site, false, 0, file, line, level);
+    }
+
+  return Suppressed (site, true,
+                     detail::TakeSuppressed (site, GetTimestamp ()), file, line,
+                     level);
+}
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RATELIMIT_INL
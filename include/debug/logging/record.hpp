@@ -0,0 +1,145 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::logging::Record, which is a log message on its way to the
+ * backends.
+ *
+ * @file   debug/logging/record.hpp
+ * @see    Record
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RECORD
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RECORD
+
+#include <ctime>
+#include <cstddef>
+#include <cstdint>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+/**
+ * A log message on its way to the backends.  A Record does not own any of its
+ * strings; they belong to whoever sent the Record, usually a
+ * logging::StreamBuffer, and they are only valid until the backend returns.  A
+ * backend that needs to keep them around has to copy them.
+ *
+ * Because nothing is copied, sending a message to any number of backends costs
+ * no allocations.
+ *
+ * A message logged with HUMMSTRUMM_ENGINE_LOGF() starts out as a format string
+ * and arguments.  The Dispatcher or AsyncQueue formats it before it reaches
+ * the backends, unless every backend accepts unformatted messages (see
+ * Backend::AcceptsUnformatted()).
+ *
+ * A message may also carry structured fields (see Field()), which are kept in
+ * their binary encoding until a backend such as JsonLinesBackend writes them.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct Record
+{
+    /**
+     * Constructs an empty Record.
+     *
+     * @since  0.7
+     */
+    inline Record ();
+    /**
+     * Constructs a Record for a formatted message.
+     *
+     * @since  0.7
+     *
+     * @param [in] timestamp When the message was flushed, in nanoseconds since
+     * 1970-01-01T00:00:00Z (see GetTimestamp()).
+     * @param [in] thread The number of the thread that flushed the message
+     * (see GetThreadNumber()).
+     * @param [in] file The name of the source file from which the message came.
+     * @param [in] line The line from which the message came.
+     * @param [in] level The level of the message.
+     * @param [in] message The user-provided message.
+     * @param [in] messageLength The length of the message, in bytes.
+     */
+    inline Record (std::uint64_t timestamp, unsigned thread, const char *file,
+                   unsigned line, Level level, const char *message,
+                   std::size_t messageLength);
+    /**
+     * Constructs a Record for a formatted message, with a timestamp that only
+     * has a resolution of one second and no thread number.
+     *
+     * @since  0.7
+     *
+     * @param [in] time The time when the message was flushed.
+     * @param [in] file The name of the source file from which the message came.
+     * @param [in] line The line from which the message came.
+     * @param [in] level The level of the message.
+     * @param [in] message The user-provided message.
+     * @param [in] messageLength The length of the message, in bytes.
+     */
+    inline Record (std::time_t time, const char *file, unsigned line,
+                   Level level, const char *message, std::size_t messageLength);
+
+    /// The time when the message was flushed, in nanoseconds since
+    /// 1970-01-01T00:00:00Z.  These come from a monotonic clock, so they order
+    /// messages from different threads.
+    std::uint64_t timestamp;
+    /// The time when the message was flushed, rounded down to the second.
+    std::time_t time;
+    /// The number of the thread that flushed the message, or 0 if it isn't
+    /// known.
+    unsigned thread;
+    /// The name of the source file from which the message came.  This is a
+    /// nul-terminated string.
+    const char *file;
+    /// The line from which the message came.
+    unsigned line;
+    /// The level of the message.
+    Level level;
+    /// The user-provided message.  This is @em not nul-terminated.  It is
+    /// @c nullptr if the message was logged with HUMMSTRUMM_ENGINE_LOGF() and
+    /// hasn't been formatted yet.
+    const char *message;
+    /// The length of the message, in bytes.
+    std::size_t messageLength;
+
+    /// The format string of a message logged with HUMMSTRUMM_ENGINE_LOGF(), or
+    /// @c nullptr .
+    const char *format;
+    /// The arguments of a message logged with HUMMSTRUMM_ENGINE_LOGF(), as
+    /// written by EncodeArguments().
+    const char *arguments;
+    /// The length of the arguments, in bytes.
+    std::size_t argumentsLength;
+
+    /// The structured fields attached to the message with Field(), or
+    /// @c nullptr .  Each field is a string key followed by its value, both
+    /// written by EncodeArgument(); read them with DecodeArgument().
+    const char *fields;
+    /// The length of the fields, in bytes.
+    std::size_t fieldsLength;
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RECORD
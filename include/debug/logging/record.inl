@@ -0,0 +1,86 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RECORD_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RECORD_INL
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+
+Record::Record ()
+  : timestamp (0),
+    time (0),
+    thread (0),
+    file (""),
+    line (0),
+    level (Level::none),
+    message (""),
+    messageLength (0),
+    format (nullptr),
+    arguments (nullptr),
+    argumentsLength (0),
+    fields (nullptr),
+    fieldsLength (0)
+{
+}
+
+Record::Record (std::uint64_t timestamp, unsigned thread, const char *file,
+                unsigned line, Level level, const char *message,
+                std::size_t messageLength)
+  : timestamp (timestamp),
+    time (static_cast<std::time_t> (timestamp / 1000000000u)),
+    thread (thread),
+    file (file),
+    line (line),
+    level (level),
+    message (message),
+    messageLength (messageLength),
+    format (nullptr),
+    arguments (nullptr),
+    argumentsLength (0),
+    fields (nullptr),
+    fieldsLength (0)
+{
+}
+
+Record::Record (std::time_t time, const char *file, unsigned line,
+                Level level, const char *message, std::size_t messageLength)
+  : timestamp (static_cast<std::uint64_t> (time) * 1000000000u),
+    time (time),
+    thread (0),
+    file (file),
+    line (line),
+    level (level),
+    message (message),
+    messageLength (messageLength),
+    format (nullptr),
+    arguments (nullptr),
+    argumentsLength (0),
+    fields (nullptr),
+    fieldsLength (0)
+{
+}
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RECORD_INL
@@ -0,0 +1,169 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::logging::RingBufferBackend, which keeps the most recent log
+ * messages in memory so they can be written out after a crash.
+ *
+ * @file   debug/logging/ringbuffer.hpp
+ * @see    RingBufferBackend
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RINGBUFFER
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RINGBUFFER
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+/**
+ * A log backend that keeps the most recent messages in a fixed block of
+ * memory, a flight recorder for crashes.  Logging to it costs one bounded copy
+ * into memory that was allocated up front; once the block is full, the oldest
+ * messages are overwritten.  Unformatted messages (see
+ * HUMMSTRUMM_ENGINE_LOGF()) are kept unformatted.
+ *
+ * The messages are kept as binary log records (see
+ * debug/logging/binarylog.hpp), so DumpToFile() only has to copy memory to a
+ * file.  It uses nothing but async-signal-safe calls, so it can run from a
+ * signal handler; core::Engine calls it when the program crashes (see
+ * core::Engine::Configuration::crashLogFile).  Read the dump with
+ * @c hummstrumm-logdump .
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @note Like other backends, this must not be called from two threads at once;
+ * the Dispatcher or AsyncQueue sees to that.  A dump may run at the same time
+ * as messages are written, though.  It leaves out the message being written,
+ * and any message that is overwritten while the dump copies it.
+ */
+class RingBufferBackend : public Backend
+{
+  public:
+    /**
+     * Constructs a new RingBufferBackend and allocates its memory.
+     *
+     * @since  0.7
+     *
+     * @param [in] allowedLevels The levels that this backend should keep, OR'd
+     * together.
+     * @param [in] capacity How many bytes of messages to keep.  This is rounded
+     * up to a power of two, and is at least 4 KiB.  Messages are cut short to
+     * fit in a quarter of it or in 64 KiB, whichever is smaller.
+     */
+    RingBufferBackend (Level allowedLevels = Level::all,
+                       std::size_t capacity = 4 << 20);
+    /**
+     * Destructs an existing RingBufferBackend.
+     *
+     * @since  0.7
+     */
+    virtual ~RingBufferBackend ();
+
+    /**
+     * Copies a message into the ring, overwriting the oldest messages if there
+     * isn't room.
+     *
+     * @since  0.7
+     *
+     * @param [in] record The message and where it came from.
+     *
+     * @see debug::logging::Backend
+     */
+    virtual void operator() (const Record &record);
+
+    /**
+     * Returns @c true : messages logged with HUMMSTRUMM_ENGINE_LOGF() are
+     * kept without being formatted.
+     *
+     * @since  0.7
+     *
+     * @return @c true .
+     */
+    virtual bool AcceptsUnformatted () const;
+
+    /**
+     * Writes the messages in the ring to a stream as a binary log, oldest
+     * first.
+     *
+     * @since  0.7
+     *
+     * @param [in,out] out The stream.  It should be opened in binary mode.
+     */
+    void Dump (std::ostream &out) const;
+    /**
+     * Writes the messages in the ring to a new file as a binary log, oldest
+     * first.  This only uses async-signal-safe calls and doesn't allocate, so
+     * it may be called from a signal handler.  It must not be called from two
+     * threads at once.
+     *
+     * @since  0.7
+     *
+     * @param [in] path The name of the file.  An existing file is replaced.
+     *
+     * @return Whether the file could be written.
+     */
+    bool DumpToFile (const char *path) const;
+
+    /**
+     * Returns how many bytes of messages the ring holds.
+     *
+     * @since  0.7
+     *
+     * @return The capacity of the ring.
+     */
+    inline std::size_t GetCapacity () const;
+
+  private:
+    /**
+     * Calls write(data, length) with the header of a binary log and then each
+     * record in the ring, oldest first.  Each record is first copied into
+     * copy, which must hold maxEntry bytes.  Stops if write returns
+     * @c false .
+     */
+    template <typename WriteT>
+    void Walk (char *copy, WriteT write) const;
+
+    /// The ring.
+    std::unique_ptr<char[]> ring;
+    /// Where DumpToFile() copies each entry before writing it.
+    std::unique_ptr<char[]> scratch;
+    /// The size of the ring, less one.  The size is a power of two.
+    std::size_t mask;
+    /// The longest an entry may be, in bytes.
+    std::size_t maxEntry;
+    /// Where the next entry goes.  Positions count bytes since the ring was
+    /// created, and wrap around.
+    std::atomic<std::size_t> head;
+    /// Where the oldest entry starts.
+    std::atomic<std::size_t> tail;
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_RINGBUFFER
@@ -0,0 +1,202 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::logging::RotatingFileBackend, which writes XML logs through
+ * memory-mapped files and starts a new file when one gets too big or too old.
+ *
+ * @file   debug/logging/rotatingfile.hpp
+ * @see    RotatingFileBackend
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_ROTATINGFILE
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_ROTATINGFILE
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+/**
+ * A log backend that writes the same XML as a FileBackend, but into a series of
+ * files, called segments.  Each segment is a file of a fixed size that is
+ * mapped into memory, so writing a message is a copy into memory instead of a
+ * system call; the operating system writes the pages out on its own.  When a
+ * message doesn't fit in the current segment, or the segment is older than the
+ * maximum age, the segment is closed and the next one is started.
+ *
+ * Segments are named @c base.0.log , @c base.1.log , and so on.  Each one is a
+ * complete XML document: the closing @c </log> tag is kept right after the
+ * last message and the rest of the segment is filled with spaces, so even a
+ * segment that was being written when the program crashed can be parsed.  When
+ * a segment is closed, the spaces are cut off.
+ *
+ * Closed segments can be compressed with gzip on a background thread, which
+ * replaces @c base.N.log with @c base.N.log.gz .
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @note Compression needs zlib.  If the engine was built without it, segments
+ * are not compressed.
+ */
+class RotatingFileBackend : public Backend
+{
+  public:
+    /**
+     * Constructs a new RotatingFileBackend and starts the first segment.
+     * Existing segments with the same names are replaced.
+     *
+     * @since  0.7
+     *
+     * @param [in] allowedLevels The levels that this backend should print, OR'd
+     * together.
+     * @param [in] baseName The name of the segments, without the number and
+     * extension.
+     * @param [in] segmentSize How big each segment is, in bytes.  A message
+     * that is bigger than this gets a segment of its own that is as big as it
+     * needs to be.
+     * @param [in] maxAge How long a segment is used before the next one is
+     * started, or zero to only start a new segment when one is full.
+     * @param [in] compress Whether to compress closed segments.
+     *
+     * @throws std::runtime_error If the first segment cannot be created.
+     */
+    RotatingFileBackend (Level allowedLevels = Level::all,
+                         std::string baseName = "hummstrummengine",
+                         std::size_t segmentSize = 16 << 20,
+                         std::chrono::nanoseconds maxAge =
+                           std::chrono::nanoseconds::zero (),
+                         bool compress = false);
+    /**
+     * Destructs an existing RotatingFileBackend.  The current segment is
+     * closed, and the destructor waits for the compression of any closed
+     * segments to finish.
+     *
+     * @since  0.7
+     */
+    virtual ~RotatingFileBackend ();
+
+    /**
+     * Copies a message into the current segment, starting a new segment first
+     * if needed.
+     *
+     * @since  0.7
+     *
+     * @param [in] record The message and where it came from.
+     *
+     * @see debug::logging::Backend
+     */
+    virtual void operator() (const Record &record);
+
+    /**
+     * Closes the current segment and starts the next one.
+     *
+     * @since  0.7
+     */
+    void Rotate ();
+
+    /**
+     * Returns the file name of a segment.  If the segment has been compressed,
+     * the file has @c .gz added to this.
+     *
+     * @since  0.7
+     *
+     * @param [in] segment The number of the segment, counting from 0.
+     *
+     * @return The name of the segment.
+     */
+    std::string GetSegmentName (unsigned segment) const;
+    /**
+     * Returns the number of the segment being written.
+     *
+     * @since  0.7
+     *
+     * @return The number of the current segment.
+     */
+    inline unsigned GetSegment () const;
+
+  private:
+    /**
+     * Creates and maps the next segment, big enough for at least the given
+     * number of bytes of messages.  Returns whether it worked.
+     */
+    bool OpenSegment (std::size_t messageSize);
+    /**
+     * Unmaps the current segment, cuts off the unused part, and hands it to
+     * the compression thread.
+     */
+    void CloseSegment ();
+    /**
+     * Copies text into the current segment, and puts the closing tag after
+     * it.
+     */
+    void Append (const char *text, std::size_t length);
+    /**
+     * Compresses closed segments until the backend is destroyed.  This runs
+     * on its own thread.
+     */
+    void CompressSegments ();
+
+    std::string baseName;       ///< The name of the segments.
+    std::size_t segmentSize;    ///< The usual size of a segment.
+    std::uint64_t maxAge;       ///< The longest a segment is used, in ns.
+    unsigned segment;           ///< The number of the current segment.
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+    void *file;                 ///< The handle of the current segment.
+    void *fileMapping;          ///< The handle of its mapping.
+#else
+    int file;                   ///< The descriptor of the current segment.
+#endif
+    char *mapping;              ///< The current segment, in memory.
+    std::size_t mappingSize;    ///< The size of the current segment.
+    std::size_t used;           ///< The bytes used, not counting the end tag.
+    std::uint64_t segmentStart; ///< When the current segment was started.
+
+    TimestampFormatter timestamps; ///< Formats the times of messages.
+    std::string text;           ///< The message being formatted.
+
+    /// Whether closed segments are compressed.
+    bool compress;
+    /// Closed segments waiting to be compressed.
+    std::vector<std::string> toCompress;
+    /// Whether the compression thread should stop when it runs out of work.
+    bool stopping;
+    /// Protects toCompress and stopping.
+    std::mutex compressMutex;
+    /// Where the compression thread waits for work.
+    std::condition_variable compressWake;
+    /// The compression thread.
+    std::thread compressor;
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_ROTATINGFILE
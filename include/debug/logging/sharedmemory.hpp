@@ -0,0 +1,250 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::logging::SharedMemoryBackend, which publishes log messages
+ * in shared memory, and debug::logging::SharedMemoryReader, which lets another
+ * process watch them.
+ *
+ * The shared memory starts with a header, followed by a ring of slots of a
+ * fixed size:
+ *
+ * @verbatim
+   "HSSM"                  4 bytes of magic
+   version                 4 bytes, currently 1
+   slot count              4 bytes
+   slot size               4 bytes, including the slot's own header
+   head                    8 bytes, how many messages were ever published
+   closed                  4 bytes, nonzero once the writer is gone
+   @endverbatim
+ *
+ * Message number @c n goes in slot @c n modulo the slot count.  Each slot is
+ * guarded by a sequence number, which is @c 2n+1 while message @c n is being
+ * written and @c 2n+2 once it is done.  A reader copies the slot and checks
+ * that the sequence number didn't change while it did; if it did, the writer
+ * lapped the reader and the message is counted as missed.  The writer never waits
+ * for readers.
+ *
+ * @file   debug/logging/sharedmemory.hpp
+ * @see    SharedMemoryBackend
+ * @see    SharedMemoryReader
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_SHAREDMEMORY
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_SHAREDMEMORY
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+/**
+ * A log backend that publishes messages in a ring in shared memory, for
+ * @c hummstrumm-logtail or another SharedMemoryReader to watch while the
+ * program runs.  Publishing a message is a copy into memory, whether anyone is
+ * watching or not; readers that fall behind miss messages instead of slowing
+ * the program down.  Messages are cut short to fit in a slot, and unformatted
+ * messages (see HUMMSTRUMM_ENGINE_LOGF()) are published unformatted.
+ *
+ * On POSIX systems, the ring is a POSIX shared memory object, which is removed
+ * when the backend is destroyed.  On Windows, it is a named file mapping.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @note Like other backends, this must not be called from two threads at once;
+ * the Dispatcher or AsyncQueue sees to that.  There can be any number of
+ * readers.
+ */
+class SharedMemoryBackend : public Backend
+{
+  public:
+    /**
+     * Constructs a new SharedMemoryBackend and creates its shared memory.  If
+     * an object of the same name is left over from an earlier run, it is
+     * replaced.
+     *
+     * @since  0.7
+     *
+     * @param [in] allowedLevels The levels that this backend should publish,
+     * OR'd together.
+     * @param [in] name The name of the shared memory.  On POSIX systems, it
+     * should start with a slash.  Two processes that log at once need
+     * different names.
+     * @param [in] slots How many messages the ring holds.  This is rounded up
+     * to a power of two.
+     * @param [in] slotSize How many bytes each message may take, including the
+     * file name.  This is rounded up to a multiple of 64, and is at least 128.
+     *
+     * @throws std::runtime_error If the shared memory cannot be created.
+     */
+    SharedMemoryBackend (Level allowedLevels = Level::all,
+                         std::string name = "/hummstrummengine",
+                         std::size_t slots = 4096,
+                         std::size_t slotSize = 512);
+    /**
+     * Destructs an existing SharedMemoryBackend, telling readers that no more
+     * messages will come and removing the shared memory.
+     *
+     * @since  0.7
+     */
+    virtual ~SharedMemoryBackend ();
+
+    /**
+     * Publishes a message in the next slot, overwriting the oldest message.
+     *
+     * @since  0.7
+     *
+     * @param [in] record The message and where it came from.
+     *
+     * @see debug::logging::Backend
+     */
+    virtual void operator() (const Record &record);
+
+    /**
+     * Returns @c true : messages logged with HUMMSTRUMM_ENGINE_LOGF() are
+     * published without being formatted, and formatted by the reader.
+     *
+     * @since  0.7
+     *
+     * @return @c true .
+     */
+    virtual bool AcceptsUnformatted () const;
+
+    /**
+     * Returns the name of the shared memory.
+     *
+     * @since  0.7
+     *
+     * @return The name given to the constructor.
+     */
+    inline const std::string &GetName () const;
+
+  private:
+    std::string name;           ///< The name of the shared memory.
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+    void *mappingHandle;        ///< The handle of the file mapping.
+#endif
+    char *mapping;              ///< The shared memory.
+    std::size_t mappingSize;    ///< The size of the shared memory.
+    std::size_t mask;           ///< The slot count, minus one.
+    std::size_t slotSize;       ///< The size of a slot.
+    std::uint64_t head;         ///< The number of the next message.
+};
+
+/**
+ * Reads the messages published by a SharedMemoryBackend, possibly in another
+ * process.  Reading never blocks the writer; messages that were overwritten
+ * before they could be read are counted and skipped.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+class SharedMemoryReader
+{
+  public:
+    /**
+     * Constructs a new SharedMemoryReader and attaches it to the shared memory
+     * of a SharedMemoryBackend.
+     *
+     * @since  0.7
+     *
+     * @param [in] name The name the SharedMemoryBackend was given.
+     * @param [in] backlog How many of the messages that were already published
+     * to read first.  The rest are skipped without being counted as missed.
+     *
+     * @throws std::runtime_error If there is no such shared memory, or it
+     * wasn't made by a SharedMemoryBackend of this version.
+     */
+    explicit SharedMemoryReader (std::string name = "/hummstrummengine",
+                                 std::size_t backlog = 0);
+    /**
+     * Destructs an existing SharedMemoryReader, detaching it from the shared
+     * memory.
+     *
+     * @since  0.7
+     */
+    ~SharedMemoryReader ();
+
+    SharedMemoryReader (const SharedMemoryReader &) = delete;
+    SharedMemoryReader &operator= (const SharedMemoryReader &) = delete;
+
+    /**
+     * Reads the next message, if one has been published.  This does not wait.
+     *
+     * @since  0.7
+     *
+     * @param [out] record The message.  Its strings belong to the reader and
+     * are only valid until the next call.  Unformatted messages are formatted,
+     * but their format string and arguments are also given.
+     *
+     * @return Whether there was a new message.
+     */
+    bool Next (Record &record);
+
+    /**
+     * Returns whether the SharedMemoryBackend was destroyed.  Messages it
+     * published before that can still be read.
+     *
+     * @since  0.7
+     *
+     * @return Whether no more messages will be published.
+     */
+    bool IsClosed () const;
+
+    /**
+     * Returns how many messages were overwritten before this reader could read
+     * them.
+     *
+     * @since  0.7
+     *
+     * @return The number of missed messages.
+     */
+    inline std::uint64_t GetMissed () const;
+
+  private:
+    /**
+     * Unmaps the shared memory.
+     */
+    void Detach ();
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+    void *mappingHandle;        ///< The handle of the file mapping.
+#endif
+    const char *mapping;        ///< The shared memory.
+    std::size_t mappingSize;    ///< The size of the shared memory.
+    std::size_t mask;           ///< The slot count, minus one.
+    std::size_t slotSize;       ///< The size of a slot.
+    std::uint64_t position;     ///< The number of the next message to read.
+    std::uint64_t missed;       ///< How many messages were overwritten.
+    std::vector<char> slot;     ///< A copy of the slot being read.
+    std::string file;           ///< The file of the last message.
+    std::string format;         ///< The format string of the last message.
+    std::string formatted;      ///< The last unformatted message.
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_SHAREDMEMORY
@@ -0,0 +1,46 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_SHAREDMEMORY_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_SHAREDMEMORY_INL
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+
+const std::string &
+SharedMemoryBackend::GetName ()
+  const
+{
+  return name;
+}
+
+std::uint64_t
+SharedMemoryReader::GetMissed ()
+  const
+{
+  return missed;
+}
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_SHAREDMEMORY_INL
@@ -42,12 +42,14 @@ namespace logging {
 
 // Forward declare for safety.
 class Backend;
+class AsyncQueue;
+class Dispatcher;
 
 /**
  * An iostream buffer, compatible with those used in the standard library.  The
- * debug::Log class uses this buffer to dispatch messages to various backends,
- * such as a FileBackend representing a log on disk and a ConsoleBackend
- * representing the terminal output of the application.
+ * engine's log uses this buffer to dispatch messages to various backends, such
+ * as a FileBackend representing a log on disk and a ConsoleBackend representing
+ * the terminal output of the application.
  *
  * We derive from @c std::stringbuf so that we don't have to worry about
  * buffering.  The string will expand in size to whatever we want, no matter how
@@ -55,6 +57,15 @@ class Backend;
  * the @c overflow() method of @c std::stringbuf , because it handles this all
  * for us.  We only override the sync() method, which is called when the user
  * requests a flush (which is when we write to our backends).
+ *
+ * The backends get a Record that points right into the buffer, and the buffer
+ * keeps its storage between messages, so once it has grown to fit the usual
+ * message, logging doesn't allocate at all.
+ *
+ * A StreamBuffer holds the message that is being built, so only one thread may
+ * write to it at a time.  To log from several threads, give each thread its own
+ * StreamBuffer and let them share a Dispatcher, which passes the flushed
+ * messages on to the backends.  core::Engine::GetLog() does this for you.
  * 
  * @version 0.7
  * @author  Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
@@ -72,8 +83,22 @@ class StreamBuffer : public std::stringbuf
      * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
      * @date   2012-12-19
      * @since  0.6
+     *
+     * @param [in] backends The backends to which to send messages.
+     * @param [in] queue A queue whose writer thread sends messages to the
+     * backends, or @c nullptr to send them on the thread that flushes.
+     */
+    StreamBuffer (std::vector<std::shared_ptr<Backend>> backends,
+                  std::unique_ptr<AsyncQueue> queue = nullptr);
+    /**
+     * Constructs a new StreamBuffer object that sends its messages through a
+     * Dispatcher, which may be shared with other StreamBuffer objects.
+     *
+     * @since  0.7
+     *
+     * @param [in] dispatcher The Dispatcher to which to send messages.
      */
-    StreamBuffer (std::vector<std::shared_ptr<Backend>> backends);
+    explicit StreamBuffer (std::shared_ptr<Dispatcher> dispatcher);
     /**
      * Destructs an existing StreamBuffer object.
      *
@@ -84,13 +109,21 @@ class StreamBuffer : public std::stringbuf
     inline virtual ~StreamBuffer ();
 
     /**
-     * Changes the file name to print on the next flush.
+     * Changes the file name to print on the next flush.  The name is copied.
      *
      * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
      * @date   2012-06-14
      * @since  0.6
      */
     inline void SetFile (std::string);
+    /**
+     * Changes the file name to print on the next flush.  The name is not
+     * copied, so it must live at least until the flush; string literals such
+     * as @c __FILE__ always do.
+     *
+     * @since  0.7
+     */
+    inline void SetFile (const char *);
     /**
      * Changes the line number to print on the next flush.
      *
@@ -107,34 +140,68 @@ class StreamBuffer : public std::stringbuf
      * @since  0.6
      */
     inline void SetLevel (Level);
+
     /**
-     * Changes the streambuf's locked state.
+     * Attaches a structured field to the next message.  The key and value are
+     * encoded into a buffer that is kept for the next message.  The Field()
+     * manipulator calls this.
      *
-     * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
-     * @date   2012-06-15
-     * @since  0.6
+     * @since  0.7
+     *
+     * @param [in] key The name of the field.
+     * @param [in] value The value of the field.  It must be a type that
+     * EncodeArgument() takes.
      */
-    inline void Lock ();
+    template <typename T>
+    inline void AddField (const char *key, const T &value);
+
     /**
-     * Returns whether the streambuf is in a locked state.
+     * Sends a message to each registered backend through the Dispatcher.
      *
      * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
-     * @date   2012-06-15
+     * @date   2012-06-14
      * @since  0.6
+     */
+    void SendToBackends ();
+
+    /**
+     * Sends a message to each registered backend without formatting it.  The
+     * arguments are copied into a buffer that is kept for the next message.
+     * HUMMSTRUMM_ENGINE_LOGF() calls this.
+     *
+     * @since  0.7
+     *
+     * @param [in] file The source file of the message.  It must live as long
+     * as the message is queued; @c __FILE__ does.
+     * @param [in] line The source line of the message.
+     * @param [in] level The level of the message.
+     * @param [in] format The format string.  It must live as long as the
+     * program.
+     * @param [in] args The arguments.
      *
-     * @return Whether someone can try to lock us again.
+     * @see FormatDeferred
      */
-    inline bool IsLocked () const;
+    template <typename... Args>
+    inline void SendDeferred (const char *file, unsigned line, Level level,
+                              const char *format, const Args &... args);
 
     /**
-     * Sends a message to each registered backend.  Calls the @c operator() of
-     * each backend with the correct parameters.
+     * Returns the Dispatcher to which this StreamBuffer sends messages.
      *
-     * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
-     * @date   2012-06-14
-     * @since  0.6
+     * @since  0.7
+     *
+     * @return The Dispatcher of this StreamBuffer.
      */
-    void SendToBackends ();
+    inline Dispatcher &GetDispatcher () const;
+
+    /**
+     * Waits until every message that has been sent to the Dispatcher of this
+     * StreamBuffer has reached the backends.  This only has to wait if the
+     * messages are being sent through an AsyncQueue.
+     *
+     * @since  0.7
+     */
+    void Flush ();
 
     /**
      * Flushes a message to all backends and then clears the @c std::stringbuf
@@ -155,16 +222,30 @@ class StreamBuffer : public std::stringbuf
     virtual int sync ();
 
   private:
-    /// Send messages to these backends.
-    std::vector<std::shared_ptr<Backend>> backends;
+    /**
+     * Sends the arguments in the argument buffer to the Dispatcher.
+     */
+    void SendArguments (const char *file, unsigned line, Level level,
+                        const char *format);
+    /**
+     * Points a Record at the fields of the next message, if there are any.
+     */
+    void AttachFields (Record &record);
+
+    /// Send messages through this.
+    std::shared_ptr<Dispatcher> dispatcher;
     /// The last update of the file name.
-    std::string file;
+    const char *file;
+    /// Holds the file name if it was given as a @c std::string .
+    std::string fileStorage;
     /// The last update of the line number.
     unsigned line;
     /// The last update of the message level.
     Level level;
-    /// Whether we are locked.
-    bool lock;
+    /// The arguments of the last message sent with SendDeferred().
+    std::vector<char> arguments;
+    /// The fields of the next message.
+    std::vector<char> fields;
 };
 
 
@@ -30,6 +30,13 @@ StreamBuffer::~StreamBuffer ()
 
 void
 StreamBuffer::SetFile (std::string s)
+{
+  fileStorage = s;
+  file = fileStorage.c_str ();
+}
+
+void
+StreamBuffer::SetFile (const char *s)
 {
   file = s;
 }
@@ -46,17 +53,28 @@ StreamBuffer::SetLevel (Level n)
   level = n;
 }
 
+template <typename T>
 void
-StreamBuffer::Lock ()
+StreamBuffer::AddField (const char *key, const T &value)
 {
-  lock = true;
+  EncodeArgument (fields, key);
+  EncodeArgument (fields, value);
 }
 
-bool
-StreamBuffer::IsLocked ()
-  const
+Dispatcher &
+StreamBuffer::GetDispatcher () const
+{
+  return *dispatcher;
+}
+
+template <typename... Args>
+void
+StreamBuffer::SendDeferred (const char *f, unsigned l, Level lev,
+                            const char *format, const Args &... args)
 {
-  return lock;
+  arguments.clear ();
+  EncodeArguments (arguments, args...);
+  SendArguments (f, l, lev, format);
 }
 
 
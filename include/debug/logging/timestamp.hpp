@@ -0,0 +1,108 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines the clock that stamps log messages, and
+ * debug::logging::TimestampFormatter, which turns its timestamps into text.
+ *
+ * @file   debug/logging/timestamp.hpp
+ * @see    TimestampFormatter
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_TIMESTAMP
+#define HUMMSTRUMM_ENGINE_DEBUG_LOGGING_TIMESTAMP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+/**
+ * Returns the current time, in nanoseconds since 1970-01-01T00:00:00Z.  The
+ * wall clock is read once, when the engine is loaded; after that, time is
+ * measured with a monotonic clock.  Timestamps therefore never go backwards,
+ * even if the system clock is changed, and timestamps taken on different
+ * threads can be compared to order the messages.
+ *
+ * @since  0.7
+ *
+ * @return The current timestamp.
+ */
+std::uint64_t GetTimestamp ();
+
+/**
+ * Returns a small number that identifies the calling thread in log messages.
+ * Threads are numbered from 1 in the order they first ask; numbers are not
+ * reused.
+ *
+ * @since  0.7
+ *
+ * @return The number of the calling thread.
+ */
+unsigned GetThreadNumber ();
+
+/**
+ * Turns timestamps into text like @c 2012-06-14T02:09:18.123456789Z .  The
+ * date and time up to the second are kept from the last call, so as long as
+ * timestamps fall in the same second, only the fraction is rendered again.
+ * Each backend that prints timestamps should have its own formatter.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @warning A formatter must not be used by two threads at once.
+ */
+class TimestampFormatter
+{
+  public:
+    /// The length of a formatted timestamp, not counting the nul.
+    static const std::size_t LENGTH = 30;
+
+    /**
+     * Constructs a new TimestampFormatter with nothing cached.
+     *
+     * @since  0.7
+     */
+    TimestampFormatter ();
+
+    /**
+     * Formats a timestamp.
+     *
+     * @since  0.7
+     *
+     * @param [in] timestamp Nanoseconds since 1970-01-01T00:00:00Z.
+     *
+     * @return The timestamp as a nul-terminated string of LENGTH characters.
+     * It belongs to the formatter and is only valid until the next call.
+     */
+    const char *Format (std::uint64_t timestamp);
+
+  private:
+    char text[LENGTH + 1];  ///< The last formatted timestamp.
+    std::uint64_t second;   ///< The second in the text, if cached is set.
+    bool cached;            ///< Whether the text holds a second yet.
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_LOGGING_TIMESTAMP
@@ -0,0 +1,355 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::Metrics, which keeps a history of the program's counters and
+ * gauges frame by frame, and debug::Counter and debug::Gauge, which count and
+ * measure things for it.
+ *
+ * @file   debug/metrics.hpp
+ * @see    Metrics
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_METRICS
+#define HUMMSTRUMM_ENGINE_DEBUG_METRICS
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "debug/logging/level.hpp"
+
+namespace hummstrummengine {
+namespace debug {
+
+/**
+ * What a metric measures.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+enum class MetricKind
+{
+  counter,                      ///< How many times something happened.
+  gauge                         ///< How much of something there is.
+};
+
+/**
+ * The recent history of a metric, as of the last frame that ended.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct MetricHistory
+{
+    /**
+     * Returns the smallest value in the history.
+     *
+     * @since  0.7
+     *
+     * @return The smallest value, or 0 if there is no history.
+     */
+    inline std::int64_t GetMin () const;
+    /**
+     * Returns the largest value in the history.
+     *
+     * @since  0.7
+     *
+     * @return The largest value, or 0 if there is no history.
+     */
+    inline std::int64_t GetMax () const;
+    /**
+     * Returns the mean of the values in the history.
+     *
+     * @since  0.7
+     *
+     * @return The mean, or 0 if there is no history.
+     */
+    inline double GetMean () const;
+
+    /// The name of the metric.
+    const char *name;
+    /// What the metric measures.
+    MetricKind kind;
+    /// For a counter, its total over the whole program; for a gauge, its
+    /// value when the last frame ended.
+    std::int64_t total;
+    /// The value of each frame, from the oldest to the last that ended: for a
+    /// counter, how much it was counted up during the frame, and for a gauge,
+    /// its value when the frame ended.  This holds at most
+    /// Metrics::historyLength frames, and none from before the metric was
+    /// made.
+    std::vector<std::int64_t> frames;
+};
+
+/**
+ * The value of a metric in one frame.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct MetricValue
+{
+    /// The name of the metric.
+    const char *name;
+    /// What the metric measures.
+    MetricKind kind;
+    /// For a counter, how much it was counted up during the frame; for a
+    /// gauge, its value when the frame ended.
+    std::int64_t value;
+};
+
+/**
+ * The counters and gauges of the program.  Counting or setting one is cheap
+ * enough for hot code (see Counter and Gauge); Metrics adds them up only when
+ * a frame ends, and keeps the value of each of the last historyLength frames.
+ * The history can be read in the program, or sent to the log backends with
+ * Log().
+ *
+ * Metrics are made by constructing a Counter or Gauge, usually at namespace
+ * scope, and any number of them may have the same name and kind, to count the
+ * same thing from different places.  The first maxThreads threads to count
+ * each have counters of their own; later threads share the last.
+ *
+ * @code
+ * debug::Counter drawCalls ("draw_calls");
+ * debug::Gauge entities ("entities");
+ *
+ * void
+ * RunFrame (core::Engine &engine)
+ * {
+ *   // ...
+ *   ++drawCalls;
+ *   entities.Set (world.size ());
+ *   // ...
+ *   debug::Metrics::EndFrame ();
+ *   if (debug::Metrics::GetFrame () % 600 == 0)
+ *     debug::Metrics::Log (engine.GetLog ());
+ * }
+ * @endcode
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+class Metrics
+{
+  public:
+    /// How many metrics there can be.
+    static const std::size_t maxMetrics = 256;
+    /// How many threads count on their own.
+    static const std::size_t maxThreads = 64;
+    /// How many frames of history are kept.
+    static const std::size_t historyLength = 128;
+    /// How long a metric's name can be, without the terminating null.
+    static const std::size_t maxNameLength = 63;
+
+    Metrics () = delete;
+
+    /**
+     * Ends a frame: adds up each counter and reads each gauge, and puts
+     * their values in the history.  Call this from one thread only, once per
+     * frame.
+     *
+     * @since  0.7
+     */
+    static void EndFrame ();
+    /**
+     * Returns how many frames have ended.
+     *
+     * @since  0.7
+     *
+     * @return The number of calls to EndFrame().
+     */
+    static std::uint64_t GetFrame ();
+
+    /**
+     * Returns the history of a metric.
+     *
+     * @since  0.7
+     *
+     * @param [in] name The name of the metric.
+     * @param [out] history Its history.
+     *
+     * @return Whether there is a metric with that name.
+     */
+    static bool GetHistory (const char *name, MetricHistory &history);
+    /**
+     * Returns the history of every metric.
+     *
+     * @since  0.7
+     *
+     * @return The histories, in the order the metrics were made.
+     */
+    static std::vector<MetricHistory> GetEveryHistory ();
+    /**
+     * Returns the value of every metric in the last frame that ended.  This
+     * is cheaper than GetEveryHistory().
+     *
+     * @since  0.7
+     *
+     * @return The values, in the order the metrics were made.  A metric made
+     * since the frame ended has the value 0.
+     */
+    static std::vector<MetricValue> GetLastFrame ();
+
+    /**
+     * Sends the history of every metric as one log message, with a line for
+     * each metric.  The value of each in the last frame is attached as a
+     * structured field (see logging::Field()) with the metric's name, so that
+     * a backend like logging::JsonLinesBackend writes it out.
+     *
+     * @since  0.7
+     *
+     * @param [in,out] log The stream to send the message on, usually
+     * core::Engine::GetLog().
+     * @param [in] level The level of the message.
+     */
+    static void Log (std::ostream &log,
+                     logging::Level level = logging::Level::info);
+};
+
+/**
+ * Counts how many times something happens, for Metrics.  Counting adds to a
+ * counter of the calling thread's own, without a lock or a locked
+ * instruction, so it is cheap enough to do many times a frame.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+class Counter
+{
+  public:
+    /**
+     * Constructs a Counter, and makes its metric if there is none with its
+     * name yet.  This takes a lock, so counters should be made once and
+     * kept, not made where they are counted.
+     *
+     * @since  0.7
+     *
+     * @param [in] name The name of the metric.
+     *
+     * @throws std::invalid_argument If the name is longer than
+     * Metrics::maxNameLength, or is the name of a gauge.
+     * @throws std::runtime_error If there are already Metrics::maxMetrics
+     * metrics.
+     */
+    explicit Counter (const char *name);
+
+    /**
+     * Counts up.
+     *
+     * @since  0.7
+     *
+     * @param [in] amount How much to count up by.
+     */
+    void Add (std::int64_t amount);
+    /**
+     * Counts up by one.
+     *
+     * @since  0.7
+     *
+     * @return `*this`.
+     */
+    inline Counter &operator++ ();
+    /**
+     * Counts up.
+     *
+     * @since  0.7
+     *
+     * @param [in] amount How much to count up by.
+     *
+     * @return `*this`.
+     */
+    inline Counter &operator+= (std::int64_t amount);
+
+    /**
+     * Returns the total of the counter over every thread, as it is now.  This
+     * reads every thread's counter.
+     *
+     * @since  0.7
+     *
+     * @return The total.
+     */
+    std::int64_t GetTotal () const;
+
+  private:
+    std::size_t metric;         ///< The number of the metric.
+};
+
+/**
+ * Measures how much of something there is, for Metrics.  Setting a gauge is
+ * one atomic store.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+class Gauge
+{
+  public:
+    /**
+     * Constructs a Gauge, and makes its metric if there is none with its name
+     * yet.  This takes a lock, so gauges should be made once and kept.
+     *
+     * @since  0.7
+     *
+     * @param [in] name The name of the metric.
+     *
+     * @throws std::invalid_argument If the name is longer than
+     * Metrics::maxNameLength, or is the name of a counter.
+     * @throws std::runtime_error If there are already Metrics::maxMetrics
+     * metrics.
+     */
+    explicit Gauge (const char *name);
+
+    /**
+     * Sets the gauge.
+     *
+     * @since  0.7
+     *
+     * @param [in] value How much there is now.
+     */
+    inline void Set (std::int64_t value);
+    /**
+     * Adds to the gauge.  Unlike Set(), this is a locked instruction, so that
+     * threads can add to the same gauge at once.
+     *
+     * @since  0.7
+     *
+     * @param [in] amount How much more there is now, or less if negative.
+     */
+    inline void Add (std::int64_t amount);
+    /**
+     * Returns the value of the gauge.
+     *
+     * @since  0.7
+     *
+     * @return How much there is now.
+     */
+    inline std::int64_t Get () const;
+
+  private:
+    std::atomic<std::int64_t> *value; ///< The value of the metric.
+};
+
+
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_METRICS
@@ -0,0 +1,90 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_METRICS_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_METRICS_INL
+
+#include <algorithm>
+
+namespace hummstrummengine {
+namespace debug {
+
+std::int64_t
+MetricHistory::GetMin () const
+{
+  if (frames.empty ())
+    return 0;
+  return *std::min_element (frames.begin (), frames.end ());
+}
+
+std::int64_t
+MetricHistory::GetMax () const
+{
+  if (frames.empty ())
+    return 0;
+  return *std::max_element (frames.begin (), frames.end ());
+}
+
+double
+MetricHistory::GetMean () const
+{
+  if (frames.empty ())
+    return 0;
+  double sum = 0;
+  for (std::int64_t value : frames)
+    sum += static_cast<double> (value);
+  return sum / frames.size ();
+}
+
+Counter &
+Counter::operator++ ()
+{
+  Add (1);
+  return *this;
+}
+
+Counter &
+Counter::operator+= (std::int64_t amount)
+{
+  Add (amount);
+  return *this;
+}
+
+void
+Gauge::Set (std::int64_t value)
+{
+  this->value->store (value, std::memory_order_relaxed);
+}
+
+void
+Gauge::Add (std::int64_t amount)
+{
+  this->value->fetch_add (amount, std::memory_order_relaxed);
+}
+
+std::int64_t
+Gauge::Get () const
+{
+  return this->value->load (std::memory_order_relaxed);
+}
+
+
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_METRICS_INL
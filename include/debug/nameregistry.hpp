@@ -0,0 +1,99 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::detail::NameRegistry, which keeps named entries in a fixed
+ * array without allocating.
+ *
+ * @file   debug/nameregistry.hpp
+ * @see    detail::NameRegistry
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_NAMEREGISTRY
+#define HUMMSTRUMM_ENGINE_DEBUG_NAMEREGISTRY
+
+#include <atomic>
+#include <cstddef>
+
+namespace hummstrummengine {
+namespace debug {
+namespace detail {
+
+/**
+ * A fixed number of entries that are looked up by name, such as the metrics of
+ * Metrics or the lock sites of LockProfiler.  Entries are made the first time
+ * their name is looked up and are never removed, so they can be read without
+ * a lock: readers only look at the first GetCount() entries, and the count is
+ * only raised after an entry is filled in.
+ *
+ * It has no constructor, so one at namespace scope is zero-initialized before
+ * any constructor runs, and can be used from the constructors of other
+ * globals.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @tparam EntryT An entry.  It must have a @c char array named @c name , and
+ * zero must be a good start for the rest of it.
+ * @tparam count The number of entries.
+ */
+template <typename EntryT, std::size_t count>
+struct NameRegistry
+{
+    /**
+     * Returns the number of the entry with a name, making it if there is
+     * none.
+     *
+     * @since 0.7
+     *
+     * @param [in] name The name.
+     * @param [in] kind What the entries are, for errors, such as "metric".
+     * @param [in] fill Called with a new entry, after its name is copied and
+     * before it can be seen by readers.
+     *
+     * @return The number of the entry.
+     *
+     * @throws std::invalid_argument If the name doesn't fit in an entry.
+     * @throws std::runtime_error If the name is new and every entry is used.
+     */
+    template <typename FillT>
+    inline std::size_t Find (const char *name, const char *kind, FillT fill);
+    /**
+     * Returns how many entries have been made.
+     *
+     * @since 0.7
+     *
+     * @return The number of entries that can be read.
+     */
+    inline std::size_t GetCount () const;
+
+    /// The entries.
+    EntryT entries[count];
+    /// How many entries have been made.  Only raised while holding
+    /// registering, after the entry is filled in.
+    std::atomic<std::size_t> used;
+    /// Whether a thread is looking up or making an entry.
+    std::atomic<bool> registering;
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_NAMEREGISTRY
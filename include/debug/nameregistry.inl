@@ -0,0 +1,73 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_NAMEREGISTRY_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_NAMEREGISTRY_INL
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace hummstrummengine {
+namespace debug {
+namespace detail {
+
+template <typename EntryT, std::size_t count>
+template <typename FillT>
+std::size_t
+NameRegistry<EntryT, count>::Find (const char *name, const char *kind,
+                                   FillT fill)
+{
+  if (std::strlen (name) >= sizeof entries[0].name)
+    throw std::invalid_argument (std::string ("The ") + kind + " name " +
+                                 name + " is too long.");
+
+  while (registering.exchange (true, std::memory_order_acquire))
+    std::this_thread::yield ();
+  std::size_t made = used.load (std::memory_order_relaxed);
+  std::size_t found = 0;
+  while (found < made && std::strcmp (entries[found].name, name) != 0)
+    ++found;
+  if (found == made && made < count)
+    {
+      std::strcpy (entries[found].name, name);
+      fill (entries[found]);
+      used.store (made + 1, std::memory_order_release);
+    }
+  registering.store (false, std::memory_order_release);
+
+  if (found == count)
+    throw std::runtime_error (std::string ("There are too many ") + kind +
+                              "s to make " + name + ".");
+  return found;
+}
+
+template <typename EntryT, std::size_t count>
+std::size_t
+NameRegistry<EntryT, count>::GetCount () const
+{
+  return used.load (std::memory_order_acquire);
+}
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_NAMEREGISTRY_INL
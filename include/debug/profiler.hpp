@@ -32,10 +32,174 @@
 #include <vector>
 #include <iosfwd>
 #include <atomic>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "debug/logging/level.hpp"
+#include "debug/logging/timestamp.hpp"
+#include "debug/profiling/allocations.hpp"
+#include "debug/profiling/chrometrace.hpp"
+#include "debug/profiling/perfcounters.hpp"
+#include "debug/statistics.hpp"
 
 namespace hummstrummengine {
 namespace debug {
 
+/**
+ * When and where a Profiler reports its runs.  By default, a Profiler prints
+ * a line as each run starts and ends, and a summary when it is destructed.
+ * Printing happens between runs, but its cost still ends up in the next run
+ * measured, so a Profiler timing something short, like a frame, should be
+ * quiet: it then only records each run, and prints the summary when
+ * `report()` is called, every so many runs, and when it is destructed.
+ *
+ * A summary can also be sent as one log message, with its numbers attached
+ * as structured fields (see logging::Field()), so that it reaches the log
+ * backends when the Profiler prints to core::Engine::GetLog().
+ *
+ * A Profiler can also count cycles, instructions, cache misses, and branch
+ * misses in its runs with profiling::PerfCounters, and add the average of
+ * each, and the instructions per cycle, to its summaries.
+ * Likewise, it can count the heap allocations its thread makes in its runs
+ * with profiling::AllocationProfiler.
+ *
+ * @code
+ * Profiler<> frames (engine.GetLog (),
+ *                    ProfilerReport::Quiet (600).ThroughLog (Level::info));
+ * @endcode
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct ProfilerReport
+{
+    /**
+     * Returns a policy that prints each run as it starts and ends.
+     *
+     * @since  0.7
+     *
+     * @return The policy that Profiler uses by default.
+     */
+    static inline ProfilerReport EveryRun ();
+    /**
+     * Returns a policy that only records runs, and prints nothing but
+     * summaries.
+     *
+     * @since  0.7
+     *
+     * @param [in] every How many runs to print a summary after, or 0 to only
+     * print one when `report()` is called or the Profiler is destructed.
+     *
+     * @return The quiet policy.
+     */
+    static inline ProfilerReport Quiet (unsigned long every = 0);
+
+    /**
+     * Returns a copy of this policy that sends each summary as a log message
+     * of the given level instead of as plain lines of text.
+     *
+     * @since  0.7
+     *
+     * @param [in] level The level of the summaries.
+     *
+     * @return The new policy.
+     */
+    inline ProfilerReport ThroughLog (logging::Level level) const;
+    /**
+     * Returns a copy of this policy that also counts hardware events in each
+     * run, and adds them to the summaries.
+     *
+     * @since  0.7
+     *
+     * @param [in] counters The counters to read.  They must have been
+     * constructed on the thread that runs the Profiler, and must outlive it.
+     * If they count nothing, nothing is added to the summaries.
+     *
+     * @return The new policy.
+     */
+    inline ProfilerReport Counting (profiling::PerfCounters &counters) const;
+    /**
+     * Returns a copy of this policy that also counts the heap allocations
+     * and frees of the Profiler's thread in each run, and adds them to the
+     * summaries.  The Profiler's own allocations, such as for printing, are
+     * left out.  If profiling::AllocationProfiler isn't hooked in, nothing
+     * is added to the summaries.
+     *
+     * @since  0.7
+     *
+     * @return The new policy.
+     */
+    inline ProfilerReport CountingAllocations () const;
+
+    /// Whether to print each run as it starts and ends.
+    bool eachRun;
+    /// How many runs to print a summary after, or 0 for never.
+    unsigned long every;
+    /// Whether to send summaries as log messages.
+    bool throughLog;
+    /// The level of the log messages.
+    logging::Level level;
+    /// The counters to read in each run, or `nullptr`.
+    profiling::PerfCounters *counters;
+    /// Whether to count the heap allocations in each run.
+    bool allocations;
+};
+
+namespace detail {
+
+/**
+ * Sends a Profiler summary as one log message, with a structured field for
+ * each number in it.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] log The stream to send the message on.
+ * @param [in] level The level of the message.
+ * @param [in] text The summary.
+ * @param [in] fields The names and values of the fields.
+ */
+void LogProfilerReport (
+  std::ostream &log, logging::Level level, const std::string &text,
+  const std::vector<std::pair<const char *, double> > &fields);
+
+/**
+ * Adds the average hardware event counts of a Profiler's runs to its summary,
+ * if the counters count anything.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] text The text of the summary.
+ * @param [in,out] fields The fields of the summary.
+ * @param [in] profiler The number of the Profiler.
+ * @param [in] counters The counters the Profiler reads.
+ * @param [in] counted The events counted in all the runs.
+ * @param [in] runs The number of runs.
+ */
+void PrintProfilerCounters (
+  std::ostream &text, std::vector<std::pair<const char *, double> > &fields,
+  unsigned long profiler, const profiling::PerfCounters &counters,
+  const profiling::PerfCounts &counted, std::size_t runs);
+
+/**
+ * Adds the average heap allocations and frees of a Profiler's runs to its
+ * summary, if profiling::AllocationProfiler counts them.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] text The text of the summary.
+ * @param [in,out] fields The fields of the summary.
+ * @param [in] profiler The number of the Profiler.
+ * @param [in] allocated The allocations and frees in all the runs.
+ * @param [in] runs The number of runs.
+ */
+void PrintProfilerAllocations (
+  std::ostream &text, std::vector<std::pair<const char *, double> > &fields,
+  unsigned long profiler, const profiling::AllocationCounts &allocated,
+  std::size_t runs);
+
+}
+
 /**
  * A timer that prints out elapsed times to a log.  A `Profiler<ClockT,
  * DurationT>` divides its lifetime into "runs" whose time durations are
@@ -57,12 +221,17 @@ namespace debug {
  *         satisfy the requirements of the `Clock` concept.
  * @tparam DurationT The type in which to print the times measured.  This type
  *         must be an instantiation of the `std::chrono::duration` template.
+ * @tparam StatisticsT The type that keeps statistics of the run durations.
+ *         `AllRunStatistics` keeps every run, and `HistogramStatistics` keeps
+ *         a fixed amount of memory and also reports percentiles.
  *
  * @invariant The log stream stored within `*this` will not be a `nullptr`.
  * A valid `Profiler<ClockT, DurationT>` is always in a run.
  */
 template <typename ClockT = std::chrono::high_resolution_clock,
-          typename DurationT = typename ClockT::duration>
+          typename DurationT = typename ClockT::duration,
+          typename StatisticsT =
+            AllRunStatistics<typename ClockT::duration> >
 class Profiler
 {
   public:
@@ -70,7 +239,9 @@ class Profiler
     typedef ClockT Clock;
     /// The `std::chrono::duration` used to print the results.
     typedef DurationT Duration;
-    
+    /// The type that keeps statistics of the run durations.
+    typedef StatisticsT Statistics;
+
     /**
      * Constructs a new `Profiler<ClockT, DurationT>` object using a given log.
      * This constructor starts the internal timer for the `Profiler<ClockT,
@@ -81,6 +252,7 @@ class Profiler
      * @since 0.7
      *
      * @param [in] outputLog A stream that will be used as a log.
+     * @param [in] report When and where to report runs.
      *
      * @pre `outputLog` is a valid object guaranteed to outlive `*this`, either
      * until `~Profiler<ClockT, DurationT>` is called on `*this` or until
@@ -88,7 +260,28 @@ class Profiler
      *
      * @post `*this` is a valid object on which any operation can be performed.
      */
-    explicit Profiler (std::ostream &outputLog);
+    explicit Profiler (std::ostream &outputLog,
+                       ProfilerReport report = ProfilerReport::EveryRun ());
+    /**
+     * Constructs a new `Profiler<ClockT, DurationT>` object using a given log,
+     * which also adds each run to a trace.  This constructor starts the
+     * internal timer for the `Profiler<ClockT, DurationT>`.
+     *
+     * @since  0.7
+     *
+     * @param [in] outputLog A stream that will be used as a log.
+     * @param [in] trace A trace to which each run is added as a span named
+     * "Profiler N", on the thread that ends the run.
+     * @param [in] report When and where to report runs.
+     *
+     * @pre `outputLog` and `trace` are valid objects guaranteed to outlive
+     * `*this`, either until `~Profiler<ClockT, DurationT>` is called on
+     * `*this` or until `*this` is moved from.
+     *
+     * @post `*this` is a valid object on which any operation can be performed.
+     */
+    Profiler (std::ostream &outputLog, profiling::ChromeTraceWriter &trace,
+              ProfilerReport report = ProfilerReport::EveryRun ());
     /**
      * Constructs a new `Profiler<ClockT, DurationT>` object by moving from
      * another existing `Profiler<ClockT, DurationT>` object.
@@ -110,12 +303,12 @@ class Profiler
      * destructor.  The effect of performing any other operations on `rhs` is
      * undefined.
      */
-    Profiler (Profiler<Clock, Duration> &&rhs);
+    Profiler (Profiler<Clock, Duration, Statistics> &&rhs);
     /**
      * Destructs an existing `Profiler<ClockT, DurationT>` object.  If `*this`
      * is a valid object, this destructor finishes this run of the timer, prints
-     * out the last run's data to the log, and then prints out statistics about
-     * all runs.
+     * out the last run's data to the log unless `*this` is quiet, and then
+     * prints out statistics about all runs.
      *
      * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
      * @date   2013-07-16
@@ -129,7 +322,8 @@ class Profiler
 
     /**
      * Finishes this run of the timer, prints out the last run's data to the
-     * log, and the starts a new run.
+     * log, and the starts a new run.  If `*this` is quiet, the run is only
+     * recorded, and statistics about all runs are printed if it is time to.
      *
      * @author Patrick M. Niedzielski <PatrickNiedzielski@gmail.com>
      * @date   2013-07-16
@@ -139,6 +333,27 @@ class Profiler
      */
     void next ();
 
+    /**
+     * Prints out statistics about all the runs that have finished so far.
+     * The current run goes on.
+     *
+     * @since  0.7
+     *
+     * @pre `*this` is a valid object.
+     */
+    void report ();
+
+    /**
+     * Returns the statistics of the runs that have finished so far.
+     *
+     * @since  0.7
+     *
+     * @return The statistics, which change as runs finish.
+     *
+     * @pre `*this` is a valid object.
+     */
+    const Statistics &GetStatistics () const;
+
   private:
     /**
      * Returns a `std::stringbuf` which contains a representation of the
@@ -160,14 +375,61 @@ class Profiler
     template <typename InDurationT>
     static std::string printDuration (const InDurationT &d);
 
+    /**
+     * Adds the last run to the trace, if there is one.  The run is taken to
+     * have ended now.
+     *
+     * @since  0.7
+     */
+    void traceRun ();
+
+    /**
+     * Adds the hardware events counted and the allocations made since the
+     * last call to the counts of all runs, if `*this` counts them.  The run
+     * is taken to have ended now.
+     *
+     * @since  0.7
+     */
+    void countRun ();
+
+    /**
+     * Adds the standard deviation and percentiles of the runs to a summary, if
+     * `Statistics` keeps them.
+     *
+     * @since  0.7
+     *
+     * @param [in,out] text The text of the summary.
+     * @param [in,out] fields The fields of the summary, in nanoseconds.
+     */
+    void printPercentiles (
+      std::ostream &text,
+      std::vector<std::pair<const char *, double> > &fields, std::true_type);
+    void printPercentiles (
+      std::ostream &text,
+      std::vector<std::pair<const char *, double> > &fields, std::false_type);
+
     /// The start of the current run.
     typename Clock::time_point start;
-    /// The times of previous runs.
-    std::vector<typename Clock::duration> times;
+    /// The time of the last run.
+    typename Clock::duration last;
+    /// The statistics of previous runs.
+    Statistics statistics;
     /// The log to print to.
     std::ostream *out;
     /// The identifier of the current profiler.
     unsigned long num;
+    /// The trace to add runs to, or `nullptr`.
+    profiling::ChromeTraceWriter *trace;
+    /// When and where to report runs.
+    ProfilerReport policy;
+    /// The hardware event counts at the start of the current run.
+    profiling::PerfCounts runCounts;
+    /// The hardware events counted in all the runs that ended.
+    profiling::PerfCounts counted;
+    /// The thread's allocation counts at the start of the current run.
+    profiling::AllocationCounts runAllocations;
+    /// The allocations made in all the runs that ended.
+    profiling::AllocationCounts allocated;
 };
 
 
@@ -29,6 +29,10 @@
 #include <atomic>
 #include <sstream>
 #include <utility>
+#include <cstdint>
+#include <type_traits>
+
+#include "debug/profiling/allocations.inl"
 
 namespace hummstrummengine {
 namespace debug {
@@ -124,87 +128,222 @@ getDurationSuffix<std::chrono::hours>() /* nothrow */
 }
 
 
-template <typename ClockT, typename DurationT>
-Profiler<ClockT, DurationT>::Profiler (std::ostream &outputLog)
-  : start (ClockT::now ()), out (&outputLog), num (detail::profilerCount ())
+ProfilerReport
+ProfilerReport::EveryRun ()
+{
+  ProfilerReport report = {
+    true, 0, false, logging::Level::info, nullptr, false
+  };
+  return report;
+}
+
+ProfilerReport
+ProfilerReport::Quiet (unsigned long every)
+{
+  ProfilerReport report = {
+    false, every, false, logging::Level::info, nullptr, false
+  };
+  return report;
+}
+
+ProfilerReport
+ProfilerReport::ThroughLog (logging::Level level) const
 {
-  *out << "Profiler " << num << ": run " << times.size () << " starting"
-       << std::endl;
+  ProfilerReport report = *this;
+  report.throughLog = true;
+  report.level = level;
+  return report;
 }
 
-template <typename ClockT, typename DurationT>
-Profiler<ClockT, DurationT>::Profiler (Profiler<ClockT, DurationT> &&rhs)
-  : start (std::move (rhs.start)), times (std::move (rhs.times)),
-    out (std::move (rhs.out)), num (std::move (rhs.num))
+ProfilerReport
+ProfilerReport::Counting (profiling::PerfCounters &counters) const
+{
+  ProfilerReport report = *this;
+  report.counters = &counters;
+  return report;
+}
+
+ProfilerReport
+ProfilerReport::CountingAllocations () const
+{
+  ProfilerReport report = *this;
+  report.allocations = true;
+  return report;
+}
+
+
+template <typename ClockT, typename DurationT, typename StatisticsT>
+Profiler<ClockT, DurationT, StatisticsT>::Profiler (std::ostream &outputLog,
+                                                    ProfilerReport report)
+  : start (ClockT::now ()), last (ClockT::duration::zero ()), statistics (),
+    out (&outputLog), num (detail::profilerCount ()),
+    trace (nullptr), policy (report), runCounts (), counted (),
+    runAllocations (), allocated ()
+{
+  if (policy.counters)
+    runCounts = policy.counters->Read ();
+  if (policy.eachRun)
+    *out << "Profiler " << num << ": run " << statistics.GetCount ()
+         << " starting" << std::endl;
+  if (policy.allocations)
+    runAllocations = profiling::AllocationProfiler::GetThreadCounts ();
+}
+
+template <typename ClockT, typename DurationT, typename StatisticsT>
+Profiler<ClockT, DurationT, StatisticsT>::Profiler (
+  std::ostream &outputLog, profiling::ChromeTraceWriter &trace,
+  ProfilerReport report)
+  : start (ClockT::now ()), last (ClockT::duration::zero ()), statistics (),
+    out (&outputLog), num (detail::profilerCount ()),
+    trace (&trace), policy (report), runCounts (), counted (),
+    runAllocations (), allocated ()
+{
+  if (policy.counters)
+    runCounts = policy.counters->Read ();
+  if (policy.eachRun)
+    *out << "Profiler " << num << ": run " << statistics.GetCount ()
+         << " starting" << std::endl;
+  if (policy.allocations)
+    runAllocations = profiling::AllocationProfiler::GetThreadCounts ();
+}
+
+template <typename ClockT, typename DurationT, typename StatisticsT>
+Profiler<ClockT, DurationT, StatisticsT>::Profiler (
+  Profiler<ClockT, DurationT, StatisticsT> &&rhs)
+  : start (std::move (rhs.start)), last (std::move (rhs.last)),
+    statistics (std::move (rhs.statistics)),
+    out (std::move (rhs.out)), num (std::move (rhs.num)),
+    trace (std::move (rhs.trace)), policy (std::move (rhs.policy)),
+    runCounts (rhs.runCounts), counted (rhs.counted),
+    runAllocations (rhs.runAllocations), allocated (rhs.allocated)
 {
   rhs.out = nullptr;
 }
 
-template <typename ClockT, typename DurationT>
-Profiler<ClockT, DurationT>::~Profiler ()
+template <typename ClockT, typename DurationT, typename StatisticsT>
+Profiler<ClockT, DurationT, StatisticsT>::~Profiler ()
 {
   // If the invariant is broken, we moved from this class.  Don't do anything.
   if (out == nullptr)
     return;
 
   auto newStart = ClockT::now ();
+  countRun ();
 
   if (newStart < start)
     {
-      times.emplace_back (ClockT::duration::zero ());
+      last = ClockT::duration::zero ();
     }
   else
     {
-      times.emplace_back (newStart - start);
+      last = newStart - start;
     }
+  statistics.Add (last);
 
   start = std::move (newStart);
+  traceRun ();
 
-  *out << "Profiler " << num << ": run " << times.size () - 1
-       << " ending after "
-       << printDuration (times.back ()) << std::endl;
-
-  auto min_max = std::minmax_element (times.begin (), times.end ());
-  // elements of times should never be negative (by construction), so we don't
-  // need to worry about any signed/unsigned mismatches here.
-  auto ave =
-    std::accumulate (times.begin (), times.end (), ClockT::duration::zero ()) /
-    times.size ();
+  if (policy.eachRun)
+    *out << "Profiler " << num << ": run " << statistics.GetCount () - 1
+         << " ending after "
+         << printDuration (last) << std::endl;
 
-  *out << "Profiler " << num << ": in " << times.size ()
-       << " run(s), min time = " << printDuration (*min_max.first)
-       << ", max time = " << printDuration (*min_max.second)
-       << ", ave time = " << printDuration (ave) << std::endl;
+  report ();
 }
 
-template <typename ClockT, typename DurationT>
-void Profiler<ClockT, DurationT>::next ()
+template <typename ClockT, typename DurationT, typename StatisticsT>
+void Profiler<ClockT, DurationT, StatisticsT>::next ()
 {
   auto newStart = ClockT::now ();
+  countRun ();
 
   if (newStart < start)
     {
-      times.emplace_back (ClockT::duration::zero ());
+      last = ClockT::duration::zero ();
     }
   else
     {
-      times.emplace_back (newStart - start);
+      last = newStart - start;
     }
+  statistics.Add (last);
 
   start = std::move (newStart);
+  if (trace != nullptr)
+    {
+      traceRun ();
+      // Don't count formatting the span, or writing out a full buffer, in the
+      // next run.
+      start = ClockT::now ();
+      if (policy.counters)
+        runCounts = policy.counters->Read ();
+    }
+
+  if (policy.eachRun)
+    {
+      *out << "Profiler " << num << ": run " << statistics.GetCount () - 1
+           << " ending after "
+           << printDuration (last) << std::endl;
+      *out << "Profiler " << num << ": run " << statistics.GetCount ()
+           << " starting" << std::endl;
+    }
+  if (policy.every != 0 && statistics.GetCount () % policy.every == 0)
+    {
+      report ();
+      // Don't count the time spent reporting in the next run.
+      start = ClockT::now ();
+      if (policy.counters)
+        runCounts = policy.counters->Read ();
+    }
+  // Leave out what this allocated, such as for statistics and printing.
+  if (policy.allocations)
+    runAllocations = profiling::AllocationProfiler::GetThreadCounts ();
+}
 
-  *out << "Profiler " << num << ": run " << times.size () - 1
-       << " ending after "
-       << printDuration (times.back ()) << std::endl;
-  *out << "Profiler " << num << ": run " << times.size () << " starting"
-       << std::endl;
+template <typename ClockT, typename DurationT, typename StatisticsT>
+void Profiler<ClockT, DurationT, StatisticsT>::report ()
+{
+  typedef std::chrono::duration<double, std::nano> Nanoseconds;
+
+  std::ostringstream text;
+  std::vector<std::pair<const char *, double> > fields;
+  text << "Profiler " << num << ": in " << statistics.GetCount ()
+       << " run(s), min time = " << printDuration (statistics.GetMin ())
+       << ", max time = " << printDuration (statistics.GetMax ())
+       << ", ave time = " << printDuration (statistics.GetMean ());
+  fields.emplace_back ("profiler", static_cast<double> (num));
+  fields.emplace_back ("runs", static_cast<double> (statistics.GetCount ()));
+  fields.emplace_back ("min_ns", Nanoseconds (statistics.GetMin ()).count ());
+  fields.emplace_back ("max_ns", Nanoseconds (statistics.GetMax ()).count ());
+  fields.emplace_back ("mean_ns",
+                       Nanoseconds (statistics.GetMean ()).count ());
+  printPercentiles (
+    text, fields,
+    std::integral_constant<bool, StatisticsT::hasPercentiles> ());
+  if (policy.counters)
+    detail::PrintProfilerCounters (text, fields, num, *policy.counters,
+                                   counted, statistics.GetCount ());
+  if (policy.allocations)
+    detail::PrintProfilerAllocations (text, fields, num, allocated,
+                                      statistics.GetCount ());
+
+  if (policy.throughLog)
+    detail::LogProfilerReport (*out, policy.level, text.str (), fields);
+  else
+    *out << text.str () << std::endl;
 }
 
+template <typename ClockT, typename DurationT, typename StatisticsT>
+const StatisticsT &
+Profiler<ClockT, DurationT, StatisticsT>::GetStatistics () const
+{
+  return statistics;
+}
 
-template <typename ClockT, typename DurationT>
+
+template <typename ClockT, typename DurationT, typename StatisticsT>
 template <typename InDurationT>
 std::string
-Profiler<ClockT, DurationT>::printDuration (const InDurationT &d)
+Profiler<ClockT, DurationT, StatisticsT>::printDuration (const InDurationT &d)
 {
   std::ostringstream ss;
   ss << std::chrono::duration_cast<DurationT> (d).count () << ' '
@@ -212,6 +351,73 @@ Profiler<ClockT, DurationT>::printDuration (const InDurationT &d)
   return ss.str ();
 }
 
+template <typename ClockT, typename DurationT, typename StatisticsT>
+void
+Profiler<ClockT, DurationT, StatisticsT>::traceRun ()
+{
+  if (trace == nullptr)
+    return;
+
+  std::uint64_t end = logging::GetTimestamp ();
+  std::uint64_t length = static_cast<std::uint64_t> (
+    std::chrono::duration_cast<std::chrono::nanoseconds> (last).count ());
+  trace->AddSpan ("Profiler " + std::to_string (num), "profiler",
+                  length < end ? end - length : 0, end,
+                  logging::GetThreadNumber ());
+}
+
+template <typename ClockT, typename DurationT, typename StatisticsT>
+void
+Profiler<ClockT, DurationT, StatisticsT>::countRun ()
+{
+  if (policy.allocations)
+    {
+      profiling::AllocationCounts now =
+        profiling::AllocationProfiler::GetThreadCounts ();
+      allocated += now - runAllocations;
+      runAllocations = now;
+    }
+
+  if (policy.counters == nullptr)
+    return;
+
+  profiling::PerfCounts now = policy.counters->Read ();
+  for (std::size_t i = 0; i < profiling::PerfCounts::events; ++i)
+    counted.counts[i] += now.counts[i] - runCounts.counts[i];
+  runCounts = now;
+}
+
+template <typename ClockT, typename DurationT, typename StatisticsT>
+void
+Profiler<ClockT, DurationT, StatisticsT>::printPercentiles (
+  std::ostream &text, std::vector<std::pair<const char *, double> > &fields,
+  std::true_type)
+{
+  typedef std::chrono::duration<double, std::nano> Nanoseconds;
+  const double fractions[] = { 0.5, 0.9, 0.99, 0.999 };
+  const char *const names[] = { "p50", "p90", "p99", "p99.9" };
+  const char *const keys[] = { "p50_ns", "p90_ns", "p99_ns", "p999_ns" };
+
+  text << "\nProfiler " << num << ": std dev = "
+       << printDuration (statistics.GetStandardDeviation ());
+  fields.emplace_back (
+    "stddev_ns", Nanoseconds (statistics.GetStandardDeviation ()).count ());
+  for (unsigned i = 0; i < 4; ++i)
+    {
+      auto percentile = statistics.GetPercentile (fractions[i]);
+      text << ", " << names[i] << " = " << printDuration (percentile);
+      fields.emplace_back (keys[i], Nanoseconds (percentile).count ());
+    }
+}
+
+template <typename ClockT, typename DurationT, typename StatisticsT>
+void
+Profiler<ClockT, DurationT, StatisticsT>::printPercentiles (
+  std::ostream &, std::vector<std::pair<const char *, double> > &,
+  std::false_type)
+{
+}
+
 }
 }
 
@@ -0,0 +1,374 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::profiling::AllocationProfiler, which counts the program's
+ * heap allocations, and HUMMSTRUMM_ENGINE_ALLOCATION_HOOKS, which replaces the
+ * global @c operator new and @c operator delete so that it can.
+ *
+ * @file   debug/profiling/allocations.hpp
+ * @see    AllocationProfiler
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_ALLOCATIONS
+#define HUMMSTRUMM_ENGINE_DEBUG_PROFILING_ALLOCATIONS
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+/**
+ * How many heap allocations and frees there were, and how many bytes they
+ * were of.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct AllocationCounts
+{
+    /**
+     * Returns how many allocations haven't been freed.
+     *
+     * @since  0.7
+     *
+     * @return The allocations, less the frees.
+     */
+    inline std::int64_t GetLiveAllocations () const;
+    /**
+     * Returns how many allocated bytes haven't been freed.
+     *
+     * @since  0.7
+     *
+     * @return The bytes allocated, less the bytes freed.
+     */
+    inline std::int64_t GetLiveBytes () const;
+
+    /**
+     * Adds other counts to these.
+     *
+     * @since  0.7
+     *
+     * @param [in] rhs The counts to add.
+     *
+     * @return `*this`.
+     */
+    inline AllocationCounts &operator+= (const AllocationCounts &rhs);
+    /**
+     * Returns how much these counts grew since earlier ones.
+     *
+     * @since  0.7
+     *
+     * @param [in] rhs The earlier counts.
+     *
+     * @return The difference of each count.
+     */
+    inline AllocationCounts operator- (const AllocationCounts &rhs) const;
+
+    std::uint64_t allocations;  ///< How many blocks were allocated.
+    std::uint64_t bytes;        ///< How many bytes were allocated.
+    std::uint64_t frees;        ///< How many blocks were freed.
+    std::uint64_t freedBytes;   ///< How many bytes were freed.
+};
+
+/**
+ * A call stack that allocated, and the counts of what it allocated.  Only
+ * some allocations have their stacks taken (see
+ * AllocationProfiler::SetSampleRate()), so the counts are estimates: each
+ * sampled allocation stands for as many allocations as the sample rate.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct AllocationSite
+{
+    /// The most frames that are kept of a call stack, from the innermost.
+    static const std::size_t maxDepth = 16;
+
+    /// The return addresses, from the innermost frame out.
+    std::uintptr_t frames[maxDepth];
+    /// How many frames there are.  Allocations whose stacks didn't fit in
+    /// the table of sites are counted in a site with no frames.
+    std::size_t depth;
+    /// The estimated counts of the allocations made here.  A block counts
+    /// as freed here wherever it is freed.
+    AllocationCounts counts;
+};
+
+/**
+ * Counts the heap allocations of the whole program, of each thread, and of
+ * each call stack that allocates, so that allocations in code that should
+ * make none, like the steady state of a frame, can be found and tested for.
+ *
+ * Nothing is counted unless one source file of the program uses
+ * HUMMSTRUMM_ENGINE_ALLOCATION_HOOKS, which replaces the global
+ * @c operator new and @c operator delete with ones that count.  They put a
+ * 16 byte header in front of each block, and add about 10 ns to each
+ * allocation and free.  Taking the call stack of an allocation costs a few
+ * microseconds, so stacks are only taken for one allocation in every so many
+ * (see SetSampleRate()), and not at all by default.
+ *
+ * Each of the first maxThreads threads to allocate is counted on its own;
+ * later threads are counted together with the last of them.
+ *
+ * @code
+ * HUMMSTRUMM_ENGINE_ALLOCATION_HOOKS
+ *
+ * void
+ * RunFrame ()
+ * {
+ *   // ...
+ *   AllocationCounts frame = AllocationProfiler::EndFrame ();
+ *   assert (frame.allocations == 0);
+ * }
+ * @endcode
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @warning With the hooks in place, memory from @c operator new must not be
+ * freed with @c free() , nor the other way around.
+ */
+class AllocationProfiler
+{
+  public:
+    /// How many threads are counted on their own.
+    static const std::size_t maxThreads = 256;
+    /// How many call stacks are kept.
+    static const std::size_t maxSites = 1024;
+
+    AllocationProfiler () = delete;
+
+    /**
+     * Returns whether allocations are being counted, which they are if
+     * HUMMSTRUMM_ENGINE_ALLOCATION_HOOKS is in the program.
+     *
+     * @since  0.7
+     *
+     * @return Whether allocations are counted.
+     */
+    static bool IsHooked ();
+
+    /**
+     * Sets how often to take the call stack of an allocation.
+     *
+     * @since  0.7
+     *
+     * @param [in] every Take the stack of one in every this many of a
+     * thread's allocations, or 0 to take none.
+     */
+    static void SetSampleRate (unsigned every);
+    /**
+     * Returns how often the call stack of an allocation is taken.
+     *
+     * @since  0.7
+     *
+     * @return The sample rate, or 0 if no stacks are taken.
+     */
+    static unsigned GetSampleRate ();
+
+    /**
+     * Returns the counts of the whole program.
+     *
+     * @since  0.7
+     *
+     * @return The counts since the program started.
+     */
+    static AllocationCounts GetCounts ();
+    /**
+     * Returns the counts of the calling thread.  This is cheap.
+     *
+     * @since  0.7
+     *
+     * @return The allocations the thread made and the blocks it freed.
+     */
+    static AllocationCounts GetThreadCounts ();
+    /**
+     * Returns the counts of every thread that allocated.
+     *
+     * @since  0.7
+     *
+     * @return Each thread's number, from 1 in the order they first
+     * allocated, and its counts.
+     */
+    static std::vector<std::pair<unsigned, AllocationCounts> >
+    GetEveryThreadCounts ();
+    /**
+     * Returns every call stack whose allocations were sampled.
+     *
+     * @since  0.7
+     *
+     * @return A snapshot of the sites.
+     */
+    static std::vector<AllocationSite> GetSites ();
+
+    /**
+     * Ends a frame, and starts the next.
+     *
+     * @since  0.7
+     *
+     * @return The counts of the whole program during the frame that ended.
+     */
+    static AllocationCounts EndFrame ();
+    /**
+     * Returns the counts of the frame so far.
+     *
+     * @since  0.7
+     *
+     * @return The counts of the whole program since EndFrame() was last
+     * called.
+     */
+    static AllocationCounts GetFrameCounts ();
+
+    /**
+     * Writes the bytes each sampled call stack allocated, as folded stacks
+     * (see Sampler::WriteFolded()), so a flame graph shows where the
+     * allocations come from.
+     *
+     * @since  0.7
+     *
+     * @param [in,out] out The stream to write to.
+     */
+    static void WriteAllocated (std::ostream &out);
+    /**
+     * Writes the bytes each sampled call stack allocated that haven't been
+     * freed, as folded stacks: a snapshot of the live heap.
+     *
+     * @since  0.7
+     *
+     * @param [in,out] out The stream to write to.
+     */
+    static void WriteLiveHeap (std::ostream &out);
+};
+
+namespace detail {
+
+/**
+ * Marks the allocation hooks as in place when constructed.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct AllocationHooks
+{
+    AllocationHooks ();
+};
+
+/**
+ * Allocates a counted block, as @c operator new does.
+ *
+ * @since  0.7
+ *
+ * @param [in] size The size of the block.
+ *
+ * @return The block.
+ *
+ * @throws std::bad_alloc If there is no memory, and the new handler can't
+ * make any.
+ */
+void *New (std::size_t size);
+/**
+ * Allocates a counted block, as the @c std::nothrow @c operator new does.
+ *
+ * @since  0.7
+ *
+ * @param [in] size The size of the block.
+ *
+ * @return The block, or @c nullptr if there is no memory.
+ */
+void *NewNothrow (std::size_t size) /* noexcept */;
+/**
+ * Frees a block from New() or NewNothrow().
+ *
+ * @since  0.7
+ *
+ * @param [in] block The block, or @c nullptr .
+ */
+void Delete (void *block) /* noexcept */;
+
+}
+
+
+}
+}
+}
+
+#ifdef HUMMSTRUMM_ENGINE_COMPILER_MSVC
+#  define HUMMSTRUMM_ENGINE_ALLOCATION_NOEXCEPT throw ()
+#else
+#  define HUMMSTRUMM_ENGINE_ALLOCATION_NOEXCEPT noexcept
+#endif
+
+/**
+ * @def HUMMSTRUMM_ENGINE_ALLOCATION_HOOKS
+ *
+ * Replaces the global @c operator new and @c operator delete , and their
+ * array and @c std::nothrow forms, with ones that count allocations for
+ * debug::profiling::AllocationProfiler.  Use this once, at namespace scope,
+ * in one source file of the program.
+ *
+ * @since  0.7
+ */
+#define HUMMSTRUMM_ENGINE_ALLOCATION_HOOKS                                  \
+  static ::hummstrummengine::debug::profiling::detail::AllocationHooks       \
+  hummstrummEngineAllocationHooks;                                          \
+  void *operator new (std::size_t size)                                     \
+  {                                                                         \
+    return ::hummstrummengine::debug::profiling::detail::New (size);        \
+  }                                                                         \
+  void *operator new[] (std::size_t size)                                   \
+  {                                                                         \
+    return ::hummstrummengine::debug::profiling::detail::New (size);        \
+  }                                                                         \
+  void *operator new (std::size_t size, const std::nothrow_t &)             \
+    HUMMSTRUMM_ENGINE_ALLOCATION_NOEXCEPT                                   \
+  {                                                                         \
+    return ::hummstrummengine::debug::profiling::detail::NewNothrow (size); \
+  }                                                                         \
+  void *operator new[] (std::size_t size, const std::nothrow_t &)           \
+    HUMMSTRUMM_ENGINE_ALLOCATION_NOEXCEPT                                   \
+  {                                                                         \
+    return ::hummstrummengine::debug::profiling::detail::NewNothrow (size); \
+  }                                                                         \
+  void operator delete (void *block) HUMMSTRUMM_ENGINE_ALLOCATION_NOEXCEPT  \
+  {                                                                         \
+    ::hummstrummengine::debug::profiling::detail::Delete (block);           \
+  }                                                                         \
+  void operator delete[] (void *block)                                      \
+    HUMMSTRUMM_ENGINE_ALLOCATION_NOEXCEPT                                   \
+  {                                                                         \
+    ::hummstrummengine::debug::profiling::detail::Delete (block);           \
+  }                                                                         \
+  void operator delete (void *block, const std::nothrow_t &)                \
+    HUMMSTRUMM_ENGINE_ALLOCATION_NOEXCEPT                                   \
+  {                                                                         \
+    ::hummstrummengine::debug::profiling::detail::Delete (block);           \
+  }                                                                         \
+  void operator delete[] (void *block, const std::nothrow_t &)              \
+    HUMMSTRUMM_ENGINE_ALLOCATION_NOEXCEPT                                   \
+  {                                                                         \
+    ::hummstrummengine::debug::profiling::detail::Delete (block);           \
+  }
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_ALLOCATIONS
@@ -0,0 +1,63 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_ALLOCATIONS_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_PROFILING_ALLOCATIONS_INL
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+std::int64_t
+AllocationCounts::GetLiveAllocations () const
+{
+  return static_cast<std::int64_t> (allocations - frees);
+}
+
+std::int64_t
+AllocationCounts::GetLiveBytes () const
+{
+  return static_cast<std::int64_t> (bytes - freedBytes);
+}
+
+AllocationCounts &
+AllocationCounts::operator+= (const AllocationCounts &rhs)
+{
+  allocations += rhs.allocations;
+  bytes += rhs.bytes;
+  frees += rhs.frees;
+  freedBytes += rhs.freedBytes;
+  return *this;
+}
+
+AllocationCounts
+AllocationCounts::operator- (const AllocationCounts &rhs) const
+{
+  AllocationCounts difference = {
+    allocations - rhs.allocations, bytes - rhs.bytes, frees - rhs.frees,
+    freedBytes - rhs.freedBytes
+  };
+  return difference;
+}
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_ALLOCATIONS_INL
@@ -0,0 +1,188 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::profiling::ChromeTraceWriter, which writes profiling data in
+ * the Chrome trace event format.
+ *
+ * @file   debug/profiling/chrometrace.hpp
+ * @see    ChromeTraceWriter
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_CHROMETRACE
+#define HUMMSTRUMM_ENGINE_DEBUG_PROFILING_CHROMETRACE
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+struct ZoneFrame;
+
+/**
+ * Writes zones and Profiler runs to a file in the Chrome trace event format,
+ * which chrome://tracing and Perfetto can open.  Each zone and run becomes a
+ * complete event on the track of the thread it was on, so nested zones show
+ * up nested, and each frame becomes an event on a track of its own.
+ *
+ * Events are written as they come, through a buffer, so a capture can be as
+ * long as the disk allows.  The file is a JSON array, which the viewers can
+ * read even if the program dies before it is closed.
+ *
+ * A ChromeTraceWriter can be given to a ZoneProfiler as its frame handler:
+ *
+ * @code
+ * debug::profiling::ChromeTraceWriter trace ("frames.json");
+ * debug::profiling::ZoneProfiler profiler (std::ref (trace));
+ * @endcode
+ *
+ * and to a Profiler, which adds its runs.  Counters, such as those of
+ * debug::Metrics, can be added too.  It can be used from any number of
+ * threads at once.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+class ChromeTraceWriter
+{
+  public:
+    /**
+     * Constructs a new ChromeTraceWriter, replacing the file if it exists.
+     * Times in the trace are counted from now.
+     *
+     * @since  0.7
+     *
+     * @param [in] file The name of the trace file.
+     * @param [in] bufferSize How many bytes to collect before writing them to
+     * the file.
+     */
+    explicit ChromeTraceWriter (std::string file =
+                                  "hummstrummengine-trace.json",
+                                std::size_t bufferSize = 1 << 16);
+    /**
+     * Destructs an existing ChromeTraceWriter, finishing the file.
+     *
+     * @since  0.7
+     */
+    ~ChromeTraceWriter ();
+
+    ChromeTraceWriter (const ChromeTraceWriter &) = delete;
+    ChromeTraceWriter &operator= (const ChromeTraceWriter &) = delete;
+
+    /**
+     * Writes the zones of a frame, and the frame itself.
+     *
+     * @since  0.7
+     *
+     * @param [in] frame The frame, as given to a ZoneProfiler's frame
+     * handler.
+     */
+    void operator() (const ZoneFrame &frame);
+
+    /**
+     * Writes a span of time on a thread, such as a Profiler run.
+     *
+     * @since  0.7
+     *
+     * @param [in] name What to call the span.
+     * @param [in] category The category of the span, which the viewers can
+     * filter by.
+     * @param [in] begin When the span started, in nanoseconds since the epoch
+     * (see logging::GetTimestamp()).
+     * @param [in] end When the span ended.
+     * @param [in] thread The number of the thread (see
+     * logging::GetThreadNumber()).
+     */
+    void AddSpan (const std::string &name, const char *category,
+                  std::uint64_t begin, std::uint64_t end, unsigned thread);
+
+    /**
+     * Writes the value of a counter at a time, which the viewers show as a
+     * graph on a track of its own.
+     *
+     * @since  0.7
+     *
+     * @param [in] name The name of the counter.
+     * @param [in] time When it had the value, in nanoseconds since the epoch
+     * (see logging::GetTimestamp()).
+     * @param [in] value The value.
+     */
+    void AddCounter (const char *name, std::uint64_t time,
+                     std::int64_t value);
+
+    /**
+     * Writes everything buffered so far to the file.  The file isn't a
+     * finished JSON array until the ChromeTraceWriter is destroyed, but the
+     * viewers can read it anyway.
+     *
+     * @since  0.7
+     */
+    void Flush ();
+
+  private:
+    /**
+     * Writes the name of a thread, if it has changed.
+     */
+    void PutThreadName (unsigned thread, const std::string &name);
+    /**
+     * Writes a complete event, apart from its arguments and closing brace.
+     */
+    void PutEvent (const char *name, std::size_t nameLength,
+                   const char *category, std::uint64_t begin,
+                   std::uint64_t end, unsigned thread);
+    /**
+     * Writes nanoseconds as microseconds.
+     */
+    void PutMicroseconds (std::uint64_t nanoseconds, bool negative);
+    /**
+     * Adds text to the buffer, writing the buffer out if it is full.
+     */
+    void Put (const char *text, std::size_t length);
+    /**
+     * Adds a JSON string to the buffer.
+     */
+    void PutString (const char *text, std::size_t length);
+    /**
+     * Writes the buffer out without flushing the file.
+     */
+    void WriteBuffer ();
+
+    std::mutex mutex;           ///< Lets threads write at once.
+    std::ofstream fileStream;   ///< The trace file.
+    std::vector<char> buffer;   ///< The bytes not written yet.
+    std::size_t used;           ///< How much of the buffer is used.
+    bool first;                 ///< Whether no event has been written yet.
+    std::uint64_t start;        ///< The time the trace starts at.
+    unsigned long process;      ///< The id of this process.
+    /// The names already written for each thread.
+    std::unordered_map<unsigned, std::string> threadNames;
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_CHROMETRACE
@@ -0,0 +1,184 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::profiling::PerfCounters, which reads the processor's
+ * performance counters, and debug::profiling::PerfCounts, which holds what it
+ * read.
+ *
+ * @file   debug/profiling/perfcounters.hpp
+ * @see    PerfCounters
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_PERFCOUNTERS
+#define HUMMSTRUMM_ENGINE_DEBUG_PROFILING_PERFCOUNTERS
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+/**
+ * An event that PerfCounters counts.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+enum class PerfEvent : unsigned
+{
+  cycles = 0,       ///< Processor cycles.
+  instructions = 1, ///< Instructions retired.
+  cacheMisses = 2,  ///< Misses in the last level cache.
+  branchMisses = 3  ///< Mispredicted branches.
+};
+
+/**
+ * The counts of every PerfEvent at some point, or over some time.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct PerfCounts
+{
+    /// How many events there are.
+    static const std::size_t events = 4;
+
+    /**
+     * Returns the count of an event.
+     *
+     * @since  0.7
+     *
+     * @param [in] event The event.
+     *
+     * @return Its count.
+     */
+    inline std::uint64_t operator[] (PerfEvent event) const;
+    /**
+     * Returns the count of an event.
+     *
+     * @since  0.7
+     *
+     * @param [in] event The event.
+     *
+     * @return Its count.
+     */
+    inline std::uint64_t &operator[] (PerfEvent event);
+
+    /// The count of each event, in the order of PerfEvent.
+    std::uint64_t counts[events];
+};
+
+/**
+ * Reads the processor's performance counters for cycles, instructions, cache
+ * misses, and branch misses, so that a Profiler can tell why a run got slower
+ * and not only that it did.  The counters only count the thread that
+ * constructed the PerfCounters, in user mode.
+ *
+ * On GNU/Linux, the counters are opened as one group with @c perf_event_open,
+ * so they all count over the same time.  When the kernel allows it, they are
+ * read with the @c rdpmc instruction, which takes nanoseconds; otherwise, they
+ * are read with a system call.  Where there are no counters, or the kernel
+ * won't let us use them (see @c /proc/sys/kernel/perf_event_paranoid ), or on
+ * other systems, nothing is counted and everything reads as 0.  A counter that
+ * the processor doesn't have is left out and reads as 0.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @note Use a PerfCounters only on the thread that constructed it.
+ */
+class PerfCounters
+{
+  public:
+    /**
+     * Constructs a new PerfCounters and starts counting on the calling
+     * thread, if it can.  This does not throw if the counters can't be
+     * opened.
+     *
+     * @since  0.7
+     */
+    PerfCounters ();
+    /**
+     * Destructs an existing PerfCounters and closes its counters.
+     *
+     * @since  0.7
+     */
+    ~PerfCounters ();
+
+    PerfCounters (const PerfCounters &) = delete;
+    PerfCounters &operator= (const PerfCounters &) = delete;
+
+    /**
+     * Returns whether anything is being counted.
+     *
+     * @since  0.7
+     *
+     * @return Whether at least the cycles are counted.
+     */
+    inline bool IsCounting () const;
+    /**
+     * Returns whether an event is being counted.
+     *
+     * @since  0.7
+     *
+     * @param [in] event The event.
+     *
+     * @return Whether the event is counted.
+     */
+    inline bool IsCounting (PerfEvent event) const;
+    /**
+     * Returns whether the counters are read with @c rdpmc .
+     *
+     * @since  0.7
+     *
+     * @return Whether reading the counters is cheap.
+     */
+    inline bool IsUsingRdpmc () const;
+
+    /**
+     * Reads the counters.  The difference between two reads is how many of
+     * each event happened in between.
+     *
+     * @since  0.7
+     *
+     * @return The count of each event since the counters were opened, or 0
+     * for events that aren't counted.
+     */
+    PerfCounts Read () const;
+
+  private:
+    /// The file of each event's counter, or -1.  The cycles lead the group.
+    int files[PerfCounts::events];
+    /// The page the kernel shares about each counter, for rdpmc, or nullptr.
+    void *pages[PerfCounts::events];
+    /// The size of a page.
+    std::size_t pageSize;
+    /// How many counters are open.
+    std::size_t open;
+    /// Whether every open counter can be read with rdpmc.
+    bool rdpmc;
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_PERFCOUNTERS
@@ -0,0 +1,62 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_PERFCOUNTERS_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_PROFILING_PERFCOUNTERS_INL
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+std::uint64_t
+PerfCounts::operator[] (PerfEvent event) const
+{
+  return counts[static_cast<unsigned> (event)];
+}
+
+std::uint64_t &
+PerfCounts::operator[] (PerfEvent event)
+{
+  return counts[static_cast<unsigned> (event)];
+}
+
+
+bool
+PerfCounters::IsCounting () const
+{
+  return open != 0;
+}
+
+bool
+PerfCounters::IsCounting (PerfEvent event) const
+{
+  return files[static_cast<unsigned> (event)] != -1;
+}
+
+bool
+PerfCounters::IsUsingRdpmc () const
+{
+  return rdpmc;
+}
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_PERFCOUNTERS_INL
@@ -0,0 +1,222 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::profiling::Sampler, which samples the call stacks of threads
+ * while they run and writes them out for flame graphs.
+ *
+ * @file   debug/profiling/sampler.hpp
+ * @see    Sampler
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_SAMPLER
+#define HUMMSTRUMM_ENGINE_DEBUG_PROFILING_SAMPLER
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+namespace detail {
+
+struct SamplerState;
+
+/**
+ * Returns the name of the function that an address is in.  If the dynamic
+ * linker doesn't know it, this is the file the address is in and its offset,
+ * like @c game+0x1a2b , or the address itself.
+ *
+ * @since  0.7
+ *
+ * @param [in] address The address.
+ *
+ * @return The name of the address.
+ */
+std::string Symbolize (std::uintptr_t address);
+
+}
+
+/**
+ * A sampling profiler, which finds where the time goes in code that nobody
+ * thought to put in a zone.  Each thread that registers gets a timer on its
+ * own processor time; every time it fires, the thread is interrupted with
+ * @c SIGPROF , and the signal handler walks the frame pointers of the
+ * interrupted code and puts the return addresses in a lock-free ring.  A
+ * background thread moves the samples out of the ring and counts how often
+ * each call stack was seen.  Nothing is looked up in the signal handler; the
+ * addresses are only turned into function names when the stacks are written
+ * out.
+ *
+ * WriteFolded() writes the folded stacks that @c flamegraph.pl reads:
+ *
+ * @verbatim
+   main;Engine::Run();Renderer::Draw() 120
+   main;Engine::Run();World::Update() 45
+   @endverbatim
+ *
+ * Functions that the dynamic linker can't name, such as static functions in
+ * an executable that wasn't linked with @c -rdynamic , are written as the file
+ * they are in and their offset in it, like @c game+0x1a2b , for
+ * @c addr2line to name later.
+ *
+ * Frame pointers must be kept for the stacks to be whole; the engine is built
+ * with @c -fno-omit-frame-pointer unless WITH_FRAME_POINTERS is turned off,
+ * and code built without it shows up with some of its callers missing.  A
+ * function that the compiler gave no frame of its own, such as a leaf
+ * function on some compilers, shows up as called by its caller's caller.
+ *
+ * Sampling only works on GNU/Linux on x86, x86-64, and ARM64.  Elsewhere, a
+ * Sampler can be made, but no thread is sampled and IsSampling() is @c false .
+ * The kernel only checks the timers on its scheduler tick, so a thread is
+ * sampled at most as often as that, which is 250 or 1000 times a second on
+ * most kernels.  At 1000 samples a second, sampling takes under 1% of a
+ * thread's time; @c bench_sampler measures it.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @note Only one Sampler can exist at a time.  The @c SIGPROF handler it
+ * installs stays installed after it is gone, and ignores the signal.
+ *
+ * @warning System calls that can't be restarted, such as @c nanosleep ,
+ * may return early with @c EINTR on a thread that is being sampled.
+ */
+class Sampler
+{
+  public:
+    /// The most frames that are kept of a call stack, from the innermost.
+    static const std::size_t maxDepth = 64;
+
+    /**
+     * Constructs a new Sampler.  No thread is sampled until it calls
+     * RegisterThread().
+     *
+     * @since  0.7
+     *
+     * @param [in] frequency How many times a second to sample each thread,
+     * while it runs.
+     * @param [in] capacity How many samples the ring holds before samples
+     * are dropped.  This is rounded up to a power of two.
+     *
+     * @throws std::runtime_error If another Sampler exists.
+     */
+    explicit Sampler (unsigned frequency = 1000, std::size_t capacity = 4096);
+    /**
+     * Destructs an existing Sampler, and stops sampling every thread.
+     *
+     * @since  0.7
+     */
+    ~Sampler ();
+
+    Sampler (const Sampler &) = delete;
+    Sampler &operator= (const Sampler &) = delete;
+
+    /**
+     * Starts sampling the calling thread.  Registering a thread twice does
+     * nothing.
+     *
+     * @since  0.7
+     *
+     * @return Whether the thread is being sampled.
+     */
+    bool RegisterThread ();
+    /**
+     * Stops sampling the calling thread.  A thread should call this before it
+     * ends.
+     *
+     * @since  0.7
+     */
+    void UnregisterThread ();
+
+    /**
+     * Returns whether threads can be sampled here.
+     *
+     * @since  0.7
+     *
+     * @return Whether RegisterThread() can sample threads.
+     */
+    inline bool IsSampling () const;
+    /**
+     * Returns how many times a second each thread is sampled.
+     *
+     * @since  0.7
+     *
+     * @return The frequency given to the constructor.
+     */
+    inline unsigned GetFrequency () const;
+    /**
+     * Returns how many samples were taken.
+     *
+     * @since  0.7
+     *
+     * @return The number of samples in the ring or counted so far.
+     */
+    std::uint64_t GetSamples () const;
+    /**
+     * Returns how many samples were dropped because the ring was full.
+     *
+     * @since  0.7
+     *
+     * @return The number of dropped samples.
+     */
+    std::uint64_t GetDropped () const;
+
+    /**
+     * Moves the samples out of the ring and counts them.  The background
+     * thread does this often enough; call it to be sure of having every
+     * sample taken so far.
+     *
+     * @since  0.7
+     */
+    void Collect ();
+    /**
+     * Writes how often each call stack was seen, as folded stacks: one line
+     * per stack, with the outermost function first, the functions separated
+     * by semicolons, and then a space and the count.  The counts are kept,
+     * so writing again later includes these samples too.
+     *
+     * @since  0.7
+     *
+     * @param [in,out] out The stream to write to.
+     * @param [in] byThread Whether to start each stack with the number of
+     * the thread it was seen on, as @c thread-1 , so each thread gets its own
+     * tower in the flame graph.
+     */
+    void WriteFolded (std::ostream &out, bool byThread = false);
+
+  private:
+    /// The ring, the counts, and the timers, which the signal handler and
+    /// the background thread share.
+    std::unique_ptr<detail::SamplerState> state;
+    /// How many times a second each thread is sampled.
+    unsigned frequency;
+    /// Whether threads can be sampled here.
+    bool sampling;
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_SAMPLER
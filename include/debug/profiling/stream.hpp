@@ -0,0 +1,384 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines the profile stream protocol, debug::profiling::ProfileStreamServer,
+ * which streams the zones of each frame and the values of the program's
+ * metrics over a local socket while the program runs, and
+ * debug::profiling::ProfileStreamReader, which reads them back.
+ *
+ * A stream starts with a header:
+ *
+ * @verbatim
+   "HSPS"                  4 bytes of magic
+   version                 1 byte, currently 1
+   ticks per second        varint
+   @endverbatim
+ *
+ * After that come records, each of which looks like this, as in a binary log
+ * (see debug/logging/binarylog.hpp):
+ *
+ * @verbatim
+   type                    1 byte
+   length                  varint, the number of bytes that follow
+   payload                 length bytes
+   @endverbatim
+ *
+ * A reader skips over records whose type it doesn't know.  The types are:
+ *
+ * @verbatim
+   1  thread name          varint thread number, then the name
+   2  zone site            varint id, varint line, then the zone's name,
+                           function, and file, each ended by a null
+   3  metric               varint id, 1 byte kind (0 for a counter, 1 for a
+                           gauge), then the name
+   4  frame                varint number, varint begin in ticks since the
+                           epoch, varint length in ticks, varint zones
+                           dropped, varint frames dropped by the stream,
+                           varint thread count, and for each thread:
+                             varint thread number, varint zone count, and
+                             for each zone, in the order they were entered:
+                               varint site id, zigzag varint begin in ticks
+                               since the frame began, varint length in
+                               ticks, varint depth
+                           then varint metric count, and for each metric:
+                             varint id, zigzag varint value
+   5  end                  nothing; the program stopped streaming
+   @endverbatim
+ *
+ * The zone site, metric, and thread name records that a frame needs come
+ * before it, and each is only sent once to a client, unless a thread's name
+ * changes.  A stream saved to a file is a capture that can be read again.
+ *
+ * @file   debug/profiling/stream.hpp
+ * @see    ProfileStreamServer
+ * @see    ProfileStreamReader
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_STREAM
+#define HUMMSTRUMM_ENGINE_DEBUG_PROFILING_STREAM
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "debug/metrics.hpp"
+#include "debug/profiling/zone.hpp"
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+namespace profilestream {
+
+/// The first bytes of every profile stream.
+const char magic[4] = { 'H', 'S', 'P', 'S' };
+/// The version of the protocol that this engine speaks.
+const unsigned char version = 1;
+
+/// The type byte at the start of each record.
+enum class RecordType : unsigned char
+{
+    threadName = 1,         ///< Gives a thread a name.
+    zoneSite = 2,           ///< Gives a zone site an id.
+    metric = 3,             ///< Gives a metric an id.
+    frame = 4,              ///< The zones and metrics of a frame.
+    end = 5                 ///< The end of the stream.
+};
+
+/// The address a ProfileStreamServer listens on by default.
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+const char *const defaultAddress = "tcp:7117";
+#else
+const char *const defaultAddress = "unix:/tmp/hummstrummengine.sock";
+#endif
+
+}
+
+/**
+ * Streams the zones of each frame, and the value of each of the program's
+ * metrics (see debug::Metrics), to a client such as @c hummstrumm-capture , so
+ * a running program can be watched.  A ProfileStreamServer is a frame handler
+ * for a ZoneProfiler:
+ *
+ * @code
+ * debug::profiling::ProfileStreamServer stream;
+ * debug::profiling::ZoneProfiler profiler (std::ref (stream));
+ * @endcode
+ *
+ * The threads that record zones already do so into buffers of their own,
+ * which the ZoneProfiler collects on its own thread; that thread calls the
+ * ProfileStreamServer, which encodes each frame as one record and queues it
+ * for a thread of its own to send.  If the client falls behind and the queue
+ * is full, frames are dropped and counted, and nothing waits for the client.
+ * When no client is connected, frames aren't even encoded.
+ *
+ * An address is @c unix:PATH , for a Unix domain socket at @c PATH , which
+ * replaces a socket already there and is removed afterwards, or @c tcp:PORT ,
+ * for a TCP socket on the loopback interface.  Anything at @c PATH that isn't
+ * a socket is left alone, and the server isn't started.  Only TCP is
+ * available on Windows.  One client is served at a time; a client that
+ * connects later starts with the next frame.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+class ProfileStreamServer
+{
+  public:
+    /**
+     * Constructs a new ProfileStreamServer, and starts listening for a
+     * client.
+     *
+     * @since  0.7
+     *
+     * @param [in] address Where to listen.
+     * @param [in] queuedFrames How many encoded frames may wait to be sent
+     * before frames are dropped.
+     *
+     * @throws std::invalid_argument If the address isn't one of the forms
+     * above.
+     * @throws std::runtime_error If the socket can't be made, or if something
+     * that isn't a socket is at the path of a @c unix: address.
+     */
+    explicit ProfileStreamServer (std::string address =
+                                    profilestream::defaultAddress,
+                                  std::size_t queuedFrames = 64);
+    /**
+     * Destructs an existing ProfileStreamServer, sending the frames still
+     * queued and ending the stream.
+     *
+     * @since  0.7
+     */
+    ~ProfileStreamServer ();
+
+    ProfileStreamServer (const ProfileStreamServer &) = delete;
+    ProfileStreamServer &operator= (const ProfileStreamServer &) = delete;
+
+    /**
+     * Queues a frame, and the last values of the metrics, to be sent to the
+     * client, unless there is no client or the queue is full.  Call this from
+     * one thread at a time.
+     *
+     * @since  0.7
+     *
+     * @param [in] frame The frame, as given to a ZoneProfiler's frame
+     * handler.
+     */
+    void operator() (const ZoneFrame &frame);
+
+    /**
+     * Returns whether a client is connected.
+     *
+     * @since  0.7
+     *
+     * @return Whether frames are being streamed.
+     */
+    bool IsConnected () const;
+    /**
+     * Returns how many frames were dropped because the client fell behind.
+     *
+     * @since  0.7
+     *
+     * @return The number of dropped frames.
+     */
+    inline std::uint64_t GetDropped () const;
+    /**
+     * Returns the address the ProfileStreamServer listens on.
+     *
+     * @since  0.7
+     *
+     * @return The address given to the constructor.
+     */
+    inline const std::string &GetAddress () const;
+
+  private:
+    /**
+     * Accepts clients and sends them the queued frames, until the
+     * ProfileStreamServer is destroyed.
+     */
+    void Run ();
+    /**
+     * Sends bytes to the client.  Returns false if the client is gone.
+     */
+    bool Send (const char *bytes, std::size_t length);
+    std::string address;        ///< Where to listen.
+    std::string path;           ///< The path of a Unix domain socket.
+    std::size_t queuedFrames;   ///< How many frames may be queued.
+    std::intptr_t listener;     ///< The listening socket.
+    std::intptr_t client;       ///< The client's socket, or -1.  Only used by
+                                ///  the sending thread.
+    std::atomic<std::uint64_t> dropped; ///< How many frames were dropped.
+
+    // These are only used by the thread calling operator().
+
+    /// The connection the records were encoded for.
+    std::uint64_t encodedFor;
+    /// The ids of the zone sites seen so far.
+    std::unordered_map<const ZoneSite *, std::uint64_t> siteIds;
+    /// Whether each zone site was sent to the client.
+    std::vector<bool> sitesSent;
+    /// How many metrics were sent to the client.
+    std::size_t metricsSent;
+    /// The names sent to the client for each thread.
+    std::unordered_map<unsigned, std::string> threadNames;
+    std::vector<char> message;  ///< The message being encoded.
+    std::vector<char> payload;  ///< The payload of the frame being encoded.
+
+    // These are guarded by mutex.
+
+    /// How many clients have connected, which tells records encoded for one
+    /// from those for the next.
+    std::uint64_t connection;
+    bool connected;             ///< Whether a client is connected.
+    bool running;               ///< Whether to keep sending.
+    std::deque<std::vector<char> > queue; ///< The messages to send.
+    mutable std::mutex mutex;   ///< Guards the members the threads share.
+    /// Wakes the sending thread.
+    std::condition_variable queued;
+    std::thread sender;         ///< Sends the queued messages.
+};
+
+/**
+ * Reads a profile stream from a ProfileStreamServer, or from a capture of one
+ * saved to a file.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+class ProfileStreamReader
+{
+  public:
+    /**
+     * Constructs a new ProfileStreamReader and connects it to a
+     * ProfileStreamServer, or opens a capture.
+     *
+     * @since  0.7
+     *
+     * @param [in] address The address the ProfileStreamServer listens on
+     * (see ProfileStreamServer), or @c file:PATH to read a capture.
+     * @param [in] capture If not empty, the name of a file to save the
+     * stream to as it is read.
+     *
+     * @throws std::invalid_argument If the address isn't one of the forms
+     * above.
+     * @throws std::runtime_error If the server can't be reached, the capture
+     * can't be opened, or the stream doesn't start with a header of this
+     * version.
+     */
+    explicit ProfileStreamReader (std::string address =
+                                    profilestream::defaultAddress,
+                                  std::string capture = "");
+    /**
+     * Destructs an existing ProfileStreamReader, disconnecting from the
+     * server.
+     *
+     * @since  0.7
+     */
+    ~ProfileStreamReader ();
+
+    ProfileStreamReader (const ProfileStreamReader &) = delete;
+    ProfileStreamReader &operator= (const ProfileStreamReader &) = delete;
+
+    /**
+     * Reads the next frame, waiting for it to be sent.
+     *
+     * @since  0.7
+     *
+     * @param [out] frame The frame.  Its zone sites belong to the reader, and
+     * live as long as it does.  The times are in nanoseconds since the epoch.
+     * @param [out] values The value of each metric when the frame was sent.
+     * Their names belong to the reader.
+     *
+     * @return Whether there was another frame; @c false once the stream has
+     * ended.
+     *
+     * @throws std::runtime_error If the stream is corrupt.
+     */
+    bool Next (ZoneFrame &frame, std::vector<MetricValue> &values);
+
+    /**
+     * Returns how many frames the server had dropped when it sent the last
+     * frame that was read.
+     *
+     * @since  0.7
+     *
+     * @return The number of dropped frames.
+     */
+    inline std::uint64_t GetDropped () const;
+
+  private:
+    /// A zone site sent by the server.
+    struct Site
+    {
+        std::string name;
+        std::string function;
+        std::string file;
+        ZoneSite site;          ///< Points to the strings above.
+    };
+    /// A metric sent by the server.
+    struct Metric
+    {
+        std::string name;
+        MetricKind kind;
+    };
+
+    /**
+     * Closes the socket.
+     */
+    void Close ();
+    /**
+     * Reads bytes, saving them to the capture.  Returns false at the end of
+     * the stream.
+     */
+    bool Read (char *bytes, std::size_t length);
+    /**
+     * Reads a varint.  Returns false at the end of the stream.
+     */
+    bool ReadVarint (std::uint64_t &value);
+
+    std::intptr_t socket;       ///< The socket, or -1 for a capture.
+    std::ifstream file;         ///< The capture being read.
+    std::ofstream capture;      ///< The file to save the stream to.
+    std::vector<char> buffer;   ///< Bytes read but not used yet.
+    std::size_t position;       ///< The first unused byte of the buffer.
+    std::size_t used;           ///< How much of the buffer is filled.
+    std::uint64_t ticksPerSecond; ///< The ticks per second of the stream.
+    std::uint64_t dropped;      ///< Frames dropped by the server.
+    std::vector<char> record;   ///< The payload of the last record.
+    /// The zone sites, by id.
+    std::unordered_map<std::uint64_t, Site> sites;
+    /// The metrics, by id.
+    std::unordered_map<std::uint64_t, Metric> metrics;
+    /// The name of each thread.
+    std::unordered_map<unsigned, std::string> threadNames;
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_STREAM
@@ -0,0 +1,53 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_STREAM_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_PROFILING_STREAM_INL
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+
+std::uint64_t
+ProfileStreamServer::GetDropped ()
+  const
+{
+  return dropped.load (std::memory_order_relaxed);
+}
+
+const std::string &
+ProfileStreamServer::GetAddress ()
+  const
+{
+  return address;
+}
+
+std::uint64_t
+ProfileStreamReader::GetDropped ()
+  const
+{
+  return dropped;
+}
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_STREAM_INL
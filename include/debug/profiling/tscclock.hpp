@@ -0,0 +1,172 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::profiling::TscClock, a clock that reads the processor's time
+ * stamp counter.
+ *
+ * @file   debug/profiling/tscclock.hpp
+ * @see    TscClock
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_TSCCLOCK
+#define HUMMSTRUMM_ENGINE_DEBUG_PROFILING_TSCCLOCK
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || \
+  defined(_M_X64)
+/// Defined if the processor has a time stamp counter.
+#  define HUMMSTRUMM_ENGINE_HAVE_TSC
+#endif
+
+namespace hummstrummengine {
+namespace system {
+class Processors;
+}
+namespace debug {
+namespace profiling {
+
+/**
+ * Where TscClock gets the time from.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+enum class TscSource : int
+{
+  steadyClock = 0, ///< @c std::chrono::steady_clock , until calibrated.
+  rdtsc = 1,       ///< The @c rdtsc instruction.
+  rdtscp = 2       ///< The @c rdtscp instruction.
+};
+
+namespace detail {
+
+/**
+ * How to turn ticks of the time stamp counter into nanoseconds.  This is
+ * written once by TscClock::Calibrate(), before the source is published, and
+ * never again after that.
+ */
+struct TscCalibration
+{
+    std::atomic<int> source;    ///< A TscSource.
+    std::uint64_t ticks;        ///< The counter when we calibrated.
+    std::int64_t nanoseconds;   ///< The steady_clock time then.
+    double nanosecondsPerTick;  ///< The length of a tick.
+};
+
+/// The calibration of TscClock.
+extern TscCalibration tscCalibration;
+
+}
+
+/**
+ * A clock that reads the processor's time stamp counter, which takes a few
+ * nanoseconds instead of the tens that @c std::chrono::steady_clock can take.
+ * It meets the requirements of the standard Clock concept, so it can be given
+ * to a Profiler:
+ *
+ * @code
+ * Profiler<profiling::TscClock> frames (engine.GetLog ());
+ * @endcode
+ *
+ * ZoneProfiler times zones with it too.
+ *
+ * The counter is only a clock if it is invariant, that is, if it ticks at the
+ * same rate in every power state and on every core.  Calibrate() checks that
+ * with system::Processors, and measures the rate of the counter against
+ * @c steady_clock ; the Engine does this when it is constructed.  Until the
+ * clock has been calibrated, or if the counter is not invariant, or if this
+ * is not an x86 processor, the clock reads @c steady_clock instead.  Either
+ * way, its time points are close to those of @c steady_clock .
+ *
+ * When the processor has it, the clock reads the counter with @c rdtscp ,
+ * which waits for the instructions before it to finish, so that the end of a
+ * run is not read before the run is done.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+class TscClock
+{
+  public:
+    /// The type of the durations this clock measures.
+    typedef std::chrono::nanoseconds duration;
+    /// The type of the tick count.
+    typedef duration::rep rep;
+    /// The length of a tick.
+    typedef duration::period period;
+    /// The type of the times this clock returns.
+    typedef std::chrono::time_point<TscClock> time_point;
+
+    /// The clock never goes backwards.
+    static const bool is_steady = true;
+
+    /**
+     * Returns the current time.  This may be called from any thread.
+     *
+     * @since  0.7
+     *
+     * @return The time, in nanoseconds from the epoch of @c steady_clock .
+     */
+    static inline time_point now () /* noexcept */;
+
+    /**
+     * Decides where the clock gets the time from, and measures the rate of the
+     * time stamp counter against @c steady_clock if it is used.  Once the
+     * clock uses the counter, later calls do nothing, so other threads may use
+     * the clock while this runs.
+     *
+     * @since  0.7
+     *
+     * @param [in] processors The processors, which tell whether the counter
+     * is invariant.
+     * @param [in] length How long to measure the counter for.  The longer,
+     * the more exact the rate.
+     */
+    static void Calibrate (const system::Processors &processors,
+                           std::chrono::nanoseconds length =
+                             std::chrono::milliseconds (10));
+
+    /**
+     * Returns where the clock gets the time from.
+     *
+     * @since  0.7
+     *
+     * @return The source of the time.
+     */
+    static inline TscSource GetSource () /* noexcept */;
+
+    /**
+     * Returns the rate of the time stamp counter, as measured by Calibrate().
+     *
+     * @since  0.7
+     *
+     * @return The ticks per second, or 0 if the counter isn't used.
+     */
+    static double GetTicksPerSecond () /* noexcept */;
+};
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_TSCCLOCK
@@ -0,0 +1,81 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_TSCCLOCK_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_PROFILING_TSCCLOCK_INL
+
+#ifdef HUMMSTRUMM_ENGINE_HAVE_TSC
+#  ifdef HUMMSTRUMM_ENGINE_COMPILER_MSVC
+#    include <intrin.h>
+#  else
+#    include <x86intrin.h>
+#  endif
+#endif
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+TscClock::time_point
+TscClock::now () /* noexcept */
+{
+  const detail::TscCalibration &calibration = detail::tscCalibration;
+  std::uint64_t ticks;
+  switch (static_cast<TscSource> (
+            calibration.source.load (std::memory_order_acquire)))
+    {
+#ifdef HUMMSTRUMM_ENGINE_HAVE_TSC
+    case TscSource::rdtscp:
+      {
+        unsigned int processor;
+        ticks = __rdtscp (&processor);
+        break;
+      }
+    case TscSource::rdtsc:
+      ticks = __rdtsc ();
+      break;
+#endif
+    default:
+      return time_point (std::chrono::duration_cast<duration> (
+                           std::chrono::steady_clock::now ()
+                           .time_since_epoch ()));
+    }
+
+  // The counters of the cores are kept in step, but not exactly, so one that
+  // is a little behind the calibration mustn't go back before it.
+  double since = ticks > calibration.ticks ?
+    static_cast<double> (ticks - calibration.ticks) : 0;
+  return time_point (duration (
+                       calibration.nanoseconds +
+                       static_cast<rep> (since *
+                                         calibration.nanosecondsPerTick)));
+}
+
+TscSource
+TscClock::GetSource () /* noexcept */
+{
+  return static_cast<TscSource> (
+    detail::tscCalibration.source.load (std::memory_order_acquire));
+}
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_TSCCLOCK_INL
@@ -0,0 +1,374 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::profiling::ZoneProfiler, which times nested zones of code on
+ * every thread and hands them over frame by frame, and the
+ * HUMMSTRUMM_ENGINE_ZONE() macro, which marks a zone.
+ *
+ * @file   debug/profiling/zone.hpp
+ * @see    ZoneProfiler
+ * @see    HUMMSTRUMM_ENGINE_ZONE
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_ZONE
+#define HUMMSTRUMM_ENGINE_DEBUG_PROFILING_ZONE
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+namespace detail {
+struct ZoneBuffer;
+}
+
+/**
+ * Where a zone is in the source code.  HUMMSTRUMM_ENGINE_ZONE() makes one of
+ * these for each zone, as a static constant, so that recording a zone only has
+ * to record its address.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct ZoneSite
+{
+    const char *name;           ///< The name given to the zone.
+    const char *function;       ///< The function the zone is in.
+    const char *file;           ///< The file the zone is in.
+    unsigned line;              ///< The line the zone starts on.
+};
+
+/**
+ * One zone that a thread went through during a frame.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct Zone
+{
+    /// The value of parent for a zone that isn't inside another one.
+    static const std::size_t noParent = static_cast<std::size_t> (-1);
+
+    const ZoneSite *site;       ///< Where the zone is in the source code.
+    /// When the zone was entered, in nanoseconds since the epoch (see
+    /// logging::GetTimestamp()).  A zone that was entered during an earlier
+    /// frame starts when this frame starts.
+    std::uint64_t begin;
+    /// When the zone was left.  A zone that hadn't been left when the frame
+    /// ended ends when the frame does, and is continued in the next frame.
+    std::uint64_t end;
+    /// How many zones this zone is inside.
+    unsigned depth;
+    /// The index of the zone this zone is inside, or noParent.
+    std::size_t parent;
+};
+
+/**
+ * The zones that one thread went through during a frame.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct ZoneThread
+{
+    /// The number of the thread (see logging::GetThreadNumber()).
+    unsigned thread;
+    /// The name given to ZoneProfiler::RegisterThread(), or an empty string.
+    std::string name;
+    /// The zones, in the order they were entered.  Since zones nest, a zone's
+    /// parent always comes before it, and this is the call tree in preorder.
+    std::vector<Zone> zones;
+};
+
+/**
+ * The zones that every thread went through during a frame.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+struct ZoneFrame
+{
+    std::uint64_t number;       ///< The number of the frame, from zero.
+    std::uint64_t begin;        ///< When the frame started.
+    std::uint64_t end;          ///< When the frame ended.
+    /// How many zones were not recorded because a thread's buffer was full.
+    std::uint64_t dropped;
+    /// Every thread that has recorded zones, including those that didn't
+    /// record any during this frame.
+    std::vector<ZoneThread> threads;
+};
+
+/**
+ * Collects the zones marked by HUMMSTRUMM_ENGINE_ZONE() on every thread, and
+ * hands them to a function once per frame.
+ *
+ * Each thread records the start and end of its zones in a buffer of its own,
+ * which is allocated the first time it records a zone or when it calls
+ * RegisterThread().  Recording a zone does not lock or allocate; if a thread
+ * records more zones in a frame than its buffer holds, the rest are dropped and
+ * counted.  When the program calls EndFrame(), a collector thread empties the
+ * buffers, puts the zones together into call trees, and calls the frame
+ * handler with them.
+ *
+ * Zones are timed with TscClock, which reads the time stamp counter once the
+ * Engine has calibrated it.  The collector thread, not the thread that records
+ * the zone, turns those times into timestamps (see logging::GetTimestamp()).
+ *
+ * Only one ZoneProfiler can exist at a time.  While none does, zones cost a
+ * function call and a check.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @note Other threads must be done recording zones before the ZoneProfiler is
+ * destroyed.
+ */
+class ZoneProfiler
+{
+  public:
+    /// A function that gets the zones of each frame.  The frame is only valid
+    /// during the call.
+    typedef std::function<void (const ZoneFrame &)> FrameHandler;
+
+    /**
+     * Constructs a new ZoneProfiler and starts its collector thread.  The
+     * first frame starts now.
+     *
+     * @since  0.7
+     *
+     * @param [in] handler The function to call with each frame, on the
+     * collector thread.
+     * @param [in] eventsPerThread How many zone starts and ends each thread's
+     * buffer holds.  This is rounded up to a power of two, and is at least 64.
+     *
+     * @throws std::logic_error If there is already a ZoneProfiler.
+     */
+    explicit ZoneProfiler (FrameHandler handler,
+                           std::size_t eventsPerThread = 1 << 16);
+    /**
+     * Destructs an existing ZoneProfiler.  The frames that have ended are
+     * handed to the frame handler first; the zones of the frame that hasn't
+     * ended are thrown away.
+     *
+     * @since  0.7
+     */
+    ~ZoneProfiler ();
+
+    ZoneProfiler (const ZoneProfiler &) = delete;
+    ZoneProfiler &operator= (const ZoneProfiler &) = delete;
+
+    /**
+     * Names the calling thread, and allocates its buffer if it doesn't have
+     * one yet.  Call this at the start of a thread to keep the allocation out
+     * of its first frame.
+     *
+     * @since  0.7
+     *
+     * @param [in] name The name to give the thread's zones.
+     */
+    void RegisterThread (const std::string &name);
+
+    /**
+     * Ends the current frame and starts the next one.  The collector thread
+     * hands the frame to the frame handler soon after; this doesn't wait for
+     * it.
+     *
+     * @since  0.7
+     */
+    void EndFrame ();
+
+    /**
+     * Waits until every frame that has ended has been handed to the frame
+     * handler.
+     *
+     * @since  0.7
+     */
+    void Flush ();
+
+    /**
+     * Returns how many zones were not recorded because a thread's buffer was
+     * full.
+     *
+     * @since  0.7
+     *
+     * @return The number of dropped zones, in every frame so far.
+     */
+    std::uint64_t GetDropped () const;
+
+    /**
+     * Returns the ZoneProfiler that zones are recorded in.
+     *
+     * @since  0.7
+     *
+     * @return The ZoneProfiler, or @c nullptr if there is none.
+     */
+    static ZoneProfiler *GetActive ();
+
+  private:
+    /**
+     * Returns the buffer of the calling thread, making it if needed.
+     */
+    detail::ZoneBuffer &FindThreadBuffer ();
+
+    /**
+     * Runs the collector thread.
+     */
+    void Run ();
+
+    /**
+     * Builds the frame that ended at the given TscClock time and hands it to
+     * the frame handler.
+     */
+    void Collect (std::uint64_t end);
+
+    friend void BeginZone (const ZoneSite &site);
+    friend void EndZone ();
+
+    FrameHandler handler;       ///< Gets each frame.
+    std::size_t eventsPerThread; ///< The size of each thread's buffer.
+    unsigned long id;           ///< Tells this ZoneProfiler from earlier ones.
+    /// The buffers of every thread that has recorded zones.  Only changed with
+    /// mutex held.
+    std::vector<std::unique_ptr<detail::ZoneBuffer> > buffers;
+    /// The buffers the collector thread is emptying.  Only used by it.
+    std::vector<detail::ZoneBuffer *> collecting;
+    /// The TscClock times at which the frames the collector thread hasn't
+    /// built yet ended.
+    std::vector<std::uint64_t> frameEnds;
+    /// The end times being built by the collector thread.
+    std::vector<std::uint64_t> building;
+    std::uint64_t framesEnded;  ///< How many frames EndFrame() ended.
+    std::uint64_t framesHandled; ///< How many frames were handed over.
+    bool running;               ///< Whether the collector should keep going.
+    /// The TscClock time at which the frame being built started.
+    std::uint64_t frameBegin;
+    /// What to add to a TscClock time to make it a timestamp.
+    std::uint64_t wallOffset;
+    ZoneFrame frame;            ///< The frame being built, reused.
+    mutable std::mutex mutex;   ///< Guards the members the threads share.
+    /// Wakes the collector thread.
+    std::condition_variable frameEnded;
+    /// Wakes threads waiting in Flush().
+    std::condition_variable frameHandled;
+    std::thread collector;      ///< Builds and hands over frames.
+};
+
+/**
+ * Records that the calling thread entered a zone.  Use HUMMSTRUMM_ENGINE_ZONE()
+ * instead.
+ *
+ * @since  0.7
+ *
+ * @param [in] site Where the zone is.  It must live as long as the program.
+ */
+void BeginZone (const ZoneSite &site);
+
+/**
+ * Records that the calling thread left the zone it entered last.  Use
+ * HUMMSTRUMM_ENGINE_ZONE() instead.
+ *
+ * @since  0.7
+ */
+void EndZone ();
+
+/**
+ * Enters a zone when constructed, and leaves it when destructed.  This is what
+ * HUMMSTRUMM_ENGINE_ZONE() declares.
+ *
+ * @version 0.7
+ * @since   0.7
+ */
+class ScopedZone
+{
+  public:
+    /**
+     * Constructs a new ScopedZone, entering a zone.
+     *
+     * @since  0.7
+     *
+     * @param [in] site Where the zone is.  It must live as long as the
+     * program.
+     */
+    inline explicit ScopedZone (const ZoneSite &site);
+    /**
+     * Destructs an existing ScopedZone, leaving its zone.
+     *
+     * @since  0.7
+     */
+    inline ~ScopedZone ();
+
+    ScopedZone (const ScopedZone &) = delete;
+    ScopedZone &operator= (const ScopedZone &) = delete;
+};
+
+
+}
+}
+}
+
+/// Pastes two tokens together after expanding them.
+#define HUMMSTRUMM_ENGINE_ZONE_CONCAT_(a, b) a##b
+/// Pastes two tokens together after expanding them.
+#define HUMMSTRUMM_ENGINE_ZONE_CONCAT(a, b) HUMMSTRUMM_ENGINE_ZONE_CONCAT_(a, b)
+
+/**
+ * Times the rest of the enclosing block as a zone for the
+ * debug::profiling::ZoneProfiler.  Zones in the same thread nest:
+ *
+ * @code
+ * void
+ * Update ()
+ * {
+ *   HUMMSTRUMM_ENGINE_ZONE ("Update");
+ *   {
+ *     HUMMSTRUMM_ENGINE_ZONE ("Physics");
+ *     ...
+ *   }
+ *   HUMMSTRUMM_ENGINE_ZONE ("Animation");
+ *   ...
+ * }
+ * @endcode
+ *
+ * Here, "Physics" and "Animation" are both inside "Update".  Only one zone can
+ * start on each line.
+ *
+ * @def    HUMMSTRUMM_ENGINE_ZONE(name)
+ * @since  0.7
+ *
+ * @param [in] name The name of the zone, as a string literal.
+ */
+#define HUMMSTRUMM_ENGINE_ZONE(name)                                          \
+  static const ::hummstrummengine::debug::profiling::ZoneSite                 \
+    HUMMSTRUMM_ENGINE_ZONE_CONCAT (hummstrummZoneSite, __LINE__) =            \
+    { name, __FUNCTION__, __FILE__, __LINE__ };                               \
+  ::hummstrummengine::debug::profiling::ScopedZone                            \
+    HUMMSTRUMM_ENGINE_ZONE_CONCAT (hummstrummZone, __LINE__) (                \
+      HUMMSTRUMM_ENGINE_ZONE_CONCAT (hummstrummZoneSite, __LINE__))
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_PROFILING_ZONE
@@ -0,0 +1,237 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines the AllRunStatistics and HistogramStatistics class templates, which
+ * a Profiler can use to keep statistics about its runs.
+ *
+ * @file   debug/statistics.hpp
+ * @see    AllRunStatistics
+ * @see    HistogramStatistics
+ * @see    Profiler
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_STATISTICS
+#define HUMMSTRUMM_ENGINE_DEBUG_STATISTICS
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hummstrummengine {
+namespace debug {
+
+/**
+ * Keeps every run of a `Profiler<ClockT, DurationT, StatisticsT>`, and
+ * computes the statistics from all of them when asked.  This takes memory in
+ * proportion to the number of runs.
+ *
+ * A statistics policy has a `Duration` type, `Add()`, `GetCount()`,
+ * `GetMin()`, `GetMax()`, and `GetMean()`.  If its static constant
+ * `hasPercentiles` is true, it also has `GetStandardDeviation()` and
+ * `GetPercentile()`.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @tparam DurationT The `std::chrono::duration` of the runs.
+ */
+template <typename DurationT>
+class AllRunStatistics
+{
+  public:
+    /// The `std::chrono::duration` of the runs.
+    typedef DurationT Duration;
+    /// This policy has no percentiles.
+    static const bool hasPercentiles = false;
+
+    /**
+     * Adds a run.
+     *
+     * @since  0.7
+     *
+     * @param [in] run How long the run took.  It must not be negative.
+     */
+    inline void Add (Duration run);
+
+    /**
+     * Returns how many runs were added.
+     *
+     * @since  0.7
+     *
+     * @return The number of runs.
+     */
+    inline std::size_t GetCount () const;
+    /**
+     * Returns the shortest run.
+     *
+     * @since  0.7
+     *
+     * @return The shortest run, or zero if there are none.
+     */
+    inline Duration GetMin () const;
+    /**
+     * Returns the longest run.
+     *
+     * @since  0.7
+     *
+     * @return The longest run, or zero if there are none.
+     */
+    inline Duration GetMax () const;
+    /**
+     * Returns the average run, rounded down to a whole `Duration`.
+     *
+     * @since  0.7
+     *
+     * @return The average run, or zero if there are none.
+     */
+    inline Duration GetMean () const;
+
+  private:
+    std::vector<Duration> runs; ///< Every run.
+};
+
+/**
+ * Keeps statistics about the runs of a `Profiler<ClockT, DurationT,
+ * StatisticsT>` in memory that doesn't grow, so a profiler can run for days.
+ * The minimum, maximum, mean, and variance are exact (the latter two kept with
+ * Welford's method); percentiles come from a log-linear histogram of the runs.
+ *
+ * The histogram counts runs of less than `2^Precision` ticks exactly.  Above
+ * that, each power of two is split into `2^Precision` buckets, so a percentile
+ * is off by at most `2^-Precision` of its value (about 3% by default).  The
+ * histogram takes `(65 - Precision) * 2^Precision` counters, allocated when
+ * the HistogramStatistics is made.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @tparam DurationT The `std::chrono::duration` of the runs.  Its ticks are
+ *         what the histogram counts.
+ * @tparam Precision How many bits of each run the histogram keeps.
+ */
+template <typename DurationT, unsigned Precision = 5>
+class HistogramStatistics
+{
+  public:
+    /// The `std::chrono::duration` of the runs.
+    typedef DurationT Duration;
+    /// A duration that can hold fractions of a tick.
+    typedef std::chrono::duration<double, typename Duration::period>
+    FractionalDuration;
+    /// This policy has percentiles.
+    static const bool hasPercentiles = true;
+
+    /**
+     * Constructs a new HistogramStatistics with no runs.
+     *
+     * @since  0.7
+     */
+    inline HistogramStatistics ();
+
+    /**
+     * Adds a run.
+     *
+     * @since  0.7
+     *
+     * @param [in] run How long the run took.  It must not be negative.
+     */
+    inline void Add (Duration run);
+
+    /**
+     * Returns how many runs were added.
+     *
+     * @since  0.7
+     *
+     * @return The number of runs.
+     */
+    inline std::size_t GetCount () const;
+    /**
+     * Returns the shortest run.
+     *
+     * @since  0.7
+     *
+     * @return The shortest run, or zero if there are none.
+     */
+    inline Duration GetMin () const;
+    /**
+     * Returns the longest run.
+     *
+     * @since  0.7
+     *
+     * @return The longest run, or zero if there are none.
+     */
+    inline Duration GetMax () const;
+    /**
+     * Returns the average run.
+     *
+     * @since  0.7
+     *
+     * @return The average run, or zero if there are none.
+     */
+    inline FractionalDuration GetMean () const;
+    /**
+     * Returns the standard deviation of the runs.
+     *
+     * @since  0.7
+     *
+     * @return The sample standard deviation, or zero if there are fewer than
+     * two runs.
+     */
+    inline FractionalDuration GetStandardDeviation () const;
+    /**
+     * Returns a run that the given fraction of runs were no longer than.
+     *
+     * @since  0.7
+     *
+     * @param [in] fraction The fraction of runs, such as 0.99 for the 99th
+     * percentile.
+     *
+     * @return The middle of the histogram bucket the percentile is in, kept
+     * between the shortest and longest run; or zero if there are no runs.
+     */
+    inline Duration GetPercentile (double fraction) const;
+
+  private:
+    /**
+     * Returns the histogram bucket of a number of ticks.
+     */
+    static inline std::size_t getBucket (std::uint64_t ticks);
+    /**
+     * Returns the middle of a histogram bucket, in ticks.
+     */
+    static inline std::uint64_t getBucketMiddle (std::size_t bucket);
+
+    std::uint64_t count;        ///< The number of runs.
+    Duration min;               ///< The shortest run.
+    Duration max;               ///< The longest run.
+    double mean;                ///< The average run, in ticks.
+    /// The sum of squared differences from the mean, in ticks squared.
+    double squares;
+    /// How many runs fell into each bucket.
+    std::vector<std::uint64_t> buckets;
+};
+
+
+}
+}
+
+#include "statistics.inl"
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_STATISTICS
@@ -0,0 +1,218 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_STATISTICS_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_STATISTICS_INL
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace hummstrummengine {
+namespace debug {
+
+template <typename DurationT>
+const bool AllRunStatistics<DurationT>::hasPercentiles;
+
+template <typename DurationT>
+void
+AllRunStatistics<DurationT>::Add (Duration run)
+{
+  runs.push_back (run);
+}
+
+template <typename DurationT>
+std::size_t
+AllRunStatistics<DurationT>::GetCount () const
+{
+  return runs.size ();
+}
+
+template <typename DurationT>
+DurationT
+AllRunStatistics<DurationT>::GetMin () const
+{
+  if (runs.empty ())
+    return Duration::zero ();
+  return *std::min_element (runs.begin (), runs.end ());
+}
+
+template <typename DurationT>
+DurationT
+AllRunStatistics<DurationT>::GetMax () const
+{
+  if (runs.empty ())
+    return Duration::zero ();
+  return *std::max_element (runs.begin (), runs.end ());
+}
+
+template <typename DurationT>
+DurationT
+AllRunStatistics<DurationT>::GetMean () const
+{
+  if (runs.empty ())
+    return Duration::zero ();
+  // Runs are never negative, so we don't need to worry about any
+  // signed/unsigned mismatches here.
+  return std::accumulate (runs.begin (), runs.end (), Duration::zero ()) /
+    runs.size ();
+}
+
+
+template <typename DurationT, unsigned Precision>
+const bool HistogramStatistics<DurationT, Precision>::hasPercentiles;
+
+template <typename DurationT, unsigned Precision>
+HistogramStatistics<DurationT, Precision>::HistogramStatistics ()
+  : count (0),
+    min (Duration::zero ()),
+    max (Duration::zero ()),
+    mean (0),
+    squares (0),
+    buckets ((65 - Precision) << Precision, 0)
+{
+}
+
+template <typename DurationT, unsigned Precision>
+void
+HistogramStatistics<DurationT, Precision>::Add (Duration run)
+{
+  if (count == 0 || run < min)
+    min = run;
+  if (count == 0 || run > max)
+    max = run;
+
+  // Welford's method, which doesn't lose precision to huge sums.
+  ++count;
+  double ticks = static_cast<double> (run.count ());
+  double delta = ticks - mean;
+  mean += delta / count;
+  squares += delta * (ticks - mean);
+
+  std::uint64_t whole = run.count () > 0 ?
+    static_cast<std::uint64_t> (run.count ()) : 0;
+  ++buckets[getBucket (whole)];
+}
+
+template <typename DurationT, unsigned Precision>
+std::size_t
+HistogramStatistics<DurationT, Precision>::GetCount () const
+{
+  return static_cast<std::size_t> (count);
+}
+
+template <typename DurationT, unsigned Precision>
+DurationT
+HistogramStatistics<DurationT, Precision>::GetMin () const
+{
+  return min;
+}
+
+template <typename DurationT, unsigned Precision>
+DurationT
+HistogramStatistics<DurationT, Precision>::GetMax () const
+{
+  return max;
+}
+
+template <typename DurationT, unsigned Precision>
+typename HistogramStatistics<DurationT, Precision>::FractionalDuration
+HistogramStatistics<DurationT, Precision>::GetMean () const
+{
+  return FractionalDuration (mean);
+}
+
+template <typename DurationT, unsigned Precision>
+typename HistogramStatistics<DurationT, Precision>::FractionalDuration
+HistogramStatistics<DurationT, Precision>::GetStandardDeviation () const
+{
+  if (count < 2)
+    return FractionalDuration::zero ();
+  return FractionalDuration (std::sqrt (squares / (count - 1)));
+}
+
+template <typename DurationT, unsigned Precision>
+DurationT
+HistogramStatistics<DurationT, Precision>::GetPercentile (double fraction)
+  const
+{
+  if (count == 0)
+    return Duration::zero ();
+
+  // The rank of the run we want, from 1.
+  double wanted = std::ceil (fraction * count);
+  std::uint64_t rank = wanted < 1 ? 1 : static_cast<std::uint64_t> (wanted);
+  if (rank > count)
+    rank = count;
+
+  std::uint64_t seen = 0;
+  std::size_t bucket = 0;
+  for (; bucket < buckets.size (); ++bucket)
+    {
+      seen += buckets[bucket];
+      if (seen >= rank)
+        break;
+    }
+
+  Duration run (static_cast<typename Duration::rep> (
+                  getBucketMiddle (bucket)));
+  if (run < min)
+    return min;
+  if (run > max)
+    return max;
+  return run;
+}
+
+template <typename DurationT, unsigned Precision>
+std::size_t
+HistogramStatistics<DurationT, Precision>::getBucket (std::uint64_t ticks)
+{
+  const std::uint64_t subBuckets = std::uint64_t (1) << Precision;
+  if (ticks < subBuckets)
+    return static_cast<std::size_t> (ticks);
+
+  // Find the highest bit set, and keep Precision bits below it.
+  unsigned shift = 0;
+  while ((ticks >> shift) >= 2 * subBuckets)
+    ++shift;
+  return static_cast<std::size_t> ((shift + 1) * subBuckets +
+                                   ((ticks >> shift) - subBuckets));
+}
+
+template <typename DurationT, unsigned Precision>
+std::uint64_t
+HistogramStatistics<DurationT, Precision>::getBucketMiddle (std::size_t bucket)
+{
+  const std::uint64_t subBuckets = std::uint64_t (1) << Precision;
+  if (bucket < subBuckets)
+    return bucket;
+
+  unsigned shift = static_cast<unsigned> (bucket / subBuckets - 1);
+  std::uint64_t low = (bucket % subBuckets + subBuckets) << shift;
+  return low + ((std::uint64_t (1) << shift) - 1) / 2;
+}
+
+
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_STATISTICS_INL
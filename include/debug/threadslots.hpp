@@ -0,0 +1,103 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Defines debug::detail::ThreadSlots, which gives each thread a block of
+ * counters of its own without allocating.
+ *
+ * @file   debug/threadslots.hpp
+ * @see    detail::ThreadSlots
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_THREADSLOTS
+#define HUMMSTRUMM_ENGINE_DEBUG_THREADSLOTS
+
+#include <atomic>
+#include <cstddef>
+
+namespace hummstrummengine {
+namespace debug {
+namespace detail {
+
+/**
+ * A fixed number of slots of counters, one for each thread that counts, so
+ * that counting is a plain store to memory no other thread writes.  The
+ * threads that come after the slots have run out share the last one, and
+ * count in it with locked adds instead (see AddToSlot()).
+ *
+ * It has no constructor, so one at namespace scope is zero-initialized before
+ * any constructor runs, and can be used from allocation hooks and from the
+ * constructors of other globals.
+ *
+ * @version 0.7
+ * @since   0.7
+ *
+ * @tparam SlotT The counters of one thread.  Zero must be a good start for
+ * them.
+ * @tparam count The number of slots.
+ */
+template <typename SlotT, std::size_t count>
+struct ThreadSlots
+{
+    /**
+     * Returns the calling thread's slot, handing it one the first time.
+     *
+     * @since  0.7
+     *
+     * @param [in,out] cached A thread-local pointer to the thread's slot,
+     * which starts as @c nullptr .
+     * @param [in,out] shared A thread-local flag, set if the thread was given
+     * the shared slot.
+     *
+     * @return The slot.
+     */
+    inline SlotT &Find (SlotT *&cached, bool &shared);
+    /**
+     * Returns how many slots have been handed out, for reading every slot.
+     *
+     * @since  0.7
+     *
+     * @return The number of slots in use.
+     */
+    inline std::size_t GetUsed () const;
+
+    /// The slots.  The last one is shared.
+    SlotT slots[count];
+    /// How many slots have been handed out.
+    std::atomic<std::size_t> used;
+};
+
+/**
+ * Adds to a counter in a slot of ThreadSlots.  Only a shared slot needs a
+ * locked add; a thread's own slot is only written by that thread.
+ *
+ * @since  0.7
+ *
+ * @param [in,out] counter The counter.
+ * @param [in] amount How much to add.
+ * @param [in] shared Whether the slot is shared.
+ */
+template <typename T>
+inline void AddToSlot (std::atomic<T> &counter, T amount, bool shared);
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_THREADSLOTS
@@ -0,0 +1,67 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HUMMSTRUMM_ENGINE_DEBUG_THREADSLOTS_INL
+#define HUMMSTRUMM_ENGINE_DEBUG_THREADSLOTS_INL
+
+namespace hummstrummengine {
+namespace debug {
+namespace detail {
+
+template <typename SlotT, std::size_t count>
+SlotT &
+ThreadSlots<SlotT, count>::Find (SlotT *&cached, bool &shared)
+{
+  if (HUMMSTRUMM_ENGINE_LIKELY (cached != nullptr))
+    return *cached;
+  std::size_t slot = used.fetch_add (1);
+  if (slot >= count - 1)
+    {
+      slot = count - 1;
+      used.store (count);
+      shared = true;
+    }
+  cached = &slots[slot];
+  return *cached;
+}
+
+template <typename SlotT, std::size_t count>
+std::size_t
+ThreadSlots<SlotT, count>::GetUsed () const
+{
+  std::size_t inUse = used.load ();
+  return inUse < count ? inUse : count;
+}
+
+template <typename T>
+void
+AddToSlot (std::atomic<T> &counter, T amount, bool shared)
+{
+  if (HUMMSTRUMM_ENGINE_UNLIKELY (shared))
+    counter.fetch_add (amount, std::memory_order_relaxed);
+  else
+    counter.store (counter.load (std::memory_order_relaxed) + amount,
+                   std::memory_order_relaxed);
+}
+
+
+}
+}
+}
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_DEBUG_THREADSLOTS_INL
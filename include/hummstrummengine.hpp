@@ -104,19 +104,73 @@ namespace hummstrummengine {
  */
 namespace debug
 {
-template <typename ClockT, typename DurationT> class Profiler;
+template <typename DurationT> class AllRunStatistics;
+template <typename DurationT, unsigned Precision> class HistogramStatistics;
+template <typename ClockT, typename DurationT, typename StatisticsT>
+class Profiler;
+enum class MetricKind;
+struct MetricHistory;
+struct MetricValue;
+class Metrics;
+class Counter;
+class Gauge;
+struct LockCounts;
+struct LockReport;
+class LockProfiler;
+class Mutex;
+class SharedMutex;
 /**
  * The namespace for classes that help logging.
  */
 namespace logging
 {
 enum class Level : unsigned;
+struct Record;
+class TimestampFormatter;
+enum class ArgumentType : unsigned char;
+struct Argument;
+struct Id;
+template <typename T> struct AddField;
+enum class OverflowPolicy;
+class AsyncQueue;
+class Dispatcher;
 class StreamBuffer;
 class Backend;
 class ConsoleBackend;
 class FileBackend;
+class BinaryFileBackend;
+class BinaryLogReader;
+class JsonLinesBackend;
+class RingBufferBackend;
+class RotatingFileBackend;
+class SharedMemoryBackend;
+class SharedMemoryReader;
 struct SetFile;
 struct SetLine;
+struct CallSite;
+struct Suppressed;
+}
+/**
+ * The namespace for classes that help profiling.
+ */
+namespace profiling
+{
+struct ZoneSite;
+struct Zone;
+struct ZoneThread;
+struct ZoneFrame;
+class ZoneProfiler;
+class ScopedZone;
+struct AllocationCounts;
+struct AllocationSite;
+class AllocationProfiler;
+class ChromeTraceWriter;
+class ProfileStreamServer;
+class ProfileStreamReader;
+class TscClock;
+struct PerfCounts;
+class PerfCounters;
+class Sampler;
 }
 }
 
@@ -226,6 +280,14 @@ class WindowSystem;
   while (0)
 #endif // #ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
 
+// MSVC 2013 does not know thread_local yet, but it can make plain old data
+// thread-local.  Only use this on plain old data.
+#ifdef HUMMSTRUMM_ENGINE_COMPILER_MSVC
+#define HUMMSTRUMM_ENGINE_THREAD_LOCAL __declspec (thread)
+#else
+#define HUMMSTRUMM_ENGINE_THREAD_LOCAL thread_local
+#endif // #ifdef HUMMSTRUMM_ENGINE_COMPILER_MSVC
+
 #include "debug/utils.hpp"
 #include "util/optimizations.hpp"
 #include "util/termcolors.hpp"
@@ -234,10 +296,34 @@ class WindowSystem;
 #include "system/processors.hpp"
 #include "system/memory.hpp"
 #include "debug/logging/level.hpp"
+#include "debug/logging/timestamp.hpp"
+#include "debug/logging/record.hpp"
+#include "debug/locks.hpp"
+#include "debug/logging/asyncqueue.hpp"
+#include "debug/logging/dispatcher.hpp"
 #include "debug/logging/streambuffer.hpp"
 #include "debug/logging/backend.hpp"
+#include "debug/logging/binarylog.hpp"
+#include "debug/logging/ringbuffer.hpp"
+#include "debug/logging/rotatingfile.hpp"
+#include "debug/logging/sharedmemory.hpp"
 #include "debug/logging/manip.hpp"
+#include "debug/logging/deferred.hpp"
+#include "debug/logging/fields.hpp"
+#include "debug/logging/jsonlines.hpp"
+#include "debug/logging/ratelimit.hpp"
+#include "debug/threadslots.hpp"
+#include "debug/nameregistry.hpp"
+#include "debug/profiling/allocations.hpp"
+#include "debug/profiling/perfcounters.hpp"
+#include "debug/profiling/sampler.hpp"
+#include "debug/profiling/tscclock.hpp"
+#include "debug/profiling/zone.hpp"
+#include "debug/profiling/chrometrace.hpp"
+#include "debug/profiling/stream.hpp"
+#include "debug/statistics.hpp"
 #include "debug/profiler.hpp"
+#include "debug/metrics.hpp"
 #include "math/mathutils.hpp"
 //#include "geometry/geomutils.hpp"
 //#include "geometry/plane.hpp"
@@ -256,9 +342,28 @@ class WindowSystem;
 #include "system/platform.inl"
 #include "system/processors.inl"
 #include "debug/logging/level.inl"
+#include "debug/logging/record.inl"
+#include "debug/locks.inl"
+#include "debug/logging/asyncqueue.inl"
 #include "debug/logging/streambuffer.inl"
 #include "debug/logging/backend.inl"
+#include "debug/logging/binarylog.inl"
+#include "debug/logging/ringbuffer.inl"
+#include "debug/logging/rotatingfile.inl"
+#include "debug/logging/sharedmemory.inl"
 #include "debug/logging/manip.inl"
+#include "debug/logging/deferred.inl"
+#include "debug/logging/fields.inl"
+#include "debug/logging/ratelimit.inl"
+#include "debug/threadslots.inl"
+#include "debug/nameregistry.inl"
+#include "debug/profiling/allocations.inl"
+#include "debug/profiling/perfcounters.inl"
+#include "debug/profiling/sampler.inl"
+#include "debug/profiling/stream.inl"
+#include "debug/profiling/tscclock.inl"
+#include "debug/profiling/zone.inl"
+#include "debug/metrics.inl"
 //#include "geometry/boundingbox.inl"
 //#include "geometry/boundingsphere.inl"
 //#include "geometry/plane.inl"
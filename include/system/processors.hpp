@@ -145,6 +145,27 @@ public:
    */
   inline bool HaveSse42Support () const /* noexcept */;
 
+  /**
+   * Returns whether the processors have an invariant time stamp counter,
+   * which ticks at a constant rate in every power state and is kept in step
+   * across cores, so that it can be used as a clock.
+   *
+   * @since  0.7
+   *
+   * @return If the time stamp counter is invariant.
+   */
+  inline bool HaveInvariantTscSupport () const /* noexcept */;
+
+  /**
+   * Returns whether the processors have the @c rdtscp instruction, which reads
+   * the time stamp counter after the instructions before it have finished.
+   *
+   * @since  0.7
+   *
+   * @return If the system has @c rdtscp support.
+   */
+  inline bool HaveRdtscpSupport () const /* noexcept */;
+
 private:
   /// The number of processors on the system.
   int numberOfProcessors;
@@ -156,6 +177,8 @@ private:
   bool sse3Support;  ///< Whether we have SSE 3.
   bool sse41Support; ///< Whether we have SSE 4.1.
   bool sse42Support; ///< Whether we have SSE 4.2.
+  bool invariantTscSupport; ///< Whether the TSC is invariant.
+  bool rdtscpSupport;       ///< Whether we have rdtscp.
 };
 }
 }
@@ -42,6 +42,12 @@ bool Processors::HaveSse41Support () const /* noexcept */
 bool Processors::HaveSse42Support () const /* noexcept */
 { return sse42Support; }
 
+bool Processors::HaveInvariantTscSupport () const /* noexcept */
+{ return invariantTscSupport; }
+
+bool Processors::HaveRdtscpSupport () const /* noexcept */
+{ return rdtscpSupport; }
+
 }
 }
 
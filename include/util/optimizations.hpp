@@ -32,8 +32,8 @@
 #  define HUMMSTRUMM_ENGINE_LIKELY(cond)   __builtin_expect (cond, true)
 #  define HUMMSTRUMM_ENGINE_UNLIKELY(cond) __builtin_expect (cond, false)
 #else
-#  define HUMMSTRUMM_ENGINE_LIKELY(cond)
-#  define HUMMSTRUMM_ENGINE_UNLIKELY(cond)
+#  define HUMMSTRUMM_ENGINE_LIKELY(cond)   (cond)
+#  define HUMMSTRUMM_ENGINE_UNLIKELY(cond) (cond)
 #endif
 
 #if __GNUC__
@@ -45,4 +45,12 @@
 #  define HUMMSTRUMM_ENGINE_PREFETCH(address)
 #endif
 
+#if __GNUC__
+#  define HUMMSTRUMM_ENGINE_NOINLINE __attribute__ ((noinline))
+#elif defined (_MSC_VER)
+#  define HUMMSTRUMM_ENGINE_NOINLINE __declspec (noinline)
+#else
+#  define HUMMSTRUMM_ENGINE_NOINLINE
+#endif
+
 #endif // #ifndef HUMMSTRUMM_ENGINE_UTIL_OPTIMIZATIONS
@@ -18,22 +18,211 @@
 
 #include "hummstrummengine.hpp"
 
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
 #include <memory>
+#include <mutex>
 #include <iostream>
+#include <string>
+#include <thread>
 
 using namespace hummstrummengine;
 
 namespace hummstrummengine {
 namespace core {
 
+namespace {
+
+/// Hands out Engine ids, so a thread can tell a new Engine from an old one.
+std::atomic<unsigned long> nextEngineId (1);
+
+/// The id of the Engine whose log this thread last used.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL unsigned long cachedEngineId = 0;
+/// This thread's log stream in that Engine.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL std::ostream *cachedLog = nullptr;
+
+/// The flight recorder to write out when the program crashes.
+std::atomic<const debug::logging::RingBufferBackend *> crashRing (nullptr);
+/// Where to write it.  This is copied here so that the signal handler doesn't
+/// have to touch a std::string.
+char crashLogPath[1024];
+/// Makes sure the flight recorder is only written out once, even if writing it
+/// out crashes too.
+std::atomic_flag crashLogWritten = ATOMIC_FLAG_INIT;
+
+/// The signals that mean the program has crashed.
+const int crashSignals[] = {
+  SIGSEGV, SIGABRT, SIGFPE, SIGILL,
+#ifdef SIGBUS
+  SIGBUS
+#endif
+};
+const std::size_t crashSignalCount =
+  sizeof crashSignals / sizeof crashSignals[0];
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_POSIX
+/// What the signals did before we caught them.
+struct sigaction previousActions[crashSignalCount];
+/// A stack for the signal handler, so that it can run after a stack overflow.
+char signalStack[64 * 1024];
+#else
+/// What the signals did before we caught them.
+void (*previousHandlers[crashSignalCount]) (int);
+#endif
+/// What std::terminate() did before we caught it.
+std::terminate_handler previousTerminate = nullptr;
+
+void
+writeCrashLog ()
+{
+  const debug::logging::RingBufferBackend *ring = crashRing.load ();
+  if (ring && !crashLogWritten.test_and_set ())
+    ring->DumpToFile (crashLogPath);
+}
+
+void
+restoreCrashSignals ()
+{
+  for (std::size_t i = 0; i < crashSignalCount; ++i)
+    {
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_POSIX
+      sigaction (crashSignals[i], &previousActions[i], nullptr);
+#else
+      std::signal (crashSignals[i], previousHandlers[i]);
+#endif
+    }
+}
+
+void
+onCrashSignal (int signal)
+{
+  writeCrashLog ();
+  // Hand the signal to whoever had it before, which usually means dying.  It
+  // is blocked until we return.
+  restoreCrashSignals ();
+  std::raise (signal);
+}
+
+void
+onTerminate ()
+{
+  writeCrashLog ();
+  if (previousTerminate)
+    previousTerminate ();
+  std::abort ();
+}
+
+void
+installCrashHandler (const debug::logging::RingBufferBackend *ring,
+                     const std::string &path)
+{
+  std::size_t length = path.size () < sizeof crashLogPath - 1 ?
+                       path.size () : sizeof crashLogPath - 1;
+  std::memcpy (crashLogPath, path.data (), length);
+  crashLogPath[length] = '\0';
+  crashLogWritten.clear ();
+  crashRing.store (ring);
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_POSIX
+  // Only this thread gets the spare stack, but that's usually the main thread,
+  // where a runaway recursion is most likely.
+  stack_t stack;
+  if (sigaltstack (nullptr, &stack) == 0 && (stack.ss_flags & SS_DISABLE))
+    {
+      stack.ss_sp = signalStack;
+      stack.ss_size = sizeof signalStack;
+      stack.ss_flags = 0;
+      sigaltstack (&stack, nullptr);
+    }
+
+  struct sigaction action;
+  std::memset (&action, 0, sizeof action);
+  action.sa_handler = onCrashSignal;
+  action.sa_flags = SA_ONSTACK;
+  sigemptyset (&action.sa_mask);
+  for (std::size_t i = 0; i < crashSignalCount; ++i)
+    sigaction (crashSignals[i], &action, &previousActions[i]);
+#else
+  for (std::size_t i = 0; i < crashSignalCount; ++i)
+    previousHandlers[i] = std::signal (crashSignals[i], onCrashSignal);
+#endif
+
+  previousTerminate = std::set_terminate (onTerminate);
+}
+
+void
+removeCrashHandler ()
+{
+  // Nothing to undo if it was never installed.
+  if (!crashRing.load ())
+    return;
+  std::set_terminate (previousTerminate);
+  restoreCrashSignals ();
+  crashRing.store (nullptr);
+}
+
+}
+
+struct Engine::ThreadLog
+{
+  ThreadLog (std::shared_ptr<debug::logging::Dispatcher> dispatcher)
+      : thread (std::this_thread::get_id ()),
+        buffer (dispatcher),
+        stream (&buffer)
+  {
+  }
+
+  /// The thread that owns this stream.
+  std::thread::id thread;
+  /// Holds the message the thread is building.
+  debug::logging::StreamBuffer buffer;
+  /// The stream the thread writes to.
+  std::ostream stream;
+};
+
 Engine *Engine::theEngine = 0;
 
 Engine::Engine (const Engine::Configuration params) try
-    : logStreamBuffer (params.logBackends),
-      log (&logStreamBuffer)
+    : logDispatcher (std::make_shared<debug::logging::Dispatcher> (
+        params.logBackends,
+        params.asyncLogging ?
+        std::unique_ptr<debug::logging::AsyncQueue> (
+          new debug::logging::AsyncQueue (params.logBackends,
+                                          params.asyncLogCapacity,
+                                          params.asyncLogOverflow)) :
+        nullptr)),
+      threadLogs (),
+      threadLogsMutex (),
+      id (nextEngineId++),
+      crashRing (),
+      sampler (),
+      samplingFile (params.samplingFile)
 {
-  log << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
-      << "Humm and Strumm Game Engine is initializing..." << std::flush;
+  // Messages that no backend would print can be skipped before they're built.
+  debug::logging::Level levels = debug::logging::Level::none;
+  for (auto i = params.logBackends.begin (); i != params.logBackends.end (); ++i)
+    levels = levels | (*i)->GetLevels ();
+  debug::logging::SetEnabledLevels (levels);
+
+  // Keep the flight recorder, if there is one, in case we crash.
+  if (!params.crashLogFile.empty ())
+    {
+      for (auto i = params.logBackends.begin ();
+           i != params.logBackends.end () && !this->crashRing; ++i)
+        {
+          this->crashRing =
+            std::dynamic_pointer_cast<debug::logging::RingBufferBackend> (*i);
+        }
+      if (this->crashRing)
+        installCrashHandler (this->crashRing.get (), params.crashLogFile);
+    }
+
+  HUMMSTRUMM_ENGINE_LOG (GetLog (), Level::info)
+    << "Humm and Strumm Game Engine is initializing..." << std::flush;
   // Set the engine pointer.
   theEngine = this;
 
@@ -43,24 +232,72 @@ Engine::Engine (const Engine::Configuration params) try
   memory = new system::Memory;
   endianness = new system::Endianness;
 
-  log << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
-      << "Humm and Strumm Game Engine is up and running." << std::flush;
+  // Profilers can time with the time stamp counter once we know its rate.
+  // That only has to be measured once.
+  if (debug::profiling::TscClock::GetSource () ==
+      debug::profiling::TscSource::steadyClock)
+    debug::profiling::TscClock::Calibrate (*processors);
+
+  if (params.samplingFrequency != 0)
+    {
+      sampler.reset (
+        new debug::profiling::Sampler (params.samplingFrequency));
+      if (sampler->RegisterThread ())
+        {
+          HUMMSTRUMM_ENGINE_LOG (GetLog (), Level::info)
+            << "Sampling call stacks " << params.samplingFrequency
+            << " times a second." << std::flush;
+        }
+      else
+        {
+          HUMMSTRUMM_ENGINE_LOG (GetLog (), Level::warning)
+            << "Call stacks can't be sampled here." << std::flush;
+        }
+    }
+
+  HUMMSTRUMM_ENGINE_LOG (GetLog (), Level::info)
+    << "Humm and Strumm Game Engine is up and running." << std::flush;
 }
 catch (...)
 {
+  // The flight recorder is freed as the members are destroyed, so the crash
+  // handler mustn't be left pointing at it.
+  removeCrashHandler ();
   theEngine = 0;
   throw;
 }
 
 Engine::~Engine ()
 {
-  log << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
-      << "Humm and Strumm Game Engine is going down." << std::flush;
+  HUMMSTRUMM_ENGINE_LOG (GetLog (), Level::info)
+    << "Humm and Strumm Game Engine is going down." << std::flush;
+
+  if (this->sampler)
+    {
+      if (!this->samplingFile.empty () && this->sampler->IsSampling ())
+        {
+          std::ofstream out (this->samplingFile.c_str ());
+          this->sampler->WriteFolded (out);
+          if (this->sampler->GetDropped () != 0)
+            {
+              HUMMSTRUMM_ENGINE_LOG (GetLog (), Level::warning)
+                << this->sampler->GetDropped ()
+                << " call stack samples were dropped." << std::flush;
+            }
+        }
+      this->sampler.reset ();
+    }
 
   delete this->endianness;
   delete this->memory;
   delete this->processors;
   delete this->platform;
+
+  // Make sure nothing is left waiting for the log writer thread.
+  FlushLog ();
+
+  if (this->crashRing)
+    removeCrashHandler ();
 }
 
 Engine *Engine::GetEngine ()
@@ -72,7 +309,35 @@ Engine *Engine::GetEngine ()
 std::ostream &Engine::GetLog ()
 /* noexcept */
 {
-  return this->log;
+  // Usually, this thread has already logged with this Engine.
+  if (HUMMSTRUMM_ENGINE_LIKELY (cachedEngineId == this->id))
+    return *cachedLog;
+
+  cachedLog = &FindThreadLog ();
+  cachedEngineId = this->id;
+  return *cachedLog;
+}
+
+void Engine::FlushLog ()
+{
+  this->logDispatcher->Flush ();
+}
+
+std::ostream &Engine::FindThreadLog ()
+{
+  std::lock_guard<std::mutex> lock (this->threadLogsMutex);
+
+  // We may already have a stream for this thread if it switched between
+  // Engines.
+  auto self = std::this_thread::get_id ();
+  for (auto i = this->threadLogs.begin (); i != this->threadLogs.end (); ++i)
+    {
+      if ((*i)->thread == self)
+        return (*i)->stream;
+    }
+
+  this->threadLogs.emplace_back (new ThreadLog (this->logDispatcher));
+  return this->threadLogs.back ()->stream;
 }
 
 hummstrummengine::system::Platform *Engine::GetPlatform ()
@@ -99,5 +364,11 @@ hummstrummengine::system::Endianness *Engine::GetEndianness ()
   return this->endianness;
 }
 
+hummstrummengine::debug::profiling::Sampler *Engine::GetSampler ()
+/* noexcept */
+{
+  return this->sampler.get ();
+}
+
 }
 }
@@ -0,0 +1,409 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+
+const size_t LockProfiler::maxLocks;
+const size_t LockProfiler::maxNameLength;
+
+namespace detail {
+
+/// The counts of every lock with one name.
+struct LockSite
+{
+  char name[LockProfiler::maxNameLength + 1];
+  atomic<uint64_t> acquisitions;
+  atomic<uint64_t> sharedAcquisitions;
+  atomic<uint64_t> contentions;
+  atomic<uint64_t> waitTime;
+  atomic<uint64_t> maxWaitTime;
+  atomic<uint64_t> holdTime;
+};
+
+}
+
+namespace {
+
+// Everything here is constant initialized, because locks at namespace scope
+// can be constructed before any constructor here has run.
+
+detail::NameRegistry<detail::LockSite, LockProfiler::maxLocks> sites;
+
+atomic<unsigned> sampleRate (64);
+/// How often to add a lock's counts to its site when no holds are sampled.
+const uint32_t flushInterval = 64;
+
+// Returns the site of a name, making it if there is none.
+detail::LockSite *
+findSite (const char *name)
+{
+  return &sites.entries[sites.Find (name, "lock", [](detail::LockSite &) {})];
+}
+
+// Returns the time in nanoseconds, which is never 0.
+uint64_t
+ticks ()
+{
+  uint64_t now = static_cast<uint64_t> (
+    profiling::TscClock::now ().time_since_epoch ().count ());
+  return now == 0 ? 1 : now;
+}
+
+// Returns how long it has been since a time from ticks().
+uint64_t
+since (uint64_t start)
+{
+  uint64_t now = ticks ();
+  return now > start ? now - start : 0;
+}
+
+// Returns how many acquisitions until the next sample.
+uint32_t
+nextSample (unsigned rate)
+{
+  return rate == 0 ? flushInterval : rate;
+}
+
+// Adds a lock's counts to its site.
+void
+flush (detail::LockSite &site, uint32_t &acquisitions,
+       uint32_t &sharedAcquisitions)
+{
+  site.acquisitions.fetch_add (acquisitions, memory_order_relaxed);
+  site.sharedAcquisitions.fetch_add (sharedAcquisitions,
+                                     memory_order_relaxed);
+  acquisitions = 0;
+  sharedAcquisitions = 0;
+}
+
+// Counts an acquisition that had to wait.
+void
+addWait (detail::LockSite &site, uint64_t waited)
+{
+  site.contentions.fetch_add (1, memory_order_relaxed);
+  site.waitTime.fetch_add (waited, memory_order_relaxed);
+  uint64_t longest = site.maxWaitTime.load (memory_order_relaxed);
+  while (waited > longest &&
+         !site.maxWaitTime.compare_exchange_weak (longest, waited,
+                                                  memory_order_relaxed))
+    ;
+}
+
+LockCounts
+getCounts (const detail::LockSite &site)
+{
+  LockCounts counts;
+  counts.acquisitions = site.acquisitions.load (memory_order_relaxed);
+  counts.sharedAcquisitions =
+    site.sharedAcquisitions.load (memory_order_relaxed);
+  counts.contentions = site.contentions.load (memory_order_relaxed);
+  counts.waitTime = chrono::nanoseconds (
+    site.waitTime.load (memory_order_relaxed));
+  counts.maxWaitTime = chrono::nanoseconds (
+    site.maxWaitTime.load (memory_order_relaxed));
+  counts.holdTime = chrono::nanoseconds (
+    site.holdTime.load (memory_order_relaxed));
+  return counts;
+}
+
+}
+
+void
+LockProfiler::SetSampleRate (unsigned every)
+{
+  sampleRate.store (every, memory_order_relaxed);
+}
+
+unsigned
+LockProfiler::GetSampleRate ()
+{
+  return sampleRate.load (memory_order_relaxed);
+}
+
+bool
+LockProfiler::GetLock (const char *name, LockCounts &counts)
+{
+  size_t count = sites.GetCount ();
+  for (size_t site = 0; site < count; ++site)
+    if (strcmp (sites.entries[site].name, name) == 0)
+      {
+        counts = getCounts (sites.entries[site]);
+        return true;
+      }
+  return false;
+}
+
+vector<LockReport>
+LockProfiler::GetEveryLock ()
+{
+  size_t count = sites.GetCount ();
+  vector<LockReport> reports;
+  reports.reserve (count);
+  for (size_t site = 0; site < count; ++site)
+    {
+      LockReport report;
+      report.name = sites.entries[site].name;
+      report.counts = getCounts (sites.entries[site]);
+      reports.push_back (report);
+    }
+  return reports;
+}
+
+void
+LockProfiler::Log (ostream &log, logging::Level level)
+{
+  if (!logging::IsLevelEnabled (level))
+    return;
+
+  vector<LockReport> reports = GetEveryLock ();
+  stable_sort (reports.begin (), reports.end (),
+               [](const LockReport &a, const LockReport &b) {
+                 return a.counts.contentions > b.counts.contentions;
+               });
+
+  ostringstream text;
+  // The fields point at these names, so they can't move.
+  vector<string> names;
+  names.reserve (4 * reports.size ());
+  vector<pair<const char *, double> > fields;
+  text << "Locks:";
+  for (auto &report : reports)
+    {
+      const LockCounts &counts = report.counts;
+      text << "\n  " << report.name << ": " << counts.acquisitions
+           << " acquisition(s), " << counts.sharedAcquisitions
+           << " shared, " << counts.contentions << " contended, waited "
+           << counts.waitTime.count () << " ns (max "
+           << counts.maxWaitTime.count () << " ns), held about "
+           << counts.holdTime.count () << " ns";
+
+      const pair<const char *, double> numbers[] = {
+        make_pair ("acquisitions",
+                   static_cast<double> (counts.acquisitions)),
+        make_pair ("contentions", static_cast<double> (counts.contentions)),
+        make_pair ("wait_ns", static_cast<double> (counts.waitTime.count ())),
+        make_pair ("hold_ns", static_cast<double> (counts.holdTime.count ()))
+      };
+      for (auto &number : numbers)
+        {
+          names.push_back (string (report.name) + "." + number.first);
+          fields.emplace_back (names.back ().c_str (), number.second);
+        }
+    }
+  detail::LogProfilerReport (log, level, text.str (), fields);
+}
+
+Mutex::Mutex (const char *name)
+  : mutex (),
+    site (findSite (name)),
+    acquisitions (0),
+    untilSample (nextSample (sampleRate.load (memory_order_relaxed))),
+    sampleWeight (0),
+    heldSince (0)
+{
+}
+
+Mutex::~Mutex ()
+{
+  uint32_t sharedAcquisitions = 0;
+  flush (*this->site, this->acquisitions, sharedAcquisitions);
+}
+
+void
+Mutex::LockContended ()
+{
+  uint64_t start = ticks ();
+  this->mutex.lock ();
+  addWait (*this->site, since (start));
+  Acquired ();
+}
+
+void
+Mutex::Sample ()
+{
+  uint32_t sharedAcquisitions = 0;
+  flush (*this->site, this->acquisitions, sharedAcquisitions);
+  unsigned rate = sampleRate.load (memory_order_relaxed);
+  this->untilSample = nextSample (rate);
+  if (rate != 0)
+    {
+      this->sampleWeight = rate;
+      this->heldSince = ticks ();
+    }
+}
+
+void
+Mutex::EndSample ()
+{
+  this->site->holdTime.fetch_add (since (this->heldSince) * this->sampleWeight,
+                                  memory_order_relaxed);
+  this->heldSince = 0;
+}
+
+SharedMutex::SharedMutex (const char *name)
+  : mutex (),
+    released (),
+    site (findSite (name)),
+    readers (0),
+    writersWaiting (0),
+    writer (false),
+    acquisitions (0),
+    sharedAcquisitions (0),
+    untilSample (nextSample (sampleRate.load (memory_order_relaxed))),
+    sampleWeight (0),
+    heldSince (0)
+{
+}
+
+SharedMutex::~SharedMutex ()
+{
+  flush (*this->site, this->acquisitions, this->sharedAcquisitions);
+}
+
+void
+SharedMutex::lock ()
+{
+  unique_lock<std::mutex> lock (this->mutex);
+  if (this->writer || this->readers != 0)
+    {
+      uint64_t start = ticks ();
+      ++this->writersWaiting;
+      this->released.wait (lock, [this]() {
+          return !this->writer && this->readers == 0;
+        });
+      --this->writersWaiting;
+      addWait (*this->site, since (start));
+    }
+  this->writer = true;
+  Acquired (false);
+}
+
+bool
+SharedMutex::try_lock ()
+{
+  lock_guard<std::mutex> lock (this->mutex);
+  if (this->writer || this->readers != 0)
+    return false;
+  this->writer = true;
+  Acquired (false);
+  return true;
+}
+
+void
+SharedMutex::unlock ()
+{
+  {
+    lock_guard<std::mutex> lock (this->mutex);
+    if (this->heldSince != 0)
+      {
+        this->site->holdTime.fetch_add (
+          since (this->heldSince) * this->sampleWeight, memory_order_relaxed);
+        this->heldSince = 0;
+      }
+    this->writer = false;
+  }
+  this->released.notify_all ();
+}
+
+void
+SharedMutex::lock_shared ()
+{
+  unique_lock<std::mutex> lock (this->mutex);
+  // Wait for writers that are waiting, too, so they aren't starved.
+  if (this->writer || this->writersWaiting != 0)
+    {
+      uint64_t start = ticks ();
+      this->released.wait (lock, [this]() {
+          return !this->writer && this->writersWaiting == 0;
+        });
+      addWait (*this->site, since (start));
+    }
+  ++this->readers;
+  Acquired (true);
+}
+
+bool
+SharedMutex::try_lock_shared ()
+{
+  lock_guard<std::mutex> lock (this->mutex);
+  if (this->writer || this->writersWaiting != 0)
+    return false;
+  ++this->readers;
+  Acquired (true);
+  return true;
+}
+
+void
+SharedMutex::unlock_shared ()
+{
+  bool wakeWriters;
+  {
+    lock_guard<std::mutex> lock (this->mutex);
+    wakeWriters = --this->readers == 0 && this->writersWaiting != 0;
+  }
+  if (wakeWriters)
+    this->released.notify_all ();
+}
+
+void
+SharedMutex::Acquired (bool shared)
+{
+  ++this->acquisitions;
+  if (shared)
+    {
+      ++this->sharedAcquisitions;
+      if (this->acquisitions >= flushInterval)
+        flush (*this->site, this->acquisitions, this->sharedAcquisitions);
+      return;
+    }
+
+  // Only exclusive holds are sampled, so only they count down.
+  if (--this->untilSample != 0)
+    return;
+  flush (*this->site, this->acquisitions, this->sharedAcquisitions);
+  unsigned rate = sampleRate.load (memory_order_relaxed);
+  this->untilSample = nextSample (rate);
+  if (rate != 0)
+    {
+      this->sampleWeight = rate;
+      this->heldSince = ticks ();
+    }
+}
+
+
+}
+}
@@ -0,0 +1,352 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+namespace {
+
+// Only messages that were pushed are counted, so written plus dropped is the
+// number of messages pushed; the drop warnings aren't.
+Counter written ("log_messages_written");
+Counter dropped ("log_messages_dropped");
+
+}
+
+AsyncQueue::AsyncQueue (vector<shared_ptr<Backend>> backends,
+                        size_t capacity, OverflowPolicy policy)
+  : backends (backends),
+    slots (),
+    mask (0),
+    policy (policy),
+    enqueuePosition (0),
+    dequeuePosition (0),
+    completed (0),
+    pendingDrops (0),
+    totalDrops (0),
+    running (true),
+    sleeping (false),
+    formatMessages (false),
+    formatted ()
+{
+  for (auto i = backends.begin (); i != backends.end (); ++i)
+    if (!(*i)->AcceptsUnformatted ())
+      formatMessages = true;
+  formatted.reserve (256);
+
+  // Round the capacity up to a power of two, so that positions can be turned
+  // into indices with a mask.
+  size_t size = 2;
+  while (size < capacity)
+    size <<= 1;
+  mask = size - 1;
+
+  slots.reset (new Slot[size]);
+  for (size_t i = 0; i < size; ++i)
+    {
+      slots[i].sequence.store (i, memory_order_relaxed);
+      slots[i].timestamp = 0;
+      slots[i].thread = 0;
+      slots[i].line = 0;
+      slots[i].level = Level::none;
+      slots[i].format = nullptr;
+      // Most messages are short.  Reserve room for them now, so we don't
+      // allocate while the game is running.
+      slots[i].file.reserve (128);
+      slots[i].message.reserve (256);
+      slots[i].arguments.reserve (256);
+      slots[i].fields.reserve (128);
+    }
+
+  writer = thread (&AsyncQueue::Run, this);
+}
+
+AsyncQueue::~AsyncQueue ()
+{
+  {
+    lock_guard<mutex> lock (sleepMutex);
+    running.store (false);
+  }
+  wakeUp.notify_one ();
+  writer.join ();
+}
+
+bool
+AsyncQueue::Push (const Record &record)
+{
+  Slot *slot = nullptr;
+  size_t position = enqueuePosition.load (memory_order_relaxed);
+
+  for (;;)
+    {
+      slot = &slots[position & mask];
+      size_t sequence = slot->sequence.load (memory_order_acquire);
+      auto difference = static_cast<ptrdiff_t> (sequence - position);
+
+      if (difference == 0)
+        {
+          // The slot is free.  Try to claim it.
+          if (enqueuePosition.compare_exchange_weak (position, position + 1,
+                                                     memory_order_relaxed))
+            break;
+        }
+      else if (difference < 0)
+        {
+          // The queue is full.
+          switch (policy)
+            {
+            case OverflowPolicy::dropNewest:
+              pendingDrops.fetch_add (1, memory_order_relaxed);
+              totalDrops.fetch_add (1, memory_order_relaxed);
+              ++dropped;
+              Wake ();
+              return false;
+
+            case OverflowPolicy::dropOldest:
+              {
+                // Only the message in the slot we want is dropped.  If the
+                // writer thread has already taken it and is still sending
+                // it, dropping the next one would not free our slot, so the
+                // new message is dropped instead.
+                size_t oldest = position - (mask + 1);
+                pendingDrops.fetch_add (1, memory_order_relaxed);
+                totalDrops.fetch_add (1, memory_order_relaxed);
+                ++dropped;
+                if (sequence != oldest + 1 ||
+                    !dequeuePosition.compare_exchange_strong
+                      (oldest, oldest + 1, memory_order_relaxed))
+                  {
+                    Wake ();
+                    return false;
+                  }
+                Release (slot, oldest);
+                completed.fetch_add (1, memory_order_release);
+              }
+              break;
+
+            case OverflowPolicy::block:
+            default:
+              Wake ();
+              this_thread::yield ();
+              break;
+            }
+          position = enqueuePosition.load (memory_order_relaxed);
+        }
+      else
+        {
+          // Someone else got this slot first.
+          position = enqueuePosition.load (memory_order_relaxed);
+        }
+    }
+
+  // We own the slot now.  Assigning into the existing strings reuses their
+  // storage.
+  slot->timestamp = record.timestamp;
+  slot->thread = record.thread;
+  slot->file.assign (record.file);
+  slot->line = record.line;
+  slot->level = record.level;
+  if (record.message)
+    {
+      slot->message.assign (record.message, record.messageLength);
+      slot->format = nullptr;
+    }
+  else
+    {
+      slot->message.clear ();
+      slot->format = record.format;
+      slot->arguments.assign (record.arguments,
+                              record.arguments + record.argumentsLength);
+    }
+  if (record.fields)
+    slot->fields.assign (record.fields, record.fields + record.fieldsLength);
+  else
+    slot->fields.clear ();
+  slot->sequence.store (position + 1, memory_order_release);
+
+  Wake ();
+  return true;
+}
+
+void
+AsyncQueue::Flush ()
+{
+  size_t target = enqueuePosition.load (memory_order_acquire);
+  while (completed.load (memory_order_acquire) < target)
+    {
+      Wake ();
+      this_thread::yield ();
+    }
+}
+
+AsyncQueue::Slot *
+AsyncQueue::Claim (size_t &position)
+{
+  position = dequeuePosition.load (memory_order_relaxed);
+
+  for (;;)
+    {
+      Slot *slot = &slots[position & mask];
+      size_t sequence = slot->sequence.load (memory_order_acquire);
+      auto difference = static_cast<ptrdiff_t> (sequence - (position + 1));
+
+      if (difference == 0)
+        {
+          // The slot has been filled.  Try to claim it.  Only producers
+          // dropping the oldest message compete with the writer thread for
+          // the dequeue position.
+          if (dequeuePosition.compare_exchange_weak (position, position + 1,
+                                                     memory_order_relaxed))
+            return slot;
+        }
+      else if (difference < 0)
+        {
+          // Nothing to read yet.
+          return nullptr;
+        }
+      else
+        {
+          position = dequeuePosition.load (memory_order_relaxed);
+        }
+    }
+}
+
+void
+AsyncQueue::Release (Slot *slot, size_t position)
+{
+  slot->sequence.store (position + mask + 1, memory_order_release);
+}
+
+void
+AsyncQueue::Dispatch (const Record &record)
+{
+  for (auto i = backends.begin (); i != backends.end (); ++i)
+    {
+      // There's no one to report an error to on this thread, so a backend
+      // that fails just misses this message.
+      try
+        {
+          (**i) (record);
+        }
+      catch (...)
+        {
+        }
+    }
+}
+
+void
+AsyncQueue::Wake ()
+{
+  // Pairs with the fence in Run(): either we see that the writer is asleep, or
+  // the writer sees our message before it goes to sleep.
+  atomic_thread_fence (memory_order_seq_cst);
+  if (sleeping.load (memory_order_relaxed))
+    {
+      lock_guard<mutex> lock (sleepMutex);
+      wakeUp.notify_one ();
+    }
+}
+
+void
+AsyncQueue::Run ()
+{
+  for (;;)
+    {
+      // Tell the backends about any messages we lost since last time.
+      unsigned long long drops = pendingDrops.exchange (0,
+                                                        memory_order_relaxed);
+      if (drops != 0)
+        {
+          string message = to_string (drops) + " log message(s) dropped "
+                           "because the log queue was full.";
+          Record record (GetTimestamp (), GetThreadNumber (), "(log queue)", 0,
+                         Level::warning, message.data (), message.size ());
+          Dispatch (record);
+        }
+
+      size_t position;
+      Slot *slot = Claim (position);
+      if (slot)
+        {
+          Record record (slot->timestamp, slot->thread, slot->file.c_str (),
+                         slot->line, slot->level, slot->message.data (),
+                         slot->message.size ());
+          if (slot->format)
+            {
+              record.message = nullptr;
+              record.messageLength = 0;
+              record.format = slot->format;
+              record.arguments = slot->arguments.data ();
+              record.argumentsLength = slot->arguments.size ();
+              // Here's where we save the thread that logged the message from
+              // formatting it.
+              if (formatMessages)
+                FormatRecord (record, formatted);
+            }
+          if (!slot->fields.empty ())
+            {
+              record.fields = slot->fields.data ();
+              record.fieldsLength = slot->fields.size ();
+            }
+          Dispatch (record);
+          ++written;
+          Release (slot, position);
+          completed.fetch_add (1, memory_order_release);
+          continue;
+        }
+
+      // The queue is empty.  Stop if we were asked to; everything that was
+      // queued before the destructor ran has been written by now.
+      if (!running.load ())
+        break;
+
+      unique_lock<mutex> lock (sleepMutex);
+      sleeping.store (true, memory_order_relaxed);
+      atomic_thread_fence (memory_order_seq_cst);
+      size_t next = dequeuePosition.load (memory_order_relaxed);
+      bool empty = slots[next & mask].sequence.load (memory_order_acquire) !=
+                   next + 1;
+      if (empty && running.load () &&
+          pendingDrops.load (memory_order_relaxed) == 0)
+        {
+          // The timeout is only a safety net; producers wake us up.
+          wakeUp.wait_for (lock, chrono::milliseconds (100));
+        }
+      sleeping.store (false, memory_order_relaxed);
+    }
+}
+
+
+}
+}
+}
@@ -35,35 +35,63 @@ namespace logging {
 
 Backend::~Backend () {}
 
+bool Backend::AcceptsUnformatted () const
+{
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hummstrummengine::debug::logging::LegacyBackend implementation
+
+LegacyBackend::~LegacyBackend () {}
+
+void LegacyBackend::operator()(const Record &record)
+{
+  // This backend only knows the old interface, so it needs its own copies.
+  std::string message;
+  if (record.message)
+    message.assign (record.message, record.messageLength);
+  else if (record.format)
+    FormatDeferred (message, record.format, record.arguments,
+                    record.argumentsLength);
+
+  (*this) (record.time, std::string (record.file), record.line, record.level,
+           message);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // hummstrummengine::debug::logging::ConsoleBackend implementation
 
 ConsoleBackend::~ConsoleBackend () {}
 
-void ConsoleBackend::operator()(std::time_t t, std::string file, unsigned line,
-                                Level level, std::string message)
+void ConsoleBackend::operator()(const Record &record)
 {
   // Should we even print on this level?
-  if ((level & acceptLevels) == Level::none)
+  if ((record.level & acceptLevels) == Level::none)
     return;
 
   // To which stream should we print?
   std::ostream &out = useStderr ? std::cerr : std::cout;
 
-  // Get timestamp.  It's guaranteed to be 22 chars, including the terminating
-  // nul.  Use std::put_time (std::gmtime (&t), "%Y-%m-%dT%H:%M:%SZ")
-  // eventually.
-  char tbuffer[22];
-  std::strftime (tbuffer, 22, "%Y-%m-%dT%H:%M:%SZ", std::gmtime (&t));
+  Print (out, record, timestamps, printColor);
+  out.flush ();
+}
+
+void ConsoleBackend::Print (std::ostream &out, const Record &record,
+                            TimestampFormatter &timestamps, bool color)
+{
+  // Only the fraction of the second changes between most messages, so the
+  // formatter only renders that.
+  const char *tbuffer = timestamps.Format (record.timestamp);
 
 // Print out.
-// Format: [ 2012-06-14T02:09:18Z ] /whatever/file.cpp(52)
+// Format: [ 2012-06-14T02:09:18.123456789Z ] /whatever/file.cpp(52)
 //         Message here.
-  if (printColor)
+  if (color)
     {
       auto colorEnd = foreground (Color::reset);
       auto colorStart = colorEnd; // by default, change below:
-      switch (level)
+      switch (record.level)
         {
         case hummstrummengine::debug::logging::Level::success:
           colorStart = foreground (Color::blue);
@@ -83,77 +111,45 @@ void ConsoleBackend::operator()(std::time_t t, std::string file, unsigned line,
         }
 
       out << colorStart << bright << "[ " << tbuffer << " ]" << normal << " "
-          << file << "(" << line << ")\n\t" << colorEnd << message
-          << std::endl;
+          << record.file << "(" << record.line << ")\n\t" << colorEnd;
     }
   else
     {
       out << "[ " << tbuffer << " ]"
-          << " " << file << "(" << line << ")\n\t" << message << std::endl;
+          << " " << record.file << "(" << record.line << ")\n\t";
     }
+  out.write (record.message, record.messageLength);
+  out << '\n';
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // hummstrummengine::debug::logging::FileBackend implementation
 
 FileBackend::FileBackend (Level levels, std::string file)
-    : Backend (levels), fileStream (file)
+    : Backend (levels), fileStream (file), timestamps ()
 {
-  // Get timestamp.  It's guaranteed to be 22 chars, including the terminating
-  // nul.  Use std::put_time (std::gmtime (&t), "%Y-%m-%dT%H:%M:%SZ")
-  // eventually.
-  std::time_t t = std::time (0);
-  char tbuffer[22];
-  std::strftime (tbuffer, 22, "%Y-%m-%dT%H:%M:%SZ", std::gmtime (&t));
-
   fileStream << "<?xml version=\"1.1\" encoding=\"utf-8\"?>\n\n"
-             << "<log timestamp=\"" << tbuffer << "\">" << std::endl;
+             << "<log timestamp=\"" << timestamps.Format (GetTimestamp ())
+             << "\">" << std::endl;
 }
 
 FileBackend::~FileBackend () { fileStream << "</log>" << std::endl; }
 
-void FileBackend::operator()(std::time_t t, std::string file, unsigned line,
-                             Level level, std::string message)
+void FileBackend::operator()(const Record &record)
 {
   // Should we even print on this level?
-  if ((level & acceptLevels) == Level::none)
+  if ((record.level & acceptLevels) == Level::none)
     return;
 
-  // Get timestamp.  It's guaranteed to be 22 chars, including the terminating
-  // nul.  Use std::put_time (std::gmtime (&t), "%Y-%m-%dT%H:%M:%SZ")
-  // eventually.
-  char tbuffer[22];
-  std::strftime (tbuffer, 22, "%Y-%m-%dT%H:%M:%SZ", std::gmtime (&t));
-
-  // Give a name to the level.
-  std::string lname;
-  switch (level)
-    {
-    case Level::info:
-      lname = "info";
-      break;
-
-    case Level::success:
-      lname = "success";
-      break;
-
-    case Level::warning:
-      lname = "warning";
-      break;
-
-    case Level::error:
-      lname = "error";
-      break;
-
-    default:
-      lname = "none";
-      break;
-    }
+  const char *tbuffer = timestamps.Format (record.timestamp);
 
   // XML format.  See schema for details.  Outputs <message> element.
-  fileStream << "<message timestamp=\"" << tbuffer << "\" file=\"" << file
-             << "\" line=\"" << line << "\" level=\"" << lname << "\">\n"
-             << message << "\n</message>" << std::endl;
+  fileStream << "<message timestamp=\"" << tbuffer << "\" thread=\""
+             << record.thread << "\" file=\"" << record.file << "\" line=\""
+             << record.line << "\" level=\"" << GetLevelName (record.level)
+             << "\">\n";
+  fileStream.write (record.message, record.messageLength);
+  fileStream << "\n</message>" << std::endl;
 }
 
 }
@@ -0,0 +1,377 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <ctime>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <istream>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+namespace {
+
+using binarylog::maxVarint;
+using binarylog::nanosecondTicks;
+using binarylog::PutVarint;
+using binarylog::Unzigzag;
+using binarylog::Zigzag;
+
+/// The longest record a reader accepts.
+const uint64_t MAX_RECORD = 1 << 30;
+/// How much of a record is read at a time, so that a corrupt length runs into
+/// the end of the log before it makes the reader allocate much.
+const size_t READ_CHUNK = 1 << 20;
+
+// Reads a varint from a stream.  Returns false at the end of the stream.
+bool
+getVarint (istream &in, uint64_t &value)
+{
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+      int c = in.get ();
+      if (c == char_traits<char>::eof ())
+        return false;
+      value |= static_cast<uint64_t> (c & 0x7f) << shift;
+      if (!(c & 0x80))
+        return true;
+    }
+  throw runtime_error ("Binary log has a varint that is too long.");
+}
+
+// Reads a varint from [position, end), moving position past it.
+uint64_t
+getVarint (const char *&position, const char *end)
+{
+  uint64_t value = 0;
+  for (unsigned shift = 0; shift < 64 && position != end; shift += 7)
+    {
+      unsigned char c = static_cast<unsigned char> (*position++);
+      value |= static_cast<uint64_t> (c & 0x7f) << shift;
+      if (!(c & 0x80))
+        return value;
+    }
+  throw runtime_error ("Binary log has a bad record.");
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hummstrummengine::debug::logging::BinaryFileBackend implementation
+
+BinaryFileBackend::BinaryFileBackend (Level levels, string file,
+                                      size_t bufferSize)
+  : Backend (levels),
+    fileStream (file, ios_base::out | ios_base::binary | ios_base::trunc),
+    buffer (bufferSize < 64 ? 64 : bufferSize),
+    used (0),
+    epoch (static_cast<time_t> (GetTimestamp () / nanosecondTicks)),
+    epochTimestamp (static_cast<uint64_t> (epoch) * nanosecondTicks)
+{
+  char header[sizeof binarylog::magic + 1 + 2 * maxVarint];
+  size_t n = 0;
+  memcpy (header, binarylog::magic, sizeof binarylog::magic);
+  n += sizeof binarylog::magic;
+  header[n++] = static_cast<char> (binarylog::version);
+  n += PutVarint (header + n, nanosecondTicks);
+  n += PutVarint (header + n, static_cast<uint64_t> (epoch));
+  fileStream.write (header, n);
+}
+
+BinaryFileBackend::~BinaryFileBackend ()
+{
+  Flush ();
+}
+
+void
+BinaryFileBackend::operator() (const Record &record)
+{
+  // Should we even print on this level?
+  if ((record.level & acceptLevels) == Level::none)
+    return;
+
+  uint64_t file = Intern (files, binarylog::RecordType::fileName,
+                          record.file);
+  bool unformatted = !record.message && record.format;
+  uint64_t format = 0;
+  if (unformatted)
+    format = Intern (formats, binarylog::RecordType::formatString,
+                     record.format);
+
+  char head[5 * maxVarint + 1];
+  size_t n = 0;
+  n += PutVarint (head + n, Zigzag (static_cast<int64_t> (record.timestamp -
+                                                          epochTimestamp)));
+  n += PutVarint (head + n, record.thread);
+  n += PutVarint (head + n, file);
+  n += PutVarint (head + n, record.line);
+  head[n++] = static_cast<char> (record.level);
+
+  if (unformatted)
+    {
+      n += PutVarint (head + n, format);
+      PutRecord (binarylog::RecordType::unformattedMessage, head, n,
+                 record.arguments, record.argumentsLength);
+    }
+  else
+    {
+      PutRecord (binarylog::RecordType::message, head, n, record.message,
+                 record.messageLength);
+    }
+}
+
+bool
+BinaryFileBackend::AcceptsUnformatted () const
+{
+  return true;
+}
+
+void
+BinaryFileBackend::Flush ()
+{
+  if (used != 0)
+    {
+      fileStream.write (buffer.data (), used);
+      used = 0;
+    }
+  fileStream.flush ();
+}
+
+uint64_t
+BinaryFileBackend::Intern (StringTable &table, binarylog::RecordType type,
+                           const char *name)
+{
+  // Usually, this is a literal we've seen before.  Check that it still says
+  // the same thing, though, because a StreamBuffer reuses its storage for file
+  // names given as std::string objects.
+  auto byAddress = table.idsByAddress.find (name);
+  if (byAddress != table.idsByAddress.end () &&
+      table.names[byAddress->second] == name)
+    return byAddress->second;
+
+  uint64_t id;
+  auto byName = table.idsByName.find (name);
+  if (byName != table.idsByName.end ())
+    {
+      id = byName->second;
+    }
+  else
+    {
+      id = table.names.size ();
+      table.names.push_back (name);
+      table.idsByName[name] = id;
+
+      char head[maxVarint];
+      size_t n = PutVarint (head, id);
+      PutRecord (type, head, n, name, strlen (name));
+    }
+
+  table.idsByAddress[name] = id;
+  return id;
+}
+
+void
+BinaryFileBackend::PutRecord (binarylog::RecordType type, const char *head,
+                              size_t headLength, const char *body,
+                              size_t bodyLength)
+{
+  char prefix[1 + maxVarint];
+  size_t n = 0;
+  prefix[n++] = static_cast<char> (type);
+  n += PutVarint (prefix + n, headLength + bodyLength);
+
+  size_t total = n + headLength + bodyLength;
+  if (used + total > buffer.size ())
+    Flush ();
+
+  if (total > buffer.size ())
+    {
+      // Too big to buffer.  Write it straight out.
+      fileStream.write (prefix, n);
+      fileStream.write (head, headLength);
+      fileStream.write (body, bodyLength);
+      return;
+    }
+
+  char *out = buffer.data () + used;
+  memcpy (out, prefix, n);
+  memcpy (out + n, head, headLength);
+  if (bodyLength != 0)
+    memcpy (out + n + headLength, body, bodyLength);
+  used += total;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hummstrummengine::debug::logging::BinaryLogReader implementation
+
+BinaryLogReader::BinaryLogReader (istream &in)
+  : in (in),
+    ticksPerSecond (1),
+    epoch (0)
+{
+  char magic[sizeof binarylog::magic];
+  if (!in.read (magic, sizeof magic) ||
+      memcmp (magic, binarylog::magic, sizeof magic) != 0)
+    throw runtime_error ("Not a binary log.");
+
+  int found = in.get ();
+  if (found == char_traits<char>::eof ())
+    throw runtime_error ("Binary log header is cut off.");
+  if (found != binarylog::version)
+    throw runtime_error ("Binary log has version " + to_string (found) +
+                         ", but only version " +
+                         to_string (binarylog::version) + " can be read.");
+
+  uint64_t start;
+  if (!getVarint (in, ticksPerSecond) || !getVarint (in, start))
+    throw runtime_error ("Binary log header is cut off.");
+  if (ticksPerSecond == 0)
+    throw runtime_error ("Binary log header is corrupt.");
+  epoch = static_cast<time_t> (start);
+}
+
+bool
+BinaryLogReader::Next (Record &record)
+{
+  for (;;)
+    {
+      int type = in.get ();
+      uint64_t length;
+      if (type == char_traits<char>::eof () || !getVarint (in, length))
+        return false;
+
+      if (length > MAX_RECORD)
+        throw runtime_error ("Binary log has a record that is too long.");
+      // The buffer only grows as fast as the record is really there.
+      for (size_t done = 0; done < length; )
+        {
+          size_t chunk = length - done < READ_CHUNK ?
+            static_cast<size_t> (length - done) : READ_CHUNK;
+          if (payload.size () < done + chunk)
+            payload.resize (done + chunk);
+          if (!in.read (payload.data () + done, chunk))
+            return false;
+          done += chunk;
+        }
+      const char *position = payload.data ();
+      const char *end = position + length;
+
+      switch (static_cast<binarylog::RecordType> (type))
+        {
+        case binarylog::RecordType::fileName:
+          {
+            // Ids are handed out in order, so the next new one can't be
+            // past the end.
+            uint64_t id = getVarint (position, end);
+            if (id > names.size ())
+              throw runtime_error ("Binary log has a bad file name id.");
+            if (id == names.size ())
+              names.resize (id + 1);
+            names[id].assign (position, end);
+          }
+          break;
+
+        case binarylog::RecordType::formatString:
+          {
+            uint64_t id = getVarint (position, end);
+            if (id > formats.size ())
+              throw runtime_error ("Binary log has a bad format string id.");
+            if (id == formats.size ())
+              formats.resize (id + 1);
+            formats[id].assign (position, end);
+          }
+          break;
+
+        case binarylog::RecordType::message:
+        case binarylog::RecordType::unformattedMessage:
+          {
+            int64_t ticks = Unzigzag (getVarint (position, end));
+            uint64_t thread = getVarint (position, end);
+            uint64_t file = getVarint (position, end);
+            uint64_t line = getVarint (position, end);
+            if (position == end || file >= names.size ())
+              throw runtime_error ("Binary log has a bad record.");
+
+            // Convert the ticks to nanoseconds without overflowing.
+            int64_t perSecond = static_cast<int64_t> (ticksPerSecond);
+            int64_t seconds = ticks / perSecond;
+            int64_t fraction = ticks % perSecond;
+            if (fraction < 0)
+              {
+                --seconds;
+                fraction += perSecond;
+              }
+            record.time = epoch + static_cast<time_t> (seconds);
+            record.timestamp =
+              static_cast<uint64_t> (record.time) * nanosecondTicks +
+              static_cast<uint64_t> (fraction) * nanosecondTicks /
+              ticksPerSecond;
+            record.thread = static_cast<unsigned> (thread);
+            record.file = names[file].c_str ();
+            record.line = static_cast<unsigned> (line);
+            record.level = static_cast<Level> (
+              static_cast<unsigned char> (*position++));
+
+            if (static_cast<binarylog::RecordType> (type) ==
+                binarylog::RecordType::message)
+              {
+                record.message = position;
+                record.messageLength = end - position;
+                record.format = nullptr;
+                record.arguments = nullptr;
+                record.argumentsLength = 0;
+              }
+            else
+              {
+                uint64_t format = getVarint (position, end);
+                if (format >= formats.size ())
+                  throw runtime_error ("Binary log has a bad record.");
+                record.format = formats[format].c_str ();
+                record.arguments = position;
+                record.argumentsLength = end - position;
+                FormatDeferred (formatted, record.format, record.arguments,
+                                record.argumentsLength);
+                record.message = formatted.data ();
+                record.messageLength = formatted.size ();
+              }
+          }
+          return true;
+
+        default:
+          // Written by a newer engine.  Skip it.
+          break;
+        }
+    }
+}
+
+
+}
+}
+}
@@ -0,0 +1,234 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef HUMMSTRUMM_ENGINE_COMPILER_MSVC
+   // MSVC 2013 only has the nonstandard version.  Our buffers are always big
+   // enough, so the difference doesn't matter.
+#  define snprintf _snprintf
+#endif
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+namespace {
+
+// Reads a value of type T from [position, end), moving position past it.
+template <typename T>
+bool
+read (const char *&position, const char *end, T &value)
+{
+  if (static_cast<size_t> (end - position) < sizeof value)
+    return false;
+  memcpy (&value, position, sizeof value);
+  position += sizeof value;
+  return true;
+}
+
+// Formats the next argument onto out, the way an ostream would by default.
+// Returns false if there are no arguments left (or they're corrupt).
+bool
+formatArgument (string &out, const char *&position, const char *end)
+{
+  Argument argument;
+  if (!DecodeArgument (position, end, argument))
+    return false;
+
+  char text[32];
+  int length = 0;
+  switch (argument.type)
+    {
+    case ArgumentType::signedInteger:
+      length = snprintf (text, sizeof text, "%lld",
+                         static_cast<long long> (argument.signedValue));
+      break;
+
+    case ArgumentType::unsignedInteger:
+      length = snprintf (text, sizeof text, "%llu",
+                         static_cast<unsigned long long> (
+                           argument.unsignedValue));
+      break;
+
+    case ArgumentType::floatingPoint:
+      length = snprintf (text, sizeof text, "%g", argument.floatValue);
+      break;
+
+    case ArgumentType::boolean:
+      out += argument.unsignedValue ? '1' : '0';
+      break;
+
+    case ArgumentType::character:
+    case ArgumentType::string:
+      out.append (argument.text, argument.textLength);
+      break;
+
+    case ArgumentType::pointer:
+      length = snprintf (text, sizeof text, "0x%llx",
+                         static_cast<unsigned long long> (
+                           argument.unsignedValue));
+      break;
+
+    case ArgumentType::id:
+      length = snprintf (text, sizeof text, "%016llx",
+                         static_cast<unsigned long long> (
+                           argument.unsignedValue));
+      break;
+    }
+
+  if (length > 0)
+    out.append (text, length);
+  return true;
+}
+
+}
+
+bool
+DecodeArgument (const char *&position, const char *end, Argument &argument)
+{
+  const char *start = position;
+  if (position == end)
+    return false;
+
+  bool good = true;
+  argument.type = static_cast<ArgumentType> (*position++);
+  argument.signedValue = 0;
+  argument.unsignedValue = 0;
+  argument.floatValue = 0;
+  argument.text = nullptr;
+  argument.textLength = 0;
+  switch (argument.type)
+    {
+    case ArgumentType::signedInteger:
+      good = read (position, end, argument.signedValue);
+      break;
+
+    case ArgumentType::unsignedInteger:
+    case ArgumentType::pointer:
+    case ArgumentType::id:
+      good = read (position, end, argument.unsignedValue);
+      break;
+
+    case ArgumentType::floatingPoint:
+      good = read (position, end, argument.floatValue);
+      break;
+
+    case ArgumentType::character:
+      good = position != end;
+      if (good)
+        {
+          argument.text = position++;
+          argument.textLength = 1;
+        }
+      break;
+
+    case ArgumentType::boolean:
+      {
+        unsigned char value = 0;
+        good = read (position, end, value);
+        argument.unsignedValue = value;
+      }
+      break;
+
+    case ArgumentType::string:
+      {
+        uint32_t size;
+        good = read (position, end, size) &&
+               static_cast<size_t> (end - position) >= size;
+        if (good)
+          {
+            argument.text = position;
+            argument.textLength = size;
+            position += size;
+          }
+      }
+      break;
+
+    default:
+      good = false;
+      break;
+    }
+
+  if (!good)
+    position = start;
+  return good;
+}
+
+void
+FormatDeferred (string &out, const char *format, const char *arguments,
+                size_t length)
+{
+  out.clear ();
+  const char *position = arguments;
+  const char *end = arguments + length;
+  bool haveArguments = length != 0;
+
+  for (const char *c = format; *c; ++c)
+    {
+      if (c[0] == '{' && c[1] == '{')
+        {
+          out += '{';
+          ++c;
+        }
+      else if (c[0] == '}' && c[1] == '}')
+        {
+          out += '}';
+          ++c;
+        }
+      else if (c[0] == '{' && c[1] == '}')
+        {
+          if (!haveArguments || !formatArgument (out, position, end))
+            {
+              // Out of arguments; leave the placeholder where it is.
+              haveArguments = false;
+              out += "{}";
+            }
+          ++c;
+        }
+      else
+        {
+          out += *c;
+        }
+    }
+}
+
+void
+FormatRecord (Record &record, string &buffer)
+{
+  if (record.message || !record.format)
+    return;
+
+  FormatDeferred (buffer, record.format, record.arguments,
+                  record.argumentsLength);
+  record.message = buffer.data ();
+  record.messageLength = buffer.size ();
+}
+
+
+}
+}
+}
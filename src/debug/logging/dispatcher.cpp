@@ -0,0 +1,100 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <ctime>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+
+Dispatcher::Dispatcher (vector<shared_ptr<Backend>> backends,
+                        unique_ptr<AsyncQueue> queue)
+  : backends (backends),
+    queue (std::move (queue)),
+    backendMutex ("log_backends"),
+    formatMessages (false),
+    formatted ()
+{
+  for (auto i = this->backends.begin (); i != this->backends.end (); ++i)
+    if (!(*i)->AcceptsUnformatted ())
+      formatMessages = true;
+}
+
+Dispatcher::~Dispatcher ()
+{
+  // Whatever call sites suppressed since their last message is lost with us
+  // otherwise.
+  try
+    {
+      ReportSuppressed (*this);
+    }
+  catch (...)
+    {
+    }
+  ForgetDispatcher (*this);
+}
+
+void
+Dispatcher::Send (const Record &record)
+{
+  // The writer thread takes it from here.
+  if (queue)
+    {
+      queue->Push (record);
+      return;
+    }
+
+  lock_guard<Mutex> lock (backendMutex);
+
+  // Without a queue, there's no other thread to format the message on.
+  Record formattedRecord = record;
+  if (formatMessages)
+    FormatRecord (formattedRecord, formatted);
+
+  for (auto i = backends.begin (); i != backends.end (); ++i)
+    {
+      // Funny syntax here: first we dereference the iterator (that's the
+      // inner star), and then we dereference the smart pointer that's in
+      // the vector (leftmost star).  Then we call the @c operator() of that
+      // dereferenced backend.
+      (**i) (formattedRecord);
+    }
+}
+
+void
+Dispatcher::Flush ()
+{
+  ReportSuppressed (*this);
+  if (queue)
+    queue->Flush ();
+}
+
+
+}
+}
+}
@@ -0,0 +1,238 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "hummstrummengine.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef HUMMSTRUMM_ENGINE_COMPILER_MSVC
+   // MSVC 2013 only has the nonstandard version.  Our buffers are always big
+   // enough, so the difference doesn't matter.
+#  define snprintf _snprintf
+#endif
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+JsonLinesBackend::JsonLinesBackend (Level levels, string file,
+                                    size_t bufferSize)
+  : Backend (levels),
+    fileStream (file, ios_base::out | ios_base::binary | ios_base::trunc),
+    buffer (bufferSize < 256 ? 256 : bufferSize),
+    used (0),
+    timestamps ()
+{
+}
+
+JsonLinesBackend::~JsonLinesBackend ()
+{
+  Flush ();
+}
+
+void
+JsonLinesBackend::operator() (const Record &record)
+{
+  // Should we even print on this level?
+  if ((record.level & acceptLevels) == Level::none)
+    return;
+
+  char number[32];
+  int length;
+
+  Put ("{\"time\":\"", 9);
+  Put (timestamps.Format (record.timestamp), TimestampFormatter::LENGTH);
+  length = snprintf (number, sizeof number, "\",\"thread\":%u,\"file\":",
+                     record.thread);
+  Put (number, length);
+  PutString (record.file, strlen (record.file));
+  length = snprintf (number, sizeof number, ",\"line\":%u,\"level\":\"",
+                     record.line);
+  Put (number, length);
+  const char *level = GetLevelName (record.level);
+  Put (level, strlen (level));
+  Put ("\",\"message\":", 12);
+  PutString (record.message, record.messageLength);
+
+  if (record.fields)
+    {
+      // Stop at anything we can't read, but keep the JSON whole.
+      const char *position = record.fields;
+      const char *end = position + record.fieldsLength;
+      Argument key, value;
+      bool first = true;
+      while (DecodeArgument (position, end, key) &&
+             key.type == ArgumentType::string &&
+             DecodeArgument (position, end, value))
+        {
+          Put (first ? ",\"fields\":{" : ",", first ? 11 : 1);
+          first = false;
+          PutString (key.text, key.textLength);
+          Put (":", 1);
+          PutValue (value);
+        }
+      if (!first)
+        Put ("}", 1);
+    }
+
+  Put ("}\n", 2);
+}
+
+void
+JsonLinesBackend::Flush ()
+{
+  if (used != 0)
+    {
+      fileStream.write (buffer.data (), used);
+      used = 0;
+    }
+  fileStream.flush ();
+}
+
+void
+JsonLinesBackend::Put (const char *text, size_t length)
+{
+  if (used + length > buffer.size ())
+    {
+      fileStream.write (buffer.data (), used);
+      used = 0;
+      if (length > buffer.size ())
+        {
+          // Too big to buffer.  Write it straight out.
+          fileStream.write (text, length);
+          return;
+        }
+    }
+  memcpy (buffer.data () + used, text, length);
+  used += length;
+}
+
+void
+JsonLinesBackend::PutString (const char *text, size_t length)
+{
+  Put ("\"", 1);
+  // Copy runs of characters that don't need escaping in one go.
+  const char *run = text;
+  const char *end = text + length;
+  for (const char *c = text; c != end; ++c)
+    {
+      unsigned char character = static_cast<unsigned char> (*c);
+      if (character >= 0x20 && character != '"' && character != '\\')
+        continue;
+
+      Put (run, c - run);
+      run = c + 1;
+      char escape[8];
+      int escapeLength = 2;
+      escape[0] = '\\';
+      switch (character)
+        {
+        case '"':
+          escape[1] = '"';
+          break;
+        case '\\':
+          escape[1] = '\\';
+          break;
+        case '\n':
+          escape[1] = 'n';
+          break;
+        case '\r':
+          escape[1] = 'r';
+          break;
+        case '\t':
+          escape[1] = 't';
+          break;
+        default:
+          escapeLength = snprintf (escape, sizeof escape, "\\u%04x",
+                                   character);
+          break;
+        }
+      Put (escape, escapeLength);
+    }
+  Put (run, end - run);
+  Put ("\"", 1);
+}
+
+void
+JsonLinesBackend::PutValue (const Argument &value)
+{
+  char text[32];
+  int length = 0;
+  switch (value.type)
+    {
+    case ArgumentType::signedInteger:
+      length = snprintf (text, sizeof text, "%lld",
+                         static_cast<long long> (value.signedValue));
+      break;
+
+    case ArgumentType::unsignedInteger:
+      length = snprintf (text, sizeof text, "%llu",
+                         static_cast<unsigned long long> (
+                           value.unsignedValue));
+      break;
+
+    case ArgumentType::floatingPoint:
+      // JSON has no infinities or NaNs.
+      if (!isfinite (value.floatValue))
+        Put ("null", 4);
+      else
+        length = snprintf (text, sizeof text, "%.17g", value.floatValue);
+      break;
+
+    case ArgumentType::boolean:
+      if (value.unsignedValue)
+        Put ("true", 4);
+      else
+        Put ("false", 5);
+      break;
+
+    case ArgumentType::character:
+    case ArgumentType::string:
+      PutString (value.text, value.textLength);
+      break;
+
+    case ArgumentType::pointer:
+      length = snprintf (text, sizeof text, "\"0x%llx\"",
+                         static_cast<unsigned long long> (
+                           value.unsignedValue));
+      break;
+
+    case ArgumentType::id:
+      length = snprintf (text, sizeof text, "\"%016llx\"",
+                         static_cast<unsigned long long> (
+                           value.unsignedValue));
+      break;
+    }
+
+  if (length > 0)
+    Put (text, length);
+}
+
+
+}
+}
+}
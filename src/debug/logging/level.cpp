@@ -0,0 +1,57 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <atomic>
+#include <type_traits>
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+namespace detail {
+
+
+// Until someone says otherwise, everything goes through.
+std::atomic<unsigned> enabledLevels (
+  static_cast<std::underlying_type<Level>::type> (Level::all));
+
+
+}
+
+const char *
+GetLevelName (Level level)
+{
+  switch (level)
+    {
+    case Level::info:
+      return "info";
+    case Level::success:
+      return "success";
+    case Level::warning:
+      return "warning";
+    case Level::error:
+      return "error";
+    default:
+      return "none";
+    }
+}
+
+}
+}
+}
@@ -72,17 +72,25 @@ operator<< (std::ostream &out, const SetLevel manip)
 }
 
 std::ostream &
-operator<< (std::ostream &out, const LockType)
+operator<< (std::ostream &out, const SetLogging &manip)
 {
   StreamBuffer *buf = dynamic_cast<StreamBuffer *> (out.rdbuf ());
   if (buf)
     {
-      while (buf->IsLocked ()); // Loop infinitely until we can lock.
-      buf->Lock ();
+      buf->SetFile (manip.file);
+      buf->SetLine (manip.line);
+      buf->SetLevel (manip.level);
     }
   return out;
 }
 
+std::ostream &
+operator<< (std::ostream &out, const LockType)
+{
+  // Every thread has its own stream, so there's nothing to lock.
+  return out;
+}
+
 }
 }
 }
@@ -0,0 +1,128 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "hummstrummengine.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+namespace {
+
+// Every call site that has let a message through, newest first.  Call sites
+// are static, so they are never taken out of the list.
+atomic<CallSite *> callSites (nullptr);
+
+void
+writeSummary (ostream &out, uint64_t count)
+{
+  out << "Suppressed " << count << (count == 1 ? " message" : " messages")
+      << " from this call site.";
+}
+
+// Remembers where the messages of a call site go, and lists the call site the
+// first time a message passes.
+void
+watch (CallSite &site, Dispatcher &dispatcher, const Suppressed &summary)
+{
+  if (site.dispatcher.load (memory_order_relaxed) != &dispatcher)
+    site.dispatcher.store (&dispatcher, memory_order_relaxed);
+
+  if (site.listed.load (memory_order_relaxed) ||
+      site.listed.exchange (true, memory_order_relaxed))
+    return;
+
+  // Only this thread writes these, and the release below publishes them.
+  site.file = summary.file;
+  site.line = summary.line;
+  site.level = summary.level;
+  CallSite *head = callSites.load (memory_order_relaxed);
+  do
+    site.next = head;
+  while (!callSites.compare_exchange_weak (head, &site, memory_order_release,
+                                           memory_order_relaxed));
+}
+
+}
+
+
+ostream &
+operator<< (ostream &out, const Suppressed &summary)
+{
+  StreamBuffer *buf = dynamic_cast<StreamBuffer *> (out.rdbuf ());
+  if (buf)
+    watch (*summary.site, buf->GetDispatcher (), summary);
+
+  if (summary.count != 0)
+    {
+      out << SetLogging (summary.file, summary.line, summary.level);
+      writeSummary (out, summary.count);
+      out << flush;
+    }
+  return out;
+}
+
+void
+ReportSuppressed (Dispatcher &dispatcher)
+{
+  for (CallSite *site = callSites.load (memory_order_acquire); site;
+       site = site->next)
+    {
+      if (site->dispatcher.load (memory_order_relaxed) != &dispatcher ||
+          site->suppressed.load (memory_order_relaxed) == 0)
+        continue;
+      uint64_t count = site->suppressed.exchange (0, memory_order_relaxed);
+      if (count == 0)
+        continue;
+
+      uint64_t now = GetTimestamp ();
+      site->lastSummary.store (now, memory_order_relaxed);
+      ostringstream text;
+      writeSummary (text, count);
+      string message = text.str ();
+      dispatcher.Send (Record (now, GetThreadNumber (), site->file, site->line,
+                               site->level, message.data (),
+                               message.size ()));
+    }
+}
+
+void
+ForgetDispatcher (Dispatcher &dispatcher)
+{
+  for (CallSite *site = callSites.load (memory_order_acquire); site;
+       site = site->next)
+    {
+      Dispatcher *expected = &dispatcher;
+      site->dispatcher.compare_exchange_strong (expected, nullptr,
+                                                memory_order_relaxed);
+    }
+}
+
+
+}
+}
+}
@@ -0,0 +1,329 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+#  include <io.h>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#else
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+namespace {
+
+using binarylog::maxVarint;
+using binarylog::PutVarint;
+using binarylog::Zigzag;
+
+/// Each entry in the ring starts with its size.  This size marks the rest of
+/// the ring as unused, because the next entry didn't fit there.
+const uint32_t PADDING = 0xffffffffu;
+
+/// The longest a file name or format string in the ring may be.
+const size_t MAX_NAME = 256;
+
+// Writes a whole buffer to a file descriptor.  Only uses async-signal-safe
+// calls.
+bool
+writeAll (int file, const char *data, size_t length)
+{
+  while (length != 0)
+    {
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+      int written = _write (file, data, static_cast<unsigned> (length));
+#else
+      ssize_t written = write (file, data, length);
+      if (written < 0 && errno == EINTR)
+        continue;
+#endif
+      if (written <= 0)
+        return false;
+      data += written;
+      length -= static_cast<size_t> (written);
+    }
+  return true;
+}
+
+}
+
+RingBufferBackend::RingBufferBackend (Level levels, size_t capacity)
+  : Backend (levels),
+    ring (),
+    scratch (),
+    mask (0),
+    maxEntry (0),
+    head (0),
+    tail (0)
+{
+  // Round the capacity up to a power of two, so that positions can be turned
+  // into offsets with a mask even after they wrap around.
+  size_t size = 4096;
+  while (size < capacity)
+    size <<= 1;
+  mask = size - 1;
+  maxEntry = size / 4 < 65536 ? size / 4 : 65536;
+
+  ring.reset (new char[size]);
+  // Touch every page now, so that the first lap around the ring doesn't take
+  // page faults.
+  memset (ring.get (), 0, size);
+  // A dump from a signal handler can't allocate.
+  scratch.reset (new char[maxEntry]);
+}
+
+RingBufferBackend::~RingBufferBackend ()
+{
+}
+
+void
+RingBufferBackend::operator() (const Record &record)
+{
+  // Should we even keep this level?
+  if ((record.level & acceptLevels) == Level::none)
+    return;
+
+  bool unformatted = !record.message && record.format;
+  const char *body = unformatted ? record.arguments : record.message;
+  size_t bodyLength = unformatted ? record.argumentsLength :
+                                    record.messageLength;
+
+  // Every entry is self-contained: it names its file (and format string) as
+  // id 0 before the message that uses them.
+  size_t fileLength = strlen (record.file);
+  if (fileLength > MAX_NAME)
+    fileLength = MAX_NAME;
+  char fileHead[2 + maxVarint];
+  size_t fileHeadLength = 0;
+  fileHead[fileHeadLength++] = static_cast<char> (
+    binarylog::RecordType::fileName);
+  fileHeadLength += PutVarint (fileHead + fileHeadLength, 1 + fileLength);
+  fileHead[fileHeadLength++] = 0;
+
+  size_t formatLength = 0;
+  char formatHead[2 + maxVarint];
+  size_t formatHeadLength = 0;
+  if (unformatted)
+    {
+      formatLength = strlen (record.format);
+      if (formatLength > MAX_NAME)
+        formatLength = MAX_NAME;
+      formatHead[formatHeadLength++] = static_cast<char> (
+        binarylog::RecordType::formatString);
+      formatHeadLength += PutVarint (formatHead + formatHeadLength,
+                                     1 + formatLength);
+      formatHead[formatHeadLength++] = 0;
+    }
+
+  char fields[5 * maxVarint + 1];
+  size_t fieldsLength = 0;
+  fieldsLength += PutVarint (fields + fieldsLength,
+                           Zigzag (static_cast<int64_t> (record.timestamp)));
+  fieldsLength += PutVarint (fields + fieldsLength, record.thread);
+  fieldsLength += PutVarint (fields + fieldsLength, 0);
+  fieldsLength += PutVarint (fields + fieldsLength, record.line);
+  fields[fieldsLength++] = static_cast<char> (record.level);
+  if (unformatted)
+    fieldsLength += PutVarint (fields + fieldsLength, 0);
+
+  // Cut the message short if it's too big.
+  size_t fixed = sizeof (uint32_t) + fileHeadLength + fileLength +
+                 formatHeadLength + formatLength + 1 + maxVarint + fieldsLength;
+  if (fixed + bodyLength > maxEntry)
+    bodyLength = maxEntry - fixed;
+
+  char messageHead[1 + maxVarint];
+  size_t messageHeadLength = 0;
+  messageHead[messageHeadLength++] = static_cast<char> (
+    unformatted ? binarylog::RecordType::unformattedMessage :
+                  binarylog::RecordType::message);
+  messageHeadLength += PutVarint (messageHead + messageHeadLength,
+                                  fieldsLength + bodyLength);
+
+  uint32_t entryLength = static_cast<uint32_t> (
+    fileHeadLength + fileLength + formatHeadLength + formatLength +
+    messageHeadLength + fieldsLength + bodyLength);
+  size_t total = sizeof entryLength + entryLength;
+
+  // Entries never wrap around the end of the ring.
+  size_t size = mask + 1;
+  size_t position = head.load (memory_order_relaxed);
+  size_t room = size - (position & mask);
+  size_t start = room < total ? position + room : position;
+  size_t end = start + total;
+
+  // Make room by dropping the oldest entries.  Move the tail before
+  // overwriting anything, so a dump never reads an entry that is being
+  // overwritten.
+  size_t oldest = tail.load (memory_order_relaxed);
+  while (end - oldest > size && oldest != position)
+    {
+      size_t left = size - (oldest & mask);
+      uint32_t length = PADDING;
+      if (left >= sizeof length)
+        memcpy (&length, ring.get () + (oldest & mask), sizeof length);
+      oldest += length == PADDING ? left : sizeof length + length;
+    }
+  if (end - oldest > size)
+    oldest = start;
+  tail.store (oldest, memory_order_release);
+
+  if (start != position && room >= sizeof PADDING)
+    memcpy (ring.get () + (position & mask), &PADDING, sizeof PADDING);
+
+  char *out = ring.get () + (start & mask);
+  memcpy (out, &entryLength, sizeof entryLength);
+  out += sizeof entryLength;
+  memcpy (out, fileHead, fileHeadLength);
+  out += fileHeadLength;
+  memcpy (out, record.file, fileLength);
+  out += fileLength;
+  if (unformatted)
+    {
+      memcpy (out, formatHead, formatHeadLength);
+      out += formatHeadLength;
+      memcpy (out, record.format, formatLength);
+      out += formatLength;
+    }
+  memcpy (out, messageHead, messageHeadLength);
+  out += messageHeadLength;
+  memcpy (out, fields, fieldsLength);
+  out += fieldsLength;
+  if (bodyLength != 0)
+    memcpy (out, body, bodyLength);
+
+  head.store (end, memory_order_release);
+}
+
+bool
+RingBufferBackend::AcceptsUnformatted () const
+{
+  return true;
+}
+
+template <typename WriteT>
+void
+RingBufferBackend::Walk (char *copy, WriteT write) const
+{
+  // The timestamps in the ring are already relative to 1970, so the epoch is
+  // 0.
+  char header[sizeof binarylog::magic + 1 + 2 * maxVarint];
+  size_t n = 0;
+  memcpy (header, binarylog::magic, sizeof binarylog::magic);
+  n += sizeof binarylog::magic;
+  header[n++] = static_cast<char> (binarylog::version);
+  n += PutVarint (header + n, binarylog::nanosecondTicks);
+  n += PutVarint (header + n, 0);
+  if (!write (header, n))
+    return;
+
+  // The writer moves the tail past an entry before it overwrites it, and the
+  // head after it has finished a new one.  Like a seqlock, copy each entry out
+  // first and then check that the tail hasn't passed it; if it has, the copy
+  // may be torn, so skip to the oldest entry that is still whole.
+  size_t size = mask + 1;
+  size_t position = tail.load (memory_order_acquire);
+  size_t end = head.load (memory_order_acquire);
+  while (position != end)
+    {
+      size_t left = size - (position & mask);
+      uint32_t length = PADDING;
+      if (left >= sizeof length)
+        memcpy (&length, ring.get () + (position & mask), sizeof length);
+      bool fits = length != PADDING && length <= maxEntry &&
+                  left >= sizeof length + length &&
+                  end - position >= sizeof length + length;
+      if (fits)
+        memcpy (copy, ring.get () + (position & mask) + sizeof length, length);
+
+      atomic_thread_fence (memory_order_acquire);
+      size_t oldest = tail.load (memory_order_relaxed);
+      if (static_cast<ptrdiff_t> (oldest - position) > 0)
+        {
+          if (static_cast<ptrdiff_t> (end - oldest) <= 0)
+            return;
+          position = oldest;
+          continue;
+        }
+
+      if (length == PADDING)
+        {
+          position += left;
+          continue;
+        }
+      if (!fits || !write (copy, length))
+        return;
+      position += sizeof length + length;
+    }
+}
+
+
+void
+RingBufferBackend::Dump (ostream &out) const
+{
+  unique_ptr<char[]> copy (new char[maxEntry]);
+  Walk (copy.get (), [&out](const char *data, size_t length) -> bool {
+      return static_cast<bool> (out.write (data, length));
+    });
+}
+
+bool
+RingBufferBackend::DumpToFile (const char *path) const
+{
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  int file = _open (path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+                    _S_IREAD | _S_IWRITE);
+#else
+  int file = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+  if (file < 0)
+    return false;
+
+  bool good = true;
+  Walk (scratch.get (), [file, &good](const char *data, size_t length) -> bool {
+      good = writeAll (file, data, length);
+      return good;
+    });
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  _close (file);
+#else
+  close (file);
+#endif
+  return good;
+}
+
+
+}
+}
+}
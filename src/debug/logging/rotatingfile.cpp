@@ -0,0 +1,363 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#ifdef HUMMSTRUMM_ENGINE_HAVE_ZLIB
+#  include <zlib.h>
+#endif
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+namespace {
+
+/// Closes every segment.  It is always right after the last message.
+const char END_TAG[] = "</log>\n";
+const size_t END_TAG_LENGTH = sizeof END_TAG - 1;
+
+// Appends a number in decimal.
+void
+appendNumber (string &out, uint64_t value)
+{
+  char digits[20];
+  size_t n = 0;
+  do
+    {
+      digits[n++] = static_cast<char> ('0' + value % 10);
+      value /= 10;
+    }
+  while (value != 0);
+  while (n != 0)
+    out += digits[--n];
+}
+
+#ifdef HUMMSTRUMM_ENGINE_HAVE_ZLIB
+// Compresses a file into file.gz, and removes the original if that worked.
+void
+compressFile (const string &name)
+{
+  ifstream in (name, ios_base::in | ios_base::binary);
+  gzFile out = gzopen ((name + ".gz").c_str (), "wb");
+  if (!in || !out)
+    {
+      if (out)
+        gzclose (out);
+      return;
+    }
+
+  vector<char> buffer (1 << 16);
+  bool good = true;
+  while (good && in)
+    {
+      in.read (buffer.data (), buffer.size ());
+      unsigned count = static_cast<unsigned> (in.gcount ());
+      if (count != 0 &&
+          gzwrite (out, buffer.data (), count) != static_cast<int> (count))
+        good = false;
+    }
+  if (gzclose (out) != Z_OK)
+    good = false;
+  in.close ();
+
+  if (good)
+    remove (name.c_str ());
+  else
+    remove ((name + ".gz").c_str ());
+}
+#endif
+
+}
+
+RotatingFileBackend::RotatingFileBackend (Level levels, string baseName,
+                                          size_t segmentSize,
+                                          chrono::nanoseconds maxAge,
+                                          bool compress)
+  : Backend (levels),
+    baseName (baseName),
+    segmentSize (segmentSize),
+    maxAge (maxAge.count () > 0 ? static_cast<uint64_t> (maxAge.count ()) : 0),
+    segment (0),
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+    file (INVALID_HANDLE_VALUE),
+    fileMapping (nullptr),
+#else
+    file (-1),
+#endif
+    mapping (nullptr),
+    mappingSize (0),
+    used (0),
+    segmentStart (0),
+    timestamps (),
+    text (),
+#ifdef HUMMSTRUMM_ENGINE_HAVE_ZLIB
+    compress (compress),
+#else
+    compress (false),
+#endif
+    toCompress (),
+    stopping (false)
+{
+  (void) compress;
+  text.reserve (512);
+  if (!OpenSegment (0))
+    throw runtime_error ("Could not create log file " + GetSegmentName (0) +
+                         ".");
+
+  if (this->compress)
+    compressor = thread (&RotatingFileBackend::CompressSegments, this);
+}
+
+RotatingFileBackend::~RotatingFileBackend ()
+{
+  CloseSegment ();
+
+  if (compressor.joinable ())
+    {
+      {
+        lock_guard<mutex> lock (compressMutex);
+        stopping = true;
+      }
+      compressWake.notify_one ();
+      compressor.join ();
+    }
+}
+
+void
+RotatingFileBackend::operator() (const Record &record)
+{
+  // Should we even print on this level?
+  if ((record.level & acceptLevels) == Level::none)
+    return;
+
+  // XML format, the same as FileBackend.  Outputs <message> element.
+  text.clear ();
+  text += "<message timestamp=\"";
+  text += timestamps.Format (record.timestamp);
+  text += "\" thread=\"";
+  appendNumber (text, record.thread);
+  text += "\" file=\"";
+  text += record.file;
+  text += "\" line=\"";
+  appendNumber (text, record.line);
+  text += "\" level=\"";
+  text += GetLevelName (record.level);
+  text += "\">\n";
+  text.append (record.message, record.messageLength);
+  text += "\n</message>\n";
+
+  bool tooOld = maxAge != 0 && record.timestamp > segmentStart &&
+                record.timestamp - segmentStart >= maxAge;
+  bool tooBig = used + text.size () + END_TAG_LENGTH > mappingSize;
+  if (!mapping || tooOld || tooBig)
+    {
+      CloseSegment ();
+      // If we can't make a new segment, this message is lost; we'll try again
+      // with the next one.
+      if (!OpenSegment (text.size ()))
+        return;
+    }
+
+  Append (text.data (), text.size ());
+}
+
+void
+RotatingFileBackend::Rotate ()
+{
+  CloseSegment ();
+  OpenSegment (0);
+}
+
+string
+RotatingFileBackend::GetSegmentName (unsigned number) const
+{
+  return baseName + "." + to_string (number) + ".log";
+}
+
+bool
+RotatingFileBackend::OpenSegment (size_t messageSize)
+{
+  segmentStart = GetTimestamp ();
+
+  string header = "<?xml version=\"1.1\" encoding=\"utf-8\"?>\n\n"
+                  "<log timestamp=\"";
+  header += timestamps.Format (segmentStart);
+  header += "\">\n";
+
+  size_t size = header.size () + messageSize + END_TAG_LENGTH;
+  if (size < segmentSize)
+    size = segmentSize;
+  string name = GetSegmentName (segment);
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  HANDLE handle = CreateFileA (name.c_str (), GENERIC_READ | GENERIC_WRITE,
+                               FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE)
+    return false;
+  ULARGE_INTEGER length;
+  length.QuadPart = size;
+  HANDLE mappingHandle = CreateFileMappingA (handle, nullptr, PAGE_READWRITE,
+                                             length.HighPart, length.LowPart,
+                                             nullptr);
+  void *view = mappingHandle ?
+               MapViewOfFile (mappingHandle, FILE_MAP_WRITE, 0, 0, size) :
+               nullptr;
+  if (!view)
+    {
+      if (mappingHandle)
+        CloseHandle (mappingHandle);
+      CloseHandle (handle);
+      return false;
+    }
+  file = handle;
+  fileMapping = mappingHandle;
+#else
+  int descriptor = open (name.c_str (), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (descriptor < 0)
+    return false;
+  void *view = MAP_FAILED;
+  if (ftruncate (descriptor, static_cast<off_t> (size)) == 0)
+    view = mmap (nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                 descriptor, 0);
+  if (view == MAP_FAILED)
+    {
+      close (descriptor);
+      unlink (name.c_str ());
+      return false;
+    }
+  file = descriptor;
+#endif
+
+  mapping = static_cast<char *> (view);
+  mappingSize = size;
+  used = 0;
+
+  // Whitespace after the end tag is still well-formed XML, so the segment can
+  // be read no matter when we stop writing it.  This also touches every page
+  // now instead of while logging.
+  memset (mapping, ' ', mappingSize);
+  mapping[mappingSize - 1] = '\n';
+  Append (header.data (), header.size ());
+  return true;
+}
+
+void
+RotatingFileBackend::CloseSegment ()
+{
+  if (!mapping)
+    return;
+
+  // The end tag is already there.
+  size_t length = used + END_TAG_LENGTH;
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  UnmapViewOfFile (mapping);
+  CloseHandle (fileMapping);
+  LARGE_INTEGER end;
+  end.QuadPart = static_cast<LONGLONG> (length);
+  if (SetFilePointerEx (file, end, nullptr, FILE_BEGIN))
+    SetEndOfFile (file);
+  CloseHandle (file);
+  file = INVALID_HANDLE_VALUE;
+  fileMapping = nullptr;
+#else
+  munmap (mapping, mappingSize);
+  if (ftruncate (file, static_cast<off_t> (length)) != 0)
+    {
+      // The rest is still spaces, so the segment is fine as it is.
+    }
+  close (file);
+  file = -1;
+#endif
+
+  mapping = nullptr;
+  mappingSize = 0;
+  used = 0;
+
+  if (compress)
+    {
+      {
+        lock_guard<mutex> lock (compressMutex);
+        toCompress.push_back (GetSegmentName (segment));
+      }
+      compressWake.notify_one ();
+    }
+  ++segment;
+}
+
+void
+RotatingFileBackend::Append (const char *data, size_t length)
+{
+  memcpy (mapping + used, data, length);
+  used += length;
+  memcpy (mapping + used, END_TAG, END_TAG_LENGTH);
+}
+
+void
+RotatingFileBackend::CompressSegments ()
+{
+#ifdef HUMMSTRUMM_ENGINE_HAVE_ZLIB
+  unique_lock<mutex> lock (compressMutex);
+  for (;;)
+    {
+      compressWake.wait (lock, [this]() {
+          return stopping || !toCompress.empty ();
+        });
+      if (toCompress.empty ())
+        break;
+
+      vector<string> names;
+      names.swap (toCompress);
+      lock.unlock ();
+      for (auto i = names.begin (); i != names.end (); ++i)
+        compressFile (*i);
+      lock.lock ();
+    }
+#endif
+}
+
+
+}
+}
+}
@@ -0,0 +1,434 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "hummstrummengine.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+namespace {
+
+const char MAGIC[4] = { 'H', 'S', 'S', 'M' };
+const uint32_t VERSION = 1;
+
+/// The header is padded to a cache line, so the slots start on one.
+const size_t HEADER_SIZE = 64;
+
+// The start of the shared memory.  Both sides of the ring must be built with
+// the same layout; the version says which one that is.
+struct Header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotSize;
+    atomic<uint64_t> head;
+    atomic<uint32_t> closed;
+};
+
+// The start of each slot.  The file name, the format string, and the message or
+// arguments follow it.
+struct Slot
+{
+    atomic<uint64_t> sequence;
+    uint64_t timestamp;
+    uint32_t thread;
+    uint32_t line;
+    uint32_t level;
+    uint32_t unformatted;
+    uint32_t fileLength;
+    uint32_t formatLength;
+    uint32_t bodyLength;
+};
+
+static_assert (sizeof (Header) <= HEADER_SIZE,
+               "The shared memory header must fit in its padding.");
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+// Kernel object names can't start with a slash like POSIX ones must.
+string
+mappingName (const string &name)
+{
+  return name.size () != 0 && name[0] == '/' ? name.substr (1) : name;
+}
+#endif
+
+// Copies at most room bytes of a string, and takes what it used from room.
+size_t
+fit (size_t length, size_t &room)
+{
+  if (length > room)
+    length = room;
+  room -= length;
+  return length;
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hummstrummengine::debug::logging::SharedMemoryBackend implementation
+
+SharedMemoryBackend::SharedMemoryBackend (Level levels, string name,
+                                          size_t slots, size_t slotSize)
+  : Backend (levels),
+    name (name),
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+    mappingHandle (nullptr),
+#endif
+    mapping (nullptr),
+    mappingSize (0),
+    mask (0),
+    slotSize (0),
+    head (0)
+{
+  size_t count = 1;
+  while (count < slots)
+    count <<= 1;
+  mask = count - 1;
+  this->slotSize = slotSize < 128 ? 128 : (slotSize + 63) & ~size_t (63);
+  mappingSize = HEADER_SIZE + count * this->slotSize;
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  ULARGE_INTEGER length;
+  length.QuadPart = mappingSize;
+  mappingHandle = CreateFileMappingA (INVALID_HANDLE_VALUE, nullptr,
+                                      PAGE_READWRITE, length.HighPart,
+                                      length.LowPart,
+                                      mappingName (name).c_str ());
+  void *view = mappingHandle ?
+               MapViewOfFile (mappingHandle, FILE_MAP_WRITE, 0, 0,
+                              mappingSize) :
+               nullptr;
+  if (!view)
+    {
+      if (mappingHandle)
+        CloseHandle (mappingHandle);
+      throw runtime_error ("Could not create the shared memory " + name + ".");
+    }
+#else
+  // Replace anything left over from a run that crashed.
+  shm_unlink (name.c_str ());
+  int descriptor = shm_open (name.c_str (), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (descriptor < 0)
+    throw runtime_error ("Could not create the shared memory " + name + ".");
+  void *view = MAP_FAILED;
+  if (ftruncate (descriptor, static_cast<off_t> (mappingSize)) == 0)
+    view = mmap (nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                 descriptor, 0);
+  close (descriptor);
+  if (view == MAP_FAILED)
+    {
+      shm_unlink (name.c_str ());
+      throw runtime_error ("Could not map the shared memory " + name + ".");
+    }
+#endif
+
+  mapping = static_cast<char *> (view);
+  // Touch every page now instead of while logging.
+  memset (mapping, 0, mappingSize);
+
+  Header *header = new (mapping) Header;
+  header->version = VERSION;
+  header->slotCount = static_cast<uint32_t> (count);
+  header->slotSize = static_cast<uint32_t> (this->slotSize);
+  header->head.store (0, memory_order_relaxed);
+  header->closed.store (0, memory_order_relaxed);
+  for (size_t i = 0; i < count; ++i)
+    {
+      Slot *slot = new (mapping + HEADER_SIZE + i * this->slotSize) Slot;
+      slot->sequence.store (0, memory_order_relaxed);
+    }
+  // Readers check the magic last, so they never see a half made header.
+  atomic_thread_fence (memory_order_release);
+  memcpy (header->magic, MAGIC, sizeof MAGIC);
+}
+
+SharedMemoryBackend::~SharedMemoryBackend ()
+{
+  reinterpret_cast<Header *> (mapping)->closed.store (1, memory_order_release);
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  UnmapViewOfFile (mapping);
+  CloseHandle (mappingHandle);
+#else
+  munmap (mapping, mappingSize);
+  // Readers that are attached keep their mapping until they detach.
+  shm_unlink (name.c_str ());
+#endif
+}
+
+void
+SharedMemoryBackend::operator() (const Record &record)
+{
+  // Should we even publish this level?
+  if ((record.level & acceptLevels) == Level::none)
+    return;
+
+  bool unformatted = !record.message && record.format;
+  const char *body = unformatted ? record.arguments : record.message;
+  size_t room = slotSize - sizeof (Slot);
+  size_t fileLength = fit (strlen (record.file), room);
+  size_t formatLength = unformatted ? fit (strlen (record.format), room) : 0;
+  size_t bodyLength = fit (unformatted ? record.argumentsLength :
+                                         record.messageLength, room);
+
+  // We're the only writer, so nothing but readers can see the slot.  Mark it
+  // as being written before touching it, and as done after.
+  Slot *slot = reinterpret_cast<Slot *> (mapping + HEADER_SIZE +
+                                         (head & mask) * slotSize);
+  slot->sequence.store (2 * head + 1, memory_order_relaxed);
+  atomic_thread_fence (memory_order_release);
+
+  slot->timestamp = record.timestamp;
+  slot->thread = record.thread;
+  slot->line = record.line;
+  slot->level = static_cast<uint32_t> (record.level);
+  slot->unformatted = unformatted;
+  slot->fileLength = static_cast<uint32_t> (fileLength);
+  slot->formatLength = static_cast<uint32_t> (formatLength);
+  slot->bodyLength = static_cast<uint32_t> (bodyLength);
+  char *out = reinterpret_cast<char *> (slot + 1);
+  memcpy (out, record.file, fileLength);
+  out += fileLength;
+  if (formatLength != 0)
+    memcpy (out, record.format, formatLength);
+  out += formatLength;
+  if (bodyLength != 0)
+    memcpy (out, body, bodyLength);
+
+  slot->sequence.store (2 * head + 2, memory_order_release);
+  ++head;
+  reinterpret_cast<Header *> (mapping)->head.store (head,
+                                                    memory_order_release);
+}
+
+bool
+SharedMemoryBackend::AcceptsUnformatted () const
+{
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hummstrummengine::debug::logging::SharedMemoryReader implementation
+
+SharedMemoryReader::SharedMemoryReader (string name, size_t backlog)
+  :
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+    mappingHandle (nullptr),
+#endif
+    mapping (nullptr),
+    mappingSize (0),
+    mask (0),
+    slotSize (0),
+    position (0),
+    missed (0)
+{
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  mappingHandle = OpenFileMappingA (FILE_MAP_READ, FALSE,
+                                    mappingName (name).c_str ());
+  const void *view = mappingHandle ?
+                     MapViewOfFile (mappingHandle, FILE_MAP_READ, 0, 0, 0) :
+                     nullptr;
+  if (!view)
+    {
+      if (mappingHandle)
+        CloseHandle (mappingHandle);
+      throw runtime_error ("Could not open the shared memory " + name + ".");
+    }
+  MEMORY_BASIC_INFORMATION information;
+  mappingSize = VirtualQuery (view, &information, sizeof information) ?
+                information.RegionSize : 0;
+#else
+  int descriptor = shm_open (name.c_str (), O_RDONLY, 0);
+  if (descriptor < 0)
+    throw runtime_error ("Could not open the shared memory " + name + ".");
+  struct stat status;
+  const void *view = MAP_FAILED;
+  if (fstat (descriptor, &status) == 0 &&
+      static_cast<size_t> (status.st_size) >= HEADER_SIZE)
+    {
+      mappingSize = static_cast<size_t> (status.st_size);
+      view = mmap (nullptr, mappingSize, PROT_READ, MAP_SHARED, descriptor,
+                   0);
+    }
+  close (descriptor);
+  if (view == MAP_FAILED)
+    throw runtime_error ("Could not map the shared memory " + name + ".");
+#endif
+  mapping = static_cast<const char *> (view);
+
+  // The writer sets the magic last, so the rest of the header is only read
+  // once the magic is there.
+  const Header *header = reinterpret_cast<const Header *> (mapping);
+  bool made = mappingSize >= HEADER_SIZE &&
+    memcmp (header->magic, MAGIC, sizeof MAGIC) == 0;
+  atomic_thread_fence (memory_order_acquire);
+  size_t count = made ? header->slotCount : 0;
+  slotSize = made ? header->slotSize : 0;
+  if (!made || header->version != VERSION || count == 0 ||
+      (count & (count - 1)) ||
+      slotSize < sizeof (Slot) || slotSize % 64 != 0 ||
+      mappingSize < HEADER_SIZE + count * slotSize)
+    {
+      Detach ();
+      throw runtime_error ("The shared memory " + name + " isn't a log of a "
+                           "version this reader understands.");
+    }
+  mask = count - 1;
+  slot.resize (slotSize);
+
+  uint64_t published = header->head.load (memory_order_acquire);
+  if (backlog > count)
+    backlog = count;
+  position = published < backlog ? 0 : published - backlog;
+}
+
+SharedMemoryReader::~SharedMemoryReader ()
+{
+  Detach ();
+}
+
+bool
+SharedMemoryReader::Next (Record &record)
+{
+  const Header *header = reinterpret_cast<const Header *> (mapping);
+  uint64_t count = mask + 1;
+
+  for (;;)
+    {
+      uint64_t published = header->head.load (memory_order_acquire);
+      if (position >= published)
+        return false;
+      if (published - position > count)
+        {
+          // The writer lapped us.  Skip what was overwritten.
+          missed += published - count - position;
+          position = published - count;
+        }
+
+      const Slot *source = reinterpret_cast<const Slot *> (
+        mapping + HEADER_SIZE + (position & mask) * slotSize);
+      uint64_t expected = 2 * position + 2;
+      if (source->sequence.load (memory_order_acquire) == expected)
+        {
+          // Copy the slot, then make sure it wasn't rewritten while we did.
+          Slot fields;
+          fields.timestamp = source->timestamp;
+          fields.thread = source->thread;
+          fields.line = source->line;
+          fields.level = source->level;
+          fields.unformatted = source->unformatted;
+          fields.fileLength = source->fileLength;
+          fields.formatLength = source->formatLength;
+          fields.bodyLength = source->bodyLength;
+          size_t room = slotSize - sizeof (Slot);
+          size_t fileLength = fit (fields.fileLength, room);
+          size_t formatLength = fit (fields.formatLength, room);
+          size_t bodyLength = fit (fields.bodyLength, room);
+          memcpy (slot.data (), source + 1,
+                  fileLength + formatLength + bodyLength);
+          atomic_thread_fence (memory_order_acquire);
+
+          if (source->sequence.load (memory_order_relaxed) == expected)
+            {
+              ++position;
+
+              const char *data = slot.data ();
+              file.assign (data, fileLength);
+              record.timestamp = fields.timestamp;
+              record.time = static_cast<time_t> (
+                fields.timestamp / binarylog::nanosecondTicks);
+              record.thread = fields.thread;
+              record.file = file.c_str ();
+              record.line = fields.line;
+              record.level = static_cast<Level> (fields.level);
+
+              const char *body = data + fileLength + formatLength;
+              if (fields.unformatted)
+                {
+                  format.assign (data + fileLength, formatLength);
+                  record.format = format.c_str ();
+                  record.arguments = body;
+                  record.argumentsLength = bodyLength;
+                  FormatDeferred (formatted, record.format, record.arguments,
+                                  record.argumentsLength);
+                  record.message = formatted.data ();
+                  record.messageLength = formatted.size ();
+                }
+              else
+                {
+                  record.message = body;
+                  record.messageLength = bodyLength;
+                  record.format = nullptr;
+                  record.arguments = nullptr;
+                  record.argumentsLength = 0;
+                }
+              return true;
+            }
+        }
+
+      // The slot was overwritten before we could read it.
+      ++missed;
+      ++position;
+    }
+}
+
+bool
+SharedMemoryReader::IsClosed () const
+{
+  return reinterpret_cast<const Header *> (mapping)->closed.load (
+    memory_order_acquire) != 0;
+}
+
+void
+SharedMemoryReader::Detach ()
+{
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  UnmapViewOfFile (mapping);
+  CloseHandle (mappingHandle);
+#else
+  munmap (const_cast<char *> (mapping), mappingSize);
+#endif
+}
+
+
+}
+}
+}
@@ -24,6 +24,7 @@
 #include <sstream>
 #include <vector>
 #include <memory>
+#include <utility>
 
 using namespace std;
 
@@ -32,31 +33,76 @@ namespace debug {
 namespace logging {
 
 
-StreamBuffer::StreamBuffer (vector<shared_ptr<Backend>> backends)
-  : backends (backends),
+StreamBuffer::StreamBuffer (vector<shared_ptr<Backend>> backends,
+                            unique_ptr<AsyncQueue> queue)
+  : stringbuf (ios_base::out),
+    dispatcher (make_shared<Dispatcher> (backends, std::move (queue))),
     file ("(no file)"),
     line (0),
     level (Level::none),
-    lock (false)
+    arguments (),
+    fields ()
 {
+  arguments.reserve (256);
+  fields.reserve (128);
+}
+
+StreamBuffer::StreamBuffer (shared_ptr<Dispatcher> dispatcher)
+  : stringbuf (ios_base::out),
+    dispatcher (dispatcher),
+    file ("(no file)"),
+    line (0),
+    level (Level::none),
+    arguments (),
+    fields ()
+{
+  arguments.reserve (256);
+  fields.reserve (128);
 }
 
 void
 StreamBuffer::SendToBackends ()
 {
-  time_t t = time (0);
-  string message = str ();
-  
-  for (auto i = backends.begin (); i != backends.end (); ++i)
+  // The message is everything that has been written to the put area.  Nothing
+  // is copied; the backends read it where it is.
+  Record record (GetTimestamp (), GetThreadNumber (), file, line, level,
+                 pbase () ? pbase () : "",
+                 static_cast<size_t> (pptr () - pbase ()));
+  AttachFields (record);
+
+  dispatcher->Send (record);
+}
+
+void
+StreamBuffer::SendArguments (const char *f, unsigned l, Level lev,
+                             const char *format)
+{
+  Record record (GetTimestamp (), GetThreadNumber (), f, l, lev, nullptr, 0);
+  record.format = format;
+  record.arguments = arguments.data ();
+  record.argumentsLength = arguments.size ();
+  AttachFields (record);
+
+  dispatcher->Send (record);
+  fields.clear ();
+}
+
+void
+StreamBuffer::AttachFields (Record &record)
+{
+  if (!fields.empty ())
     {
-      // Funny syntax here: first we dereference the iterator (that's the
-      // inner star), and then we dereference the smart pointer that's in
-      // the vector (leftmost star).  Then we call the @c operator() of that
-      // dereferenced backend.
-      (**i) (t, file, line, level, message);
+      record.fields = fields.data ();
+      record.fieldsLength = fields.size ();
     }
 }
 
+void
+StreamBuffer::Flush ()
+{
+  dispatcher->Flush ();
+}
+
 int
 StreamBuffer::sync ()
 {
@@ -64,18 +110,16 @@ StreamBuffer::sync ()
   int result = stringbuf::sync ();
   if (result == -1) return result;
   
-  // Now we flush to backends and clear our own string buffer.
-  //   --> Is this efficient?  Will the string make lots of allocations?
-  //       Can we set a default size, à la std::string's constructor that
-  //       takes an integer value for size?
+  // Now we flush to backends and clear our own string buffer.  Rewinding the
+  // put area keeps the storage we've already got for the next message.
   try
     {
       SendToBackends ();
-      str ("");
+      setp (pbase (), epptr ());
+      fields.clear ();
       file = "(no file)";
       line = 0;
       level = Level::none;
-      lock = false;
     }
   catch (...)
     {
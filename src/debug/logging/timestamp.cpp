@@ -0,0 +1,135 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace logging {
+
+namespace {
+
+const uint64_t NANOSECONDS_PER_SECOND = 1000000000u;
+
+// Where the monotonic clock was when the wall clock was read.
+struct Anchor
+{
+    chrono::steady_clock::time_point steady;
+    uint64_t wall;
+};
+
+Anchor
+readAnchor ()
+{
+  Anchor anchor;
+  anchor.steady = chrono::steady_clock::now ();
+  anchor.wall = chrono::duration_cast<chrono::nanoseconds> (
+    chrono::system_clock::now ().time_since_epoch ()).count ();
+  return anchor;
+}
+
+// The anchor is read the first time it's needed, so a timestamp taken
+// in another file's static constructor is already wall time.
+const Anchor &
+getAnchor ()
+{
+  static const Anchor anchor = readAnchor ();
+  return anchor;
+}
+
+atomic<unsigned> nextThreadNumber (1);
+HUMMSTRUMM_ENGINE_THREAD_LOCAL unsigned threadNumber = 0;
+
+// Writes count digits of value, most significant first.
+void
+putDigits (char *out, uint64_t value, size_t count)
+{
+  for (size_t i = count; i > 0; --i)
+    {
+      out[i - 1] = static_cast<char> ('0' + value % 10);
+      value /= 10;
+    }
+}
+
+}
+
+uint64_t
+GetTimestamp ()
+{
+  const Anchor &anchor = getAnchor ();
+  return anchor.wall + chrono::duration_cast<chrono::nanoseconds> (
+    chrono::steady_clock::now () - anchor.steady).count ();
+}
+
+unsigned
+GetThreadNumber ()
+{
+  if (threadNumber == 0)
+    threadNumber = nextThreadNumber.fetch_add (1, memory_order_relaxed);
+  return threadNumber;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hummstrummengine::debug::logging::TimestampFormatter implementation
+
+TimestampFormatter::TimestampFormatter ()
+  : second (0),
+    cached (false)
+{
+  text[0] = '\0';
+}
+
+const char *
+TimestampFormatter::Format (uint64_t timestamp)
+{
+  uint64_t now = timestamp / NANOSECONDS_PER_SECOND;
+  if (!cached || now != second)
+    {
+      // Use std::put_time eventually.  The first 19 characters are
+      // 2012-06-14T02:09:18.
+      time_t t = static_cast<time_t> (now);
+      tm broken;
+#ifdef _MSC_VER
+      gmtime_s (&broken, &t);
+#else
+      gmtime_r (&t, &broken);
+#endif
+      strftime (text, sizeof text, "%Y-%m-%dT%H:%M:%S", &broken);
+      text[19] = '.';
+      text[LENGTH - 1] = 'Z';
+      text[LENGTH] = '\0';
+      second = now;
+      cached = true;
+    }
+
+  putDigits (text + 20, timestamp % NANOSECONDS_PER_SECOND, 9);
+  return text;
+}
+
+
+}
+}
+}
@@ -0,0 +1,250 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+
+const size_t Metrics::maxMetrics;
+const size_t Metrics::maxThreads;
+const size_t Metrics::historyLength;
+const size_t Metrics::maxNameLength;
+
+namespace {
+
+// Everything here is constant initialized, because counters and gauges at
+// namespace scope can be constructed before any constructor here has run.
+
+/// A counter or gauge.
+struct Metric
+{
+  char name[Metrics::maxNameLength + 1];
+  MetricKind kind;
+  /// The frame the metric was made in.
+  uint64_t since;
+  /// The value of a gauge.
+  atomic<int64_t> value;
+  /// For a counter, its total when the last frame ended; for a gauge, its
+  /// value then.
+  atomic<int64_t> total;
+  /// The value of each frame, by the frame's number modulo the length.
+  atomic<int64_t> history[Metrics::historyLength];
+};
+
+/// The counters of one thread.
+struct ThreadCounters
+{
+  atomic<int64_t> counts[Metrics::maxMetrics];
+};
+
+detail::NameRegistry<Metric, Metrics::maxMetrics> metrics;
+
+detail::ThreadSlots<ThreadCounters, Metrics::maxThreads> threads;
+
+atomic<uint64_t> frame (0);
+
+/// This thread's counters, once it has counted.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL ThreadCounters *threadCounters = nullptr;
+/// Whether this thread shares its counters.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL bool sharedCounters = false;
+
+// Returns the number of the metric with a name, making it if there is none.
+size_t
+findMetric (const char *name, MetricKind kind)
+{
+  size_t found = metrics.Find (name, "metric", [kind](Metric &metric) {
+      metric.kind = kind;
+      metric.since = frame.load ();
+    });
+  if (metrics.entries[found].kind != kind)
+    throw invalid_argument (string ("The metric ") + name +
+                            " is already of another kind.");
+  return found;
+}
+
+int64_t
+getTotal (size_t metric)
+{
+  size_t counting = threads.GetUsed ();
+  int64_t total = 0;
+  for (size_t thread = 0; thread < counting; ++thread)
+    total += threads.slots[thread].counts[metric].load (memory_order_relaxed);
+  return total;
+}
+
+MetricHistory
+getHistory (size_t number, uint64_t ended)
+{
+  const Metric &metric = metrics.entries[number];
+  MetricHistory history;
+  history.name = metric.name;
+  history.kind = metric.kind;
+  history.total = metric.total.load (memory_order_relaxed);
+  uint64_t first = ended > Metrics::historyLength ?
+    ended - Metrics::historyLength : 0;
+  if (first < metric.since)
+    first = metric.since;
+  for (uint64_t frame = first; frame < ended; ++frame)
+    history.frames.push_back (
+      metric.history[frame % Metrics::historyLength].load (
+        memory_order_relaxed));
+  return history;
+}
+
+}
+
+void
+Metrics::EndFrame ()
+{
+  uint64_t ending = frame.load ();
+  size_t count = metrics.GetCount ();
+  for (size_t number = 0; number < count; ++number)
+    {
+      Metric &metric = metrics.entries[number];
+      int64_t value;
+      if (metric.kind == MetricKind::counter)
+        {
+          int64_t total = getTotal (number);
+          value = total - metric.total.load (memory_order_relaxed);
+          metric.total.store (total, memory_order_relaxed);
+        }
+      else
+        {
+          value = metric.value.load (memory_order_relaxed);
+          metric.total.store (value, memory_order_relaxed);
+        }
+      metric.history[ending % historyLength].store (value,
+                                                    memory_order_relaxed);
+    }
+  frame.store (ending + 1);
+}
+
+uint64_t
+Metrics::GetFrame ()
+{
+  return frame.load ();
+}
+
+bool
+Metrics::GetHistory (const char *name, MetricHistory &history)
+{
+  uint64_t ended = frame.load ();
+  size_t count = metrics.GetCount ();
+  for (size_t number = 0; number < count; ++number)
+    if (strcmp (metrics.entries[number].name, name) == 0)
+      {
+        history = getHistory (number, ended);
+        return true;
+      }
+  return false;
+}
+
+vector<MetricHistory>
+Metrics::GetEveryHistory ()
+{
+  uint64_t ended = frame.load ();
+  size_t count = metrics.GetCount ();
+  vector<MetricHistory> histories;
+  histories.reserve (count);
+  for (size_t number = 0; number < count; ++number)
+    histories.push_back (getHistory (number, ended));
+  return histories;
+}
+
+vector<MetricValue>
+Metrics::GetLastFrame ()
+{
+  uint64_t ended = frame.load ();
+  size_t count = metrics.GetCount ();
+  vector<MetricValue> values;
+  values.reserve (count);
+  for (size_t number = 0; number < count; ++number)
+    {
+      const Metric &metric = metrics.entries[number];
+      MetricValue value = { metric.name, metric.kind, 0 };
+      if (ended > metric.since)
+        value.value = metric.history[(ended - 1) % historyLength].load (
+          memory_order_relaxed);
+      values.push_back (value);
+    }
+  return values;
+}
+
+void
+Metrics::Log (ostream &log, logging::Level level)
+{
+  if (!logging::IsLevelEnabled (level))
+    return;
+
+  ostringstream text;
+  vector<pair<const char *, double> > fields;
+  text << "Metrics after frame " << GetFrame () << ":";
+  for (auto &history : GetEveryHistory ())
+    {
+      int64_t last = history.frames.empty () ? 0 : history.frames.back ();
+      text << "\n  " << history.name << " = " << last << " (mean "
+           << history.GetMean () << ", min " << history.GetMin ()
+           << ", max " << history.GetMax ();
+      if (history.kind == MetricKind::counter)
+        text << ", total " << history.total;
+      text << ")";
+      fields.emplace_back (history.name, static_cast<double> (last));
+    }
+  detail::LogProfilerReport (log, level, text.str (), fields);
+}
+
+Counter::Counter (const char *name)
+  : metric (findMetric (name, MetricKind::counter))
+{
+}
+
+void
+Counter::Add (int64_t amount)
+{
+  ThreadCounters &counters = threads.Find (threadCounters, sharedCounters);
+  detail::AddToSlot (counters.counts[this->metric], amount, sharedCounters);
+}
+
+int64_t
+Counter::GetTotal () const
+{
+  return getTotal (this->metric);
+}
+
+Gauge::Gauge (const char *name)
+  : value (&metrics.entries[findMetric (name, MetricKind::gauge)].value)
+{
+}
+
+
+}
+}
@@ -0,0 +1,108 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace detail {
+
+void
+LogProfilerReport (ostream &log, logging::Level level, const string &text,
+                   const vector<pair<const char *, double> > &fields)
+{
+  if (!logging::IsLevelEnabled (level))
+    return;
+
+  log << logging::SetLogging (__FILE__, __LINE__, level);
+  for (auto &field : fields)
+    log << logging::Field (field.first, field.second);
+  // One flush, so the whole summary reaches the backends as one message.
+  log << text << flush;
+}
+
+void
+PrintProfilerCounters (ostream &text,
+                       vector<pair<const char *, double> > &fields,
+                       unsigned long profiler,
+                       const profiling::PerfCounters &counters,
+                       const profiling::PerfCounts &counted, size_t runs)
+{
+  using profiling::PerfEvent;
+  if (!counters.IsCounting () || runs == 0)
+    return;
+
+  const char *const names[profiling::PerfCounts::events] = {
+    "cycles", "instructions", "cache misses", "branch misses"
+  };
+  const char *const keys[profiling::PerfCounts::events] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"
+  };
+
+  text << "\nProfiler " << profiler << ": per run";
+  for (size_t i = 0; i < profiling::PerfCounts::events; ++i)
+    {
+      if (!counters.IsCounting (static_cast<PerfEvent> (i)))
+        continue;
+      double mean = static_cast<double> (counted.counts[i]) / runs;
+      text << ", " << names[i] << " = " << static_cast<uint64_t> (mean);
+      fields.emplace_back (keys[i], mean);
+      // IPC is the number to watch, so put it next to the instructions.
+      if (static_cast<PerfEvent> (i) == PerfEvent::instructions &&
+          counted[PerfEvent::cycles] != 0)
+        {
+          double ipc = static_cast<double> (counted[PerfEvent::instructions]) /
+            counted[PerfEvent::cycles];
+          text << ", IPC = " << ipc;
+          fields.emplace_back ("ipc", ipc);
+        }
+    }
+}
+
+void
+PrintProfilerAllocations (ostream &text,
+                          vector<pair<const char *, double> > &fields,
+                          unsigned long profiler,
+                          const profiling::AllocationCounts &allocated,
+                          size_t runs)
+{
+  if (!profiling::AllocationProfiler::IsHooked () || runs == 0)
+    return;
+
+  double allocations = static_cast<double> (allocated.allocations) / runs;
+  double bytes = static_cast<double> (allocated.bytes) / runs;
+  double frees = static_cast<double> (allocated.frees) / runs;
+  text << "\nProfiler " << profiler << ": per run, allocations = "
+       << allocations << ", bytes = " << bytes << ", frees = " << frees;
+  fields.emplace_back ("allocations", allocations);
+  fields.emplace_back ("allocated_bytes", bytes);
+  fields.emplace_back ("frees", frees);
+}
+
+}
+}
+}
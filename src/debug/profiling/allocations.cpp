@@ -0,0 +1,416 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+#  include <windows.h>
+#elif defined(HUMMSTRUMM_ENGINE_PLATFORM_GNULINUX)
+#  include <execinfo.h>
+#endif
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+const size_t AllocationSite::maxDepth;
+const size_t AllocationProfiler::maxThreads;
+const size_t AllocationProfiler::maxSites;
+
+namespace {
+
+// Everything here is constant initialized, because the hooks can run before
+// any constructor has.
+
+/// The counts of one thread.
+struct ThreadCounts
+{
+  atomic<uint64_t> allocations;
+  atomic<uint64_t> bytes;
+  atomic<uint64_t> frees;
+  atomic<uint64_t> freedBytes;
+};
+
+/// A call stack that allocated.
+struct Site
+{
+  /// A hash of the frames, or 0 if the site is free.
+  atomic<uint64_t> hash;
+  /// Whether the frames have been written.
+  atomic<bool> ready;
+  uintptr_t frames[AllocationSite::maxDepth];
+  size_t depth;
+  ThreadCounts counts;
+};
+
+/// What goes in front of each block.  It is 16 bytes, so the block is as
+/// aligned as the memory from malloc().
+struct Header
+{
+  uint64_t size;                ///< The size of the block.
+  uint32_t site;                ///< The site that allocated it plus 1, or 0.
+  uint32_t weight;              ///< How many allocations it stands for.
+};
+static_assert (sizeof (Header) == 16, "The header must keep blocks aligned.");
+
+atomic<bool> hooked (false);
+atomic<unsigned> sampleRate (0);
+
+debug::detail::ThreadSlots<ThreadCounts, AllocationProfiler::maxThreads> threads;
+/// The last slot of sites holds the allocations whose stacks didn't fit.
+Site sites[AllocationProfiler::maxSites];
+
+/// The counts of the whole program when the frame started.
+atomic<uint64_t> frameAllocations (0);
+atomic<uint64_t> frameBytes (0);
+atomic<uint64_t> frameFrees (0);
+atomic<uint64_t> frameFreedBytes (0);
+
+/// This thread's counts, once it has allocated.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL ThreadCounts *threadCounts = nullptr;
+/// Whether this thread shares its counts.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL bool sharedCounts = false;
+/// This thread's allocations since it last took a stack.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL unsigned sinceSample = 0;
+/// Whether this thread is taking a stack, which may allocate.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL bool sampling = false;
+
+AllocationCounts
+read (const ThreadCounts &counts)
+{
+  AllocationCounts read = {
+    counts.allocations.load (memory_order_relaxed),
+    counts.bytes.load (memory_order_relaxed),
+    counts.frees.load (memory_order_relaxed),
+    counts.freedBytes.load (memory_order_relaxed)
+  };
+  return read;
+}
+
+// Returns the number of the site of a call stack, adding it if it is new.
+uint32_t
+findSite (const uintptr_t *frames, size_t depth)
+{
+  // FNV-1a, never 0.
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < depth; ++i)
+    hash = (hash ^ frames[i]) * 1099511628211ull;
+  hash |= 1;
+
+  const size_t overflow = AllocationProfiler::maxSites - 1;
+  size_t index = static_cast<size_t> (hash % overflow);
+  for (size_t probe = 0; probe < 32; ++probe, index = (index + 1) % overflow)
+    {
+      Site &site = sites[index];
+      uint64_t found = site.hash.load (memory_order_acquire);
+      if (found == 0 && site.hash.compare_exchange_strong (found, hash))
+        {
+          for (size_t i = 0; i < depth; ++i)
+            site.frames[i] = frames[i];
+          site.depth = depth;
+          site.ready.store (true, memory_order_release);
+          return static_cast<uint32_t> (index);
+        }
+      if (found == hash)
+        return static_cast<uint32_t> (index);
+    }
+  return static_cast<uint32_t> (overflow);
+}
+
+// Takes the call stack of an allocation, leaving out the allocator's frames.
+HUMMSTRUMM_ENGINE_NOINLINE size_t
+takeStack (uintptr_t *frames)
+{
+  // This, allocate(), New(), and operator new.
+  const size_t skip = 4;
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  void *stack[AllocationSite::maxDepth];
+  size_t depth = CaptureStackBackTrace (skip, AllocationSite::maxDepth, stack,
+                                        nullptr);
+#elif defined(HUMMSTRUMM_ENGINE_PLATFORM_GNULINUX)
+  void *all[AllocationSite::maxDepth + skip];
+  int found = backtrace (all, AllocationSite::maxDepth + skip);
+  size_t depth = found > static_cast<int> (skip) ? found - skip : 0;
+  void **stack = all + skip;
+#else
+  void **stack = nullptr;
+  size_t depth = 0;
+#endif
+  for (size_t i = 0; i < depth; ++i)
+    frames[i] = reinterpret_cast<uintptr_t> (stack[i]);
+  return depth;
+}
+
+HUMMSTRUMM_ENGINE_NOINLINE void *
+allocate (size_t size)
+{
+  Header *header = static_cast<Header *> (malloc (sizeof (Header) + size));
+  if (header == nullptr)
+    return nullptr;
+  header->size = size;
+  header->site = 0;
+  header->weight = 0;
+
+  ThreadCounts &counts = threads.Find (threadCounts, sharedCounts);
+  debug::detail::AddToSlot (counts.allocations, uint64_t (1), sharedCounts);
+  debug::detail::AddToSlot (counts.bytes, header->size, sharedCounts);
+
+  unsigned rate = sampleRate.load (memory_order_relaxed);
+  if (rate != 0 && !sampling && ++sinceSample >= rate)
+    {
+      sinceSample = 0;
+      // Taking the stack may allocate the first time.
+      sampling = true;
+      uintptr_t frames[AllocationSite::maxDepth];
+      size_t depth = takeStack (frames);
+      uint32_t site = findSite (frames, depth);
+      Site &sampled = sites[site];
+      sampled.counts.allocations.fetch_add (rate, memory_order_relaxed);
+      sampled.counts.bytes.fetch_add (static_cast<uint64_t> (size) * rate,
+                                      memory_order_relaxed);
+      header->site = site + 1;
+      header->weight = rate;
+      sampling = false;
+    }
+  return header + 1;
+}
+
+// Writes the sites as folded stacks, weighted by the bytes allocated or the
+// live bytes.
+void
+writeSites (ostream &out, bool live)
+{
+  map<string, int64_t> folded;
+  map<uintptr_t, string> names;
+  for (auto &site : AllocationProfiler::GetSites ())
+    {
+      int64_t bytes = live ? site.counts.GetLiveBytes () :
+        static_cast<int64_t> (site.counts.bytes);
+      if (bytes <= 0)
+        continue;
+      string line;
+      for (size_t i = site.depth; i-- > 0;)
+        {
+          // Return addresses are just past the call; look up the call.
+          uintptr_t address = site.frames[i] - 1;
+          auto name = names.find (address);
+          if (name == names.end ())
+            name = names.insert (make_pair (address,
+                                            detail::Symbolize (address)))
+              .first;
+          if (!line.empty ())
+            line += ';';
+          line += name->second;
+        }
+      if (line.empty ())
+        line = "[unknown]";
+      folded[line] += bytes;
+    }
+  for (auto &stack : folded)
+    out << stack.first << ' ' << stack.second << '\n';
+  out.flush ();
+}
+
+}
+
+bool
+AllocationProfiler::IsHooked ()
+{
+  return hooked.load ();
+}
+
+void
+AllocationProfiler::SetSampleRate (unsigned every)
+{
+  sampleRate.store (every);
+}
+
+unsigned
+AllocationProfiler::GetSampleRate ()
+{
+  return sampleRate.load ();
+}
+
+AllocationCounts
+AllocationProfiler::GetCounts ()
+{
+  AllocationCounts counts = { 0, 0, 0, 0 };
+  size_t used = threads.GetUsed ();
+  for (size_t i = 0; i < used; ++i)
+    counts += read (threads.slots[i]);
+  return counts;
+}
+
+AllocationCounts
+AllocationProfiler::GetThreadCounts ()
+{
+  AllocationCounts counts = { 0, 0, 0, 0 };
+  if (threadCounts)
+    counts = read (*threadCounts);
+  return counts;
+}
+
+vector<pair<unsigned, AllocationCounts> >
+AllocationProfiler::GetEveryThreadCounts ()
+{
+  size_t used = threads.GetUsed ();
+  vector<pair<unsigned, AllocationCounts> > counts;
+  counts.reserve (used);
+  for (size_t i = 0; i < used; ++i)
+    counts.push_back (make_pair (static_cast<unsigned> (i + 1),
+                                 read (threads.slots[i])));
+  return counts;
+}
+
+vector<AllocationSite>
+AllocationProfiler::GetSites ()
+{
+  vector<AllocationSite> found;
+  for (size_t i = 0; i < maxSites; ++i)
+    {
+      const Site &site = sites[i];
+      bool overflow = i == maxSites - 1;
+      if (!overflow && !site.ready.load (memory_order_acquire))
+        continue;
+      AllocationSite snapshot;
+      snapshot.depth = overflow ? 0 : site.depth;
+      for (size_t frame = 0; frame < snapshot.depth; ++frame)
+        snapshot.frames[frame] = site.frames[frame];
+      snapshot.counts = read (site.counts);
+      if (!overflow || snapshot.counts.allocations != 0)
+        found.push_back (snapshot);
+    }
+  return found;
+}
+
+AllocationCounts
+AllocationProfiler::EndFrame ()
+{
+  AllocationCounts now = GetCounts ();
+  AllocationCounts start = {
+    frameAllocations.exchange (now.allocations),
+    frameBytes.exchange (now.bytes),
+    frameFrees.exchange (now.frees),
+    frameFreedBytes.exchange (now.freedBytes)
+  };
+  return now - start;
+}
+
+AllocationCounts
+AllocationProfiler::GetFrameCounts ()
+{
+  AllocationCounts start = {
+    frameAllocations.load (), frameBytes.load (), frameFrees.load (),
+    frameFreedBytes.load ()
+  };
+  return GetCounts () - start;
+}
+
+void
+AllocationProfiler::WriteAllocated (ostream &out)
+{
+  writeSites (out, false);
+}
+
+void
+AllocationProfiler::WriteLiveHeap (ostream &out)
+{
+  writeSites (out, true);
+}
+
+
+namespace detail {
+
+AllocationHooks::AllocationHooks ()
+{
+  hooked.store (true);
+}
+
+void *
+New (size_t size)
+{
+  for (;;)
+    {
+      void *block = allocate (size);
+      if (block)
+        return block;
+      // Give the new handler a chance to make room, as operator new does.
+#ifdef HUMMSTRUMM_ENGINE_COMPILER_MSVC
+      if (_callnewh (size) == 0)
+        throw bad_alloc ();
+#else
+      new_handler handler = get_new_handler ();
+      if (handler == nullptr)
+        throw bad_alloc ();
+      handler ();
+#endif
+    }
+}
+
+void *
+NewNothrow (size_t size) /* noexcept */
+{
+  try
+    {
+      return New (size);
+    }
+  catch (const bad_alloc &)
+    {
+      return nullptr;
+    }
+}
+
+void
+Delete (void *block) /* noexcept */
+{
+  if (block == nullptr)
+    return;
+  Header *header = static_cast<Header *> (block) - 1;
+
+  ThreadCounts &counts = threads.Find (threadCounts, sharedCounts);
+  debug::detail::AddToSlot (counts.frees, uint64_t (1), sharedCounts);
+  debug::detail::AddToSlot (counts.freedBytes, header->size, sharedCounts);
+  if (header->site != 0)
+    {
+      Site &site = sites[header->site - 1];
+      site.counts.frees.fetch_add (header->weight, memory_order_relaxed);
+      site.counts.freedBytes.fetch_add (header->size * header->weight,
+                                        memory_order_relaxed);
+    }
+  free (header);
+}
+
+}
+
+
+}
+}
+}
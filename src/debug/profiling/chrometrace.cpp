@@ -0,0 +1,268 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
+
+#ifdef HUMMSTRUMM_ENGINE_COMPILER_MSVC
+   // MSVC 2013 only has the nonstandard version.  Our buffers are always big
+   // enough, so the difference doesn't matter.
+#  define snprintf _snprintf
+#endif
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+namespace {
+
+/// The track that frames go on.  Thread numbers start at 1.
+const unsigned FRAME_TRACK = 0;
+
+unsigned long
+processId ()
+{
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  return GetCurrentProcessId ();
+#else
+  return static_cast<unsigned long> (getpid ());
+#endif
+}
+
+}
+
+ChromeTraceWriter::ChromeTraceWriter (string file, size_t bufferSize)
+  : mutex (),
+    fileStream (file, ios_base::out | ios_base::binary | ios_base::trunc),
+    buffer (bufferSize < 256 ? 256 : bufferSize),
+    used (0),
+    first (true),
+    start (logging::GetTimestamp ()),
+    process (processId ()),
+    threadNames ()
+{
+  Put ("[", 1);
+  PutThreadName (FRAME_TRACK, "Frames");
+}
+
+ChromeTraceWriter::~ChromeTraceWriter ()
+{
+  Put ("\n]\n", 3);
+  Flush ();
+}
+
+void
+ChromeTraceWriter::operator() (const ZoneFrame &frame)
+{
+  lock_guard<std::mutex> lock (mutex);
+
+  char text[64];
+  int length = snprintf (text, sizeof text, "Frame %llu",
+                         static_cast<unsigned long long> (frame.number));
+  PutEvent (text, length, "frame", frame.begin, frame.end, FRAME_TRACK);
+  length = snprintf (text, sizeof text, ",\"args\":{\"dropped\":%llu}}",
+                     static_cast<unsigned long long> (frame.dropped));
+  Put (text, length);
+
+  for (auto thread = frame.threads.begin (); thread != frame.threads.end ();
+       ++thread)
+    {
+      PutThreadName (thread->thread, thread->name);
+      for (auto zone = thread->zones.begin (); zone != thread->zones.end ();
+           ++zone)
+        {
+          PutEvent (zone->site->name, strlen (zone->site->name), "zone",
+                    zone->begin, zone->end, thread->thread);
+          Put (",\"args\":{\"file\":", 16);
+          PutString (zone->site->file, strlen (zone->site->file));
+          length = snprintf (text, sizeof text, ",\"line\":%u}}",
+                             zone->site->line);
+          Put (text, length);
+        }
+    }
+}
+
+void
+ChromeTraceWriter::AddSpan (const string &name, const char *category,
+                            uint64_t begin, uint64_t end, unsigned thread)
+{
+  lock_guard<std::mutex> lock (mutex);
+  PutEvent (name.data (), name.size (), category, begin, end, thread);
+  Put ("}", 1);
+}
+
+void
+ChromeTraceWriter::AddCounter (const char *name, uint64_t time, int64_t value)
+{
+  lock_guard<std::mutex> lock (mutex);
+  Put (first ? "\n{\"name\":" : ",\n{\"name\":", first ? 9 : 10);
+  first = false;
+  PutString (name, strlen (name));
+  Put (",\"cat\":\"counter\",\"ph\":\"C\",\"ts\":", 31);
+  if (time < start)
+    PutMicroseconds (start - time, true);
+  else
+    PutMicroseconds (time - start, false);
+
+  char text[96];
+  int length = snprintf (text, sizeof text,
+                         ",\"pid\":%lu,\"args\":{\"value\":%lld}}", process,
+                         static_cast<long long> (value));
+  Put (text, length);
+}
+
+void
+ChromeTraceWriter::Flush ()
+{
+  lock_guard<std::mutex> lock (mutex);
+  WriteBuffer ();
+  fileStream.flush ();
+}
+
+void
+ChromeTraceWriter::PutThreadName (unsigned thread, const string &name)
+{
+  auto known = threadNames.find (thread);
+  if (known != threadNames.end () && known->second == name)
+    return;
+  threadNames[thread] = name;
+
+  // Threads without a name are only known by their number.
+  string shown = name;
+  if (shown.empty ())
+    shown = "Thread " + to_string (thread);
+
+  char text[96];
+  int length = snprintf (text, sizeof text,
+                         "%s\n{\"name\":\"thread_name\",\"ph\":\"M\","
+                         "\"pid\":%lu,\"tid\":%u,\"args\":{\"name\":",
+                         first ? "" : ",", process, thread);
+  first = false;
+  Put (text, length);
+  PutString (shown.data (), shown.size ());
+  Put ("}}", 2);
+}
+
+void
+ChromeTraceWriter::PutEvent (const char *name, size_t nameLength,
+                             const char *category, uint64_t begin,
+                             uint64_t end, unsigned thread)
+{
+  Put (first ? "\n{\"name\":" : ",\n{\"name\":", first ? 9 : 10);
+  first = false;
+  PutString (name, nameLength);
+  Put (",\"cat\":\"", 8);
+  Put (category, strlen (category));
+  Put ("\",\"ph\":\"X\",\"ts\":", 16);
+  if (begin < start)
+    PutMicroseconds (start - begin, true);
+  else
+    PutMicroseconds (begin - start, false);
+  Put (",\"dur\":", 7);
+  PutMicroseconds (end > begin ? end - begin : 0, false);
+
+  char text[64];
+  int length = snprintf (text, sizeof text, ",\"pid\":%lu,\"tid\":%u",
+                         process, thread);
+  Put (text, length);
+}
+
+void
+ChromeTraceWriter::PutMicroseconds (uint64_t nanoseconds, bool negative)
+{
+  // The viewers keep fractions of microseconds.
+  char text[32];
+  int length = snprintf (text, sizeof text, "%s%llu.%03u",
+                         negative ? "-" : "",
+                         static_cast<unsigned long long> (nanoseconds / 1000),
+                         static_cast<unsigned> (nanoseconds % 1000));
+  Put (text, length);
+}
+
+void
+ChromeTraceWriter::Put (const char *text, size_t length)
+{
+  if (used + length > buffer.size ())
+    {
+      WriteBuffer ();
+      if (length > buffer.size ())
+        {
+          // Too big to buffer.  Write it straight out.
+          fileStream.write (text, length);
+          return;
+        }
+    }
+  memcpy (buffer.data () + used, text, length);
+  used += length;
+}
+
+void
+ChromeTraceWriter::PutString (const char *text, size_t length)
+{
+  Put ("\"", 1);
+  // Copy runs of characters that don't need escaping in one go.
+  const char *run = text;
+  const char *end = text + length;
+  for (const char *c = text; c != end; ++c)
+    {
+      unsigned char character = static_cast<unsigned char> (*c);
+      if (character >= 0x20 && character != '"' && character != '\\')
+        continue;
+
+      Put (run, c - run);
+      run = c + 1;
+      char escape[8];
+      int escapeLength = snprintf (escape, sizeof escape,
+                                   character == '"' || character == '\\' ?
+                                   "\\%c" : "\\u%04x", character);
+      Put (escape, escapeLength);
+    }
+  Put (run, end - run);
+  Put ("\"", 1);
+}
+
+void
+ChromeTraceWriter::WriteBuffer ()
+{
+  if (used != 0)
+    {
+      fileStream.write (buffer.data (), used);
+      used = 0;
+    }
+}
+
+
+}
+}
+}
@@ -0,0 +1,207 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_GNULINUX
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#  ifdef HUMMSTRUMM_ENGINE_HAVE_TSC
+#    include <x86intrin.h>
+#  endif
+#endif
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+const size_t PerfCounts::events;
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_GNULINUX
+namespace {
+
+// The kind of counter for each PerfEvent.
+const uint64_t eventConfigs[PerfCounts::events] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES
+};
+
+// There is no glibc wrapper for this.
+int
+openCounter (uint64_t config, int group)
+{
+  perf_event_attr attributes;
+  memset (&attributes, 0, sizeof attributes);
+  attributes.size = sizeof attributes;
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.config = config;
+  attributes.read_format = PERF_FORMAT_GROUP;
+  // Only the leader starts disabled; the group starts when it does.
+  attributes.disabled = group == -1;
+  // A paranoid kernel may still let us count our own user mode.
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  return static_cast<int> (syscall (__NR_perf_event_open, &attributes, 0, -1,
+                                    group, 0));
+}
+
+#ifdef HUMMSTRUMM_ENGINE_HAVE_TSC
+// Reads a counter through the page the kernel shares about it.  Returns false
+// if the kernel doesn't let us use rdpmc for it right now.
+bool
+readPage (const void *page, uint64_t &count)
+{
+  const volatile perf_event_mmap_page *info =
+    static_cast<const volatile perf_event_mmap_page *> (page);
+  uint32_t sequence;
+  do
+    {
+      sequence = info->lock;
+      __sync_synchronize ();
+      uint32_t index = info->index;
+      if (!info->cap_user_rdpmc || index == 0)
+        return false;
+      int64_t value = static_cast<int64_t> (__rdpmc (index - 1));
+      // The counter is narrower than 64 bits; sign extend it.
+      unsigned shift = 64 - info->pmc_width;
+      value = static_cast<int64_t> (static_cast<uint64_t> (value) << shift) >>
+        shift;
+      count = static_cast<uint64_t> (info->offset + value);
+      __sync_synchronize ();
+    }
+  while (info->lock != sequence);
+  return true;
+}
+#endif
+
+}
+#endif
+
+PerfCounters::PerfCounters ()
+  : pageSize (0),
+    open (0),
+    rdpmc (false)
+{
+  for (size_t i = 0; i < PerfCounts::events; ++i)
+    {
+      files[i] = -1;
+      pages[i] = nullptr;
+    }
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_GNULINUX
+  // Without the cycles to lead the group, count nothing.
+  files[0] = openCounter (eventConfigs[0], -1);
+  if (files[0] == -1)
+    return;
+  for (size_t i = 1; i < PerfCounts::events; ++i)
+    files[i] = openCounter (eventConfigs[i], files[0]);
+  for (size_t i = 0; i < PerfCounts::events; ++i)
+    if (files[i] != -1)
+      ++open;
+
+#ifdef HUMMSTRUMM_ENGINE_HAVE_TSC
+  pageSize = static_cast<size_t> (sysconf (_SC_PAGESIZE));
+  rdpmc = true;
+  for (size_t i = 0; i < PerfCounts::events; ++i)
+    {
+      if (files[i] == -1)
+        continue;
+      void *page = mmap (nullptr, pageSize, PROT_READ, MAP_SHARED, files[i],
+                         0);
+      if (page == MAP_FAILED)
+        {
+          rdpmc = false;
+          continue;
+        }
+      pages[i] = page;
+      if (!static_cast<perf_event_mmap_page *> (page)->cap_user_rdpmc)
+        rdpmc = false;
+    }
+#endif
+
+  ioctl (files[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl (files[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+PerfCounters::~PerfCounters ()
+{
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_GNULINUX
+  // Close the members before the leader.
+  for (size_t i = PerfCounts::events; i-- > 0;)
+    {
+      if (pages[i])
+        munmap (pages[i], pageSize);
+      if (files[i] != -1)
+        close (files[i]);
+    }
+#endif
+}
+
+PerfCounts
+PerfCounters::Read () const
+{
+  PerfCounts counts;
+  for (size_t i = 0; i < PerfCounts::events; ++i)
+    counts.counts[i] = 0;
+  if (open == 0)
+    return counts;
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_GNULINUX
+#ifdef HUMMSTRUMM_ENGINE_HAVE_TSC
+  if (rdpmc)
+    {
+      bool read = true;
+      for (size_t i = 0; i < PerfCounts::events && read; ++i)
+        if (pages[i])
+          read = readPage (pages[i], counts.counts[i]);
+      // The counters may not be on the processor at the moment; ask the
+      // kernel.
+      if (read)
+        return counts;
+    }
+#endif
+
+  // One read gives the whole group, leader first, in the order it was opened.
+  uint64_t values[1 + PerfCounts::events];
+  ssize_t length = ::read (files[0], values, sizeof values);
+  if (length < static_cast<ssize_t> (sizeof (uint64_t)))
+    return counts;
+  size_t value = 0;
+  for (size_t i = 0; i < PerfCounts::events && value < values[0]; ++i)
+    if (files[i] != -1)
+      counts.counts[i] = values[1 + value++];
+#endif
+  return counts;
+}
+
+
+}
+}
+}
@@ -0,0 +1,497 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(HUMMSTRUMM_ENGINE_PLATFORM_GNULINUX) && \
+  (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__))
+#  define HUMMSTRUMM_ENGINE_HAVE_SAMPLER
+#  include <cerrno>
+#  include <csignal>
+#  include <ctime>
+#  include <pthread.h>
+#  include <sys/syscall.h>
+#  include <ucontext.h>
+#  include <unistd.h>
+// Older C libraries don't name this field.
+#  ifndef sigev_notify_thread_id
+#    define sigev_notify_thread_id _sigev_un._tid
+#  endif
+#endif
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_GNULINUX
+#  include <cxxabi.h>
+#  include <dlfcn.h>
+#endif
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+const size_t Sampler::maxDepth;
+
+namespace detail {
+
+/// What the signal handler and the background thread of a Sampler share.
+struct SamplerState
+{
+  /// One sample in the ring.
+  struct Slot
+  {
+    /// @c n+1 once sample number @c n has been written here.
+    atomic<uint64_t> sequence;
+    /// The number of the thread that was sampled.
+    uint32_t thread;
+    /// How many frames were found.
+    uint32_t depth;
+    /// The return addresses, from the innermost frame out.
+    uintptr_t frames[Sampler::maxDepth];
+  };
+
+  SamplerState (size_t capacity)
+    : slots (capacity),
+      mask (capacity - 1),
+      head (0),
+      tail (0),
+      dropped (0),
+      id (0),
+      stacks (),
+      timers (),
+      mutex (),
+      wake (),
+      stopping (false),
+      collector ()
+  {
+    for (size_t i = 0; i < capacity; ++i)
+      slots[i].sequence.store (0, memory_order_relaxed);
+  }
+
+  /// The ring of samples.
+  vector<Slot> slots;
+  /// The number of slots, minus one.
+  size_t mask;
+  /// How many samples were ever put in the ring.
+  atomic<uint64_t> head;
+  /// How many samples were ever taken out of the ring.
+  atomic<uint64_t> tail;
+  /// How many samples didn't fit in the ring.
+  atomic<uint64_t> dropped;
+  /// Tells this Sampler apart from ones that existed before it.
+  unsigned long id;
+  /// How often each stack was seen; the key is the thread, then the frames.
+  map<vector<uintptr_t>, uint64_t> stacks;
+#ifdef HUMMSTRUMM_ENGINE_HAVE_SAMPLER
+  /// The timer of every thread being sampled.
+  vector<timer_t> timers;
+#else
+  vector<void *> timers;
+#endif
+  /// Protects stacks, timers, and the reading end of the ring.
+  std::mutex mutex;
+  /// Wakes the background thread when it's time to stop.
+  condition_variable wake;
+  /// Whether the background thread should stop.
+  bool stopping;
+  /// The background thread, which collects the samples.
+  thread collector;
+};
+
+}
+
+namespace {
+
+/// Hands out Sampler ids, so a thread can tell a new Sampler from an old one.
+atomic<unsigned long> nextSamplerId (1);
+
+/// The Sampler the signal handler records samples for, if any.
+atomic<detail::SamplerState *> activeState (nullptr);
+
+#ifdef HUMMSTRUMM_ENGINE_HAVE_SAMPLER
+/// Whether the signal handler has been installed.
+atomic<bool> handlerInstalled (false);
+/// How many signal handlers are looking at activeState.
+atomic<unsigned> handlersRunning (0);
+/// Hands out thread numbers.
+atomic<uint32_t> nextThread (1);
+
+/// The id of the Sampler that samples this thread, or 0.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL unsigned long sampledBy = 0;
+/// This thread's number.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL uint32_t threadNumber = 0;
+/// The top of this thread's stack, which no frame is above.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL uintptr_t stackTop = 0;
+/// This thread's timer.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL timer_t threadTimer;
+
+// Walks the frame pointers of the interrupted code.  Every frame must be
+// between the interrupted stack pointer and the top of the stack, and further
+// out than the last, so a register that doesn't hold a frame pointer at the
+// moment can only end the walk early, and not read bad memory.
+uint32_t
+walkStack (const ucontext_t *context, uintptr_t *frames)
+{
+#if defined(__x86_64__)
+  uintptr_t pc = context->uc_mcontext.gregs[REG_RIP];
+  uintptr_t sp = context->uc_mcontext.gregs[REG_RSP];
+  uintptr_t fp = context->uc_mcontext.gregs[REG_RBP];
+#elif defined(__i386__)
+  uintptr_t pc = context->uc_mcontext.gregs[REG_EIP];
+  uintptr_t sp = context->uc_mcontext.gregs[REG_ESP];
+  uintptr_t fp = context->uc_mcontext.gregs[REG_EBP];
+#else
+  uintptr_t pc = context->uc_mcontext.pc;
+  uintptr_t sp = context->uc_mcontext.sp;
+  uintptr_t fp = context->uc_mcontext.regs[29];
+#endif
+
+  uint32_t depth = 0;
+  frames[depth++] = pc;
+  while (depth < Sampler::maxDepth && fp >= sp &&
+         fp <= stackTop - 2 * sizeof (uintptr_t) &&
+         fp % sizeof (uintptr_t) == 0)
+    {
+      // A frame holds the caller's frame pointer, then the return address.
+      const uintptr_t *frame = reinterpret_cast<const uintptr_t *> (fp);
+      uintptr_t next = frame[0];
+      uintptr_t address = frame[1];
+      if (address == 0)
+        break;
+      frames[depth++] = address;
+      if (next <= fp)
+        break;
+      fp = next;
+    }
+  return depth;
+}
+
+// Puts a sample in the ring, or counts it as dropped if the ring is full.
+// Any number of threads can do this at once.
+void
+record (detail::SamplerState &state, const ucontext_t *context)
+{
+  uint64_t sample = state.head.load (memory_order_relaxed);
+  do
+    {
+      if (sample - state.tail.load (memory_order_acquire) > state.mask)
+        {
+          state.dropped.fetch_add (1, memory_order_relaxed);
+          return;
+        }
+    }
+  while (!state.head.compare_exchange_weak (sample, sample + 1,
+                                            memory_order_relaxed));
+
+  detail::SamplerState::Slot &slot = state.slots[sample & state.mask];
+  slot.thread = threadNumber;
+  slot.depth = walkStack (context, slot.frames);
+  slot.sequence.store (sample + 1, memory_order_release);
+}
+
+void
+onSignal (int, siginfo_t *info, void *context)
+{
+  int savedErrno = errno;
+  handlersRunning.fetch_add (1);
+  detail::SamplerState *state = activeState.load ();
+  // Only take samples for our timers, on threads this Sampler samples.
+  if (state && info->si_code == SI_TIMER && sampledBy == state->id)
+    record (*state, static_cast<const ucontext_t *> (context));
+  handlersRunning.fetch_sub (1);
+  errno = savedErrno;
+}
+
+#endif
+
+// Rounds up to a power of two.
+size_t
+roundCapacity (size_t capacity)
+{
+  size_t rounded = 1;
+  while (rounded < capacity)
+    rounded <<= 1;
+  return rounded;
+}
+
+}
+
+namespace detail {
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_GNULINUX
+string
+Symbolize (uintptr_t address)
+{
+  Dl_info info;
+  ostringstream name;
+  if (dladdr (reinterpret_cast<void *> (address), &info) == 0)
+    {
+      name << "0x" << hex << address;
+      return name.str ();
+    }
+  if (info.dli_sname)
+    {
+      int status = 0;
+      char *demangled = abi::__cxa_demangle (info.dli_sname, nullptr, nullptr,
+                                             &status);
+      if (status == 0 && demangled)
+        name << demangled;
+      else
+        name << info.dli_sname;
+      free (demangled);
+      return name.str ();
+    }
+  const char *file = info.dli_fname ? info.dli_fname : "";
+  if (const char *slash = strrchr (file, '/'))
+    file = slash + 1;
+  name << file << "+0x" << hex
+       << address - reinterpret_cast<uintptr_t> (info.dli_fbase);
+  return name.str ();
+}
+#else
+string
+Symbolize (uintptr_t address)
+{
+  ostringstream name;
+  name << "0x" << hex << address;
+  return name.str ();
+}
+#endif
+
+}
+
+Sampler::Sampler (unsigned frequency, size_t capacity)
+  : state (new detail::SamplerState (roundCapacity (capacity))),
+    frequency (frequency),
+    sampling (false)
+{
+  state->id = nextSamplerId++;
+  detail::SamplerState *none = nullptr;
+  if (!activeState.compare_exchange_strong (none, state.get ()))
+    throw runtime_error ("Only one Sampler can exist at a time.");
+
+#ifdef HUMMSTRUMM_ENGINE_HAVE_SAMPLER
+  sampling = frequency != 0;
+  if (sampling && !handlerInstalled.exchange (true))
+    {
+      struct sigaction action;
+      memset (&action, 0, sizeof action);
+      action.sa_sigaction = onSignal;
+      action.sa_flags = SA_SIGINFO | SA_RESTART;
+      sigemptyset (&action.sa_mask);
+      if (sigaction (SIGPROF, &action, nullptr) != 0)
+        {
+          handlerInstalled.store (false);
+          sampling = false;
+        }
+    }
+#endif
+
+  // Empty the ring often enough that it doesn't fill up.
+  detail::SamplerState *shared = state.get ();
+  state->collector = thread ([this, shared] () {
+      unique_lock<std::mutex> lock (shared->mutex);
+      while (!shared->stopping)
+        {
+          shared->wake.wait_for (lock, chrono::milliseconds (50));
+          lock.unlock ();
+          Collect ();
+          lock.lock ();
+        }
+    });
+}
+
+Sampler::~Sampler ()
+{
+  {
+    lock_guard<std::mutex> lock (state->mutex);
+    state->stopping = true;
+#ifdef HUMMSTRUMM_ENGINE_HAVE_SAMPLER
+    for (auto &timer : state->timers)
+      timer_delete (timer);
+    state->timers.clear ();
+#endif
+  }
+  state->wake.notify_one ();
+  state->collector.join ();
+
+  // A signal may already be on its way, or be in the handler.
+  activeState.store (nullptr);
+#ifdef HUMMSTRUMM_ENGINE_HAVE_SAMPLER
+  while (handlersRunning.load () != 0)
+    this_thread::yield ();
+#endif
+}
+
+bool
+Sampler::RegisterThread ()
+{
+#ifdef HUMMSTRUMM_ENGINE_HAVE_SAMPLER
+  if (!sampling)
+    return false;
+  if (sampledBy == state->id)
+    return true;
+
+  if (threadNumber == 0)
+    threadNumber = nextThread++;
+  pthread_attr_t attributes;
+  if (pthread_getattr_np (pthread_self (), &attributes) != 0)
+    return false;
+  void *stack = nullptr;
+  size_t stackSize = 0;
+  pthread_attr_getstack (&attributes, &stack, &stackSize);
+  pthread_attr_destroy (&attributes);
+  stackTop = reinterpret_cast<uintptr_t> (stack) + stackSize;
+
+  // The timer counts this thread's processor time, so a thread that is
+  // waiting isn't sampled.
+  sigevent event;
+  memset (&event, 0, sizeof event);
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = SIGPROF;
+  event.sigev_notify_thread_id = static_cast<pid_t> (syscall (SYS_gettid));
+  timer_t timer;
+  if (timer_create (CLOCK_THREAD_CPUTIME_ID, &event, &timer) != 0)
+    return false;
+
+  lock_guard<std::mutex> lock (state->mutex);
+  state->timers.push_back (timer);
+  threadTimer = timer;
+  sampledBy = state->id;
+
+  long interval = 1000000000L / static_cast<long> (frequency);
+  itimerspec spec;
+  spec.it_interval.tv_sec = interval / 1000000000L;
+  spec.it_interval.tv_nsec = interval % 1000000000L;
+  spec.it_value = spec.it_interval;
+  timer_settime (timer, 0, &spec, nullptr);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+Sampler::UnregisterThread ()
+{
+#ifdef HUMMSTRUMM_ENGINE_HAVE_SAMPLER
+  if (sampledBy != state->id)
+    return;
+  sampledBy = 0;
+  lock_guard<std::mutex> lock (state->mutex);
+  for (auto i = state->timers.begin (); i != state->timers.end (); ++i)
+    if (*i == threadTimer)
+      {
+        timer_delete (*i);
+        state->timers.erase (i);
+        break;
+      }
+#endif
+}
+
+uint64_t
+Sampler::GetSamples () const
+{
+  return state->head.load ();
+}
+
+uint64_t
+Sampler::GetDropped () const
+{
+  return state->dropped.load ();
+}
+
+void
+Sampler::Collect ()
+{
+  lock_guard<std::mutex> lock (state->mutex);
+  uint64_t sample = state->tail.load (memory_order_relaxed);
+  uint64_t head = state->head.load (memory_order_acquire);
+  vector<uintptr_t> key;
+  for (; sample != head; ++sample)
+    {
+      detail::SamplerState::Slot &slot = state->slots[sample & state->mask];
+      // The handler that took this slot may not be done with it yet.
+      if (slot.sequence.load (memory_order_acquire) != sample + 1)
+        break;
+      key.assign (1, slot.thread);
+      key.insert (key.end (), slot.frames, slot.frames + slot.depth);
+      state->tail.store (sample + 1, memory_order_release);
+      ++state->stacks[key];
+    }
+}
+
+void
+Sampler::WriteFolded (ostream &out, bool byThread)
+{
+  Collect ();
+
+  // Different addresses in one function fold into one stack.
+  map<string, uint64_t> folded;
+  {
+    lock_guard<std::mutex> lock (state->mutex);
+    map<uintptr_t, string> names;
+    for (auto &stack : state->stacks)
+      {
+        string line;
+        if (byThread)
+          line = "thread-" + to_string (stack.first[0]);
+        for (size_t i = stack.first.size (); i-- > 1;)
+          {
+            // Return addresses are just past the call; look up the call.
+            uintptr_t address = stack.first[i];
+            if (i != 1)
+              --address;
+            auto name = names.find (address);
+            if (name == names.end ())
+              name = names.insert (make_pair (address,
+                                              detail::Symbolize (address))).first;
+            if (!line.empty ())
+              line += ';';
+            line += name->second;
+          }
+        folded[line] += stack.second;
+      }
+  }
+
+  for (auto &stack : folded)
+    out << stack.first << ' ' << stack.second << '\n';
+  out.flush ();
+}
+
+
+}
+}
+}
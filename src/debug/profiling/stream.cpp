@@ -0,0 +1,879 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#else
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <poll.h>
+#  include <sys/socket.h>
+#  include <sys/stat.h>
+#  include <sys/time.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+namespace {
+
+using logging::binarylog::maxVarint;
+using logging::binarylog::nanosecondTicks;
+using logging::binarylog::PutVarint;
+using logging::binarylog::Unzigzag;
+using logging::binarylog::Zigzag;
+using profilestream::RecordType;
+
+const intptr_t NO_SOCKET = -1;
+/// How long the sending thread waits before checking whether to stop.
+const int WAIT_MILLISECONDS = 100;
+/// The longest record a reader accepts.
+const uint64_t MAX_RECORD = 1 << 30;
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+const int SEND_FLAGS = 0;
+#elif defined(MSG_NOSIGNAL)
+// A client that goes away must not kill the program with SIGPIPE.
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+/// Where to listen or connect.
+struct Address
+{
+  bool local;                   ///< Whether it is a Unix domain socket.
+  string path;                  ///< The path of a Unix domain socket.
+  unsigned short port;          ///< The port of a TCP socket.
+};
+
+Address
+parseAddress (const string &address)
+{
+  Address where = { false, "", 0 };
+  if (address.compare (0, 5, "unix:") == 0 && address.size () > 5)
+    {
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+      throw invalid_argument ("There are no Unix domain sockets on Windows, "
+                              "so " + address + " can't be used.");
+#else
+      where.local = true;
+      where.path = address.substr (5);
+      if (where.path.size () >= sizeof (sockaddr_un::sun_path))
+        throw invalid_argument ("The path of " + address + " is too long.");
+      return where;
+#endif
+    }
+  if (address.compare (0, 4, "tcp:") == 0 && address.size () > 4)
+    {
+      char *end;
+      unsigned long port = strtoul (address.c_str () + 4, &end, 10);
+      if (*end == '\0' && port != 0 && port <= 65535)
+        {
+          where.port = static_cast<unsigned short> (port);
+          return where;
+        }
+    }
+  throw invalid_argument ("The address " + address +
+                          " isn't unix:PATH or tcp:PORT.");
+}
+
+void
+startSockets ()
+{
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  WSADATA data;
+  WSAStartup (MAKEWORD (2, 2), &data);
+#endif
+}
+
+void
+stopSockets ()
+{
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  WSACleanup ();
+#endif
+}
+
+void
+closeSocket (intptr_t socket)
+{
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  closesocket (static_cast<SOCKET> (socket));
+#else
+  close (static_cast<int> (socket));
+#endif
+}
+
+#ifndef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+// Removes a Unix domain socket left at a path, say by an earlier run.
+// Returns false, and leaves it alone, if something other than a socket is
+// there.
+bool
+removeSocketFile (const string &path)
+{
+  struct stat status;
+  if (lstat (path.c_str (), &status) != 0)
+    return errno == ENOENT;
+  if (!S_ISSOCK (status.st_mode))
+    return false;
+  unlink (path.c_str ());
+  return true;
+}
+#endif
+
+// Makes a socket that listens on an address, or is connected to it.  Returns
+// NO_SOCKET if that can't be done.
+intptr_t
+openSocket (const Address &where, bool listening)
+{
+  intptr_t opened;
+  int done;
+#ifndef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  if (where.local)
+    {
+      sockaddr_un name;
+      memset (&name, 0, sizeof name);
+      name.sun_family = AF_UNIX;
+      strcpy (name.sun_path, where.path.c_str ());
+      opened = ::socket (AF_UNIX, SOCK_STREAM, 0);
+      if (opened == NO_SOCKET)
+        return NO_SOCKET;
+      if (listening)
+        {
+          // A socket left over from an earlier run is in the way.
+          if (!removeSocketFile (where.path))
+            {
+              closeSocket (opened);
+              return NO_SOCKET;
+            }
+          done = ::bind (opened, reinterpret_cast<sockaddr *> (&name),
+                         sizeof name);
+        }
+      else
+        {
+          done = ::connect (opened, reinterpret_cast<sockaddr *> (&name),
+                            sizeof name);
+        }
+    }
+  else
+#endif
+    {
+      sockaddr_in name;
+      memset (&name, 0, sizeof name);
+      name.sin_family = AF_INET;
+      name.sin_port = htons (where.port);
+      name.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+      opened = static_cast<intptr_t> (::socket (AF_INET, SOCK_STREAM,
+                                                IPPROTO_TCP));
+      if (opened == NO_SOCKET)
+        return NO_SOCKET;
+      if (listening)
+        {
+          int yes = 1;
+          setsockopt (opened, SOL_SOCKET, SO_REUSEADDR,
+                      reinterpret_cast<const char *> (&yes), sizeof yes);
+          done = ::bind (opened, reinterpret_cast<sockaddr *> (&name),
+                         sizeof name);
+        }
+      else
+        {
+          done = ::connect (opened, reinterpret_cast<sockaddr *> (&name),
+                            sizeof name);
+        }
+    }
+  if (done == 0 && listening)
+    done = ::listen (opened, 1);
+  if (done != 0)
+    {
+      closeSocket (opened);
+      return NO_SOCKET;
+    }
+  return opened;
+}
+
+// Waits for a socket to have something to read, or a client to accept.
+bool
+waitReadable (intptr_t socket, int milliseconds)
+{
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  WSAPOLLFD waiting = { static_cast<SOCKET> (socket), POLLRDNORM, 0 };
+  return WSAPoll (&waiting, 1, milliseconds) > 0;
+#else
+  pollfd waiting = { static_cast<int> (socket), POLLIN, 0 };
+  return poll (&waiting, 1, milliseconds) > 0;
+#endif
+}
+
+// Makes sends to a socket give up after a while, so a client that stopped
+// reading can't keep the sending thread from stopping.
+void
+setSendTimeout (intptr_t socket, int milliseconds)
+{
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  DWORD timeout = milliseconds;
+#else
+  timeval timeout = { milliseconds / 1000, (milliseconds % 1000) * 1000 };
+#endif
+  setsockopt (socket, SOL_SOCKET, SO_SNDTIMEO,
+              reinterpret_cast<const char *> (&timeout), sizeof timeout);
+#ifdef SO_NOSIGPIPE
+  int yes = 1;
+  setsockopt (socket, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof yes);
+#endif
+}
+
+// Returns whether the last send or receive failed only because it timed out or
+// was interrupted.
+bool
+interrupted ()
+{
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  int error = WSAGetLastError ();
+  return error == WSAETIMEDOUT || error == WSAEINTR;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+void
+putVarint (vector<char> &out, uint64_t value)
+{
+  char bytes[maxVarint];
+  size_t n = PutVarint (bytes, value);
+  out.insert (out.end (), bytes, bytes + n);
+}
+
+// Appends a record to a message.
+void
+putRecord (vector<char> &out, RecordType type, const char *head,
+           size_t headLength, const char *body, size_t bodyLength)
+{
+  out.push_back (static_cast<char> (type));
+  putVarint (out, headLength + bodyLength);
+  out.insert (out.end (), head, head + headLength);
+  out.insert (out.end (), body, body + bodyLength);
+}
+
+// Reads a varint from [position, end), moving position past it.
+uint64_t
+getVarint (const char *&position, const char *end)
+{
+  uint64_t value = 0;
+  for (unsigned shift = 0; shift < 64 && position != end; shift += 7)
+    {
+      unsigned char c = static_cast<unsigned char> (*position++);
+      value |= static_cast<uint64_t> (c & 0x7f) << shift;
+      if (!(c & 0x80))
+        return value;
+    }
+  throw runtime_error ("The profile stream has a bad record.");
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hummstrummengine::debug::profiling::ProfileStreamServer implementation
+
+ProfileStreamServer::ProfileStreamServer (string address, size_t queuedFrames)
+  : address (address),
+    path (),
+    queuedFrames (queuedFrames == 0 ? 1 : queuedFrames),
+    listener (NO_SOCKET),
+    client (NO_SOCKET),
+    dropped (0),
+    encodedFor (0),
+    siteIds (),
+    sitesSent (),
+    metricsSent (0),
+    threadNames (),
+    message (),
+    payload (),
+    connection (0),
+    connected (false),
+    running (true),
+    queue (),
+    mutex (),
+    queued (),
+    sender ()
+{
+  Address where = parseAddress (address);
+#ifndef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  if (where.local && !removeSocketFile (where.path))
+    throw runtime_error ("Could not listen on " + address + ", because " +
+                         where.path + " is in the way and isn't a socket.");
+#endif
+  startSockets ();
+  listener = openSocket (where, true);
+  if (listener == NO_SOCKET)
+    {
+      stopSockets ();
+      throw runtime_error ("Could not listen on " + address + ".");
+    }
+  path = where.path;
+  sender = thread (&ProfileStreamServer::Run, this);
+}
+
+ProfileStreamServer::~ProfileStreamServer ()
+{
+  {
+    lock_guard<std::mutex> lock (mutex);
+    running = false;
+  }
+  queued.notify_one ();
+  sender.join ();
+  closeSocket (listener);
+#ifndef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+  if (!path.empty ())
+    removeSocketFile (path);
+#endif
+  stopSockets ();
+}
+
+void
+ProfileStreamServer::operator() (const ZoneFrame &frame)
+{
+  // Don't encode a frame that there is no one to send to, or no room for.
+  // Only this thread adds to the queue, so there is still room after
+  // encoding.
+  uint64_t encoding;
+  {
+    lock_guard<std::mutex> lock (mutex);
+    if (!connected)
+      return;
+    if (queue.size () >= queuedFrames)
+      {
+        dropped.fetch_add (1, memory_order_relaxed);
+        return;
+      }
+    encoding = connection;
+  }
+  if (encoding != encodedFor)
+    {
+      // A new client knows nothing yet.
+      encodedFor = encoding;
+      sitesSent.assign (sitesSent.size (), false);
+      metricsSent = 0;
+      threadNames.clear ();
+    }
+
+  message.clear ();
+  payload.clear ();
+  char head[2 * maxVarint + 1];
+  size_t n;
+
+  vector<MetricValue> values = Metrics::GetLastFrame ();
+  for (; metricsSent < values.size (); ++metricsSent)
+    {
+      const MetricValue &metric = values[metricsSent];
+      n = PutVarint (head, metricsSent);
+      head[n++] = metric.kind == MetricKind::counter ? 0 : 1;
+      putRecord (message, RecordType::metric, head, n, metric.name,
+                 strlen (metric.name));
+    }
+
+  putVarint (payload, frame.number);
+  putVarint (payload, frame.begin);
+  putVarint (payload, frame.end - frame.begin);
+  putVarint (payload, frame.dropped);
+  putVarint (payload, dropped.load (memory_order_relaxed));
+  putVarint (payload, frame.threads.size ());
+  for (auto &thread : frame.threads)
+    {
+      auto name = threadNames.find (thread.thread);
+      if (name == threadNames.end () || name->second != thread.name)
+        {
+          threadNames[thread.thread] = thread.name;
+          n = PutVarint (head, thread.thread);
+          putRecord (message, RecordType::threadName, head, n,
+                     thread.name.data (), thread.name.size ());
+        }
+
+      putVarint (payload, thread.thread);
+      putVarint (payload, thread.zones.size ());
+      for (auto &zone : thread.zones)
+        {
+          auto site = siteIds.find (zone.site);
+          if (site == siteIds.end ())
+            {
+              site = siteIds.insert (make_pair (zone.site, siteIds.size ()))
+                .first;
+              sitesSent.push_back (false);
+            }
+          if (!sitesSent[site->second])
+            {
+              sitesSent[site->second] = true;
+              string names = zone.site->name;
+              names += '\0';
+              names += zone.site->function ? zone.site->function : "";
+              names += '\0';
+              names += zone.site->file ? zone.site->file : "";
+              names += '\0';
+              n = PutVarint (head, site->second);
+              n += PutVarint (head + n, zone.site->line);
+              putRecord (message, RecordType::zoneSite, head, n,
+                         names.data (), names.size ());
+            }
+
+          putVarint (payload, site->second);
+          putVarint (payload, Zigzag (static_cast<int64_t> (zone.begin -
+                                                            frame.begin)));
+          putVarint (payload, zone.end - zone.begin);
+          putVarint (payload, zone.depth);
+        }
+    }
+  putVarint (payload, values.size ());
+  for (size_t id = 0; id < values.size (); ++id)
+    {
+      putVarint (payload, id);
+      putVarint (payload, Zigzag (values[id].value));
+    }
+  putRecord (message, RecordType::frame, payload.data (), payload.size (),
+             nullptr, 0);
+
+  {
+    lock_guard<std::mutex> lock (mutex);
+    // The client may have gone while this was encoded.
+    if (!connected || connection != encoding)
+      return;
+    queue.push_back (message);
+  }
+  queued.notify_one ();
+}
+
+bool
+ProfileStreamServer::IsConnected ()
+  const
+{
+  lock_guard<std::mutex> lock (mutex);
+  return connected;
+}
+
+void
+ProfileStreamServer::Run ()
+{
+  for (;;)
+    {
+      if (client == NO_SOCKET)
+        {
+          {
+            lock_guard<std::mutex> lock (mutex);
+            if (!running)
+              break;
+          }
+          if (!waitReadable (listener, WAIT_MILLISECONDS))
+            continue;
+          intptr_t accepted = static_cast<intptr_t> (
+            ::accept (listener, nullptr, nullptr));
+          if (accepted == NO_SOCKET)
+            continue;
+          setSendTimeout (accepted, 1000);
+          client = accepted;
+
+          char header[sizeof profilestream::magic + 1 + maxVarint];
+          memcpy (header, profilestream::magic, sizeof profilestream::magic);
+          size_t n = sizeof profilestream::magic;
+          header[n++] = static_cast<char> (profilestream::version);
+          n += PutVarint (header + n, nanosecondTicks);
+          if (!Send (header, n))
+            {
+              closeSocket (client);
+              client = NO_SOCKET;
+              continue;
+            }
+
+          lock_guard<std::mutex> lock (mutex);
+          ++connection;
+          connected = true;
+          continue;
+        }
+
+      vector<char> next;
+      {
+        unique_lock<std::mutex> lock (mutex);
+        while (queue.empty () && running)
+          queued.wait (lock);
+        // Send what is queued before stopping.
+        if (queue.empty ())
+          break;
+        next.swap (queue.front ());
+        queue.pop_front ();
+      }
+      if (!Send (next.data (), next.size ()))
+        {
+          closeSocket (client);
+          client = NO_SOCKET;
+          lock_guard<std::mutex> lock (mutex);
+          connected = false;
+          queue.clear ();
+        }
+    }
+
+  if (client != NO_SOCKET)
+    {
+      char end[2] = { static_cast<char> (RecordType::end), 0 };
+      Send (end, sizeof end);
+      closeSocket (client);
+      client = NO_SOCKET;
+    }
+}
+
+bool
+ProfileStreamServer::Send (const char *bytes, size_t length)
+{
+  while (length != 0)
+    {
+      int chunk = length > 1 << 20 ? 1 << 20 : static_cast<int> (length);
+      int sent = static_cast<int> (::send (client, bytes, chunk,
+                                           SEND_FLAGS));
+      if (sent > 0)
+        {
+          bytes += sent;
+          length -= sent;
+          continue;
+        }
+      // A slow client is waited for, unless the server is stopping.
+      if (sent < 0 && interrupted ())
+        {
+          lock_guard<std::mutex> lock (mutex);
+          if (running)
+            continue;
+        }
+      return false;
+    }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// hummstrummengine::debug::profiling::ProfileStreamReader implementation
+
+ProfileStreamReader::ProfileStreamReader (string address, string capture)
+  : socket (NO_SOCKET),
+    file (),
+    capture (),
+    buffer (1 << 16),
+    position (0),
+    used (0),
+    ticksPerSecond (0),
+    dropped (0),
+    record (),
+    sites (),
+    metrics (),
+    threadNames ()
+{
+  if (address.compare (0, 5, "file:") == 0)
+    {
+      file.open (address.substr (5), ios_base::in | ios_base::binary);
+      if (!file)
+        throw runtime_error ("Could not open the capture " +
+                             address.substr (5) + ".");
+    }
+  else
+    {
+      Address where = parseAddress (address);
+      startSockets ();
+      socket = openSocket (where, false);
+      if (socket == NO_SOCKET)
+        {
+          stopSockets ();
+          throw runtime_error ("Could not connect to " + address + ".");
+        }
+    }
+
+  if (!capture.empty ())
+    {
+      this->capture.open (capture, ios_base::out | ios_base::binary |
+                          ios_base::trunc);
+      if (!this->capture)
+        {
+          Close ();
+          throw runtime_error ("Could not create the capture " + capture +
+                               ".");
+        }
+    }
+
+  char header[sizeof profilestream::magic + 1];
+  if (!Read (header, sizeof header) ||
+      memcmp (header, profilestream::magic, sizeof profilestream::magic) !=
+        0 ||
+      static_cast<unsigned char> (header[sizeof profilestream::magic]) !=
+        profilestream::version ||
+      !ReadVarint (ticksPerSecond) || ticksPerSecond == 0)
+    {
+      Close ();
+      throw runtime_error (address + " isn't a profile stream of version " +
+                           to_string (profilestream::version) + ".");
+    }
+}
+
+ProfileStreamReader::~ProfileStreamReader ()
+{
+  Close ();
+}
+
+bool
+ProfileStreamReader::Next (ZoneFrame &frame, vector<MetricValue> &values)
+{
+  for (;;)
+    {
+      char type;
+      uint64_t length;
+      if (!Read (&type, 1))
+        return false;
+      if (!ReadVarint (length) || length > MAX_RECORD)
+        throw runtime_error ("The profile stream has a bad record.");
+      record.resize (static_cast<size_t> (length));
+      if (length != 0 && !Read (record.data (), record.size ()))
+        throw runtime_error ("The profile stream ends in the middle of a "
+                             "record.");
+
+      const char *at = record.data ();
+      const char *end = at + record.size ();
+      // Converts ticks to nanoseconds.
+      auto nanoseconds = [this] (uint64_t ticks) -> uint64_t {
+        if (ticksPerSecond == nanosecondTicks)
+          return ticks;
+        return ticks / ticksPerSecond * nanosecondTicks +
+          ticks % ticksPerSecond * nanosecondTicks / ticksPerSecond;
+      };
+
+      switch (static_cast<RecordType> (type))
+        {
+        case RecordType::threadName:
+          {
+            unsigned thread = static_cast<unsigned> (getVarint (at,
+                                                                end));
+            threadNames[thread].assign (at, end);
+          }
+          break;
+
+        case RecordType::zoneSite:
+          {
+            uint64_t id = getVarint (at, end);
+            unsigned line = static_cast<unsigned> (getVarint (at, end));
+            if (sites.count (id) != 0)
+              break;
+            string names[3];
+            for (auto &name : names)
+              {
+                const char *stop = static_cast<const char *> (
+                  memchr (at, '\0', end - at));
+                if (!stop)
+                  throw runtime_error ("The profile stream has a bad "
+                                       "record.");
+                name.assign (at, stop);
+                at = stop + 1;
+              }
+            Site &site = sites[id];
+            site.name = names[0];
+            site.function = names[1];
+            site.file = names[2];
+            site.site.name = site.name.c_str ();
+            site.site.function = site.function.c_str ();
+            site.site.file = site.file.c_str ();
+            site.site.line = line;
+          }
+          break;
+
+        case RecordType::metric:
+          {
+            uint64_t id = getVarint (at, end);
+            if (at == end)
+              throw runtime_error ("The profile stream has a bad record.");
+            Metric &metric = metrics[id];
+            metric.kind = *at++ == 0 ? MetricKind::counter :
+              MetricKind::gauge;
+            metric.name.assign (at, end);
+          }
+          break;
+
+        case RecordType::frame:
+          {
+            frame.number = getVarint (at, end);
+            uint64_t begin = getVarint (at, end);
+            frame.begin = nanoseconds (begin);
+            frame.end = nanoseconds (begin + getVarint (at, end));
+            frame.dropped = getVarint (at, end);
+            dropped = getVarint (at, end);
+            uint64_t threads = getVarint (at, end);
+            // Each thread takes at least two bytes.
+            if (threads > static_cast<uint64_t> (end - at) / 2)
+              throw runtime_error ("The profile stream has a bad record.");
+            frame.threads.resize (static_cast<size_t> (threads));
+            vector<size_t> open;
+            for (auto &thread : frame.threads)
+              {
+                thread.thread = static_cast<unsigned> (getVarint (at,
+                                                                  end));
+                thread.name = threadNames[thread.thread];
+                uint64_t zones = getVarint (at, end);
+                // Each zone takes at least four bytes.
+                if (zones > static_cast<uint64_t> (end - at) / 4)
+                  throw runtime_error ("The profile stream has a bad "
+                                       "record.");
+                thread.zones.resize (static_cast<size_t> (zones));
+                open.clear ();
+                for (size_t index = 0; index < thread.zones.size (); ++index)
+                  {
+                    Zone &zone = thread.zones[index];
+                    auto site = sites.find (getVarint (at, end));
+                    if (site == sites.end ())
+                      throw runtime_error ("The profile stream has a zone "
+                                           "from an unknown site.");
+                    zone.site = &site->second.site;
+                    uint64_t zoneBegin = begin +
+                      Unzigzag (getVarint (at, end));
+                    zone.begin = nanoseconds (zoneBegin);
+                    zone.end = nanoseconds (zoneBegin +
+                                            getVarint (at, end));
+                    zone.depth = static_cast<unsigned> (getVarint (at,
+                                                                   end));
+                    // Zones come in preorder, so the parent is the last
+                    // zone entered that is less deep.
+                    while (open.size () > zone.depth)
+                      open.pop_back ();
+                    zone.parent = open.empty () ? Zone::noParent :
+                      open.back ();
+                    open.push_back (index);
+                  }
+              }
+
+            uint64_t count = getVarint (at, end);
+            if (count > static_cast<uint64_t> (end - at) / 2)
+              throw runtime_error ("The profile stream has a bad record.");
+            values.clear ();
+            for (uint64_t i = 0; i < count; ++i)
+              {
+                auto metric = metrics.find (getVarint (at, end));
+                if (metric == metrics.end ())
+                  throw runtime_error ("The profile stream has an unknown "
+                                       "metric.");
+                MetricValue value = {
+                  metric->second.name.c_str (), metric->second.kind,
+                  Unzigzag (getVarint (at, end))
+                };
+                values.push_back (value);
+              }
+            if (capture.is_open ())
+              capture.flush ();
+          }
+          return true;
+
+        case RecordType::end:
+          return false;
+
+        default:
+          // A record this version doesn't know about.
+          break;
+        }
+    }
+}
+
+void
+ProfileStreamReader::Close ()
+{
+  if (socket != NO_SOCKET)
+    {
+      closeSocket (socket);
+      socket = NO_SOCKET;
+      stopSockets ();
+    }
+}
+
+bool
+ProfileStreamReader::Read (char *bytes, size_t length)
+{
+  while (length != 0)
+    {
+      if (position == used)
+        {
+          position = 0;
+          used = 0;
+          size_t got;
+          if (socket != NO_SOCKET)
+            {
+              int received = static_cast<int> (
+                ::recv (socket, buffer.data (),
+                        static_cast<int> (buffer.size ()), 0));
+              if (received < 0 && interrupted ())
+                continue;
+              if (received <= 0)
+                return false;
+              got = static_cast<size_t> (received);
+            }
+          else
+            {
+              file.read (buffer.data (), buffer.size ());
+              got = static_cast<size_t> (file.gcount ());
+              if (got == 0)
+                return false;
+            }
+          if (capture.is_open ())
+            capture.write (buffer.data (), got);
+          used = got;
+        }
+
+      size_t taken = used - position < length ? used - position : length;
+      memcpy (bytes, buffer.data () + position, taken);
+      position += taken;
+      bytes += taken;
+      length -= taken;
+    }
+  return true;
+}
+
+bool
+ProfileStreamReader::ReadVarint (uint64_t &value)
+{
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+      char c;
+      if (!Read (&c, 1))
+        return false;
+      value |= static_cast<uint64_t> (c & 0x7f) << shift;
+      if (!(c & 0x80))
+        return true;
+    }
+  throw runtime_error ("The profile stream has a varint that is too long.");
+}
+
+
+}
+}
+}
@@ -0,0 +1,125 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+namespace detail {
+
+// Zero-initialized before anything runs, so the clock reads steady_clock until
+// it is calibrated.
+TscCalibration tscCalibration;
+
+}
+
+namespace {
+
+/// Keeps two threads from calibrating at once.
+mutex calibrating;
+
+#ifdef HUMMSTRUMM_ENGINE_HAVE_TSC
+// Reads steady_clock and the counter at about the same time.  The counter is
+// read on both sides of steady_clock, a few times, and the closest pair wins.
+uint64_t
+readBoth (int64_t &nanoseconds)
+{
+  uint64_t best = 0;
+  uint64_t bestWidth = ~uint64_t (0);
+  for (unsigned i = 0; i < 5; ++i)
+    {
+      uint64_t before = __rdtsc ();
+      int64_t now = chrono::duration_cast<chrono::nanoseconds> (
+        chrono::steady_clock::now ().time_since_epoch ()).count ();
+      uint64_t after = __rdtsc ();
+      if (after >= before && after - before < bestWidth)
+        {
+          bestWidth = after - before;
+          best = before + bestWidth / 2;
+          nanoseconds = now;
+        }
+    }
+  return best;
+}
+#endif
+
+}
+
+void
+TscClock::Calibrate (const system::Processors &processors,
+                     chrono::nanoseconds length)
+{
+  detail::TscCalibration &calibration = detail::tscCalibration;
+  lock_guard<mutex> lock (calibrating);
+  // Other threads may be reading the calibration through now() once the
+  // counter is in use, so it is only ever written while they read
+  // steady_clock.
+  if (calibration.source.load (memory_order_acquire) !=
+      static_cast<int> (TscSource::steadyClock))
+    return;
+
+#ifdef HUMMSTRUMM_ENGINE_HAVE_TSC
+  // A counter that changes speed or stops with the processor isn't a clock.
+  if (!processors.HaveInvariantTscSupport ())
+    return;
+
+  int64_t start = 0;
+  uint64_t startTicks = readBoth (start);
+  int64_t end = start;
+  uint64_t endTicks = startTicks;
+  while (end - start < length.count ())
+    endTicks = readBoth (end);
+  if (endTicks <= startTicks || end <= start)
+    return;
+
+  calibration.ticks = endTicks;
+  calibration.nanoseconds = end;
+  calibration.nanosecondsPerTick =
+    static_cast<double> (end - start) /
+    static_cast<double> (endTicks - startTicks);
+  calibration.source.store (
+    static_cast<int> (processors.HaveRdtscpSupport () ? TscSource::rdtscp :
+                      TscSource::rdtsc),
+    memory_order_release);
+#else
+  // There's no counter to use.
+  (void) processors;
+  (void) length;
+#endif
+}
+
+double
+TscClock::GetTicksPerSecond () /* noexcept */
+{
+  if (GetSource () == TscSource::steadyClock)
+    return 0;
+  return 1e9 / detail::tscCalibration.nanosecondsPerTick;
+}
+
+
+}
+}
+}
@@ -0,0 +1,454 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hummstrummengine.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace hummstrummengine {
+namespace debug {
+namespace profiling {
+
+namespace detail {
+
+// A zone starting or ending.
+struct ZoneEvent
+{
+    uint64_t timestamp;         // A TscClock time, in nanoseconds.
+    const ZoneSite *site;       // nullptr when a zone ends.
+};
+
+// The zones one thread recorded that the collector thread hasn't taken yet.
+// This is a single-producer single-consumer ring: the thread writes events at
+// head, and the collector reads them from tail.
+struct ZoneBuffer
+{
+    ZoneBuffer (size_t capacity, unsigned thread)
+      : events (new ZoneEvent[capacity]),
+        mask (capacity - 1),
+        thread (thread),
+        open (0),
+        skipped (0),
+        head (0),
+        tail (0),
+        dropped (0),
+        name (),
+        pending (),
+        pendingStart (0),
+        stack (),
+        droppedSeen (0)
+    {
+      pending.reserve (capacity);
+      stack.reserve (64);
+    }
+
+    void
+    Begin (const ZoneSite &site, uint64_t timestamp)
+    {
+      if (skipped != 0)
+        {
+          // We're inside a zone that was dropped, so drop this one too.
+          ++skipped;
+          dropped.fetch_add (1, memory_order_relaxed);
+          return;
+        }
+
+      // Keep room for the end of this zone and of every zone it is inside, so
+      // that a zone that was recorded never loses its end.
+      uint64_t position = head.load (memory_order_relaxed);
+      if (position - tail.load (memory_order_acquire) + open + 2 > mask + 1)
+        {
+          ++skipped;
+          dropped.fetch_add (1, memory_order_relaxed);
+          return;
+        }
+
+      ZoneEvent &event = events[position & mask];
+      event.timestamp = timestamp;
+      event.site = &site;
+      head.store (position + 1, memory_order_release);
+      ++open;
+    }
+
+    void
+    End (uint64_t timestamp)
+    {
+      if (skipped != 0)
+        {
+          --skipped;
+          return;
+        }
+      // A zone entered before the ZoneProfiler was made.
+      if (open == 0)
+        return;
+
+      uint64_t position = head.load (memory_order_relaxed);
+      ZoneEvent &event = events[position & mask];
+      event.timestamp = timestamp;
+      event.site = nullptr;
+      head.store (position + 1, memory_order_release);
+      --open;
+    }
+
+    // Only used by the thread that records zones.
+    unique_ptr<ZoneEvent[]> events;
+    size_t mask;
+    unsigned thread;
+    unsigned open;              // Recorded zones that haven't ended.
+    unsigned skipped;           // Dropped zones that haven't ended.
+
+    // The thread and the collector thread write these; keep them on
+    // different cache lines.
+    char padding0[64];
+    atomic<uint64_t> head;
+    char padding1[64 - sizeof (atomic<uint64_t>)];
+    atomic<uint64_t> tail;
+    char padding2[64 - sizeof (atomic<uint64_t>)];
+    atomic<uint64_t> dropped;
+    char padding3[64 - sizeof (atomic<uint64_t>)];
+
+    // Only changed with the ZoneProfiler's mutex held.
+    string name;
+
+    // Only used by the collector thread.
+    vector<ZoneEvent> pending;  // Taken from the ring, for later frames.
+    size_t pendingStart;        // The first event in pending not used yet.
+    vector<size_t> stack;       // The open zones in this frame's zones.
+    vector<const ZoneSite *> openSites; // The sites of the open zones.
+    uint64_t droppedSeen;       // The value of dropped at the last frame.
+};
+
+}
+
+namespace {
+
+/// The ZoneProfiler that zones are recorded in.
+atomic<ZoneProfiler *> activeProfiler (nullptr);
+/// Hands out ZoneProfiler ids, so a thread can tell a new ZoneProfiler from an
+/// old one.
+atomic<unsigned long> nextProfilerId (1);
+
+/// The id of the ZoneProfiler this thread last recorded zones in.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL unsigned long cachedProfilerId = 0;
+/// This thread's buffer in that ZoneProfiler.
+HUMMSTRUMM_ENGINE_THREAD_LOCAL detail::ZoneBuffer *cachedBuffer = nullptr;
+
+// Reads the clock zones are timed with.  This is all a zone pays for its
+// times; they are turned into timestamps on the collector thread.
+inline uint64_t
+readClock ()
+{
+  return static_cast<uint64_t> (TscClock::now ().time_since_epoch ().count ());
+}
+
+// Rounds up to a power of two.
+size_t
+roundUp (size_t value)
+{
+  size_t rounded = 1;
+  while (rounded < value)
+    rounded <<= 1;
+  return rounded;
+}
+
+}
+
+const size_t Zone::noParent;
+
+////////////////////////////////////////////////////////////////////////////////
+// hummstrummengine::debug::profiling::ZoneProfiler implementation
+
+ZoneProfiler::ZoneProfiler (FrameHandler handler, size_t eventsPerThread)
+  : handler (handler),
+    eventsPerThread (roundUp (eventsPerThread < 64 ? 64 : eventsPerThread)),
+    id (nextProfilerId.fetch_add (1)),
+    buffers (),
+    collecting (),
+    frameEnds (),
+    building (),
+    framesEnded (0),
+    framesHandled (0),
+    running (true),
+    frameBegin (0),
+    wallOffset (0),
+    frame (),
+    mutex (),
+    frameEnded (),
+    frameHandled (),
+    collector ()
+{
+  // Read the clock on both sides of the timestamp, to find what to add to its
+  // times to make them timestamps.
+  uint64_t before = readClock ();
+  uint64_t wall = logging::GetTimestamp ();
+  uint64_t after = readClock ();
+  wallOffset = wall - (before + (after - before) / 2);
+  frameBegin = after;
+
+  frame.number = 0;
+  frame.begin = frameBegin + wallOffset;
+  frame.end = frame.begin;
+  frame.dropped = 0;
+  frameEnds.reserve (16);
+  building.reserve (16);
+
+  ZoneProfiler *none = nullptr;
+  if (!activeProfiler.compare_exchange_strong (none, this))
+    throw logic_error ("Only one ZoneProfiler can exist at a time.");
+  try
+    {
+      collector = thread (&ZoneProfiler::Run, this);
+    }
+  catch (...)
+    {
+      activeProfiler.store (nullptr);
+      throw;
+    }
+}
+
+ZoneProfiler::~ZoneProfiler ()
+{
+  activeProfiler.store (nullptr);
+  {
+    lock_guard<std::mutex> lock (mutex);
+    running = false;
+  }
+  frameEnded.notify_one ();
+  collector.join ();
+}
+
+void
+ZoneProfiler::RegisterThread (const string &name)
+{
+  detail::ZoneBuffer &buffer = FindThreadBuffer ();
+  {
+    lock_guard<std::mutex> lock (mutex);
+    buffer.name = name;
+  }
+  cachedBuffer = &buffer;
+  cachedProfilerId = id;
+}
+
+void
+ZoneProfiler::EndFrame ()
+{
+  uint64_t now = readClock ();
+  {
+    lock_guard<std::mutex> lock (mutex);
+    frameEnds.push_back (now);
+    ++framesEnded;
+  }
+  frameEnded.notify_one ();
+}
+
+void
+ZoneProfiler::Flush ()
+{
+  unique_lock<std::mutex> lock (mutex);
+  uint64_t target = framesEnded;
+  frameHandled.wait (lock, [this, target]() {
+      return framesHandled >= target;
+    });
+}
+
+uint64_t
+ZoneProfiler::GetDropped () const
+{
+  lock_guard<std::mutex> lock (mutex);
+  uint64_t dropped = 0;
+  for (auto i = buffers.begin (); i != buffers.end (); ++i)
+    dropped += (*i)->dropped.load (memory_order_relaxed);
+  return dropped;
+}
+
+ZoneProfiler *
+ZoneProfiler::GetActive ()
+{
+  return activeProfiler.load (memory_order_acquire);
+}
+
+detail::ZoneBuffer &
+ZoneProfiler::FindThreadBuffer ()
+{
+  unsigned thread = logging::GetThreadNumber ();
+  lock_guard<std::mutex> lock (mutex);
+  for (auto i = buffers.begin (); i != buffers.end (); ++i)
+    if ((*i)->thread == thread)
+      return **i;
+
+  buffers.emplace_back (new detail::ZoneBuffer (eventsPerThread, thread));
+  return *buffers.back ();
+}
+
+void
+ZoneProfiler::Run ()
+{
+  unique_lock<std::mutex> lock (mutex);
+  for (;;)
+    {
+      frameEnded.wait (lock, [this]() {
+          return !running || !frameEnds.empty ();
+        });
+      if (frameEnds.empty ())
+        return;
+
+      // Take everything we need from the other threads while the lock is
+      // held, and build the frames without it.
+      building.swap (frameEnds);
+      collecting.clear ();
+      for (auto i = buffers.begin (); i != buffers.end (); ++i)
+        collecting.push_back (i->get ());
+      frame.threads.resize (collecting.size ());
+      for (size_t i = 0; i < collecting.size (); ++i)
+        {
+          frame.threads[i].thread = collecting[i]->thread;
+          frame.threads[i].name = collecting[i]->name;
+        }
+      lock.unlock ();
+
+      for (auto i = building.begin (); i != building.end (); ++i)
+        Collect (*i);
+      size_t built = building.size ();
+      building.clear ();
+
+      lock.lock ();
+      framesHandled += built;
+      frameHandled.notify_all ();
+    }
+}
+
+void
+ZoneProfiler::Collect (uint64_t end)
+{
+  // The events and frame ends are clock times; only the zones handed over are
+  // turned into timestamps.
+  frame.begin = frameBegin + wallOffset;
+  frame.end = end + wallOffset;
+  frame.dropped = 0;
+
+  for (size_t i = 0; i < collecting.size (); ++i)
+    {
+      detail::ZoneBuffer &buffer = *collecting[i];
+      vector<Zone> &zones = frame.threads[i].zones;
+      zones.clear ();
+
+      // Take the new events out of the ring, after the ones left over from
+      // the last frame.
+      buffer.pending.erase (buffer.pending.begin (),
+                            buffer.pending.begin () + buffer.pendingStart);
+      buffer.pendingStart = 0;
+      uint64_t head = buffer.head.load (memory_order_acquire);
+      uint64_t tail = buffer.tail.load (memory_order_relaxed);
+      for (; tail != head; ++tail)
+        buffer.pending.push_back (buffer.events[tail & buffer.mask]);
+      buffer.tail.store (tail, memory_order_release);
+
+      // Continue the zones that were still open at the end of the last frame.
+      buffer.stack.clear ();
+      for (size_t depth = 0; depth < buffer.openSites.size (); ++depth)
+        {
+          Zone zone;
+          zone.site = buffer.openSites[depth];
+          zone.begin = frame.begin;
+          zone.end = frame.end;
+          zone.depth = static_cast<unsigned> (depth);
+          zone.parent = depth == 0 ? Zone::noParent : depth - 1;
+          zones.push_back (zone);
+          buffer.stack.push_back (depth);
+        }
+
+      // Events after the end of the frame were recorded after EndFrame() was
+      // called, and wait for the next frame.
+      for (; buffer.pendingStart < buffer.pending.size () &&
+             buffer.pending[buffer.pendingStart].timestamp <= end;
+           ++buffer.pendingStart)
+        {
+          const detail::ZoneEvent &event = buffer.pending[buffer.pendingStart];
+          if (event.site)
+            {
+              Zone zone;
+              zone.site = event.site;
+              zone.begin = event.timestamp + wallOffset;
+              zone.end = frame.end;
+              zone.depth = static_cast<unsigned> (buffer.stack.size ());
+              zone.parent = buffer.stack.empty () ? Zone::noParent :
+                buffer.stack.back ();
+              buffer.stack.push_back (zones.size ());
+              buffer.openSites.push_back (event.site);
+              zones.push_back (zone);
+            }
+          else if (!buffer.stack.empty ())
+            {
+              zones[buffer.stack.back ()].end = event.timestamp + wallOffset;
+              buffer.stack.pop_back ();
+              buffer.openSites.pop_back ();
+            }
+        }
+
+      uint64_t dropped = buffer.dropped.load (memory_order_relaxed);
+      frame.dropped += dropped - buffer.droppedSeen;
+      buffer.droppedSeen = dropped;
+    }
+
+  if (handler)
+    handler (frame);
+
+  frameBegin = end;
+  ++frame.number;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Recording zones
+
+void
+BeginZone (const ZoneSite &site)
+{
+  ZoneProfiler *profiler = activeProfiler.load (memory_order_acquire);
+  if (!profiler)
+    return;
+  if (HUMMSTRUMM_ENGINE_UNLIKELY (cachedProfilerId != profiler->id))
+    {
+      cachedBuffer = &profiler->FindThreadBuffer ();
+      cachedProfilerId = profiler->id;
+    }
+  cachedBuffer->Begin (site, readClock ());
+}
+
+void
+EndZone ()
+{
+  ZoneProfiler *profiler = activeProfiler.load (memory_order_acquire);
+  if (!profiler || cachedProfilerId != profiler->id)
+    return;
+  cachedBuffer->End (readClock ());
+}
+
+
+}
+}
+}
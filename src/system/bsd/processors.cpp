@@ -38,7 +38,9 @@ Processors::Processors ()
     sse2Support (false),
     sse3Support (false),
     sse41Support (false),
-    sse42Support (false)
+    sse42Support (false),
+    invariantTscSupport (false),
+    rdtscpSupport (false)
 {
   int mib[2];
   std::size_t length;
@@ -116,6 +118,13 @@ Processors::Processors ()
           sse3Support  = regC & bit_SSE3;
           sse2Support  = regD & bit_SSE2;
           sseSupport   = regD & bit_SSE;
+
+          // Look for an invariant TSC and rdtscp.  __get_cpuid returns 0 if
+          // the leaf isn't there.
+          if (__get_cpuid (0x80000001, &regA, &regB, &regC, &regD))
+            rdtscpSupport = (regD & (1 << 27)) != 0;
+          if (__get_cpuid (0x80000007, &regA, &regB, &regC, &regD))
+            invariantTscSupport = (regD & (1 << 8)) != 0;
         }
     }
   delete [] name;
@@ -35,7 +35,9 @@ Processors::Processors ()
       sse2Support (false),
       sse3Support (false),
       sse41Support (false),
-      sse42Support (false)
+      sse42Support (false),
+      invariantTscSupport (false),
+      rdtscpSupport (false)
 {
   // We get our info from /proc/cpuinfo
   std::ifstream cpuinfo ("/proc/cpuinfo");
@@ -95,6 +97,12 @@ Processors::Processors ()
             sse41Support = true;
           if (std::string::npos != line.find (sse42Flag))
             sse42Support = true;
+          // The kernel splits the invariant TSC bit in two.
+          if (std::string::npos != line.find ("constant_tsc") &&
+              std::string::npos != line.find ("nonstop_tsc"))
+            invariantTscSupport = true;
+          if (std::string::npos != line.find ("rdtscp"))
+            rdtscpSupport = true;
 
           continue;
         }
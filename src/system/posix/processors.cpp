@@ -35,7 +35,9 @@ Processors::Processors ()
     sse2Support (false),
     sse3Support (false),
     sse41Support (false),
-    sse42Support (false)
+    sse42Support (false),
+    invariantTscSupport (false),
+    rdtscpSupport (false)
 {
   // I don't know of a way to do this with just POSIX functions, so only assume
   // one processor with unknown name.
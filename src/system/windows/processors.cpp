@@ -33,7 +33,9 @@ Processors::Processors ()
     sse2Support (false),
     sse3Support (false),
     sse41Support (false),
-    sse42Support (false)
+    sse42Support (false),
+    invariantTscSupport (false),
+    rdtscpSupport (false)
 {  
   // Get the system information.
   SYSTEM_INFO systemInfo;
@@ -102,6 +104,18 @@ Processors::Processors ()
   sse3Support  = (cpuInfo[2] & (1 << 0)) != 0;
   sse2Support  = (cpuInfo[3] & (1 << 26)) != 0;
   sseSupport   = (cpuInfo[3] & (1 << 25)) != 0;
+
+  // Look for an invariant TSC and rdtscp.
+  if (extendedIds >= 0x80000001)
+    {
+      __cpuid (cpuInfo, 0x80000001);
+      rdtscpSupport = (cpuInfo[3] & (1 << 27)) != 0;
+    }
+  if (extendedIds >= 0x80000007)
+    {
+      __cpuid (cpuInfo, 0x80000007);
+      invariantTscSupport = (cpuInfo[3] & (1 << 8)) != 0;
+    }
 }
 
 }
@@ -61,8 +61,7 @@ WindowSystem::DestroyWindow()
     {
       error = GetLastError();
       std::string errMsg = GetErrorMessage("wglMakeCurrent: ",error);
-      core::Engine::GetEngine ()->GetLog ()
-        << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning)
+      HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::warning)
         << errMsg << std::flush;
     }
     BOOL ctxDeleted = wglDeleteContext(renderingContext);
@@ -70,8 +69,7 @@ WindowSystem::DestroyWindow()
     {
       error = GetLastError();
       std::string errMsg = GetErrorMessage("wglDeleteContext: ",error);
-      core::Engine::GetEngine ()->GetLog ()
-        << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning)
+      HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::warning)
         << errMsg << std::flush;
     }  
     renderingContext = NULL; 
@@ -83,8 +81,7 @@ WindowSystem::DestroyWindow()
       deviceContext = NULL;
       error = GetLastError();
       std::string errMsg = GetErrorMessage("ReleaseDC: ",error);
-      core::Engine::GetEngine ()->GetLog ()
-        << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning)
+      HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::warning)
         << errMsg << std::flush;
   } 
 
@@ -94,8 +91,7 @@ WindowSystem::DestroyWindow()
       windowHandle = NULL;
       error = GetLastError();
       std::string errMsg = GetErrorMessage("DestroyWindow: ",error);
-      core::Engine::GetEngine ()->GetLog ()
-        << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning)
+      HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::warning)
         << errMsg << std::flush;
   }
 
@@ -105,8 +101,7 @@ WindowSystem::DestroyWindow()
       moduleHandle = NULL; 
       error = GetLastError();
       std::string errMsg = GetErrorMessage("UnregisteredClass: ",error);
-      core::Engine::GetEngine ()->GetLog ()
-        << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning)
+      HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::warning)
         << errMsg << std::flush;
   }
 
@@ -404,8 +399,7 @@ WindowSystem::SetMode(WindowVisualInfo &param)
     LONG ret = ChangeDisplaySettings(&dmScreenSettings,CDS_FULLSCREEN);
     if (ret != DISP_CHANGE_SUCCESSFUL)
     {
-      core::Engine::GetEngine ()->GetLog ()
-        << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning)
+      HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::warning)
         << "Window doesn't support fullscreen." << std::flush;
       param.useFullscreen = false;
       return;
@@ -514,8 +508,7 @@ WindowSystem::InitializeWGLExtensions()
   if (wglGetExtensionsStringARB != NULL)
   {
     const char * extensionsARB = wglGetExtensionsStringARB(deviceContext);
-    core::Engine::GetEngine ()->GetLog ()
-      << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning)
+    HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::warning)
       << "Supported WGL ARB Extensions : " << extensionsARB << std::flush;
   }
 
@@ -525,8 +518,7 @@ WindowSystem::InitializeWGLExtensions()
   if (wglGetExtensionsStringEXT != NULL)
   {
     const char * extensionsEXT = wglGetExtensionsStringEXT();
-    core::Engine::GetEngine ()->GetLog ()
-      << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning)
+    HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::warning)
       << "Supported WGL EXT Extensions : " << extensionsEXT << std::flush;
   }
 
@@ -63,7 +63,7 @@ WindowSystem::WindowSystem()
   wndProtocols = XInternAtom(dpy, "WM_PROTOCOLS", False);
   wndDelete = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
 
-  core::Engine::GetEngine ()->GetLog () << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
+  HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::info)
     << "Supported GLX version: " << major << '.' << minor << std::flush;
 
   swapIntervalAddr = NULL;
@@ -143,8 +143,7 @@ WindowSystem::DestroyWindow()
     XDestroyWindow(dpy, window);
   else
   {
-    core::Engine::GetEngine ()->GetLog ()
-      << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning)
+    HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::warning)
       << "Cannot destroy window.  Display is " << dpy
       << " and Window is " << window << std::flush;
   }
@@ -172,8 +171,7 @@ WindowSystem::CreatePbuffer(WindowVisualInfo &param)
     GLXFBConfig *fbconfig;
     const int* attribList;
     
-    core::Engine::GetEngine ()->GetLog ()
-      << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
+    HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::info)
       << "Creating pixel buffer for offscreen rendering" << std::flush;
     if (createPbufferAddr == NULL || destroyPbufferAddr == NULL)
     {
@@ -252,7 +250,7 @@ WindowSystem::InitializeGLXExtensions()
 
   const char* extensions =  glXQueryExtensionsString(dpy, screen);
 
-  core::Engine::GetEngine ()->GetLog () << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
+  HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::info)
     << "Available GLX extensions: " << extensions << std::flush;
 
   if (IsGLXExtensionSupported("GLX_SGI_swap_control",(const GLubyte *) extensions))
@@ -496,12 +494,10 @@ WindowSystem::CreateWindow(WindowVisualInfo &windowParameters)
     glXMakeCurrent(dpy,window,windowContext);
 
   if (glXIsDirect(dpy,windowContext))
-    core::Engine::GetEngine ()->GetLog ()
-      << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
+    HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::info)
       << "DRI enabled" << std::flush;
   else
-    core::Engine::GetEngine ()->GetLog ()
-      << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning)
+    HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::warning)
       << "DRI not enabled" << std::flush;
 
   if ( swapIntervalAddr != NULL)
@@ -602,8 +598,7 @@ WindowSystem::SetMode(WindowVisualInfo &param)
           glXQueryDrawable(dpy, pbuffer, GLX_PRESERVED_CONTENTS, &state);
           if (state == 0)
           {
-            core::Engine::GetEngine ()->GetLog ()
-              << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning)
+            HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::warning)
               << "Pbuffer contents have been lost!" << std::flush;
             DestroyPbuffer();
             CreatePbuffer(param);   
@@ -615,8 +610,7 @@ WindowSystem::SetMode(WindowVisualInfo &param)
     }
 
     // Set fullscreen (fallback)
-    core::Engine::GetEngine ()->GetLog ()
-      << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning)
+    HUMMSTRUMM_ENGINE_LOG (core::Engine::GetEngine ()->GetLog (), Level::warning)
       << "The Window Manager doesn't support NETWM. "
       << "Using fullscreen fallback mode"
       << std::flush;
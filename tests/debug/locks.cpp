@@ -0,0 +1,170 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug;
+
+int
+main ()
+{
+  struct LocksTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (14);
+
+      unsigned rate = LockProfiler::GetSampleRate ();
+      is (rate, 64u, "One in 64 holds is timed by default.");
+
+      {
+        Mutex plain ("test_plain");
+        for (int i = 0; i < 10; ++i)
+          std::lock_guard<Mutex> lock (plain);
+        ok (plain.try_lock (), "A free Mutex can be tried.");
+        bool taken = true;
+        std::thread other ([&plain, &taken] ()
+                           {
+                             taken = plain.try_lock ();
+                             if (taken)
+                               plain.unlock ();
+                           });
+        other.join ();
+        plain.unlock ();
+        ok (!taken, "A held Mutex can't be tried.");
+      }
+      LockCounts counts;
+      ok (LockProfiler::GetLock ("test_plain", counts) &&
+          counts.acquisitions == 11 && counts.sharedAcquisitions == 0 &&
+          counts.contentions == 0,
+          "Uncontended acquisitions are counted.");
+      ok (!LockProfiler::GetLock ("test_none", counts),
+          "There are no counts for unknown locks.");
+
+      {
+        Mutex contended ("test_contended");
+        std::unique_lock<Mutex> lock (contended);
+        std::thread other ([&contended] ()
+                           {
+                             std::lock_guard<Mutex> lock (contended);
+                           });
+        std::this_thread::sleep_for (std::chrono::milliseconds (20));
+        lock.unlock ();
+        other.join ();
+      }
+      LockProfiler::GetLock ("test_contended", counts);
+      ok (counts.acquisitions == 2 && counts.contentions == 1 &&
+          counts.waitTime >= std::chrono::milliseconds (10) &&
+          counts.maxWaitTime == counts.waitTime,
+          "Waiting for a Mutex is counted and timed.");
+
+      LockProfiler::SetSampleRate (1);
+      {
+        Mutex held ("test_held");
+        std::lock_guard<Mutex> lock (held);
+        std::this_thread::sleep_for (std::chrono::milliseconds (10));
+      }
+      LockProfiler::GetLock ("test_held", counts);
+      ok (counts.holdTime >= std::chrono::milliseconds (5),
+          "Sampled holds are timed.");
+
+      LockProfiler::SetSampleRate (0);
+      {
+        Mutex untimed ("test_untimed");
+        std::lock_guard<Mutex> lock (untimed);
+      }
+      LockProfiler::GetLock ("test_untimed", counts);
+      ok (counts.acquisitions == 1 && counts.holdTime.count () == 0,
+          "Holds aren't timed with a sample rate of 0.");
+      LockProfiler::SetSampleRate (64);
+
+      {
+        SharedMutex shared ("test_shared");
+        shared.lock_shared ();
+        bool both = shared.try_lock_shared ();
+        bool exclusive = shared.try_lock ();
+        ok (both && !exclusive,
+            "A SharedMutex can be shared, but not taken while shared.");
+        shared.unlock_shared ();
+        shared.unlock_shared ();
+
+        shared.lock ();
+        bool sharing = shared.try_lock_shared ();
+        ok (!sharing, "A SharedMutex can't be shared while taken.");
+        shared.unlock ();
+
+        shared.lock_shared ();
+        std::thread writer ([&shared] ()
+                            {
+                              std::lock_guard<SharedMutex> lock (shared);
+                            });
+        std::this_thread::sleep_for (std::chrono::milliseconds (20));
+        shared.unlock_shared ();
+        writer.join ();
+      }
+      LockProfiler::GetLock ("test_shared", counts);
+      ok (counts.acquisitions == 5 && counts.sharedAcquisitions == 3 &&
+          counts.contentions == 1 &&
+          counts.waitTime >= std::chrono::milliseconds (10),
+          "SharedMutex acquisitions and waits are counted.");
+
+      {
+        Mutex again ("test_plain");
+        std::lock_guard<Mutex> lock (again);
+      }
+      LockProfiler::GetLock ("test_plain", counts);
+      is (counts.acquisitions, std::uint64_t (12),
+          "Locks with one name count together.");
+
+      bool threw = false;
+      try
+        {
+          Mutex tooLong (std::string (100, 'x').c_str ());
+        }
+      catch (std::invalid_argument &)
+        {
+          threw = true;
+        }
+      ok (threw, "Long names are refused.");
+
+      std::ostringstream log;
+      LockProfiler::Log (log);
+      std::string text = log.str ();
+      ok (text.find ("\n  test_contended: 2 acquisition(s), 0 shared, "
+                     "1 contended") != std::string::npos &&
+          text.find ("test_contended") < text.find ("test_plain"),
+          "Log() writes each lock, most contended first.");
+    }
+  } test;
+
+  return test.run ();
+}
@@ -0,0 +1,133 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+#include "recordingbackend.hpp"
+using namespace hummstrummengine::debug::logging;
+
+// Queues a message from the given line.
+bool
+push (AsyncQueue &queue, unsigned line, Level level, const std::string &message)
+{
+  Record record = { 0, "file", line, level, message.data (), message.size () };
+  return queue.Push (record);
+}
+
+int
+main ()
+{
+  struct AsyncQueueTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (9);
+
+      // Every message from every thread arrives, in order per thread.
+      {
+        auto backend = std::make_shared<RecordingBackend> ();
+        {
+          AsyncQueue queue ({ backend }, 16, OverflowPolicy::block);
+          std::vector<std::thread> producers;
+          for (unsigned t = 0; t < 4; ++t)
+            {
+              producers.emplace_back ([&queue, t]() {
+                  for (unsigned i = 0; i < 1000; ++i)
+                    push (queue, t, Level::info, std::to_string (i));
+                });
+            }
+          for (auto &producer : producers)
+            producer.join ();
+          queue.Flush ();
+          is (backend->messages.size (), 4000u,
+              "Blocking queue delivers every message.");
+          is (queue.GetDroppedCount (), 0ull,
+              "Blocking queue drops nothing.");
+        }
+
+        std::vector<unsigned> next (4, 0);
+        bool ordered = true;
+        for (std::size_t i = 0; i < backend->messages.size (); ++i)
+          {
+            unsigned t = backend->lines[i];
+            if (backend->messages[i] != std::to_string (next[t]++))
+              ordered = false;
+          }
+        ok (ordered, "Messages from one thread stay in order.");
+      }
+
+      // A full queue drops the new messages and says so.
+      {
+        hummstrummengine::debug::Counter written ("log_messages_written");
+        hummstrummengine::debug::Counter dropped ("log_messages_dropped");
+        std::int64_t before = written.GetTotal () + dropped.GetTotal ();
+        auto backend = std::make_shared<RecordingBackend> ();
+        backend->gateOpen = false;
+        AsyncQueue queue ({ backend }, 2, OverflowPolicy::dropNewest);
+        unsigned accepted = 0;
+        for (unsigned i = 0; i < 100; ++i)
+          if (push (queue, i, Level::info, std::to_string (i)))
+            ++accepted;
+        ok (accepted < 100u, "Full queue refuses new messages.");
+        is (queue.GetDroppedCount (), 100ull - accepted,
+            "Dropped messages are counted.");
+        backend->gateOpen = true;
+        queue.Flush ();
+        push (queue, 100, Level::info, "last");
+        queue.Flush ();
+        unsigned long reported = 0;
+        for (std::size_t i = 0; i < backend->messages.size (); ++i)
+          if (backend->levels[i] == Level::warning)
+            reported += std::stoul (backend->messages[i]);
+        is (reported, 100ul - accepted,
+            "Dropped messages are reported to the backends.");
+        is (backend->messages.back (), std::string ("last"),
+            "Queue keeps working after dropping messages.");
+        is (written.GetTotal () + dropped.GetTotal () - before,
+            std::int64_t (101),
+            "Every message pushed is counted as written or dropped.");
+      }
+
+      // Destroying the queue writes what's left.
+      {
+        auto backend = std::make_shared<RecordingBackend> ();
+        {
+          AsyncQueue queue ({ backend }, 64, OverflowPolicy::dropOldest);
+          for (unsigned i = 0; i < 10; ++i)
+            push (queue, i, Level::error, "message");
+        }
+        is (backend->messages.size (), 10u,
+            "Destructor drains the queue.");
+      }
+    }
+  } test;
+
+  return test.run ();
+}
@@ -0,0 +1,145 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug::logging;
+
+const char *const LOG_FILE = "test_binarylog.hslog";
+
+int
+main ()
+{
+  struct BinaryLogTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (9);
+
+      std::time_t now = std::time (0);
+      {
+        BinaryFileBackend backend (Level::info | Level::error, LOG_FILE, 64);
+        std::string big (200, 'x');
+        std::string moved = "moved.cpp";
+        Record records[] = {
+          { now, "first.cpp", 10, Level::info, "Hello", 5 },
+          { now + 2, "second.cpp", 20, Level::error, big.data (), big.size () },
+          { now, "first.cpp", 30, Level::warning, "Filtered", 8 },
+          { now + 3, moved.c_str (), 40, Level::info, "", 0 }
+        };
+        for (auto &record : records)
+          backend (record);
+        // Same address, different name.
+        moved = "other.cpp";
+        Record last = { now, moved.c_str (), 50, Level::info, "Last", 4 };
+        backend (last);
+        Record precise (static_cast<std::uint64_t> (now) * 1000000000u + 42, 7,
+                        "precise.cpp", 60, Level::info, "Precise", 7);
+        backend (precise);
+      }
+
+      std::ifstream in (LOG_FILE, std::ios_base::in | std::ios_base::binary);
+      BinaryLogReader reader (in);
+      Record record;
+      std::string messages, files, lines;
+      unsigned count = 0;
+      std::time_t lastTime = 0;
+      std::uint64_t preciseTimestamp = 0;
+      unsigned preciseThread = 0;
+      while (reader.Next (record))
+        {
+          ++count;
+          messages += std::string (record.message, record.messageLength) + ";";
+          files += std::string (record.file) + ";";
+          lines += std::to_string (record.line) + ";";
+          if (record.line == 20)
+            lastTime = record.time;
+          if (record.line == 60)
+            {
+              preciseTimestamp = record.timestamp;
+              preciseThread = record.thread;
+            }
+        }
+
+      is (count, 5u, "Every accepted message is read back.");
+      is (messages, "Hello;" + std::string (200, 'x') + ";;Last;Precise;",
+          "Messages are read back, including ones bigger than the buffer.");
+      is (files, std::string ("first.cpp;second.cpp;moved.cpp;other.cpp;precise.cpp;"),
+          "File names are read back, even when a name's storage is reused.");
+      is (lines, std::string ("10;20;40;50;60;"), "Lines are read back.");
+      is (lastTime, now + 2, "Timestamps are read back.");
+      ok (reader.GetEpoch () <= now + 1, "Epoch is when the log started.");
+      ok (preciseTimestamp == static_cast<std::uint64_t> (now) * 1000000000u +
+          42 && preciseThread == 7,
+          "Nanoseconds and thread numbers are read back.");
+
+      std::istringstream garbage ("<?xml version=\"1.1\"?>");
+      bool threw = false;
+      try
+        {
+          BinaryLogReader bad (garbage);
+        }
+      catch (const std::runtime_error &)
+        {
+          threw = true;
+        }
+      ok (threw, "Reader refuses files that aren't binary logs.");
+
+      // A header, then a file name with an id that was never handed out, then
+      // a record that claims to be about 2^63 bytes long.
+      std::string header (binarylog::magic, sizeof binarylog::magic);
+      header += static_cast<char> (binarylog::version);
+      header += std::string ("\x01\x00", 2);
+      std::istringstream badId (header + std::string ("\x01\x02\x7f" "a", 4));
+      std::istringstream badLength (header + "\x02" +
+                                    std::string (8, '\xff') + "\x7f");
+      unsigned refused = 0;
+      for (std::istringstream *corrupt : { &badId, &badLength })
+        {
+          try
+            {
+              BinaryLogReader reader (*corrupt);
+              Record record;
+              reader.Next (record);
+            }
+          catch (const std::runtime_error &)
+            {
+              ++refused;
+            }
+        }
+      is (refused, 2u, "Reader refuses corrupt ids and lengths.");
+
+      std::remove (LOG_FILE);
+    }
+  } test;
+
+  return test.run ();
+}
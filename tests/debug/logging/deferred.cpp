@@ -0,0 +1,123 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+#include "recordingbackend.hpp"
+using namespace hummstrummengine::debug::logging;
+
+const char *const LOG_FILE = "test_deferred.hslog";
+
+// Formats a format string and its arguments the way a backend would see them.
+template <typename... Args>
+std::string
+format (const char *string, const Args &... args)
+{
+  std::vector<char> arguments;
+  EncodeArguments (arguments, args...);
+  std::string out;
+  FormatDeferred (out, string, arguments.data (), arguments.size ());
+  return out;
+}
+
+int
+main ()
+{
+  struct DeferredTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (7);
+
+      std::string name = "player";
+      int value = 42;
+      is (format ("{} {} {} {} {} {} {}", -7, 3000000000u, 0.5, 'c', true,
+                  "text", name),
+          std::string ("-7 3000000000 0.5 c 1 text player"),
+          "Each kind of argument is formatted like an ostream would.");
+      is (format ("{}", static_cast<const void *> (nullptr)),
+          std::string ("0x0"), "Pointers are formatted in hexadecimal.");
+      is (format ("{{{}}} and {}}}", 1, 2), std::string ("{1} and 2}"),
+          "Doubled braces are literal braces.");
+      is (format ("{} of {}", value), std::string ("42 of {}"),
+          "Placeholders without arguments are left alone.");
+
+      // With an AsyncQueue, the writer thread formats the message.
+      {
+        auto backend = std::make_shared<RecordingBackend> ();
+        {
+          std::unique_ptr<AsyncQueue> queue (
+            new AsyncQueue ({ backend }, 16, OverflowPolicy::block));
+          StreamBuffer buffer ({ backend }, std::move (queue));
+          std::ostream log (&buffer);
+          HUMMSTRUMM_ENGINE_LOGF (log, Level::info, "Loaded {} of {}.", value,
+                                  name);
+          // The arguments were copied, so changing them now doesn't matter.
+          name = "changed";
+        }
+        is (backend->messages.size () == 1 ? backend->messages[0] : "",
+            std::string ("Loaded 42 of player."),
+            "Messages are formatted through an AsyncQueue.");
+        ok (backend->threads.size () == 1 &&
+            backend->threads[0] != std::this_thread::get_id (),
+            "Messages are formatted on the writer thread.");
+      }
+
+      // A BinaryFileBackend keeps the arguments; the reader formats them.
+      {
+        {
+          auto backend = std::make_shared<BinaryFileBackend> (Level::all,
+                                                              LOG_FILE);
+          StreamBuffer buffer ({ backend });
+          std::ostream log (&buffer);
+          HUMMSTRUMM_ENGINE_LOGF (log, Level::info, "{} + {} = {}", 1, 2.5,
+                                  3.5);
+          HUMMSTRUMM_ENGINE_LOGF (log, Level::info, "{} + {} = {}", 2, 2.5,
+                                  4.5);
+          log << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info) << "Formatted"
+              << std::flush;
+        }
+        std::ifstream in (LOG_FILE, std::ios_base::in | std::ios_base::binary);
+        BinaryLogReader reader (in);
+        Record record;
+        std::string messages;
+        while (reader.Next (record))
+          messages += std::string (record.message, record.messageLength) + ";";
+        is (messages, std::string ("1 + 2.5 = 3.5;2 + 2.5 = 4.5;Formatted;"),
+            "Unformatted messages are read back from a binary log.");
+        std::remove (LOG_FILE);
+      }
+    }
+  } test;
+
+  return test.run ();
+}
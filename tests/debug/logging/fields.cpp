@@ -0,0 +1,160 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+#include "recordingbackend.hpp"
+using namespace hummstrummengine::debug::logging;
+
+const char *const LOG_FILE = "test_fields.jsonl";
+
+// Writes one record with the given fields to a JsonLinesBackend and returns
+// the line it wrote.
+template <typename... Args>
+std::string
+jsonLine (const char *message, const Args &... args)
+{
+  std::vector<char> fields;
+  EncodeArguments (fields, args...);
+  {
+    JsonLinesBackend backend (Level::all, LOG_FILE);
+    Record record (static_cast<std::uint64_t> (0), 7, "game.cpp", 52,
+                   Level::warning, message, std::string (message).size ());
+    if (!fields.empty ())
+      {
+        record.fields = fields.data ();
+        record.fieldsLength = fields.size ();
+      }
+    backend (record);
+  }
+  std::ifstream in (LOG_FILE);
+  std::string line;
+  std::getline (in, line);
+  std::remove (LOG_FILE);
+  return line;
+}
+
+int
+main ()
+{
+  struct FieldsTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (8);
+
+      {
+        auto backend = std::make_shared<RecordingBackend> ();
+        StreamBuffer buffer ({ backend });
+        std::ostream log (&buffer);
+        std::string name = "player";
+        HUMMSTRUMM_ENGINE_LOG (log, Level::info)
+          << Field ("frame", 12) << Field ("ms", 16.5)
+          << Field ("name", name) << Field ("entity", Id (0x4d2))
+          << "Frame finished." << std::flush;
+        HUMMSTRUMM_ENGINE_LOG (log, Level::info) << "Plain" << std::flush;
+        is (backend->fields.size () == 2 ? backend->fields[0] : "",
+            std::string ("frame=12;ms=16.5;name=player;"
+                         "entity=00000000000004d2;"),
+            "Fields reach the backends with their types.");
+        is (backend->fields.size () == 2 ? backend->fields[1] : "x",
+            std::string (""), "Fields only belong to one message.");
+      }
+
+      {
+        auto backend = std::make_shared<RecordingBackend> ();
+        {
+          std::unique_ptr<AsyncQueue> queue (
+            new AsyncQueue ({ backend }, 16, OverflowPolicy::block));
+          StreamBuffer buffer ({ backend }, std::move (queue));
+          std::ostream log (&buffer);
+          for (int i = 0; i < 3; ++i)
+            HUMMSTRUMM_ENGINE_LOG (log, Level::info)
+              << Field ("i", i) << "Message" << std::flush;
+        }
+        std::string all;
+        for (auto &fields : backend->fields)
+          all += fields;
+        is (all, std::string ("i=0;i=1;i=2;"),
+            "Fields are copied through an AsyncQueue.");
+      }
+
+      is (jsonLine ("Frame finished.", "frame", 1200, "ms", 16.25, "entity",
+                    Id (1234), "paused", false, "player", "Fred"),
+          std::string ("{\"time\":\"1970-01-01T00:00:00.000000000Z\","
+                       "\"thread\":7,\"file\":\"game.cpp\",\"line\":52,"
+                       "\"level\":\"warning\",\"message\":\"Frame finished.\","
+                       "\"fields\":{\"frame\":1200,\"ms\":16.25,"
+                       "\"entity\":\"00000000000004d2\",\"paused\":false,"
+                       "\"player\":\"Fred\"}}"),
+          "JsonLinesBackend writes messages and fields as JSON.");
+      is (jsonLine ("Plain"),
+          std::string ("{\"time\":\"1970-01-01T00:00:00.000000000Z\","
+                       "\"thread\":7,\"file\":\"game.cpp\",\"line\":52,"
+                       "\"level\":\"warning\",\"message\":\"Plain\"}"),
+          "Messages without fields have no fields member.");
+      is (jsonLine ("Say \"hi\"\\\n\x01"),
+          std::string ("{\"time\":\"1970-01-01T00:00:00.000000000Z\","
+                       "\"thread\":7,\"file\":\"game.cpp\",\"line\":52,"
+                       "\"level\":\"warning\",\"message\":"
+                       "\"Say \\\"hi\\\"\\\\\\n\\u0001\"}"),
+          "Strings are escaped.");
+      std::string line = jsonLine ("", "speed",
+                                   std::numeric_limits<double>::infinity ());
+      ok (line.find ("\"fields\":{\"speed\":null}") != std::string::npos,
+          "Numbers JSON can't hold are written as null.");
+
+      // A buffer that is too small for a line still writes it whole.
+      {
+        {
+          JsonLinesBackend backend (Level::all, LOG_FILE, 16);
+          std::string message (1000, 'x');
+          Record record (static_cast<std::uint64_t> (0), 1, "game.cpp", 1,
+                         Level::info, message.data (), message.size ());
+          for (int i = 0; i < 10; ++i)
+            backend (record);
+        }
+        std::ifstream in (LOG_FILE);
+        std::string line;
+        unsigned whole = 0;
+        while (std::getline (in, line))
+          if (line.size () > 1000 && line.back () == '}')
+            ++whole;
+        is (whole, 10u, "Lines longer than the buffer are written whole.");
+        std::remove (LOG_FILE);
+      }
+    }
+  } test;
+
+  return test.run ();
+}
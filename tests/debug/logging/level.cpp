@@ -0,0 +1,77 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+#include "recordingbackend.hpp"
+using namespace hummstrummengine::debug::logging;
+
+int
+main ()
+{
+  struct LevelTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (8);
+
+      auto backend = std::make_shared<RecordingBackend> ();
+      StreamBuffer buffer ({ backend });
+      std::ostream log (&buffer);
+      unsigned evaluated = 0;
+
+      SetEnabledLevels (Level::all);
+      ok (IsLevelEnabled (Level::info), "Every level starts enabled.");
+
+      HUMMSTRUMM_ENGINE_LOG (log, Level::warning)
+        << "Message " << ++evaluated << std::flush;
+      is (backend->messages.size (), 1u, "Enabled message is sent.");
+      is (backend->messages.back (), std::string ("Message 1"),
+          "Enabled message is formatted.");
+      ok (backend->levels.back () == Level::warning &&
+          backend->files.back () == __FILE__,
+          "Enabled message has its level and file.");
+
+      SetEnabledLevels (Level::warning | Level::error);
+      ok (!IsLevelEnabled (Level::info), "Levels can be turned off.");
+
+      HUMMSTRUMM_ENGINE_LOG (log, Level::info)
+        << "Message " << ++evaluated << std::flush;
+      is (evaluated, 1u, "Disabled message is not evaluated.");
+      is (backend->messages.size (), 1u, "Disabled message is not sent.");
+
+      SetEnabledLevels (Level::all);
+
+      ok (std::string (GetLevelName (Level::warning)) == "warning" &&
+          std::string (GetLevelName (Level::all)) == "none",
+          "Levels have names.");
+    }
+  } test;
+
+  return test.run ();
+}
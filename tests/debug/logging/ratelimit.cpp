@@ -0,0 +1,165 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+#include "recordingbackend.hpp"
+using namespace hummstrummengine::debug::logging;
+
+int
+main ()
+{
+  struct RateLimitTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (10);
+
+      {
+        auto backend = std::make_shared<RecordingBackend> ();
+        StreamBuffer buffer ({ backend });
+        std::ostream log (&buffer);
+        for (int i = 0; i < 100; ++i)
+          {
+            HUMMSTRUMM_ENGINE_LOG_RATE_LIMITED (log, Level::warning, 1, 5)
+              << "Limited " << i << std::flush;
+            HUMMSTRUMM_ENGINE_LOG_SAMPLED (log, Level::warning, 10)
+              << "Sampled " << i << std::flush;
+          }
+        is (backend->Count ("Limited "), 5u,
+            "A burst of rate limited messages passes.");
+        is (backend->Count ("Sampled "), 10u,
+            "One in every N sampled messages passes.");
+        is (backend->Count ("Suppressed 9 messages from this call site."), 1u,
+            "The first suppressed messages are summarized right away.");
+      }
+
+      // The stream expression is only evaluated for messages that pass.
+      {
+        auto backend = std::make_shared<RecordingBackend> ();
+        StreamBuffer buffer ({ backend });
+        std::ostream log (&buffer);
+        unsigned evaluated = 0;
+        for (int i = 0; i < 20; ++i)
+          HUMMSTRUMM_ENGINE_LOG_SAMPLED ((++evaluated, log), Level::info, 4)
+            << "Sampled" << std::flush;
+        is (evaluated, 5u, "Suppressed messages evaluate nothing.");
+      }
+
+      // The summary comes from the same line, just before the next message.
+      {
+        auto backend = std::make_shared<RecordingBackend> ();
+        StreamBuffer buffer ({ backend });
+        std::ostream log (&buffer);
+        for (int i = 0; i < 2; ++i)
+          {
+            for (int j = 0; j < 50; ++j)
+              HUMMSTRUMM_ENGINE_LOGF_RATE_LIMITED (log, Level::warning, 1, 1,
+                                                   "Limited {}", j);
+            if (i == 0)
+              std::this_thread::sleep_for (std::chrono::milliseconds (1100));
+          }
+        std::string messages;
+        for (auto &message : backend->messages)
+          messages += message + ";";
+        is (messages, std::string ("Limited 0;Suppressed 49 messages from this "
+                                   "call site.;Limited 0;"),
+            "Suppressed messages are summarized when the next one passes.");
+        ok (backend->lines.size () == 3 &&
+            backend->lines[0] == backend->lines[1],
+            "Summaries have the line of the call site.");
+      }
+
+      // A burst followed by silence is summarized when the log is flushed,
+      // or at the latest when it is destroyed.
+      {
+        auto backend = std::make_shared<RecordingBackend> ();
+        {
+          StreamBuffer buffer ({ backend });
+          std::ostream log (&buffer);
+          for (int i = 0; i < 2; ++i)
+            {
+              for (int j = 0; j < 50; ++j)
+                HUMMSTRUMM_ENGINE_LOG_RATE_LIMITED (log, Level::warning, 1, 1)
+                  << "Limited " << j << std::flush;
+              if (i == 0)
+                {
+                  buffer.Flush ();
+                  is (backend->Count ("Suppressed 49 messages"), 1u,
+                      "A burst followed by silence is summarized on a flush.");
+                }
+            }
+        }
+        is (backend->Count ("Suppressed 50 messages"), 1u,
+            "A burst followed by silence is summarized when the log is "
+            "destroyed.");
+      }
+
+      // An else after the macro belongs to the if around it.
+      {
+        auto backend = std::make_shared<RecordingBackend> ();
+        StreamBuffer buffer ({ backend });
+        std::ostream log (&buffer);
+        bool otherwise = false;
+        if (backend->messages.size () != 0)
+          HUMMSTRUMM_ENGINE_LOG_SAMPLED (log, Level::info, 2)
+            << "Never" << std::flush;
+        else
+          otherwise = true;
+        ok (otherwise, "The macros can be used in an if statement.");
+      }
+
+      // Threads share the state of a call site without losing counts.
+      {
+        auto backend = std::make_shared<RecordingBackend> ();
+        {
+          std::vector<std::thread> threads;
+          for (int t = 0; t < 4; ++t)
+            {
+              threads.emplace_back ([backend]() {
+                  StreamBuffer buffer ({ backend });
+                  std::ostream log (&buffer);
+                  for (int i = 0; i < 1000; ++i)
+                    HUMMSTRUMM_ENGINE_LOG_SAMPLED (log, Level::info, 100)
+                      << "Sampled" << std::flush;
+                });
+            }
+          for (auto &thread : threads)
+            thread.join ();
+        }
+        is (backend->Count ("Sampled"), 40u,
+            "Sampling is exact across threads.");
+      }
+    }
+  } test;
+
+  return test.run ();
+}
@@ -0,0 +1,146 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <string>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug::logging;
+
+// Count every allocation in the program.
+unsigned long allocations = 0;
+
+void *
+operator new (std::size_t size)
+{
+  ++allocations;
+  void *p = std::malloc (size ? size : 1);
+  if (!p)
+    throw std::bad_alloc ();
+  return p;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+// Remembers the last message it got, without allocating.
+struct ViewingBackend : public Backend
+{
+  public:
+    ViewingBackend ()
+      : count (0), file (nullptr), message (nullptr), length (0)
+    {
+    }
+
+    virtual void
+    operator() (const Record &record) override
+    {
+      ++count;
+      file = record.file;
+      message = record.message;
+      length = record.messageLength;
+    }
+
+    unsigned count;
+    const char *file;
+    const char *message;
+    std::size_t length;
+};
+
+// Only knows the old interface.
+struct OldBackend : public LegacyBackend
+{
+  public:
+    virtual void
+    operator() (std::time_t, std::string file, unsigned, Level,
+                std::string message) override
+    {
+      lastFile = file;
+      lastMessage = message;
+    }
+
+    std::string lastFile;
+    std::string lastMessage;
+};
+
+int
+main ()
+{
+  struct RecordTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (6);
+
+      {
+        auto a = std::make_shared<ViewingBackend> ();
+        auto b = std::make_shared<ViewingBackend> ();
+        auto c = std::make_shared<ViewingBackend> ();
+        StreamBuffer buffer ({ a, b, c });
+        std::ostream log (&buffer);
+
+        // Let the buffer grow to fit the message once.
+        log << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
+            << "Warming up the buffer with message " << 1000 << std::flush;
+
+        unsigned long before = allocations;
+        for (unsigned i = 1; i <= 100; ++i)
+          {
+            log << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
+                << "Warming up the buffer with message " << i << std::flush;
+          }
+        unsigned long during = allocations - before;
+        is (during, 0ul,
+            "Steady state logging to three backends does not allocate.");
+        is (a->count + b->count + c->count, 303u,
+            "Every backend gets every message.");
+        ok (a->message == b->message && b->message == c->message,
+            "Backends share one copy of the message.");
+        is (std::string (a->file), std::string (__FILE__),
+            "File name is passed through.");
+      }
+
+      {
+        auto old = std::make_shared<OldBackend> ();
+        StreamBuffer buffer ({ old });
+        std::ostream log (&buffer);
+        log << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
+            << "Old backend " << 1 << std::flush;
+        is (old->lastMessage, std::string ("Old backend 1"),
+            "Old backends still get the message.");
+        is (old->lastFile, std::string (__FILE__),
+            "Old backends still get the file name.");
+      }
+    }
+  } test;
+
+  return test.run ();
+}
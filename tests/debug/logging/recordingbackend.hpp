@@ -0,0 +1,98 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The backend the logging tests check what reaches the backends with.
+
+#ifndef HUMMSTRUMM_ENGINE_TESTS_DEBUG_LOGGING_RECORDINGBACKEND
+#define HUMMSTRUMM_ENGINE_TESTS_DEBUG_LOGGING_RECORDINGBACKEND
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hummstrummengine.hpp"
+
+// Remembers every message it gets, which thread it got it on, and its fields
+// as key=value pairs.  Messages are held up while the gate is closed.
+struct RecordingBackend : public hummstrummengine::debug::logging::Backend
+{
+  public:
+    RecordingBackend ()
+      : gateOpen (true)
+    {
+    }
+
+    virtual void
+    operator() (const hummstrummengine::debug::logging::Record &record)
+      override
+    {
+      using namespace hummstrummengine::debug::logging;
+
+      while (!gateOpen.load ())
+        std::this_thread::yield ();
+
+      std::string text;
+      const char *position = record.fields;
+      const char *end = position + record.fieldsLength;
+      Argument key, value;
+      while (position && DecodeArgument (position, end, key))
+        {
+          // Format the value the way HUMMSTRUMM_ENGINE_LOGF() would.
+          const char *start = position;
+          if (!DecodeArgument (position, end, value))
+            break;
+          std::string formatted;
+          FormatDeferred (formatted, "{}", start, position - start);
+          text.append (key.text, key.textLength);
+          text += "=" + formatted + ";";
+        }
+
+      std::lock_guard<std::mutex> lock (mutex);
+      files.push_back (record.file);
+      lines.push_back (record.line);
+      levels.push_back (record.level);
+      threads.push_back (std::this_thread::get_id ());
+      messages.push_back (std::string (record.message, record.messageLength));
+      fields.push_back (text);
+    }
+
+    // How many messages start with a prefix.
+    unsigned
+    Count (const std::string &prefix)
+    {
+      std::lock_guard<std::mutex> lock (mutex);
+      unsigned count = 0;
+      for (auto &message : messages)
+        if (message.compare (0, prefix.size (), prefix) == 0)
+          ++count;
+      return count;
+    }
+
+    std::atomic<bool> gateOpen;
+    std::mutex mutex;
+    std::vector<std::string> files;
+    std::vector<unsigned> lines;
+    std::vector<hummstrummengine::debug::logging::Level> levels;
+    std::vector<std::thread::id> threads;
+    std::vector<std::string> messages;
+    std::vector<std::string> fields;
+};
+
+#endif // #ifndef HUMMSTRUMM_ENGINE_TESTS_DEBUG_LOGGING_RECORDINGBACKEND
@@ -0,0 +1,168 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_POSIX
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
+using namespace hummstrummengine;
+using namespace hummstrummengine::debug::logging;
+
+const char *const CRASH_FILE = "test_ringbuffer_crash.hslog";
+
+// Reads the messages in a binary log, separated by semicolons.
+std::string
+readMessages (std::istream &in, unsigned *count = nullptr)
+{
+  BinaryLogReader reader (in);
+  Record record;
+  std::string messages;
+  unsigned n = 0;
+  while (reader.Next (record))
+    {
+      messages += std::string (record.message, record.messageLength) + ";";
+      ++n;
+    }
+  if (count)
+    *count = n;
+  return messages;
+}
+
+int
+main ()
+{
+  struct RingBufferTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_POSIX
+      plan (6);
+#else
+      // Crash handling is only tested where we can fork.
+      plan (5);
+#endif
+
+      RingBufferBackend ring (Level::all, 4096);
+      is (ring.GetCapacity (), static_cast<std::size_t> (4096),
+          "The ring has the capacity it was given.");
+
+      {
+        std::stringstream out;
+        ring.Dump (out);
+        is (readMessages (out), std::string (),
+            "An empty ring dumps an empty log.");
+      }
+
+      // Go around the ring a few times.
+      for (unsigned i = 0; i < 1000; ++i)
+        {
+          std::string message = "Message " + std::to_string (i);
+          Record record (1000000000ull * i, 1, "ring.cpp", i, Level::info,
+                         message.data (), message.size ());
+          ring (record);
+        }
+      {
+        std::stringstream out;
+        ring.Dump (out);
+        unsigned count;
+        std::string messages = readMessages (out, &count);
+        ok (count > 10 && count < 1000 &&
+            messages.find ("Message 999;") + 12 == messages.size () &&
+            messages.find ("Message " + std::to_string (1000 - count) + ";")
+            == 0,
+            "Only the newest messages are kept, oldest first.");
+      }
+
+      {
+        std::string big (10000, 'x');
+        Record record (0, 1, "ring.cpp", 1, Level::info, big.data (),
+                       big.size ());
+        ring (record);
+        std::stringstream out;
+        ring.Dump (out);
+        std::string messages = readMessages (out);
+        auto kept = std::count (messages.begin (), messages.end (), 'x');
+        ok (kept > 100 && kept < 1024,
+            "Messages too big for the ring are cut short.");
+      }
+
+      {
+        std::vector<char> arguments;
+        EncodeArguments (arguments, 42, "frames");
+        Record record;
+        record.file = "ring.cpp";
+        record.level = Level::error;
+        record.message = nullptr;
+        record.format = "Lost {} {}.";
+        record.arguments = arguments.data ();
+        record.argumentsLength = arguments.size ();
+        ring (record);
+        std::stringstream out;
+        ring.Dump (out);
+        std::string messages = readMessages (out);
+        ok (messages.find ("Lost 42 frames.;") + 16 == messages.size (),
+            "Unformatted messages are kept and formatted by the reader.");
+      }
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_POSIX
+      std::remove (CRASH_FILE);
+      pid_t child = fork ();
+      if (child == 0)
+        {
+          core::Engine::Configuration params;
+          params.logBackends.push_back (std::make_shared<RingBufferBackend> ());
+          params.crashLogFile = CRASH_FILE;
+          core::Engine engine (params);
+          HUMMSTRUMM_ENGINE_LOG (engine.GetLog (), Level::info)
+            << "Last words" << std::flush;
+          std::abort ();
+        }
+      int status = 0;
+      waitpid (child, &status, 0);
+      std::ifstream in (CRASH_FILE, std::ios_base::in | std::ios_base::binary);
+      std::string messages = in ? readMessages (in) : std::string ();
+      ok (WIFSIGNALED (status) && WTERMSIG (status) == SIGABRT &&
+          messages.find ("Last words;") != std::string::npos,
+          "The Engine writes out the ring when the program aborts.");
+      std::remove (CRASH_FILE);
+#endif
+    }
+  } test;
+
+  return test.run ();
+}
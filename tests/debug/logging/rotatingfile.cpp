@@ -0,0 +1,164 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+
+#ifdef HUMMSTRUMM_ENGINE_HAVE_ZLIB
+#  include <zlib.h>
+#endif
+
+using namespace hummstrummengine::debug::logging;
+
+// Reads a whole file, or returns an empty string if there isn't one.
+std::string
+readFile (const std::string &name)
+{
+  std::ifstream in (name, std::ios_base::in | std::ios_base::binary);
+  return std::string (std::istreambuf_iterator<char> (in),
+                      std::istreambuf_iterator<char> ());
+}
+
+bool
+endsWith (const std::string &text, const std::string &end)
+{
+  return text.size () >= end.size () &&
+         text.compare (text.size () - end.size (), end.size (), end) == 0;
+}
+
+// Counts how often a string shows up in another.
+unsigned
+count (const std::string &text, const std::string &what)
+{
+  unsigned n = 0;
+  for (auto i = text.find (what); i != std::string::npos;
+       i = text.find (what, i + 1))
+    ++n;
+  return n;
+}
+
+void
+log (RotatingFileBackend &backend, std::uint64_t timestamp, unsigned line)
+{
+  std::string message = "Message number " + std::to_string (line);
+  Record record (timestamp, 1, "rotating.cpp", line, Level::info,
+                 message.data (), message.size ());
+  backend (record);
+}
+
+int
+main ()
+{
+  struct RotatingFileTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (7);
+
+      std::uint64_t now = GetTimestamp ();
+      unsigned segments;
+      {
+        RotatingFileBackend backend (Level::all, "test_rotating", 4096);
+        for (unsigned i = 0; i < 100; ++i)
+          log (backend, now, i);
+
+        std::string open = readFile (backend.GetSegmentName (
+                                       backend.GetSegment ()));
+        std::string trimmed =
+          open.substr (0, open.find_last_not_of (" \n") + 1);
+        is (open.size (), static_cast<std::size_t> (4096),
+            "Open segments are preallocated.");
+        ok (endsWith (trimmed, "</message>\n</log>"),
+            "Open segments end with the end tag and whitespace.");
+        segments = backend.GetSegment () + 1;
+      }
+
+      bool wellFormed = true;
+      std::string all;
+      for (unsigned i = 0; i < segments; ++i)
+        {
+          std::string text = readFile ("test_rotating." + std::to_string (i) +
+                                       ".log");
+          wellFormed = wellFormed && text.size () <= 4096 &&
+                       text.compare (0, 5, "<?xml") == 0 &&
+                       endsWith (text, "</message>\n</log>\n") &&
+                       count (text, "<log ") == 1;
+          all += text;
+          std::remove (("test_rotating." + std::to_string (i) +
+                        ".log").c_str ());
+        }
+      ok (segments > 1, "Full segments are rotated.");
+      ok (wellFormed, "Every closed segment is a complete log.");
+      is (count (all, "<message "), 100u, "No message is lost.");
+
+      {
+        RotatingFileBackend backend (Level::all, "test_rotating", 1 << 20,
+                                     std::chrono::seconds (1));
+        log (backend, now, 1);
+        log (backend, now + 500000000u, 2);
+        log (backend, now + 1500000000u, 3);
+        is (backend.GetSegment (), 1u, "Old segments are rotated.");
+      }
+      std::remove ("test_rotating.0.log");
+      std::remove ("test_rotating.1.log");
+
+#ifdef HUMMSTRUMM_ENGINE_HAVE_ZLIB
+      {
+        RotatingFileBackend backend (Level::all, "test_rotating", 4096,
+                                     std::chrono::nanoseconds::zero (), true);
+        log (backend, now, 1);
+        backend.Rotate ();
+        log (backend, now, 2);
+      }
+      std::string decompressed;
+      gzFile in = gzopen ("test_rotating.0.log.gz", "rb");
+      if (in)
+        {
+          char buffer[4096];
+          int n;
+          while ((n = gzread (in, buffer, sizeof buffer)) > 0)
+            decompressed.append (buffer, n);
+          gzclose (in);
+        }
+      ok (endsWith (decompressed, "Message number 1\n</message>\n</log>\n") &&
+          readFile ("test_rotating.0.log").empty (),
+          "Closed segments are compressed.");
+      std::remove ("test_rotating.0.log.gz");
+      std::remove ("test_rotating.1.log.gz");
+#else
+      ok (true, "# SKIP Built without zlib.");
+#endif
+    }
+  } test;
+
+  return test.run ();
+}
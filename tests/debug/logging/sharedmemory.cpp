@@ -0,0 +1,117 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug::logging;
+
+const char *const NAME = "/hummstrummengine-test-sharedmemory";
+
+// Reads every new message, separated by semicolons.
+std::string
+readMessages (SharedMemoryReader &reader)
+{
+  Record record;
+  std::string messages;
+  while (reader.Next (record))
+    messages += std::string (record.message, record.messageLength) + ";";
+  return messages;
+}
+
+int
+main ()
+{
+  struct SharedMemoryTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (10);
+
+      std::unique_ptr<SharedMemoryReader> watcher;
+      {
+        auto backend = std::make_shared<SharedMemoryBackend> (Level::all, NAME,
+                                                              4, 128);
+        StreamBuffer buffer ({ backend });
+        std::ostream log (&buffer);
+        SharedMemoryReader reader (NAME);
+        watcher.reset (new SharedMemoryReader (NAME));
+
+        Record record;
+        ok (!reader.Next (record), "A new reader has nothing to read.");
+
+        log << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::warning) << "First"
+            << std::flush;
+        unsigned line = __LINE__ - 2;
+        HUMMSTRUMM_ENGINE_LOGF (log, Level::info, "{} + {} = {}", 1, 2, 3);
+        bool first = reader.Next (record);
+        ok (first && std::string (record.message, record.messageLength) ==
+            "First" && record.level == Level::warning &&
+            record.line == line && std::string (record.file) == __FILE__,
+            "Messages are read with their level, file, and line.");
+        is (readMessages (reader), std::string ("1 + 2 = 3;"),
+            "Unformatted messages are formatted by the reader.");
+
+        // Four slots, so the reader misses all but the last four.
+        for (int i = 0; i < 10; ++i)
+          log << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info) << i
+              << std::flush;
+        is (readMessages (reader), std::string ("6;7;8;9;"),
+            "A reader that falls behind skips to the oldest message.");
+        is (reader.GetMissed (), static_cast<std::uint64_t> (6),
+            "Overwritten messages are counted as missed.");
+
+        SharedMemoryReader late (NAME, 2);
+        is (readMessages (late), std::string ("8;9;"),
+            "A new reader can start with the last few messages.");
+
+        log << HUMMSTRUMM_ENGINE_SET_LOGGING (Level::info)
+            << std::string (1000, 'x') << std::flush;
+        bool cut = reader.Next (record);
+        ok (cut && record.messageLength > 0 && record.messageLength < 128,
+            "Messages are cut short to fit in a slot.");
+        ok (!watcher->IsClosed (), "The backend is open while it lives.");
+      }
+      ok (watcher->IsClosed (), "Readers see that the backend is gone.");
+      watcher.reset ();
+
+      bool threw = false;
+      try
+        {
+          SharedMemoryReader reader (NAME);
+        }
+      catch (const std::runtime_error &)
+        {
+          threw = true;
+        }
+      ok (threw, "The shared memory is removed with the backend.");
+    }
+  } test;
+
+  return test.run ();
+}
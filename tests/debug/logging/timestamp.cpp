@@ -0,0 +1,75 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <thread>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug::logging;
+
+int
+main ()
+{
+  struct TimestampTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (6);
+
+      // 2012-06-14T02:09:18Z
+      const std::uint64_t second = 1339639758ull * 1000000000ull;
+      TimestampFormatter formatter;
+      std::string first = formatter.Format (second + 123456789);
+      std::string same = formatter.Format (second + 5);
+      std::string next = formatter.Format (second + 1000000000ull);
+      is (first, std::string ("2012-06-14T02:09:18.123456789Z"),
+          "Timestamps are formatted with nanoseconds.");
+      is (same, std::string ("2012-06-14T02:09:18.000000005Z"),
+          "Only the fraction changes within a second.");
+      is (next, std::string ("2012-06-14T02:09:19.000000000Z"),
+          "The rest is formatted again in the next second.");
+
+      std::uint64_t before = GetTimestamp ();
+      std::uint64_t wall = static_cast<std::uint64_t> (std::time (0));
+      std::uint64_t after = GetTimestamp ();
+      ok (before <= after, "Timestamps don't go backwards.");
+      ok (after / 1000000000ull + 2 >= wall &&
+          after / 1000000000ull <= wall + 2,
+          "Timestamps follow the wall clock.");
+
+      unsigned here = GetThreadNumber ();
+      unsigned there = 0;
+      std::thread other ([&there]() { there = GetThreadNumber (); });
+      other.join ();
+      ok (here != 0 && there != 0 && here != there &&
+          GetThreadNumber () == here,
+          "Each thread has its own number.");
+    }
+  } test;
+
+  return test.run ();
+}
@@ -0,0 +1,140 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug;
+
+namespace {
+
+Counter draws ("test_draws");
+Gauge entities ("test_entities");
+
+}
+
+int
+main ()
+{
+  struct MetricsTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (13);
+
+      ++draws;
+      draws += 2;
+      std::thread other ([] () { draws.Add (4); });
+      other.join ();
+      std::int64_t total = draws.GetTotal ();
+      is (total, std::int64_t (7), "Counters add up every thread.");
+
+      entities.Set (10);
+      entities.Add (-3);
+      std::int64_t value = entities.Get ();
+      is (value, std::int64_t (7), "Gauges can be set and added to.");
+
+      Counter same ("test_draws");
+      ++same;
+      total = draws.GetTotal ();
+      is (total, std::int64_t (8), "Counters with one name count together.");
+
+      bool threw = false;
+      try
+        {
+          Gauge wrong ("test_draws");
+        }
+      catch (std::invalid_argument &)
+        {
+          threw = true;
+        }
+      ok (threw, "A name has one kind.");
+      threw = false;
+      try
+        {
+          Counter tooLong (std::string (100, 'x').c_str ());
+        }
+      catch (std::invalid_argument &)
+        {
+          threw = true;
+        }
+      ok (threw, "Long names are refused.");
+
+      MetricHistory history;
+      ok (!Metrics::GetHistory ("test_none", history),
+          "There is no history of unknown metrics.");
+
+      std::uint64_t start = Metrics::GetFrame ();
+      Metrics::EndFrame ();
+      draws.Add (5);
+      entities.Set (2);
+      Metrics::EndFrame ();
+      std::uint64_t frames = Metrics::GetFrame () - start;
+      is (frames, std::uint64_t (2), "Frames are counted.");
+
+      ok (Metrics::GetHistory ("test_draws", history) &&
+          history.kind == MetricKind::counter && history.total == 13 &&
+          history.frames.size () == 2 && history.frames[0] == 8 &&
+          history.frames[1] == 5,
+          "A counter's history has how much it counted each frame.");
+      ok (Metrics::GetHistory ("test_entities", history) &&
+          history.kind == MetricKind::gauge && history.total == 2 &&
+          history.frames.size () == 2 && history.frames[0] == 7 &&
+          history.frames[1] == 2,
+          "A gauge's history has its value at the end of each frame.");
+      ok (history.GetMin () == 2 && history.GetMax () == 7 &&
+          history.GetMean () == 4.5,
+          "Histories are summarized.");
+
+      for (std::size_t i = 0; i < Metrics::historyLength + 10; ++i)
+        Metrics::EndFrame ();
+      Metrics::GetHistory ("test_draws", history);
+      ok (history.frames.size () == Metrics::historyLength &&
+          history.frames.back () == 0 && history.total == 13,
+          "Only the last frames are kept.");
+
+      Counter late ("test_late");
+      Metrics::EndFrame ();
+      Metrics::GetHistory ("test_late", history);
+      is (history.frames.size (), std::size_t (1),
+          "History starts when a metric is made.");
+
+      std::ostringstream log;
+      Metrics::Log (log);
+      std::string text = log.str ();
+      ok (text.find ("\n  test_draws = 0 (mean 0, min 0, max 0, "
+                     "total 13)") != std::string::npos &&
+          text.find ("\n  test_entities = 2 (mean 2, min 2, max 2)") !=
+          std::string::npos,
+          "Log() writes each metric.");
+    }
+  } test;
+
+  return test.run ();
+}
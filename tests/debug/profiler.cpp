@@ -94,7 +94,7 @@ main ()
     virtual void
     test() override
     {
-      plan(13);
+      plan(24);
       std::ostringstream out;
         
       // block to limit the lifetime of the profiler
@@ -168,6 +168,67 @@ main ()
         
       SteadyClockMock::is_first_call = true;
       out.str ("");
+
+      // block to limit the lifetime of the profiler
+      {
+        typedef Profiler<SteadyClockMock, SteadyClockMock::duration,
+                         HistogramStatistics<SteadyClockMock::duration>>
+          HistogramProfiler;
+        auto p = new_ok<HistogramProfiler> (out);
+        is (out.str (), "Profiler 4: run 0 starting\n",
+            "Constructor prints out proper string to log.");
+        p.next ();
+        out.str ("");
+      }
+      is (out.str (), "Profiler 4: run 1 ending after 0 s\n"
+          "Profiler 4: in 2 run(s), min time = 0 s, max time = 1 s, "
+          "ave time = 0 s\n"
+          "Profiler 4: std dev = 0 s, p50 = 0 s, p90 = 1 s, p99 = 1 s, "
+          "p99.9 = 1 s\n",
+          "Destructor prints out percentiles to log.");
+
+      SteadyClockMock::is_first_call = true;
+      out.str ("");
+
+      // block to limit the lifetime of the profiler
+      {
+        auto p = new_ok<Profiler<SteadyClockMock>> (
+          out, ProfilerReport::Quiet (2));
+        is (out.str (), "", "Quiet constructor prints nothing.");
+        p.next ();
+        is (out.str (), "", "Quiet next() prints nothing.");
+        p.next ();
+        is (out.str (), "Profiler 5: in 2 run(s), min time = 0 s, "
+            "max time = 1 s, ave time = 0 s\n",
+            "Quiet next() prints statistics every 2 runs.");
+        out.str ("");
+        p.report ();
+        is (out.str (), "Profiler 5: in 2 run(s), min time = 0 s, "
+            "max time = 1 s, ave time = 0 s\n",
+            "report() prints statistics to log.");
+        is (p.GetStatistics ().GetCount (), std::size_t (2),
+            "GetStatistics() gives the runs so far.");
+        out.str ("");
+      }
+      is (out.str (), "Profiler 5: in 3 run(s), min time = 0 s, "
+          "max time = 1 s, ave time = 0 s\n",
+          "Quiet destructor only prints statistics to log.");
+
+      SteadyClockMock::is_first_call = true;
+      out.str ("");
+
+      // block to limit the lifetime of the profiler
+      {
+        Profiler<SteadyClockMock> p (
+          out, ProfilerReport::Quiet ().ThroughLog (
+            hummstrummengine::debug::logging::Level::info));
+      }
+      is (out.str (), "Profiler 6: in 1 run(s), min time = 1 s, "
+          "max time = 1 s, ave time = 1 s",
+          "Statistics are sent to log as one message.");
+
+      SteadyClockMock::is_first_call = true;
+      out.str ("");
     }
   } test;
 
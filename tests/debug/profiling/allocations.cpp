@@ -0,0 +1,150 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug;
+using namespace hummstrummengine::debug::profiling;
+
+HUMMSTRUMM_ENGINE_ALLOCATION_HOOKS
+
+namespace {
+
+// Allocates a block that is never freed.
+HUMMSTRUMM_ENGINE_NOINLINE void *
+leak (std::size_t size)
+{
+  return new char[size];
+}
+
+// Allocates an int where the compiler can't see it freed, so the
+// allocation isn't optimized away.
+HUMMSTRUMM_ENGINE_NOINLINE int *
+allocate (int value)
+{
+  return new int (value);
+}
+
+// Frees an int from allocate().
+HUMMSTRUMM_ENGINE_NOINLINE void
+release (int *value)
+{
+  delete value;
+}
+
+}
+
+int
+main ()
+{
+  struct AllocationsTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (11);
+
+      ok (AllocationProfiler::IsHooked (), "The hooks are in place.");
+
+      AllocationCounts before = AllocationProfiler::GetThreadCounts ();
+      int *one = allocate (1);
+      AllocationCounts during = AllocationProfiler::GetThreadCounts ();
+      release (one);
+      AllocationCounts after = AllocationProfiler::GetThreadCounts ();
+      ok ((during - before).allocations == 1 &&
+          (during - before).bytes == sizeof (int),
+          "Allocations are counted.");
+      ok ((after - during).frees == 1 &&
+          (after - during).freedBytes == sizeof (int),
+          "Frees are counted.");
+
+      before = AllocationProfiler::GetCounts ();
+      std::thread other ([] () { delete new long[4]; });
+      other.join ();
+      after = AllocationProfiler::GetCounts ();
+      ok ((after - before).allocations >= 1 &&
+          (after - before).bytes >= 4 * sizeof (long),
+          "Other threads are counted.");
+      ok (AllocationProfiler::GetEveryThreadCounts ().size () >= 2,
+          "Each thread has its own counts.");
+
+      // A steady state with no allocations can be asserted.
+      std::vector<int> reused (64);
+      AllocationProfiler::EndFrame ();
+      for (int i = 0; i < 64; ++i)
+        reused[i] = i;
+      AllocationCounts frame = AllocationProfiler::EndFrame ();
+      reused.resize (128);
+      AllocationCounts next = AllocationProfiler::GetFrameCounts ();
+      is (frame.allocations, std::uint64_t (0),
+          "A frame that doesn't allocate counts none.");
+      is (next.allocations, std::uint64_t (1),
+          "A frame's allocations are counted.");
+
+      AllocationProfiler::SetSampleRate (1);
+      void *leaked = leak (1000);
+      delete new char[10];
+      AllocationProfiler::SetSampleRate (0);
+      bool found = false;
+      for (auto &site : AllocationProfiler::GetSites ())
+        found = found || (site.counts.GetLiveBytes () == 1000 &&
+                          site.depth > 0);
+      ok (found, "The stacks of allocations are kept.");
+
+      std::ostringstream heap;
+      AllocationProfiler::WriteLiveHeap (heap);
+      ok (heap.str ().find (" 1000\n") != std::string::npos,
+          "The live heap is written as folded stacks.");
+      delete[] static_cast<char *> (leaked);
+
+      std::ostringstream out;
+      {
+        Profiler<> profiler (
+          out, ProfilerReport::Quiet ().CountingAllocations ());
+        release (allocate (2));
+        profiler.next ();
+      }
+      ok (out.str ().find ("per run, allocations = 0.5, bytes = 2, "
+                           "frees = 0.5") != std::string::npos,
+          "Profiler reports the allocations of its runs.");
+
+      out.str ("");
+      {
+        Profiler<> profiler (
+          out, ProfilerReport::EveryRun ().CountingAllocations ());
+        profiler.next ();
+      }
+      ok (out.str ().find ("per run, allocations = 0, bytes = 0, "
+                           "frees = 0") != std::string::npos,
+          "The Profiler's own allocations are left out.");
+    }
+  } test;
+
+  return test.run ();
+}
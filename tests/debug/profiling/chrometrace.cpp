@@ -0,0 +1,109 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug;
+using namespace hummstrummengine::debug::profiling;
+
+// Counts how many times text appears in a string.
+unsigned
+count (const std::string &in, const std::string &text)
+{
+  unsigned found = 0;
+  for (std::size_t i = in.find (text); i != std::string::npos;
+       i = in.find (text, i + 1))
+    ++found;
+  return found;
+}
+
+int
+main ()
+{
+  struct ChromeTraceTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (9);
+      const char *file = "test-chrometrace.json";
+
+      {
+        // A tiny buffer, so that the trace is written in many pieces.
+        ChromeTraceWriter trace (file, 16);
+        ZoneProfiler profiler (std::ref (trace));
+        profiler.RegisterThread ("main \"thread\"");
+        std::ostringstream log;
+        Profiler<> runs (log, trace);
+        for (int i = 0; i < 3; ++i)
+          {
+            {
+              HUMMSTRUMM_ENGINE_ZONE ("outer");
+              HUMMSTRUMM_ENGINE_ZONE ("inner");
+            }
+            profiler.EndFrame ();
+            runs.next ();
+            trace.AddCounter ("draws", logging::GetTimestamp (), i);
+          }
+        profiler.Flush ();
+      }
+
+      std::ifstream in (file);
+      std::stringstream contents;
+      contents << in.rdbuf ();
+      std::string trace = contents.str ();
+
+      ok (trace.compare (0, 2, "[\n") == 0 &&
+          trace.compare (trace.size () - 3, 3, "\n]\n") == 0,
+          "The trace is a JSON array.");
+      is (count (trace, "\"name\":\"outer\",\"cat\":\"zone\",\"ph\":\"X\""), 3u,
+          "Each zone is a complete event.");
+      is (count (trace, "\"name\":\"inner\""), 3u,
+          "Nested zones are written too.");
+      is (count (trace, "\"cat\":\"frame\""), 3u,
+          "Each frame is an event.");
+      ok (count (trace, "\"name\":\"Frame 2\"") == 1,
+          "Frames are named by their number.");
+      is (count (trace, "\"cat\":\"profiler\""), 4u,
+          "Each Profiler run is an event.");
+      is (count (trace, "\"args\":{\"name\":\"main \\\"thread\\\"\"}"), 1u,
+          "Thread names are written once, and escaped.");
+      ok (count (trace, "\"file\":\"") == 6 && count (trace, "\"line\":") == 6,
+          "Zones know where they are in the source.");
+      ok (count (trace, "\"name\":\"draws\",\"cat\":\"counter\","
+                 "\"ph\":\"C\"") == 3 &&
+          count (trace, "\"args\":{\"value\":2}}") == 1,
+          "Counters are counter events.");
+
+      std::remove (file);
+    }
+  } test;
+
+  return test.run ();
+}
@@ -0,0 +1,79 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sstream>
+#include <string>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug;
+using namespace hummstrummengine::debug::profiling;
+
+int
+main ()
+{
+  struct PerfCountersTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (5);
+
+      // Whether the counters work depends on the processor and the kernel,
+      // so the tests check that they either work or read as nothing.
+      PerfCounters counters;
+      bool counting = counters.IsCounting ();
+      ok (counting == counters.IsCounting (PerfEvent::cycles),
+          "The cycles lead the counters.");
+
+      PerfCounts before = counters.Read ();
+      volatile unsigned sum = 0;
+      for (unsigned i = 0; i < 100000; ++i)
+        sum = sum + i;
+      PerfCounts after = counters.Read ();
+      ok (!counting || after[PerfEvent::cycles] > before[PerfEvent::cycles],
+          "Cycles are counted.");
+      ok (!counters.IsCounting (PerfEvent::instructions) ||
+          after[PerfEvent::instructions] >=
+            before[PerfEvent::instructions] + 100000,
+          "Instructions are counted.");
+
+      bool zero = true;
+      for (std::size_t i = 0; i < PerfCounts::events; ++i)
+        if (!counters.IsCounting (static_cast<PerfEvent> (i)))
+          zero = zero && after.counts[i] == 0;
+      ok (zero, "Events that aren't counted read as 0.");
+
+      std::ostringstream out;
+      {
+        Profiler<> profiler (out,
+                             ProfilerReport::Quiet ().Counting (counters));
+        profiler.next ();
+      }
+      ok ((out.str ().find ("per run, cycles = ") != std::string::npos) ==
+          counting, "Profiler reports the counts if there are any.");
+    }
+  } test;
+
+  return test.run ();
+}
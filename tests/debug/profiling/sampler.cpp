@@ -0,0 +1,130 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug::profiling;
+
+namespace {
+
+// Keeps the processor busy for a while, so the thread is sampled.
+void
+burn (std::chrono::milliseconds length)
+{
+  auto end = std::chrono::steady_clock::now () + length;
+  volatile unsigned sum = 0;
+  while (std::chrono::steady_clock::now () < end)
+    for (unsigned i = 0; i < 10000; ++i)
+      sum = sum + i;
+}
+
+}
+
+int
+main ()
+{
+  struct SamplerTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (8);
+
+      // Whether threads can be sampled depends on the system, so the tests
+      // check that they either are or that nothing is sampled.
+      {
+        Sampler sampler (1000);
+        bool sampling = sampler.IsSampling ();
+        ok (sampler.RegisterThread () == sampling,
+            "Threads are sampled where they can be.");
+
+        bool threw = false;
+        try
+          {
+            Sampler second;
+          }
+        catch (const std::runtime_error &)
+          {
+            threw = true;
+          }
+        ok (threw, "Only one Sampler can exist at a time.");
+
+        burn (std::chrono::milliseconds (200));
+        sampler.Collect ();
+        std::uint64_t samples = sampler.GetSamples ();
+        ok (sampling ? samples > 0 : samples == 0,
+            "A busy thread is sampled.");
+
+        std::ostringstream out;
+        sampler.WriteFolded (out);
+        std::istringstream in (out.str ());
+        std::string line;
+        std::uint64_t total = 0;
+        bool folded = true;
+        while (std::getline (in, line))
+          {
+            std::string::size_type space = line.rfind (' ');
+            folded = folded && space != std::string::npos && space != 0;
+            if (folded)
+              total += std::strtoull (line.c_str () + space + 1, nullptr, 10);
+          }
+        ok (folded, "Stacks are written as folded stacks.");
+        ok (total >= samples - sampler.GetDropped () &&
+            total <= sampler.GetSamples (),
+            "Every sample is counted once.");
+
+        out.str ("");
+        sampler.WriteFolded (out, true);
+        ok (!sampling || out.str ().compare (0, 7, "thread-") == 0,
+            "Stacks can start with their thread.");
+
+        sampler.UnregisterThread ();
+        sampler.Collect ();
+        samples = sampler.GetSamples ();
+        burn (std::chrono::milliseconds (50));
+        is (sampler.GetSamples (), samples,
+            "Unregistered threads aren't sampled.");
+      }
+
+      bool threw = false;
+      try
+        {
+          Sampler sampler;
+        }
+      catch (const std::runtime_error &)
+        {
+          threw = true;
+        }
+      ok (!threw, "A new Sampler can be made once the last is gone.");
+    }
+  } test;
+
+  return test.run ();
+}
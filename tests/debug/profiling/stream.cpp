@@ -0,0 +1,229 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug;
+using namespace hummstrummengine::debug::profiling;
+
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+const char *const ADDRESS = "tcp:7118";
+#else
+const char *const ADDRESS = "unix:test_stream.sock";
+#endif
+const char *const CAPTURE = "test_stream.hsps";
+
+const ZoneSite FRAME_SITE = { "frame", "main", "stream.cpp", 10 };
+const ZoneSite DRAW_SITE = { "draw", "draw", "render.cpp", 20 };
+
+Counter draws ("test_stream_draws");
+
+// Waits for a client to connect to the server.
+bool
+waitForClient (const ProfileStreamServer &server)
+{
+  for (int i = 0; i < 5000 && !server.IsConnected (); ++i)
+    std::this_thread::sleep_for (std::chrono::milliseconds (1));
+  return server.IsConnected ();
+}
+
+// Makes a frame with a thread that draws twice in a frame zone, and an idle
+// thread.
+ZoneFrame
+makeFrame (std::uint64_t number)
+{
+  ZoneFrame frame;
+  frame.number = number;
+  frame.begin = 1000000000000 + number * 1000;
+  frame.end = frame.begin + 1000;
+  frame.dropped = 2;
+  frame.threads.resize (2);
+  frame.threads[0].thread = 1;
+  frame.threads[0].name = "main";
+  Zone zones[3] = {
+    { &FRAME_SITE, frame.begin, frame.begin + 900, 0, Zone::noParent },
+    { &DRAW_SITE, frame.begin + 100, frame.begin + 200, 1, 0 },
+    { &DRAW_SITE, frame.begin + 300, frame.begin + 400, 1, 0 }
+  };
+  frame.threads[0].zones.assign (zones, zones + 3);
+  frame.threads[1].thread = 2;
+  return frame;
+}
+
+// Checks that a frame read back is the one made by makeFrame().
+bool
+isFrame (const ZoneFrame &frame, std::uint64_t number)
+{
+  ZoneFrame made = makeFrame (number);
+  if (frame.number != made.number || frame.begin != made.begin ||
+      frame.end != made.end || frame.dropped != made.dropped ||
+      frame.threads.size () != 2 || frame.threads[0].name != "main" ||
+      frame.threads[1].name != "" || !frame.threads[1].zones.empty () ||
+      frame.threads[0].zones.size () != 3)
+    return false;
+  for (std::size_t i = 0; i < 3; ++i)
+    {
+      const Zone &zone = frame.threads[0].zones[i];
+      const Zone &expected = made.threads[0].zones[i];
+      if (std::string (zone.site->name) != expected.site->name ||
+          std::string (zone.site->file) != expected.site->file ||
+          zone.site->line != expected.site->line ||
+          zone.begin != expected.begin || zone.end != expected.end ||
+          zone.depth != expected.depth || zone.parent != expected.parent)
+        return false;
+    }
+  return true;
+}
+
+// Returns the value of the test's counter, or -1 if it wasn't sent.
+std::int64_t
+findDraws (const std::vector<MetricValue> &values)
+{
+  for (auto &value : values)
+    if (std::string (value.name) == "test_stream_draws" &&
+        value.kind == MetricKind::counter)
+      return value.value;
+  return -1;
+}
+
+int
+main ()
+{
+  struct StreamTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+#ifdef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+      plan (12);
+#else
+      plan (13);
+#endif
+
+      bool threw = false;
+      try
+        {
+          ProfileStreamServer bad ("http://localhost");
+        }
+      catch (std::invalid_argument &)
+        {
+          threw = true;
+        }
+      ok (threw, "Bad addresses are refused.");
+
+#ifndef HUMMSTRUMM_ENGINE_PLATFORM_WINDOWS
+      // A file that isn't a socket must not be removed to make room.
+      std::FILE *file = std::fopen ("test_stream.txt", "w");
+      std::fclose (file);
+      threw = false;
+      try
+        {
+          ProfileStreamServer inTheWay ("unix:test_stream.txt");
+        }
+      catch (std::runtime_error &)
+        {
+          threw = true;
+        }
+      file = std::fopen ("test_stream.txt", "r");
+      ok (threw && file, "A file that isn't a socket is left alone.");
+      if (file)
+        std::fclose (file);
+      std::remove ("test_stream.txt");
+#endif
+
+      ZoneFrame frame;
+      std::vector<MetricValue> values;
+      {
+        std::unique_ptr<ProfileStreamReader> reader;
+        {
+          ProfileStreamServer server (ADDRESS);
+          server (makeFrame (0));
+          reader.reset (new ProfileStreamReader (ADDRESS, CAPTURE));
+          ok (waitForClient (server), "The server accepts a client.");
+
+          draws.Add (3);
+          Metrics::EndFrame ();
+          server (makeFrame (1));
+          ok (reader->Next (frame, values) && isFrame (frame, 1),
+              "Frames are streamed.");
+          is (findDraws (values), std::int64_t (3),
+              "Metrics are streamed with the frames.");
+
+          Metrics::EndFrame ();
+          server (makeFrame (2));
+          ok (reader->Next (frame, values) && isFrame (frame, 2) &&
+              findDraws (values) == 0,
+              "Later frames use the zone sites and metrics already sent.");
+        }
+        ok (!reader->Next (frame, values), "The stream ends with the server.");
+      }
+
+      ProfileStreamReader saved (std::string ("file:") + CAPTURE);
+      ok (saved.Next (frame, values) && isFrame (frame, 1) &&
+          saved.Next (frame, values) && isFrame (frame, 2) &&
+          !saved.Next (frame, values),
+          "Streams can be saved and read again.");
+
+      {
+        // A frame too big for the socket's buffers, so the client falls
+        // behind when it doesn't read.
+        ZoneFrame big = makeFrame (3);
+        Zone zone = big.threads[0].zones[1];
+        big.threads[0].zones.resize (400000, zone);
+
+        ProfileStreamServer server (ADDRESS, 1);
+        ProfileStreamReader reader (ADDRESS);
+        ok (waitForClient (server), "The server accepts another client.");
+        std::uint64_t sent = 0;
+        for (; sent < 64 && server.GetDropped () < 3; ++sent)
+          server (big);
+        std::uint64_t dropped = server.GetDropped ();
+        ok (dropped >= 3, "Frames are dropped when the client falls behind.");
+
+        bool read = true;
+        for (std::uint64_t i = 0; i < sent - dropped; ++i)
+          read = read && reader.Next (frame, values) &&
+            frame.threads[0].zones.size () == 400000;
+        ok (read, "The frames that weren't dropped are sent.");
+        server (makeFrame (4));
+        ok (reader.Next (frame, values) && isFrame (frame, 4),
+            "Frames are sent again once the client catches up.");
+        is (reader.GetDropped (), dropped,
+            "The client is told how many frames were dropped.");
+      }
+
+      std::remove (CAPTURE);
+    }
+  } test;
+
+  return test.run ();
+}
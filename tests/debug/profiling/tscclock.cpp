@@ -0,0 +1,100 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine;
+using namespace hummstrummengine::debug;
+using namespace hummstrummengine::debug::profiling;
+
+// Returns how far apart two times are, in nanoseconds.
+double
+apart (std::chrono::nanoseconds a, std::chrono::nanoseconds b)
+{
+  return std::fabs (static_cast<double> ((a - b).count ()));
+}
+
+int
+main ()
+{
+  struct TscClockTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (7);
+      typedef std::chrono::steady_clock Steady;
+      const std::chrono::nanoseconds millisecond =
+        std::chrono::milliseconds (1);
+
+      ok (TscClock::GetSource () == TscSource::steadyClock &&
+          TscClock::GetTicksPerSecond () == 0,
+          "The clock reads steady_clock until it is calibrated.");
+      ok (apart (TscClock::now ().time_since_epoch (),
+                 Steady::now ().time_since_epoch ()) < 1e6,
+          "Uncalibrated times are steady_clock times.");
+
+      system::Processors processors;
+      TscClock::Calibrate (processors);
+      bool counter = TscClock::GetSource () != TscSource::steadyClock;
+      ok (counter == processors.HaveInvariantTscSupport (),
+          "The counter is used if it is invariant.");
+      ok (!counter || TscClock::GetTicksPerSecond () > 1e6,
+          "The counter runs at a believable rate.");
+
+      // Compare the clock against steady_clock over a while.
+      auto steadyStart = Steady::now ();
+      auto start = TscClock::now ();
+      std::this_thread::sleep_for (std::chrono::milliseconds (50));
+      auto steadyLength = Steady::now () - steadyStart;
+      auto length = TscClock::now () - start;
+      ok (apart (length, steadyLength) < 0.02 * steadyLength.count () +
+          millisecond.count (),
+          "The clock keeps time with steady_clock.");
+
+      bool forward = true;
+      auto last = TscClock::now ();
+      for (unsigned i = 0; i < 100000; ++i)
+        {
+          auto now = TscClock::now ();
+          forward = forward && now >= last;
+          last = now;
+        }
+      ok (forward, "The clock never goes backwards.");
+
+      std::ostringstream out;
+      {
+        Profiler<TscClock> profiler (out, ProfilerReport::Quiet ());
+      }
+      ok (out.str ().find ("in 1 run(s)") != std::string::npos,
+          "The clock works in a Profiler.");
+    }
+  } test;
+
+  return test.run ();
+}
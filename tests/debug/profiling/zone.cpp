@@ -0,0 +1,191 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug::profiling;
+
+// Keeps a copy of every frame it gets.
+struct FrameRecorder
+{
+    void
+    operator() (const ZoneFrame &frame)
+    {
+      std::lock_guard<std::mutex> lock (mutex);
+      frames.push_back (frame);
+    }
+
+    // The zones of the thread with the given name in a frame.
+    const std::vector<Zone> &
+    Zones (std::size_t frame, const std::string &name)
+    {
+      static const std::vector<Zone> none;
+      for (auto &thread : frames[frame].threads)
+        if (thread.name == name)
+          return thread.zones;
+      return none;
+    }
+
+    std::mutex mutex;
+    std::vector<ZoneFrame> frames;
+};
+
+void
+leaf ()
+{
+  HUMMSTRUMM_ENGINE_ZONE ("leaf");
+}
+
+void
+branch ()
+{
+  HUMMSTRUMM_ENGINE_ZONE ("branch");
+  leaf ();
+  leaf ();
+}
+
+int
+main ()
+{
+  struct ZoneTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (13);
+
+      // Without a ZoneProfiler, zones do nothing.
+      branch ();
+      ok (ZoneProfiler::GetActive () == nullptr,
+          "There is no ZoneProfiler by default.");
+
+      {
+        FrameRecorder recorder;
+        ZoneProfiler profiler (std::ref (recorder));
+        ok (ZoneProfiler::GetActive () == &profiler,
+            "Zones are recorded in the new ZoneProfiler.");
+
+        bool threw = false;
+        try
+          {
+            ZoneProfiler second (std::ref (recorder));
+          }
+        catch (std::logic_error &)
+          {
+            threw = true;
+          }
+        ok (threw, "Only one ZoneProfiler can exist at a time.");
+
+        profiler.RegisterThread ("main");
+        branch ();
+        profiler.EndFrame ();
+        profiler.Flush ();
+
+        const std::vector<Zone> &zones = recorder.Zones (0, "main");
+        is (zones.size (), 3u, "Every zone is recorded.");
+        ok (zones.size () == 3 &&
+            std::string (zones[0].site->name) == "branch" &&
+            std::string (zones[1].site->name) == "leaf" &&
+            std::string (zones[2].site->name) == "leaf",
+            "Zones are in the order they were entered.");
+        ok (zones.size () == 3 &&
+            zones[0].depth == 0 && zones[0].parent == Zone::noParent &&
+            zones[1].depth == 1 && zones[1].parent == 0 &&
+            zones[2].depth == 1 && zones[2].parent == 0,
+            "Zones inside other zones know their parent.");
+        ok (zones.size () == 3 &&
+            zones[0].begin <= zones[1].begin &&
+            zones[1].end <= zones[2].begin &&
+            zones[2].end <= zones[0].end &&
+            zones[0].end <= recorder.frames[0].end,
+            "Zones are timed.");
+
+        // A zone that spans the end of a frame.
+        {
+          HUMMSTRUMM_ENGINE_ZONE ("long");
+          profiler.EndFrame ();
+          leaf ();
+        }
+        profiler.EndFrame ();
+        profiler.Flush ();
+        const std::vector<Zone> &first = recorder.Zones (1, "main");
+        const std::vector<Zone> &second = recorder.Zones (2, "main");
+        ok (first.size () == 1 && first[0].end == recorder.frames[1].end,
+            "A zone that is still open ends with its frame.");
+        ok (second.size () == 2 &&
+            std::string (second[0].site->name) == "long" &&
+            second[0].begin == recorder.frames[2].begin &&
+            second[1].parent == 0,
+            "The zone is continued in the next frame.");
+
+        // Zones from other threads.
+        std::thread worker ([&profiler]() {
+            profiler.RegisterThread ("worker");
+            branch ();
+          });
+        worker.join ();
+        profiler.EndFrame ();
+        profiler.Flush ();
+        is (recorder.Zones (3, "worker").size (), 3u,
+            "Each thread gets its own call tree.");
+        is (recorder.frames.back ().number, 3u, "Frames are numbered.");
+      }
+      ok (ZoneProfiler::GetActive () == nullptr,
+          "Zones stop being recorded when the ZoneProfiler goes away.");
+
+      // A buffer too small for the frame.
+      {
+        FrameRecorder recorder;
+        ZoneProfiler profiler (std::ref (recorder), 64);
+        for (int i = 0; i < 100; ++i)
+          branch ();
+        profiler.EndFrame ();
+        profiler.Flush ();
+
+        const ZoneFrame &frame = recorder.frames[0];
+        bool complete = true;
+        std::size_t recorded = 0;
+        for (auto &thread : frame.threads)
+          for (auto &zone : thread.zones)
+            {
+              ++recorded;
+              if (zone.end >= frame.end)
+                complete = false;
+            }
+        ok (complete && frame.dropped == 300 - recorded &&
+            profiler.GetDropped () == frame.dropped,
+            "Zones that don't fit are dropped and counted, and the rest are "
+            "whole.");
+      }
+    }
+  } test;
+
+  return test.run ();
+}
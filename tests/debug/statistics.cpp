@@ -0,0 +1,81 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#ifdef __GNUC__
+#  define CIPRA_CXX_ABI
+#endif
+#define CIPRA_USE_VARIADIC_TEMPLATES
+#include <cipra.hpp>
+
+#include "debug/statistics.hpp"
+using namespace hummstrummengine::debug;
+
+int
+main ()
+{
+  struct StatisticsTest : cipra::fixture
+  {
+    virtual void
+    test () override
+    {
+      plan (10);
+      typedef std::chrono::nanoseconds ns;
+
+      AllRunStatistics<ns> all;
+      HistogramStatistics<ns> histogram;
+      for (std::int64_t i = 1; i <= 100000; ++i)
+        {
+          all.Add (ns (i * 10));
+          histogram.Add (ns (i * 10));
+        }
+
+      is (histogram.GetCount (), all.GetCount (),
+          "Both policies count every run.");
+      ok (histogram.GetMin () == ns (10) && histogram.GetMax () == ns (1000000),
+          "The minimum and maximum are exact.");
+      ok (std::fabs (histogram.GetMean ().count () - 500005.0) < 1e-3,
+          "The running mean is exact.");
+      ok (all.GetMean () == ns (500005), "The mean of all runs is exact.");
+      // The sample standard deviation of 10, 20, ..., 10n.
+      double deviation = 10 * std::sqrt (100000.0 * 100001.0 / 12.0);
+      ok (std::fabs (histogram.GetStandardDeviation ().count () - deviation) <
+          1e-3 * deviation, "The standard deviation is right.");
+
+      // With 5 bits of precision, each bucket is at most 1/32 as wide as
+      // the values in it.
+      const double fractions[] = { 0.5, 0.9, 0.99, 0.999 };
+      for (double fraction : fractions)
+        {
+          double exact = fraction * 1000000;
+          double error = std::fabs (histogram.GetPercentile (fraction).count () -
+                                    exact) / exact;
+          ok (error < 1.0 / 32, "Percentiles are within a bucket.");
+        }
+
+      HistogramStatistics<ns> empty;
+      ok (empty.GetCount () == 0 && empty.GetPercentile (0.5) == ns (0),
+          "An empty histogram has no runs.");
+    }
+  } test;
+
+  return test.run ();
+}
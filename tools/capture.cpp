@@ -0,0 +1,136 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// hummstrumm-capture -- Captures the zones and metrics that a running program
+// streams with ProfileStreamServer, into a Chrome trace that chrome://tracing
+// and Perfetto can open, or into a raw capture that this tool can read again.
+//
+// Usage: hummstrumm-capture [--chrome FILE] [--raw FILE] [--frames N] [ADDRESS]
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug;
+using namespace hummstrummengine::debug::profiling;
+
+namespace {
+
+int
+usage (const char *program)
+{
+  std::cerr << "Usage: " << program << " [--chrome FILE] [--raw FILE] "
+            << "[--frames N] [ADDRESS]\n"
+            << "Captures the frames a running program streams with a "
+            << "ProfileStreamServer\n"
+            << "(by default, at " << profilestream::defaultAddress
+            << ") until it stops streaming.\n\n"
+            << "  --chrome FILE  write a Chrome trace (by default, "
+            << "hummstrummengine-trace.json)\n"
+            << "  --raw FILE     save the stream as it is, to read later "
+            << "with file:FILE\n"
+            << "  --frames N     stop after N frames\n\n"
+            << "ADDRESS is unix:PATH, tcp:PORT, or file:FILE for a saved "
+            << "stream.\n";
+  return EXIT_FAILURE;
+}
+
+}
+
+int
+main (int argc, char **argv)
+{
+  std::string chrome;
+  std::string raw;
+  unsigned long long frames = 0;
+  std::string address = profilestream::defaultAddress;
+  bool haveAddress = false;
+  for (int i = 1; i < argc; ++i)
+    {
+      if (std::strcmp (argv[i], "--chrome") == 0 && i + 1 < argc)
+        {
+          chrome = argv[++i];
+        }
+      else if (std::strcmp (argv[i], "--raw") == 0 && i + 1 < argc)
+        {
+          raw = argv[++i];
+        }
+      else if (std::strcmp (argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+          char *end;
+          frames = std::strtoull (argv[++i], &end, 10);
+          if (*end != '\0' || frames == 0)
+            return usage (argv[0]);
+        }
+      else if (!haveAddress && argv[i][0] != '-')
+        {
+          address = argv[i];
+          haveAddress = true;
+        }
+      else
+        {
+          return usage (argv[0]);
+        }
+    }
+  // Without anywhere else to go, the frames go to a Chrome trace.
+  if (chrome.empty () && raw.empty ())
+    chrome = "hummstrummengine-trace.json";
+
+  try
+    {
+      ProfileStreamReader reader (address, raw);
+      std::unique_ptr<ChromeTraceWriter> trace;
+      if (!chrome.empty ())
+        trace.reset (new ChromeTraceWriter (chrome));
+
+      ZoneFrame frame;
+      std::vector<MetricValue> metrics;
+      unsigned long long read = 0;
+      unsigned long long zones = 0;
+      while ((frames == 0 || read < frames) && reader.Next (frame, metrics))
+        {
+          ++read;
+          for (auto &thread : frame.threads)
+            zones += thread.zones.size ();
+          if (trace)
+            {
+              (*trace) (frame);
+              for (auto &metric : metrics)
+                trace->AddCounter (metric.name, frame.end, metric.value);
+            }
+        }
+
+      std::cerr << read << (read == 1 ? " frame" : " frames") << " with "
+                << zones << (zones == 1 ? " zone" : " zones")
+                << " captured; " << reader.GetDropped ()
+                << " dropped by the program.\n";
+    }
+  catch (const std::exception &e)
+    {
+      std::cerr << argv[0] << ": " << e.what () << "\n";
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// hummstrumm-logdump -- Turns a log written by BinaryFileBackend into the XML
+// that FileBackend writes, or into the text that ConsoleBackend prints.
+//
+// Usage: hummstrumm-logdump [--xml | --text] FILE
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug::logging;
+
+namespace {
+
+int
+usage (const char *program)
+{
+  std::cerr << "Usage: " << program << " [--xml | --text] FILE\n"
+            << "Prints a binary Humm and Strumm log as XML (the default) or "
+            << "as text.\n";
+  return EXIT_FAILURE;
+}
+
+}
+
+int
+main (int argc, char **argv)
+{
+  bool xml = true;
+  const char *path = nullptr;
+  for (int i = 1; i < argc; ++i)
+    {
+      if (std::strcmp (argv[i], "--xml") == 0)
+        xml = true;
+      else if (std::strcmp (argv[i], "--text") == 0)
+        xml = false;
+      else if (!path && argv[i][0] != '-')
+        path = argv[i];
+      else
+        return usage (argv[0]);
+    }
+  if (!path)
+    return usage (argv[0]);
+
+  std::ifstream in (path, std::ios_base::in | std::ios_base::binary);
+  if (!in)
+    {
+      std::cerr << argv[0] << ": cannot open " << path << "\n";
+      return EXIT_FAILURE;
+    }
+
+  try
+    {
+      BinaryLogReader reader (in);
+      std::ostream &out = std::cout;
+      // Same as the timestamps FileBackend and ConsoleBackend write.
+      TimestampFormatter timestamps;
+
+      if (xml)
+        {
+          out << "<?xml version=\"1.1\" encoding=\"utf-8\"?>\n\n"
+              << "<log timestamp=\""
+              << timestamps.Format (static_cast<std::uint64_t> (
+                                      reader.GetEpoch ()) * 1000000000u)
+              << "\">\n";
+        }
+
+      Record record;
+      while (reader.Next (record))
+        {
+          const char *tbuffer = timestamps.Format (record.timestamp);
+          if (xml)
+            {
+              out << "<message timestamp=\"" << tbuffer << "\" thread=\""
+                  << record.thread << "\" file=\"" << record.file
+                  << "\" line=\"" << record.line << "\" level=\""
+                  << GetLevelName (record.level) << "\">\n";
+              out.write (record.message, record.messageLength);
+              out << "\n</message>\n";
+            }
+          else
+            {
+              out << "[ " << tbuffer << " ] " << record.file << "("
+                  << record.line << ")\n\t";
+              out.write (record.message, record.messageLength);
+              out << '\n';
+            }
+        }
+
+      if (xml)
+        out << "</log>\n";
+      out.flush ();
+    }
+  catch (const std::exception &e)
+    {
+      std::cerr << argv[0] << ": " << path << ": " << e.what () << "\n";
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
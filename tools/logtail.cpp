@@ -0,0 +1,184 @@
+// -*- mode: c++; c-file-style: hummstrumm -*-
+/* Humm and Strumm Engine
+ * Copyright (C) 2008-2014, the people listed in the AUTHORS file.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// hummstrumm-logtail -- Shows the log messages that a running program publishes
+// with SharedMemoryBackend, as they come, in the colors ConsoleBackend uses.
+//
+// Usage: hummstrumm-logtail [--level LEVEL,...] [--file TEXT] [--lines N]
+//                           [--no-color] [NAME]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "hummstrummengine.hpp"
+using namespace hummstrummengine::debug::logging;
+
+namespace {
+
+// How long to wait before looking for new messages again.
+const std::chrono::milliseconds POLL_INTERVAL (10);
+
+// Parses a comma separated list of level names.  Returns Level::none if one of
+// them isn't a level.
+Level
+parseLevels (const char *text)
+{
+  Level levels = Level::none;
+  std::string names (text);
+  std::string::size_type start = 0;
+  while (start <= names.size ())
+    {
+      std::string::size_type end = names.find (',', start);
+      if (end == std::string::npos)
+        end = names.size ();
+      std::string name = names.substr (start, end - start);
+      if (name == "info")
+        levels = levels | Level::info;
+      else if (name == "success")
+        levels = levels | Level::success;
+      else if (name == "warning")
+        levels = levels | Level::warning;
+      else if (name == "error")
+        levels = levels | Level::error;
+      else if (name == "all")
+        levels = levels | Level::all;
+      else
+        return Level::none;
+      start = end + 1;
+    }
+  return levels;
+}
+
+int
+usage (const char *program)
+{
+  std::cerr << "Usage: " << program << " [--level LEVEL,...] [--file TEXT] "
+            << "[--lines N] [--no-color] [NAME]\n"
+            << "Shows the log messages a running program publishes with a "
+            << "SharedMemoryBackend\n"
+            << "(by default, /hummstrummengine) until the program stops.\n\n"
+            << "  --level LEVEL,...  only show info, success, warning, or "
+            << "error messages\n"
+            << "  --file TEXT        only show messages from files whose name "
+            << "contains TEXT\n"
+            << "  --lines N          start with the last N messages (default "
+            << "10)\n"
+            << "  --no-color         don't color the messages\n";
+  return EXIT_FAILURE;
+}
+
+}
+
+int
+main (int argc, char **argv)
+{
+  Level levels = Level::all;
+  const char *file = nullptr;
+  unsigned long lines = 10;
+  bool color = true;
+  const char *name = "/hummstrummengine";
+  bool haveName = false;
+  for (int i = 1; i < argc; ++i)
+    {
+      if (std::strcmp (argv[i], "--level") == 0 && i + 1 < argc)
+        {
+          levels = parseLevels (argv[++i]);
+          if (levels == Level::none)
+            return usage (argv[0]);
+        }
+      else if (std::strcmp (argv[i], "--file") == 0 && i + 1 < argc)
+        {
+          file = argv[++i];
+        }
+      else if (std::strcmp (argv[i], "--lines") == 0 && i + 1 < argc)
+        {
+          char *end;
+          lines = std::strtoul (argv[++i], &end, 10);
+          if (*end != '\0')
+            return usage (argv[0]);
+        }
+      else if (std::strcmp (argv[i], "--no-color") == 0)
+        {
+          color = false;
+        }
+      else if (!haveName && argv[i][0] != '-')
+        {
+          name = argv[i];
+          haveName = true;
+        }
+      else
+        {
+          return usage (argv[0]);
+        }
+    }
+
+  try
+    {
+      SharedMemoryReader reader (name, lines);
+      TimestampFormatter timestamps;
+      std::ostream &out = std::cout;
+      std::uint64_t missed = 0;
+
+      for (;;)
+        {
+          // Check before reading, so messages published just before the
+          // program stopped are still shown.
+          bool closed = reader.IsClosed ();
+
+          Record record;
+          bool any = false;
+          while (reader.Next (record))
+            {
+              any = true;
+              if (reader.GetMissed () != missed)
+                {
+                  std::uint64_t count = reader.GetMissed () - missed;
+                  out << "[ " << count
+                      << (count == 1 ? " message" : " messages")
+                      << " missed ]\n";
+                  missed = reader.GetMissed ();
+                }
+              if ((record.level & levels) == Level::none ||
+                  (file && !std::strstr (record.file, file)))
+                continue;
+              ConsoleBackend::Print (out, record, timestamps, color);
+            }
+
+          if (closed)
+            break;
+          if (any)
+            out.flush ();
+          else
+            std::this_thread::sleep_for (POLL_INTERVAL);
+        }
+      out.flush ();
+    }
+  catch (const std::exception &e)
+    {
+      std::cerr << argv[0] << ": " << e.what () << "\n";
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}